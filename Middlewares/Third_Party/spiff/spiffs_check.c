@@ -58,6 +58,19 @@ static s32_t spiffs_object_get_data_page_index_reference(
   res = spiffs_obj_lu_find_id_and_span(fs, obj_id | SPIFFS_OBJ_ID_IX_FLAG, objix_spix, 0, objix_pix);
   SPIFFS_CHECK_RES(res);
 
+#if SPIFFS_INLINE_DATA
+  if (objix_spix == 0) {
+    spiffs_page_header objix_p_hdr;
+    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ,
+        0, SPIFFS_PAGE_TO_PADDR(fs, *objix_pix), sizeof(spiffs_page_header), (u8_t *)&objix_p_hdr);
+    SPIFFS_CHECK_RES(res);
+    if ((objix_p_hdr.flags & SPIFFS_PH_FLAG_INLINE) == 0) {
+      // object data is inline in the header, no data page is referenced
+      return SPIFFS_ERR_NOT_FOUND;
+    }
+  }
+#endif
+
   // load obj index entry
   u32_t addr = SPIFFS_PAGE_TO_PADDR(fs, *objix_pix);
   if (objix_spix == 0) {
@@ -300,14 +313,14 @@ static s32_t spiffs_lookup_check_validate(spiffs *fs, spiffs_obj_id lu_obj_id, s
             res = spiffs_obj_lu_find_id_and_span(fs, lu_obj_id & ~SPIFFS_OBJ_ID_IX_FLAG, 0, 0, &data_pix_lu);
             if (res == SPIFFS_ERR_NOT_FOUND) {
               res = SPIFFS_OK;
-              objix_pix_lu = 0;
+              data_pix_lu = 0;
             }
             SPIFFS_CHECK_RES(res);
             // see if other data page exists for page header obj id and span index
             res = spiffs_obj_lu_find_id_and_span(fs, p_hdr->obj_id & ~SPIFFS_OBJ_ID_IX_FLAG, 0, 0, &data_pix_ph);
             if (res == SPIFFS_ERR_NOT_FOUND) {
               res = SPIFFS_OK;
-              objix_pix_ph = 0;
+              data_pix_ph = 0;
             }
             SPIFFS_CHECK_RES(res);
 
@@ -573,6 +586,25 @@ static s32_t spiffs_page_consistency_check_i(spiffs *fs) {
             entries = SPIFFS_OBJ_HDR_IX_LEN(fs);
             data_spix_offset = 0;
             object_page_index = (spiffs_page_ix *)((u8_t *)fs->lu_work + sizeof(spiffs_page_object_ix_header));
+#if SPIFFS_INLINE_DATA
+            if ((p_hdr.flags & SPIFFS_PH_FLAG_INLINE) == 0) {
+              // object data is inline, header holds no index entries
+              entries = 0;
+            }
+#endif
+#if SPIFFS_RING_FILES
+            if (((spiffs_page_object_ix_header *)fs->lu_work)->type == SPIFFS_TYPE_RING) {
+              // only the ring pages are references, the last entry holds
+              // their number and the ones between log appends
+              entries = MIN(object_page_index[SPIFFS_RING_MAX_PAGES(fs)], SPIFFS_RING_MAX_PAGES(fs));
+            }
+#endif
+#if SPIFFS_TXN
+            if (((spiffs_page_object_ix_header *)fs->lu_work)->type == SPIFFS_TYPE_TXN_MARKER) {
+              // marker entries are object ids, not pages
+              entries = 0;
+            }
+#endif
           } else {
             // object page index
             entries = SPIFFS_OBJ_IX_LEN(fs);
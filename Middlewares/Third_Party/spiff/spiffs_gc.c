@@ -195,6 +195,111 @@ s32_t spiffs_gc_check(
   return res;
 }
 
+// Cleans blocks until an append of len bytes in writes of write_len bytes
+// allocates from free blocks only, with the spare blocks spiffs_gc_check
+// demands left over, so that none of the appends runs the gc.
+// Each append allocates its data pages, the object index pages it starts
+// and a new copy of the object index header page.
+s32_t spiffs_gc_reserve(
+    spiffs *fs,
+    u32_t len,
+    u32_t write_len) {
+  s32_t res = SPIFFS_OK;
+  u32_t pages_per_block = SPIFFS_PAGES_PER_BLOCK(fs) - SPIFFS_OBJ_LOOKUP_PAGES(fs);
+  u32_t data_pages = (len + SPIFFS_DATA_PAGE_SIZE(fs) - 1) / SPIFFS_DATA_PAGE_SIZE(fs);
+  u32_t writes = write_len == 0 ? data_pages : (len + write_len - 1) / write_len;
+  u32_t pages = data_pages + writes +
+      (data_pages + SPIFFS_OBJ_IX_LEN(fs) - 1) / SPIFFS_OBJ_IX_LEN(fs);
+  // spiffs_gc_check runs the gc once 3 blocks or less are free
+  u32_t needed_blocks = 4 + (pages + pages_per_block - 1) / pages_per_block;
+  u32_t tries = 0;
+
+  if (needed_blocks > fs->block_count) {
+    return SPIFFS_ERR_FULL;
+  }
+
+  // erasing fully deleted blocks moves nothing, try it first
+  while (res == SPIFFS_OK && fs->free_blocks < needed_blocks) {
+    res = spiffs_gc_quick(fs, 0);
+  }
+  if (res != SPIFFS_OK && res != SPIFFS_ERR_NO_DELETED_BLOCKS) {
+    return res;
+  }
+  res = SPIFFS_OK;
+
+  while (fs->free_blocks < needed_blocks && tries++ < fs->block_count) {
+    spiffs_block_ix *cands;
+    int count;
+    spiffs_block_ix cand;
+    u32_t prev_free_blocks = fs->free_blocks;
+
+    res = spiffs_gc_find_candidate(fs, &cands, &count, 0);
+    SPIFFS_CHECK_RES(res);
+    if (count == 0) {
+      break;
+    }
+    cand = cands[0];
+    SPIFFS_GC_DBG("gc_reserve: cleaning block "_SPIPRIbl", "_SPIPRIi" of "_SPIPRIi" free blocks\n",
+        cand, fs->free_blocks, needed_blocks);
+#if SPIFFS_GC_STATS
+    fs->stats_gc_runs++;
+#endif
+    fs->cleaning = 1;
+    res = spiffs_gc_clean(fs, cand);
+    fs->cleaning = 0;
+    SPIFFS_CHECK_RES(res);
+
+    res = spiffs_gc_erase_page_stats(fs, cand);
+    SPIFFS_CHECK_RES(res);
+
+    res = spiffs_gc_erase_block(fs, cand);
+    SPIFFS_CHECK_RES(res);
+
+    if (fs->free_blocks <= prev_free_blocks && fs->stats_p_deleted == 0) {
+      // only live pages left to move around
+      break;
+    }
+  }
+
+  return fs->free_blocks < needed_blocks ? SPIFFS_ERR_FULL : SPIFFS_OK;
+}
+
+// Erases the block of given page right away if all other pages of the block
+// are deleted, so that an object dropping its oldest pages frees whole blocks
+// as it goes, without the gc. The page itself may be in use or deleted.
+// Returns SPIFFS_ERR_NO_DELETED_BLOCKS if the block holds other pages.
+s32_t spiffs_gc_erase_if_dead(
+    spiffs *fs,
+    spiffs_page_ix pix) {
+  s32_t res = SPIFFS_OK;
+  spiffs_block_ix bix = SPIFFS_BLOCK_FOR_PAGE(fs, pix);
+  int pix_entry = SPIFFS_OBJ_LOOKUP_ENTRY_FOR_PAGE(fs, pix);
+  int obj_lookup_page = 0;
+  int entries_per_page = (SPIFFS_CFG_LOG_PAGE_SZ(fs) / sizeof(spiffs_obj_id));
+  spiffs_obj_id *obj_lu_buf = (spiffs_obj_id *)fs->lu_work;
+  int cur_entry = 0;
+
+  // check each object lookup page, stop at the first page not deleted
+  while (obj_lookup_page < (int)SPIFFS_OBJ_LOOKUP_PAGES(fs)) {
+    int entry_offset = obj_lookup_page * entries_per_page;
+    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU | SPIFFS_OP_C_READ,
+        0, bix * SPIFFS_CFG_LOG_BLOCK_SZ(fs) + SPIFFS_PAGE_TO_PADDR(fs, obj_lookup_page), SPIFFS_CFG_LOG_PAGE_SZ(fs), fs->lu_work);
+    SPIFFS_CHECK_RES(res);
+    while (cur_entry - entry_offset < entries_per_page && cur_entry < (int)(SPIFFS_PAGES_PER_BLOCK(fs)-SPIFFS_OBJ_LOOKUP_PAGES(fs))) {
+      if (cur_entry != pix_entry && obj_lu_buf[cur_entry-entry_offset] != SPIFFS_OBJ_ID_DELETED) {
+        return SPIFFS_ERR_NO_DELETED_BLOCKS;
+      }
+      cur_entry++;
+    } // per entry
+    obj_lookup_page++;
+  } // per object lookup page
+
+  SPIFFS_GC_DBG("gc_erase_if_dead: block "_SPIPRIbl" left with page "_SPIPRIpg" only\n", bix, pix);
+  res = spiffs_gc_erase_page_stats(fs, bix);
+  SPIFFS_CHECK_RES(res);
+  return spiffs_gc_erase_block(fs, bix);
+}
+
 // Updates page statistics for a block that is about to be erased
 s32_t spiffs_gc_erase_page_stats(
     spiffs *fs,
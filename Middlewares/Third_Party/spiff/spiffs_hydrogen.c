@@ -11,6 +11,9 @@
 #if SPIFFS_CACHE == 1
 static s32_t spiffs_fflush_cache(spiffs *fs, spiffs_file fh);
 #endif
+#if SPIFFS_COMPRESSED_FILES && !SPIFFS_READ_ONLY
+static s32_t spiffs_fflush_compress(spiffs *fs, spiffs_file fh);
+#endif
 
 #if SPIFFS_BUFFER_HELP
 u32_t SPIFFS_buffer_bytes_for_filedescs(spiffs *fs, u32_t num_descs) {
@@ -21,6 +24,12 @@ u32_t SPIFFS_buffer_bytes_for_cache(spiffs *fs, u32_t num_pages) {
   return sizeof(spiffs_cache) + num_pages * (sizeof(spiffs_cache_page) + SPIFFS_CFG_LOG_PAGE_SZ(fs));
 }
 #endif
+#if SPIFFS_COMPRESSED_FILES
+u32_t SPIFFS_buffer_bytes_for_compress(spiffs *fs, u32_t raw_len) {
+  return sizeof(spiffs_compress) + (sizeof(u16_t) << SPIFFS_COMPRESS_HASH_BITS) +
+      SPIFFS_CFG_LOG_PAGE_SZ(fs) + raw_len;
+}
+#endif
 #endif
 
 u8_t SPIFFS_mounted(spiffs *fs) {
@@ -141,6 +150,12 @@ s32_t SPIFFS_mount(spiffs *fs, spiffs_config *config, u8_t *work,
   SPIFFS_DBG("available file descriptors:  "_SPIPRIi"\n", (u32_t)fs->fd_count);
   SPIFFS_DBG("free blocks:                 "_SPIPRIi"\n", (u32_t)fs->free_blocks);
 
+#if SPIFFS_TXN && !SPIFFS_READ_ONLY
+  // finish any transaction interrupted by power loss
+  res = spiffs_txn_recover(fs);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+#endif
+
   fs->check_cb_f = check_cb_f;
 
   fs->mounted = 1;
@@ -161,6 +176,9 @@ void SPIFFS_unmount(spiffs *fs) {
     if (cur_fd->file_nbr != 0) {
 #if SPIFFS_CACHE
       (void)spiffs_fflush_cache(fs, cur_fd->file_nbr);
+#endif
+#if SPIFFS_COMPRESSED_FILES && !SPIFFS_READ_ONLY
+      (void)spiffs_fflush_compress(fs, cur_fd->file_nbr);
 #endif
       spiffs_fd_return(fs, cur_fd->file_nbr);
     }
@@ -204,6 +222,63 @@ s32_t SPIFFS_creat(spiffs *fs, const char *path, spiffs_mode mode) {
 #endif // SPIFFS_READ_ONLY
 }
 
+#if SPIFFS_RING_FILES
+s32_t SPIFFS_ring_create(spiffs *fs, const char *path, u32_t capacity) {
+  SPIFFS_API_DBG("%s '%s' "_SPIPRIi "\n", __func__, path, capacity);
+#if SPIFFS_READ_ONLY
+  (void)fs; (void)path; (void)capacity;
+  return SPIFFS_ERR_RO_NOT_IMPL;
+#else
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  if (strlen(path) > SPIFFS_OBJ_NAME_LEN - 1) {
+    SPIFFS_API_CHECK_RES(fs, SPIFFS_ERR_NAME_TOO_LONG);
+  }
+  // one page more than the capacity needs: the tail moves a whole page at a
+  // time, so the head page may be almost empty when the oldest one is dropped
+  u32_t pages = (capacity + SPIFFS_DATA_PAGE_SIZE(fs) - 1) / SPIFFS_DATA_PAGE_SIZE(fs) + 1;
+  if (capacity == 0 || pages > SPIFFS_RING_MAX_PAGES(fs)) {
+    SPIFFS_API_CHECK_RES(fs, SPIFFS_ERR_RING_CAPACITY);
+  }
+  SPIFFS_LOCK(fs);
+  spiffs_obj_id obj_id;
+  s32_t res;
+
+  res = spiffs_obj_lu_find_free_obj_id(fs, &obj_id, (const u8_t*)path);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+  res = spiffs_object_ring_create(fs, obj_id, (const u8_t*)path, pages, 0);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+  SPIFFS_UNLOCK(fs);
+  return 0;
+#endif // SPIFFS_READ_ONLY
+}
+
+s32_t SPIFFS_ring_cursors(spiffs *fs, spiffs_file fh, u32_t *tail, u32_t *head) {
+  SPIFFS_API_DBG("%s "_SPIPRIfd "\n", __func__, fh);
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  SPIFFS_LOCK(fs);
+
+  spiffs_fd *fd;
+  s32_t res;
+
+  fh = SPIFFS_FH_UNOFFS(fs, fh);
+  res = spiffs_fd_get(fs, fh, &fd);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+
+  if (fd->ring_pages == 0) {
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, SPIFFS_ERR_NOT_A_FILE);
+  }
+
+  u32_t cur_head = fd->size == SPIFFS_UNDEFINED_LEN ? 0 : fd->size;
+  if (tail) *tail = SPIFFS_RING_TAIL(fs, cur_head, fd->ring_pages);
+  if (head) *head = cur_head;
+
+  SPIFFS_UNLOCK(fs);
+  return res;
+}
+#endif // SPIFFS_RING_FILES
+
 spiffs_file SPIFFS_open(spiffs *fs, const char *path, spiffs_flags flags, spiffs_mode mode) {
   SPIFFS_API_DBG("%s '%s' "_SPIPRIfl "\n", __func__, path, flags);
   (void)mode;
@@ -225,6 +300,25 @@ spiffs_file SPIFFS_open(spiffs *fs, const char *path, spiffs_flags flags, spiffs
   s32_t res = spiffs_fd_find_new(fs, &fd, path);
   SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
 
+#if SPIFFS_TXN && !SPIFFS_READ_ONLY
+  if (flags & SPIFFS_O_SHADOW) {
+    // always a new object, the current version is left as is
+    res = spiffs_txn_shadow_open(fs, fd, (const u8_t*)path, flags, mode);
+#if SPIFFS_COMPRESSED_FILES
+    if (res == SPIFFS_OK) {
+      res = spiffs_object_compress_claim(fd);
+    }
+#endif
+    if (res < SPIFFS_OK) {
+      spiffs_fd_return(fs, fd->file_nbr);
+    }
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+    fd->fdoffset = 0;
+    SPIFFS_UNLOCK(fs);
+    return SPIFFS_FH_OFFS(fs, fd->file_nbr);
+  }
+#endif
+
   res = spiffs_object_find_object_index_header_by_name(fs, (const u8_t*)path, &pix);
   if ((flags & SPIFFS_O_CREAT) == 0) {
     if (res < SPIFFS_OK) {
@@ -250,7 +344,13 @@ spiffs_file SPIFFS_open(spiffs *fs, const char *path, spiffs_flags flags, spiffs
       spiffs_fd_return(fs, fd->file_nbr);
     }
     SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
-    res = spiffs_object_create(fs, obj_id, (const u8_t*)path, 0, SPIFFS_TYPE_FILE, &pix);
+    u8_t type = SPIFFS_TYPE_FILE;
+#if SPIFFS_COMPRESSED_FILES
+    if (flags & SPIFFS_O_COMPRESS) {
+      type = SPIFFS_TYPE_COMPRESSED;
+    }
+#endif
+    res = spiffs_object_create(fs, obj_id, (const u8_t*)path, 0, type, &pix);
     if (res < SPIFFS_OK) {
       spiffs_fd_return(fs, fd->file_nbr);
     }
@@ -264,6 +364,11 @@ spiffs_file SPIFFS_open(spiffs *fs, const char *path, spiffs_flags flags, spiffs
     SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
   }
   res = spiffs_object_open_by_page(fs, pix, fd, flags, mode);
+#if SPIFFS_COMPRESSED_FILES
+  if (res == SPIFFS_OK) {
+    res = spiffs_object_compress_claim(fd);
+  }
+#endif
   if (res < SPIFFS_OK) {
     spiffs_fd_return(fs, fd->file_nbr);
   }
@@ -297,6 +402,11 @@ spiffs_file SPIFFS_open_by_dirent(spiffs *fs, struct spiffs_dirent *e, spiffs_fl
   SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
 
   res = spiffs_object_open_by_page(fs, e->pix, fd, flags, mode);
+#if SPIFFS_COMPRESSED_FILES
+  if (res == SPIFFS_OK) {
+    res = spiffs_object_compress_claim(fd);
+  }
+#endif
   if (res < SPIFFS_OK) {
     spiffs_fd_return(fs, fd->file_nbr);
   }
@@ -343,6 +453,11 @@ spiffs_file SPIFFS_open_by_page(spiffs *fs, spiffs_page_ix page_ix, spiffs_flags
       res == SPIFFS_ERR_INDEX_SPAN_MISMATCH) {
     res = SPIFFS_ERR_NOT_A_FILE;
   }
+#if SPIFFS_COMPRESSED_FILES
+  if (res == SPIFFS_OK) {
+    res = spiffs_object_compress_claim(fd);
+  }
+#endif
   if (res < SPIFFS_OK) {
     spiffs_fd_return(fs, fd->file_nbr);
   }
@@ -382,12 +497,32 @@ static s32_t spiffs_hydro_read(spiffs *fs, spiffs_file fh, void *buf, s32_t len)
     SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
   }
 
+#if SPIFFS_COMPRESSED_FILES
+  if (fd->flags & SPIFFS_O_COMPRESS) {
+    res = spiffs_object_compress_read(fd, fd->fdoffset, len, (u8_t*)buf);
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+    fd->fdoffset += res;
+    SPIFFS_UNLOCK(fs);
+    return res;
+  }
+#endif
+
   if (fd->size == SPIFFS_UNDEFINED_LEN && len > 0) {
     // special case for zero sized files
     res = SPIFFS_ERR_END_OF_OBJECT;
     SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
   }
 
+#if SPIFFS_RING_FILES
+  if (fd->ring_pages) {
+    res = spiffs_object_ring_read(fd, fd->fdoffset, len, (u8_t*)buf);
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+    fd->fdoffset += res;
+    SPIFFS_UNLOCK(fs);
+    return res;
+  }
+#endif
+
 #if SPIFFS_CACHE_WR
   spiffs_fflush_cache(fs, fh);
 #endif
@@ -434,6 +569,16 @@ static s32_t spiffs_hydro_write(spiffs *fs, spiffs_fd *fd, void *buf, u32_t offs
   (void)fs;
   s32_t res = SPIFFS_OK;
   s32_t remaining = len;
+#if SPIFFS_INLINE_DATA
+  if (len > 0) {
+    u8_t inlined;
+    res = spiffs_object_inline_write(fd, offset, (u8_t *)buf, len, &inlined);
+    SPIFFS_CHECK_RES(res);
+    if (inlined) {
+      return len;
+    }
+  }
+#endif
   if (fd->size != SPIFFS_UNDEFINED_LEN && offset < fd->size) {
     s32_t m_len = MIN((s32_t)(fd->size - offset), len);
     res = spiffs_object_modify(fd, offset, (u8_t *)buf, m_len);
@@ -480,6 +625,35 @@ s32_t SPIFFS_write(spiffs *fs, spiffs_file fh, void *buf, s32_t len) {
     fd->fdoffset = fd->size == SPIFFS_UNDEFINED_LEN ? 0 : fd->size;
   }
 
+#if SPIFFS_COMPRESSED_FILES
+  if (fd->flags & SPIFFS_O_COMPRESS) {
+    // compressed files always append, and bypass the write cache
+    u32_t size;
+    if (len > 0) {
+      res = spiffs_object_compress_append(fd, (u8_t *)buf, len);
+      SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+    }
+    res = spiffs_object_compress_size(fd, &size);
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+    fd->fdoffset = size;
+    SPIFFS_UNLOCK(fs);
+    return len;
+  }
+#endif
+
+#if SPIFFS_RING_FILES
+  if (fd->ring_pages) {
+    // rings always append, and bypass the write cache
+    if (len > 0) {
+      res = spiffs_object_ring_append(fd, (u8_t *)buf, len);
+      SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+    }
+    fd->fdoffset = fd->size == SPIFFS_UNDEFINED_LEN ? 0 : fd->size;
+    SPIFFS_UNLOCK(fs);
+    return len;
+  }
+#endif
+
   offset = fd->fdoffset;
 
 #if SPIFFS_CACHE_WR
@@ -594,7 +768,7 @@ s32_t SPIFFS_write(spiffs *fs, spiffs_file fh, void *buf, s32_t len) {
 }
 
 s32_t SPIFFS_lseek(spiffs *fs, spiffs_file fh, s32_t offs, int whence) {
-  SPIFFS_API_DBG("%s "_SPIPRIfd " "_SPIPRIi " %s\n", __func__, fh, offs, (const char* []){"SET","CUR","END","???"}[MIN(whence,3)]);
+  SPIFFS_API_DBG("%s "_SPIPRIfd " "_SPIPRIi " %s\n", __func__, fh, offs, ((const char* []){"SET","CUR","END","???"})[MIN(whence,3)]);
   SPIFFS_API_CHECK_CFG(fs);
   SPIFFS_API_CHECK_MOUNT(fs);
   SPIFFS_LOCK(fs);
@@ -610,6 +784,15 @@ s32_t SPIFFS_lseek(spiffs *fs, spiffs_file fh, s32_t offs, int whence) {
 #endif
 
   s32_t file_size = fd->size == SPIFFS_UNDEFINED_LEN ? 0 : fd->size;
+#if SPIFFS_COMPRESSED_FILES
+  if (fd->flags & SPIFFS_O_COMPRESS) {
+    // offsets are uncompressed, the frame is located when reading
+    u32_t size;
+    res = spiffs_object_compress_size(fd, &size);
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+    file_size = size;
+  }
+#endif
 
   switch (whence) {
   case SPIFFS_SEEK_CUR:
@@ -628,8 +811,22 @@ s32_t SPIFFS_lseek(spiffs *fs, spiffs_file fh, s32_t offs, int whence) {
   }
   SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
 
+#if SPIFFS_COMPRESSED_FILES
+  if (fd->flags & SPIFFS_O_COMPRESS) {
+    fd->fdoffset = offs;
+    SPIFFS_UNLOCK(fs);
+    return offs;
+  }
+#endif
+
   spiffs_span_ix data_spix = (offs > 0 ? (offs-1) : 0) / SPIFFS_DATA_PAGE_SIZE(fs);
   spiffs_span_ix objix_spix = SPIFFS_OBJ_IX_ENTRY_SPAN_IX(fs, data_spix);
+#if SPIFFS_RING_FILES
+  if (fd->ring_pages) {
+    // all ring data pages are referenced from the object index header
+    objix_spix = 0;
+  }
+#endif
   if (fd->cursor_objix_spix != objix_spix) {
     spiffs_page_ix pix;
     res = spiffs_obj_lu_find_id_and_span(
@@ -712,6 +909,18 @@ s32_t SPIFFS_fremove(spiffs *fs, spiffs_file fh) {
 #if SPIFFS_CACHE_WR
   spiffs_cache_fd_release(fs, fd->cache_page);
 #endif
+#if SPIFFS_COMPRESSED_FILES
+  // drop buffered bytes, nothing to flush on close
+  spiffs_object_compress_release(fs, fd);
+#endif
+
+#if SPIFFS_TXN
+  if ((fd->flags & SPIFFS_O_SHADOW) && fs->txn.state == SPIFFS_TXN_STATE_IMPLICIT) {
+    // nothing left to replace on close
+    fs->txn.count = 0;
+    fs->txn.state = SPIFFS_TXN_STATE_NONE;
+  }
+#endif
 
   res = spiffs_object_truncate(fd, 0, 1);
 
@@ -740,10 +949,16 @@ static s32_t spiffs_stat_pix(spiffs *fs, spiffs_page_ix pix, spiffs_file fh, spi
   s->obj_id = obj_id & ~SPIFFS_OBJ_ID_IX_FLAG;
   s->type = objix_hdr.type;
   s->size = objix_hdr.size == SPIFFS_UNDEFINED_LEN ? 0 : objix_hdr.size;
+#if SPIFFS_RING_FILES
+  if (objix_hdr.type == SPIFFS_TYPE_RING) {
+    res = spiffs_object_ring_head(fs, fh, pix, objix_hdr.size, &s->size, 0);
+    SPIFFS_API_CHECK_RES(fs, res);
+  }
+#endif
   s->pix = pix;
-  strncpy((char *)s->name, (char *)objix_hdr.name, SPIFFS_OBJ_NAME_LEN);
+  spiffs_object_hdr_name(&objix_hdr, s->name);
 #if SPIFFS_OBJ_META_LEN
-  _SPIFFS_MEMCPY(s->meta, objix_hdr.meta, SPIFFS_OBJ_META_LEN);
+  _SPIFFS_MEMCPY(s->meta, spiffs_object_hdr_meta(&objix_hdr), SPIFFS_OBJ_META_LEN);
 #endif
 
   return res;
@@ -789,6 +1004,12 @@ s32_t SPIFFS_fstat(spiffs *fs, spiffs_file fh, spiffs_stat *s) {
 #endif
 
   res = spiffs_stat_pix(fs, fd->objix_hdr_pix, fh, s);
+#if SPIFFS_COMPRESSED_FILES
+  if (res == SPIFFS_OK && (fd->flags & SPIFFS_O_COMPRESS)) {
+    res = spiffs_object_compress_size(fd, &s->size);
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+  }
+#endif
 
   SPIFFS_UNLOCK(fs);
 
@@ -831,17 +1052,37 @@ static s32_t spiffs_fflush_cache(spiffs *fs, spiffs_file fh) {
 }
 #endif
 
+#if SPIFFS_COMPRESSED_FILES && !SPIFFS_READ_ONLY
+// Writes bytes buffered for a compressed file to the medium
+static s32_t spiffs_fflush_compress(spiffs *fs, spiffs_file fh) {
+  spiffs_fd *fd;
+  s32_t res = spiffs_fd_get(fs, fh, &fd);
+  SPIFFS_API_CHECK_RES(fs, res);
+  res = spiffs_object_compress_flush(fd);
+  if (res < SPIFFS_OK) {
+    fs->err_code = res;
+  }
+  return res;
+}
+#endif
+
 s32_t SPIFFS_fflush(spiffs *fs, spiffs_file fh) {
   SPIFFS_API_DBG("%s "_SPIPRIfd "\n", __func__, fh);
   (void)fh;
   SPIFFS_API_CHECK_CFG(fs);
   SPIFFS_API_CHECK_MOUNT(fs);
   s32_t res = SPIFFS_OK;
-#if !SPIFFS_READ_ONLY && SPIFFS_CACHE_WR
+#if !SPIFFS_READ_ONLY && (SPIFFS_CACHE_WR || SPIFFS_COMPRESSED_FILES)
   SPIFFS_LOCK(fs);
   fh = SPIFFS_FH_UNOFFS(fs, fh);
+#if SPIFFS_CACHE_WR
   res = spiffs_fflush_cache(fs, fh);
   SPIFFS_API_CHECK_RES_UNLOCK(fs,res);
+#endif
+#if SPIFFS_COMPRESSED_FILES
+  res = spiffs_fflush_compress(fs, fh);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs,res);
+#endif
   SPIFFS_UNLOCK(fs);
 #endif
 
@@ -860,9 +1101,27 @@ s32_t SPIFFS_close(spiffs *fs, spiffs_file fh) {
 #if SPIFFS_CACHE
   res = spiffs_fflush_cache(fs, fh);
   SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+#endif
+#if SPIFFS_COMPRESSED_FILES && !SPIFFS_READ_ONLY
+  res = spiffs_fflush_compress(fs, fh);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+#endif
+#if SPIFFS_TXN && !SPIFFS_READ_ONLY
+  spiffs_fd *fd;
+  u8_t replace = 0;
+  if (fs->txn.state == SPIFFS_TXN_STATE_IMPLICIT && spiffs_fd_get(fs, fh, &fd) == SPIFFS_OK) {
+    replace = (fd->flags & SPIFFS_O_SHADOW) != 0;
+  }
 #endif
   res = spiffs_fd_return(fs, fh);
   SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+#if SPIFFS_TXN && !SPIFFS_READ_ONLY
+  if (replace) {
+    // replace on close, the fd just returned is free for the commit
+    res = spiffs_txn_commit(fs);
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+  }
+#endif
 
   SPIFFS_UNLOCK(fs);
 
@@ -1023,7 +1282,6 @@ static s32_t spiffs_read_dir_v(
     int ix_entry,
     const void *user_const_p,
     void *user_var_p) {
-  (void)user_const_p;
   s32_t res;
   spiffs_page_object_ix_header objix_hdr;
   if (obj_id == SPIFFS_OBJ_ID_FREE || obj_id == SPIFFS_OBJ_ID_DELETED ||
@@ -1038,22 +1296,38 @@ static s32_t spiffs_read_dir_v(
   if ((obj_id & SPIFFS_OBJ_ID_IX_FLAG) &&
       objix_hdr.p_hdr.span_ix == 0 &&
       (objix_hdr.p_hdr.flags & (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_IXDELE)) ==
-          (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_IXDELE)) {
+          (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_IXDELE) &&
+      (objix_hdr.type & SPIFFS_TYPE_HIDDEN) == 0) {
     struct spiffs_dirent *e = (struct spiffs_dirent*)user_var_p;
     e->obj_id = obj_id;
-    strcpy((char *)e->name, (char *)objix_hdr.name);
+    spiffs_object_hdr_name(&objix_hdr, e->name);
     e->type = objix_hdr.type;
     e->size = objix_hdr.size == SPIFFS_UNDEFINED_LEN ? 0 : objix_hdr.size;
+#if SPIFFS_RING_FILES
+    if (objix_hdr.type == SPIFFS_TYPE_RING) {
+      res = spiffs_object_ring_head(fs, 0, pix, objix_hdr.size, &e->size, 0);
+      if (res != SPIFFS_OK) return res;
+    }
+#endif
     e->pix = pix;
 #if SPIFFS_OBJ_META_LEN
-    _SPIFFS_MEMCPY(e->meta, objix_hdr.meta, SPIFFS_OBJ_META_LEN);
+    _SPIFFS_MEMCPY(e->meta, spiffs_object_hdr_meta(&objix_hdr), SPIFFS_OBJ_META_LEN);
 #endif
+    const spiffs_dirent_filter_arg *filter = (const spiffs_dirent_filter_arg *)user_const_p;
+    if (filter && !filter->filter(fs, e, filter->arg)) {
+      return SPIFFS_VIS_COUNTINUE;
+    }
     return SPIFFS_OK;
   }
   return SPIFFS_VIS_COUNTINUE;
 }
 
 struct spiffs_dirent *SPIFFS_readdir(spiffs_DIR *d, struct spiffs_dirent *e) {
+  return SPIFFS_readdir_filter(d, e, 0, 0);
+}
+
+struct spiffs_dirent *SPIFFS_readdir_filter(spiffs_DIR *d, struct spiffs_dirent *e,
+    spiffs_dirent_filter filter, void *arg) {
   SPIFFS_API_DBG("%s\n", __func__);
   if (!SPIFFS_CHECK_MOUNT(d->fs)) {
     d->fs->err_code = SPIFFS_ERR_NOT_MOUNTED;
@@ -1065,6 +1339,9 @@ struct spiffs_dirent *SPIFFS_readdir(spiffs_DIR *d, struct spiffs_dirent *e) {
   int entry;
   s32_t res;
   struct spiffs_dirent *ret = 0;
+  spiffs_dirent_filter_arg filter_arg;
+  filter_arg.filter = filter;
+  filter_arg.arg = arg;
 
   res = spiffs_obj_lu_find_entry_visitor(d->fs,
       d->block,
@@ -1072,7 +1349,7 @@ struct spiffs_dirent *SPIFFS_readdir(spiffs_DIR *d, struct spiffs_dirent *e) {
       SPIFFS_VIS_NO_WRAP,
       0,
       spiffs_read_dir_v,
-      0,
+      filter ? &filter_arg : 0,
       e,
       &bix,
       &entry);
@@ -1114,6 +1391,13 @@ s32_t SPIFFS_check(spiffs *fs) {
 
   res = spiffs_obj_lu_scan(fs);
 
+#if SPIFFS_META_IX
+  if (res == SPIFFS_OK && fs->meta_ix) {
+    // check may have moved or removed object index headers
+    res = spiffs_meta_ix_populate(fs);
+  }
+#endif
+
   SPIFFS_UNLOCK(fs);
   return res;
 #endif // SPIFFS_READ_ONLY
@@ -1183,6 +1467,25 @@ s32_t SPIFFS_gc(spiffs *fs, u32_t size) {
 #endif // SPIFFS_READ_ONLY
 }
 
+s32_t SPIFFS_reserve(spiffs *fs, u32_t size, u32_t write_size) {
+  SPIFFS_API_DBG("%s "_SPIPRIi " "_SPIPRIi "\n", __func__, size, write_size);
+#if SPIFFS_READ_ONLY
+  (void)fs; (void)size; (void)write_size;
+  return SPIFFS_ERR_RO_NOT_IMPL;
+#else
+  s32_t res;
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  SPIFFS_LOCK(fs);
+
+  res = spiffs_gc_reserve(fs, size, write_size);
+
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+  SPIFFS_UNLOCK(fs);
+  return 0;
+#endif // SPIFFS_READ_ONLY
+}
+
 s32_t SPIFFS_eof(spiffs *fs, spiffs_file fh) {
   SPIFFS_API_DBG("%s "_SPIPRIfd "\n", __func__, fh);
   s32_t res;
@@ -1374,6 +1677,224 @@ s32_t SPIFFS_ix_map_entries_to_bytes(spiffs *fs, u32_t map_page_ix_entries) {
 
 #endif // SPIFFS_IX_MAP
 
+#if SPIFFS_META_IX
+
+s32_t SPIFFS_meta_ix_map(spiffs *fs, spiffs_meta_ix *ix,
+    u32_t key_offs, u32_t key_len, spiffs_meta_ix_entry *entries, u32_t max_count) {
+  SPIFFS_API_DBG("%s "_SPIPRIi " "_SPIPRIi " "_SPIPRIi "\n", __func__, key_offs, key_len, max_count);
+  s32_t res;
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  SPIFFS_LOCK(fs);
+
+  if (fs->meta_ix) {
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, SPIFFS_ERR_META_IX_MAPPED);
+  }
+  if (key_len == 0 || key_len > sizeof(u32_t) || key_offs + key_len > SPIFFS_OBJ_META_LEN) {
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, SPIFFS_ERR_META_IX_BAD_FIELD);
+  }
+
+  ix->entries = entries;
+  ix->max_count = max_count;
+  ix->key_offs = key_offs;
+  ix->key_len = key_len;
+  fs->meta_ix = ix;
+
+  res = spiffs_meta_ix_populate(fs);
+  if (res != SPIFFS_OK) {
+    fs->meta_ix = 0;
+  }
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+
+  SPIFFS_UNLOCK(fs);
+  return res;
+}
+
+s32_t SPIFFS_meta_ix_unmap(spiffs *fs) {
+  SPIFFS_API_DBG("%s\n", __func__);
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  SPIFFS_LOCK(fs);
+
+  if (fs->meta_ix == 0) {
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, SPIFFS_ERR_META_IX_UNMAPPED);
+  }
+
+  fs->meta_ix = 0;
+
+  SPIFFS_UNLOCK(fs);
+  return SPIFFS_OK;
+}
+
+s32_t SPIFFS_meta_ix_find(spiffs *fs, u32_t key_min, u32_t key_max,
+    spiffs_meta_ix_entry **first) {
+  SPIFFS_API_DBG("%s "_SPIPRIi " "_SPIPRIi "\n", __func__, key_min, key_max);
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  SPIFFS_LOCK(fs);
+
+  spiffs_meta_ix *ix = fs->meta_ix;
+  if (ix == 0) {
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, SPIFFS_ERR_META_IX_UNMAPPED);
+  }
+  if (ix->overflow) {
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, SPIFFS_ERR_META_IX_FULL);
+  }
+
+  // entries are sorted on key
+  u32_t lo = spiffs_meta_ix_lower_bound(ix, key_min);
+  u32_t end = lo;
+  while (end < ix->count && ix->entries[end].key <= key_max) {
+    end++;
+  }
+  if (first) {
+    *first = &ix->entries[lo];
+  }
+
+  SPIFFS_UNLOCK(fs);
+  return end - lo;
+}
+
+#endif // SPIFFS_META_IX
+
+#if SPIFFS_TXN
+
+s32_t SPIFFS_txn_begin(spiffs *fs) {
+  SPIFFS_API_DBG("%s\n", __func__);
+#if SPIFFS_READ_ONLY
+  (void)fs;
+  return SPIFFS_ERR_RO_NOT_IMPL;
+#else
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  SPIFFS_LOCK(fs);
+
+  if (fs->txn.state != SPIFFS_TXN_STATE_NONE) {
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, SPIFFS_ERR_TXN_STATE);
+  }
+  fs->txn.count = 0;
+  fs->txn.state = SPIFFS_TXN_STATE_OPEN;
+
+  SPIFFS_UNLOCK(fs);
+  return SPIFFS_OK;
+#endif // SPIFFS_READ_ONLY
+}
+
+s32_t SPIFFS_txn_commit(spiffs *fs) {
+  SPIFFS_API_DBG("%s\n", __func__);
+#if SPIFFS_READ_ONLY
+  (void)fs;
+  return SPIFFS_ERR_RO_NOT_IMPL;
+#else
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  SPIFFS_LOCK(fs);
+
+  s32_t res;
+  if (fs->txn.state != SPIFFS_TXN_STATE_OPEN) {
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, SPIFFS_ERR_TXN_STATE);
+  }
+
+#if SPIFFS_CACHE || SPIFFS_COMPRESSED_FILES
+  // shadows must be complete on the medium before the marker
+  u32_t i;
+  spiffs_fd *fds = (spiffs_fd *)fs->fd_space;
+  for (i = 0; i < fs->fd_count; i++) {
+    if (fds[i].file_nbr != 0 && (fds[i].flags & SPIFFS_O_SHADOW)) {
+#if SPIFFS_CACHE
+      res = spiffs_fflush_cache(fs, fds[i].file_nbr);
+      SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+#endif
+#if SPIFFS_COMPRESSED_FILES
+      res = spiffs_fflush_compress(fs, fds[i].file_nbr);
+      SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+#endif
+    }
+  }
+#endif
+
+  res = spiffs_txn_commit(fs);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+
+  SPIFFS_UNLOCK(fs);
+  return res;
+#endif // SPIFFS_READ_ONLY
+}
+
+s32_t SPIFFS_txn_abort(spiffs *fs) {
+  SPIFFS_API_DBG("%s\n", __func__);
+#if SPIFFS_READ_ONLY
+  (void)fs;
+  return SPIFFS_ERR_RO_NOT_IMPL;
+#else
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  SPIFFS_LOCK(fs);
+
+  s32_t res;
+  if (fs->txn.state == SPIFFS_TXN_STATE_NONE) {
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, SPIFFS_ERR_TXN_STATE);
+  }
+
+  res = spiffs_txn_abort(fs);
+  SPIFFS_API_CHECK_RES_UNLOCK(fs, res);
+
+  SPIFFS_UNLOCK(fs);
+  return res;
+#endif // SPIFFS_READ_ONLY
+}
+
+#endif // SPIFFS_TXN
+
+#if SPIFFS_COMPRESSED_FILES
+s32_t SPIFFS_compress_buffer(spiffs *fs, void *buf, u32_t size) {
+  SPIFFS_API_DBG("%s "_SPIPRIi "\n", __func__, size);
+  SPIFFS_API_CHECK_CFG(fs);
+  SPIFFS_API_CHECK_MOUNT(fs);
+  SPIFFS_LOCK(fs);
+
+  spiffs_compress *c = spiffs_get_compress(fs);
+  if (c && c->file_nbr != 0) {
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, SPIFFS_ERR_COMPRESS_BUF);
+  }
+  fs->compress = 0;
+  if (buf == 0) {
+    SPIFFS_UNLOCK(fs);
+    return SPIFFS_OK;
+  }
+
+  // align buffer pointer to pointer size byte boundary
+  u8_t ptr_size = sizeof(void*);
+  u8_t addr_lsb = ((u8_t)(intptr_t)buf) & (ptr_size-1);
+  u8_t *buf_8 = (u8_t *)buf;
+  if (addr_lsb) {
+    if (size < (u32_t)(ptr_size-addr_lsb)) {
+      SPIFFS_API_CHECK_RES_UNLOCK(fs, SPIFFS_ERR_COMPRESS_BUF);
+    }
+    buf_8 += (ptr_size-addr_lsb);
+    size -= (ptr_size-addr_lsb);
+  }
+  u32_t fixed = sizeof(spiffs_compress) + (sizeof(u16_t) << SPIFFS_COMPRESS_HASH_BITS) +
+      SPIFFS_CFG_LOG_PAGE_SZ(fs);
+  if (size < fixed + SPIFFS_DATA_PAGE_SIZE(fs)) {
+    // room for at least one data page of uncompressed bytes
+    SPIFFS_API_CHECK_RES_UNLOCK(fs, SPIFFS_ERR_COMPRESS_BUF);
+  }
+
+  c = (spiffs_compress *)buf_8;
+  memset(c, 0, sizeof(spiffs_compress));
+  c->hash = (u16_t *)(buf_8 + sizeof(spiffs_compress));
+  c->frame = buf_8 + sizeof(spiffs_compress) + (sizeof(u16_t) << SPIFFS_COMPRESS_HASH_BITS);
+  c->raw = c->frame + SPIFFS_CFG_LOG_PAGE_SZ(fs);
+  // raw positions and frame lengths are 16 bit
+  c->raw_size = MIN(size - fixed, 0xffff);
+  fs->compress = c;
+
+  SPIFFS_UNLOCK(fs);
+  return SPIFFS_OK;
+}
+#endif // SPIFFS_COMPRESSED_FILES
+
 #if SPIFFS_TEST_VISUALISATION
 s32_t SPIFFS_vis(spiffs *fs) {
   s32_t res = SPIFFS_OK;
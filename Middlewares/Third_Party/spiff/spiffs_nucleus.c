@@ -617,6 +617,13 @@ static void spiffs_update_ix_map(spiffs *fs,
     return;
   }
 
+#if SPIFFS_INLINE_DATA
+  if (objix_spix == 0 && (objix->p_hdr.flags & SPIFFS_PH_FLAG_INLINE) == 0) {
+    // object data is inline in the header, no data pages to map
+    return;
+  }
+#endif
+
   // update memory mapped page index buffer to new pages
 
   // get range of updated object index map data span indices
@@ -902,6 +909,223 @@ s32_t spiffs_page_delete(
 }
 #endif // !SPIFFS_READ_ONLY
 
+#if SPIFFS_TEMPORAL_FD_CACHE || SPIFFS_COMPACT_NAMES
+// djb2 hash
+static u32_t spiffs_hash(spiffs *fs, const u8_t *name) {
+  (void)fs;
+  u32_t hash = 5381;
+  u8_t c;
+  int i = 0;
+  while ((c = name[i++]) && i < SPIFFS_OBJ_NAME_LEN) {
+    hash = (hash * 33) ^ c;
+  }
+  return hash;
+}
+#endif
+
+// name to look for in object index headers, hashed once per search
+typedef struct {
+  const u8_t *name;
+  u32_t len;
+#if SPIFFS_COMPACT_NAMES
+  u16_t hash;
+#endif
+} spiffs_name_key;
+
+static u32_t spiffs_name_len(const u8_t *name) {
+  u32_t len = 0;
+  while (len < SPIFFS_OBJ_NAME_LEN && name[len]) {
+    len++;
+  }
+  return len;
+}
+
+static void spiffs_name_key_init(spiffs *fs, spiffs_name_key *key, const u8_t *name) {
+  (void)fs;
+  key->name = name;
+  key->len = spiffs_name_len(name);
+#if SPIFFS_COMPACT_NAMES
+  u32_t hash = spiffs_hash(fs, name);
+  key->hash = (u16_t)(hash ^ (hash >> 16));
+#endif
+}
+
+// Copies the zero terminated name of an object index header of either layout
+void spiffs_object_hdr_name(
+    const spiffs_page_object_ix_header *objix_hdr,
+    u8_t name[SPIFFS_OBJ_NAME_LEN]) {
+#if SPIFFS_COMPACT_NAMES
+  if ((objix_hdr->p_hdr.flags & SPIFFS_PH_FLAG_COMPACT) == 0) {
+    const spiffs_page_object_ix_header_compact *chdr = (const spiffs_page_object_ix_header_compact *)objix_hdr;
+    u32_t name_len = MIN(chdr->name_len, SPIFFS_OBJ_COMPACT_NAME_LEN);
+    _SPIFFS_MEMCPY(name, (const u8_t *)(chdr + 1), name_len);
+    name[name_len] = 0;
+    return;
+  }
+#endif
+  strncpy((char *)name, (const char *)objix_hdr->name, SPIFFS_OBJ_NAME_LEN);
+}
+
+#if SPIFFS_OBJ_META_LEN
+// Returns the metadata of an object index header of either layout
+u8_t *spiffs_object_hdr_meta(
+    spiffs_page_object_ix_header *objix_hdr) {
+#if SPIFFS_COMPACT_NAMES
+  if ((objix_hdr->p_hdr.flags & SPIFFS_PH_FLAG_COMPACT) == 0) {
+    return ((spiffs_page_object_ix_header_compact *)objix_hdr)->meta;
+  }
+#endif
+  return objix_hdr->meta;
+}
+#endif
+
+// Returns the length of an object index header of either layout. Inline data
+// starts at this offset, index entries always start at
+// sizeof(spiffs_page_object_ix_header)
+u32_t spiffs_object_hdr_data_offs(
+    const spiffs_page_object_ix_header *objix_hdr) {
+#if SPIFFS_COMPACT_NAMES
+  if ((objix_hdr->p_hdr.flags & SPIFFS_PH_FLAG_COMPACT) == 0) {
+    const spiffs_page_object_ix_header_compact *chdr = (const spiffs_page_object_ix_header_compact *)objix_hdr;
+    return sizeof(spiffs_page_object_ix_header_compact) + MIN(chdr->name_len, SPIFFS_OBJ_COMPACT_NAME_LEN);
+  }
+#endif
+  return sizeof(spiffs_page_object_ix_header);
+}
+
+// Reads the object index header at pix into objix_hdr and checks if it carries
+// the name in key. Only the fixed part is read first; compact headers are
+// rejected on name length and hash before any name bytes are fetched. Name is
+// only compared for pages looking like a live object index header, callers
+// check flags further on their own.
+// Returns 1 on match, 0 if not, or error.
+static s32_t spiffs_object_hdr_name_match(
+    spiffs *fs,
+    spiffs_page_ix pix,
+    const spiffs_name_key *key,
+    spiffs_page_object_ix_header *objix_hdr) {
+  s32_t res;
+  u32_t addr = SPIFFS_PAGE_TO_PADDR(fs, pix);
+  res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ,
+      0, addr, SPIFFS_OBJ_HDR_MIN_LEN, (u8_t *)objix_hdr);
+  SPIFFS_CHECK_RES(res);
+  if (objix_hdr->p_hdr.span_ix != 0 ||
+      (objix_hdr->p_hdr.flags & (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_INDEX | SPIFFS_PH_FLAG_FINAL)) !=
+          SPIFFS_PH_FLAG_DELET ||
+      (objix_hdr->type & SPIFFS_TYPE_HIDDEN)) {
+    return 0;
+  }
+#if SPIFFS_COMPACT_NAMES
+  if ((objix_hdr->p_hdr.flags & SPIFFS_PH_FLAG_COMPACT) == 0) {
+    spiffs_page_object_ix_header_compact *chdr = (spiffs_page_object_ix_header_compact *)objix_hdr;
+    if (chdr->name_len != key->len || chdr->name_hash != key->hash) {
+      return 0;
+    }
+    if (key->len > 0) {
+      res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ,
+          0, addr + sizeof(spiffs_page_object_ix_header_compact), key->len, (u8_t *)(chdr + 1));
+      SPIFFS_CHECK_RES(res);
+    }
+    return memcmp(key->name, (u8_t *)(chdr + 1), key->len) == 0;
+  }
+  // classic header, fetch rest of name
+  res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ,
+      0, addr + SPIFFS_OBJ_HDR_MIN_LEN, sizeof(spiffs_page_object_ix_header) - SPIFFS_OBJ_HDR_MIN_LEN,
+      (u8_t *)objix_hdr + SPIFFS_OBJ_HDR_MIN_LEN);
+  SPIFFS_CHECK_RES(res);
+#endif
+  return strncmp((const char *)key->name, (const char *)objix_hdr->name, SPIFFS_OBJ_NAME_LEN) == 0;
+}
+
+#if !SPIFFS_READ_ONLY
+// Lays out name and meta in an object index header in memory, picking the
+// compact layout if enabled and the name fits. data_len bytes of inline data
+// are moved along to follow the name, bytes freed up behind them are erased.
+// Name and meta must not point into the header itself.
+static void spiffs_object_hdr_set_name_meta(
+    spiffs *fs,
+    spiffs_page_object_ix_header *objix_hdr,
+    const u8_t name[],
+    const u8_t meta[],
+    u32_t data_len) {
+  (void)fs;
+  u8_t *hdr_data = (u8_t *)objix_hdr;
+  u32_t old_offs = spiffs_object_hdr_data_offs(objix_hdr);
+  u32_t new_offs = sizeof(spiffs_page_object_ix_header);
+#if SPIFFS_COMPACT_NAMES
+  u32_t name_len = spiffs_name_len(name);
+  if (name_len <= SPIFFS_OBJ_COMPACT_NAME_LEN) {
+    new_offs = sizeof(spiffs_page_object_ix_header_compact) + name_len;
+  }
+#endif
+  if (data_len && new_offs != old_offs) {
+    memmove(hdr_data + new_offs, hdr_data + old_offs, data_len);
+  }
+  if (new_offs < old_offs) {
+    memset(hdr_data + new_offs + data_len, 0xff, old_offs - new_offs);
+  }
+#if SPIFFS_COMPACT_NAMES
+  if (new_offs != sizeof(spiffs_page_object_ix_header)) {
+    spiffs_page_object_ix_header_compact *chdr = (spiffs_page_object_ix_header_compact *)objix_hdr;
+    u32_t hash = spiffs_hash(fs, name);
+    objix_hdr->p_hdr.flags &= ~SPIFFS_PH_FLAG_COMPACT;
+    chdr->name_hash = (u16_t)(hash ^ (hash >> 16));
+    chdr->name_len = (u8_t)name_len;
+#if SPIFFS_OBJ_META_LEN
+    if (meta) {
+      _SPIFFS_MEMCPY(chdr->meta, meta, SPIFFS_OBJ_META_LEN);
+    } else {
+      memset(chdr->meta, 0xff, SPIFFS_OBJ_META_LEN);
+    }
+#endif
+    _SPIFFS_MEMCPY((u8_t *)(chdr + 1), name, name_len);
+    return;
+  }
+  objix_hdr->p_hdr.flags |= SPIFFS_PH_FLAG_COMPACT;
+#endif
+  strncpy((char*)objix_hdr->name, (const char*)name, SPIFFS_OBJ_NAME_LEN);
+#if SPIFFS_OBJ_META_LEN
+  if (meta) {
+    _SPIFFS_MEMCPY(objix_hdr->meta, meta, SPIFFS_OBJ_META_LEN);
+  } else {
+    memset(objix_hdr->meta, 0xff, SPIFFS_OBJ_META_LEN);
+  }
+#else
+  (void) meta;
+#endif
+}
+#endif // !SPIFFS_READ_ONLY
+
+#if SPIFFS_INLINE_DATA && !SPIFFS_READ_ONLY
+// Moves the inline data of an object index header page in memory to a data
+// page and turns the header into a plain index referring to it
+static s32_t spiffs_object_inline_spill(
+    spiffs *fs,
+    spiffs_obj_id obj_id,
+    u8_t *objix_hdr_data,
+    u32_t size) {
+  s32_t res = SPIFFS_OK;
+  spiffs_page_object_ix_header *objix_hdr = (spiffs_page_object_ix_header *)objix_hdr_data;
+  u32_t data_offs = spiffs_object_hdr_data_offs(objix_hdr);
+  spiffs_page_ix data_pix = (spiffs_page_ix)-1;
+  obj_id &= ~SPIFFS_OBJ_ID_IX_FLAG;
+  if (size > 0) {
+    spiffs_page_header p_hdr;
+    p_hdr.obj_id = obj_id;
+    p_hdr.span_ix = 0;
+    p_hdr.flags = 0xff & ~(SPIFFS_PH_FLAG_FINAL);  // finalize immediately
+    res = spiffs_page_allocate_data(fs, obj_id,
+        &p_hdr, objix_hdr_data + data_offs, size, 0, 1, &data_pix);
+    SPIFFS_CHECK_RES(res);
+  }
+  memset(objix_hdr_data + data_offs, 0xff, SPIFFS_CFG_LOG_PAGE_SZ(fs) - data_offs);
+  ((spiffs_page_ix*)(objix_hdr_data + sizeof(spiffs_page_object_ix_header)))[0] = data_pix;
+  objix_hdr->p_hdr.flags |= SPIFFS_PH_FLAG_INLINE;
+  SPIFFS_DBG("inline: "_SPIPRIid" spilled "_SPIPRIi" bytes to data page "_SPIPRIpg"\n", obj_id, size, data_pix);
+  return res;
+}
+#endif // SPIFFS_INLINE_DATA && !SPIFFS_READ_ONLY
+
 #if !SPIFFS_READ_ONLY
 // Create an object index header page with empty index and undefined length
 s32_t spiffs_object_create(
@@ -939,20 +1163,11 @@ s32_t spiffs_object_create(
   oix_hdr.p_hdr.flags = 0xff & ~(SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_INDEX | SPIFFS_PH_FLAG_USED);
   oix_hdr.type = type;
   oix_hdr.size = SPIFFS_UNDEFINED_LEN; // keep ones so we can update later without wasting this page
-  strncpy((char*)oix_hdr.name, (const char*)name, SPIFFS_OBJ_NAME_LEN);
-#if SPIFFS_OBJ_META_LEN
-  if (meta) {
-    _SPIFFS_MEMCPY(oix_hdr.meta, meta, SPIFFS_OBJ_META_LEN);
-  } else {
-    memset(oix_hdr.meta, 0xff, SPIFFS_OBJ_META_LEN);
-  }
-#else
-  (void) meta;
-#endif
+  spiffs_object_hdr_set_name_meta(fs, &oix_hdr, name, meta, 0);
 
-  // update page
+  // update page, only the used part of the header so the rest stays erased
   res = _spiffs_wr(fs, SPIFFS_OP_T_OBJ_DA | SPIFFS_OP_C_UPDT,
-      0, SPIFFS_OBJ_LOOKUP_ENTRY_TO_PADDR(fs, bix, entry), sizeof(spiffs_page_object_ix_header), (u8_t*)&oix_hdr);
+      0, SPIFFS_OBJ_LOOKUP_ENTRY_TO_PADDR(fs, bix, entry), spiffs_object_hdr_data_offs(&oix_hdr), (u8_t*)&oix_hdr);
 
   SPIFFS_CHECK_RES(res);
   spiffs_cb_object_event(fs, (spiffs_page_object_ix *)&oix_hdr,
@@ -1000,17 +1215,38 @@ s32_t spiffs_object_update_index_hdr(
 
   SPIFFS_VALIDATE_OBJIX(objix_hdr->p_hdr, obj_id, 0);
 
-  // change name
-  if (name) {
-    strncpy((char*)objix_hdr->name, (const char*)name, SPIFFS_OBJ_NAME_LEN);
-  }
+  // change name and/or meta, header layout may change with the name
+  if (name || meta) {
+    u8_t cur_name[SPIFFS_OBJ_NAME_LEN];
+    u32_t data_len = 0;
 #if SPIFFS_OBJ_META_LEN
-  if (meta) {
-    _SPIFFS_MEMCPY(objix_hdr->meta, meta, SPIFFS_OBJ_META_LEN);
-  }
-#else
-  (void) meta;
+    u8_t cur_meta[SPIFFS_OBJ_META_LEN];
+    _SPIFFS_MEMCPY(cur_meta, meta ? meta : spiffs_object_hdr_meta(objix_hdr), SPIFFS_OBJ_META_LEN);
+    meta = cur_meta;
+#endif
+    if (name) {
+      strncpy((char *)cur_name, (const char *)name, SPIFFS_OBJ_NAME_LEN);
+    } else {
+      spiffs_object_hdr_name(objix_hdr, cur_name);
+    }
+#if SPIFFS_INLINE_DATA
+    if ((objix_hdr->p_hdr.flags & SPIFFS_PH_FLAG_INLINE) == 0 && objix_hdr->size != SPIFFS_UNDEFINED_LEN) {
+      data_len = objix_hdr->size;
+#if SPIFFS_COMPACT_NAMES
+      u32_t name_len = spiffs_name_len(cur_name);
+      u32_t new_data_offs = name_len <= SPIFFS_OBJ_COMPACT_NAME_LEN ?
+          sizeof(spiffs_page_object_ix_header_compact) + name_len : sizeof(spiffs_page_object_ix_header);
+      if (new_data_offs + data_len > SPIFFS_CFG_LOG_PAGE_SZ(fs)) {
+        // inline data does not fit behind the new name
+        res = spiffs_object_inline_spill(fs, obj_id, (u8_t *)objix_hdr, data_len);
+        SPIFFS_CHECK_RES(res);
+        data_len = 0;
+      }
+#endif
+    }
 #endif
+    spiffs_object_hdr_set_name_meta(fs, objix_hdr, cur_name, meta, data_len);
+  }
   if (size) {
     objix_hdr->size = size;
   }
@@ -1033,6 +1269,129 @@ s32_t spiffs_object_update_index_hdr(
 }
 #endif // !SPIFFS_READ_ONLY
 
+#if SPIFFS_META_IX
+static u32_t spiffs_meta_ix_key(const spiffs_meta_ix *ix, const u8_t *meta) {
+  u32_t key = 0;
+  u32_t i;
+  for (i = 0; i < ix->key_len; i++) {
+    key |= (u32_t)meta[ix->key_offs + i] << (8*i);
+  }
+  return key;
+}
+
+// Returns index of first entry with key not less than given key
+u32_t spiffs_meta_ix_lower_bound(
+    const spiffs_meta_ix *ix,
+    u32_t key) {
+  u32_t lo = 0;
+  u32_t hi = ix->count;
+  while (lo < hi) {
+    u32_t mid = (lo + hi) / 2;
+    if (ix->entries[mid].key < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static spiffs_meta_ix_entry *spiffs_meta_ix_get(spiffs_meta_ix *ix, spiffs_obj_id obj_id) {
+  u32_t i;
+  for (i = 0; i < ix->count; i++) {
+    if (ix->entries[i].obj_id == obj_id) {
+      return &ix->entries[i];
+    }
+  }
+  return 0;
+}
+
+static void spiffs_meta_ix_remove(spiffs_meta_ix *ix, spiffs_meta_ix_entry *e) {
+  u32_t i = e - ix->entries;
+  memmove(e, e + 1, (ix->count - i - 1) * sizeof(spiffs_meta_ix_entry));
+  ix->count--;
+}
+
+static void spiffs_meta_ix_insert(spiffs_meta_ix *ix, u32_t key, spiffs_obj_id obj_id, spiffs_page_ix pix) {
+  if (ix->count >= ix->max_count) {
+    ix->overflow = 1;
+    return;
+  }
+  u32_t i = spiffs_meta_ix_lower_bound(ix, key);
+  memmove(&ix->entries[i + 1], &ix->entries[i], (ix->count - i) * sizeof(spiffs_meta_ix_entry));
+  ix->entries[i].key = key;
+  ix->entries[i].obj_id = obj_id;
+  ix->entries[i].pix = pix;
+  ix->count++;
+}
+
+// Updates the metadata index on object index header events
+static void spiffs_meta_ix_update(
+    spiffs *fs,
+    spiffs_page_object_ix *objix,
+    int ev,
+    spiffs_obj_id obj_id,
+    spiffs_page_ix new_pix) {
+  spiffs_meta_ix *ix = fs->meta_ix;
+  spiffs_meta_ix_entry *e = spiffs_meta_ix_get(ix, obj_id);
+  if (ev == SPIFFS_EV_IX_DEL) {
+    if (e) spiffs_meta_ix_remove(ix, e);
+  } else if (ev == SPIFFS_EV_IX_MOV) {
+    // only the page header is given, metadata is unchanged
+    if (e) e->pix = new_pix;
+  } else if (objix && (((spiffs_page_object_ix_header *)objix)->type & SPIFFS_TYPE_HIDDEN) == 0) {
+    u32_t key = spiffs_meta_ix_key(ix, spiffs_object_hdr_meta((spiffs_page_object_ix_header *)objix));
+    if (e && e->key == key) {
+      e->pix = new_pix;
+    } else {
+      if (e) spiffs_meta_ix_remove(ix, e);
+      spiffs_meta_ix_insert(ix, key, obj_id, new_pix);
+    }
+  }
+}
+
+static s32_t spiffs_meta_ix_populate_v(
+    spiffs *fs,
+    spiffs_obj_id obj_id,
+    spiffs_block_ix bix,
+    int ix_entry,
+    const void *user_const_p,
+    void *user_var_p) {
+  (void)user_const_p;
+  (void)user_var_p;
+  s32_t res;
+  spiffs_page_object_ix_header objix_hdr;
+  if (obj_id == SPIFFS_OBJ_ID_FREE || obj_id == SPIFFS_OBJ_ID_DELETED ||
+      (obj_id & SPIFFS_OBJ_ID_IX_FLAG) == 0) {
+    return SPIFFS_VIS_COUNTINUE;
+  }
+  spiffs_page_ix pix = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, ix_entry);
+  res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ,
+      0, SPIFFS_PAGE_TO_PADDR(fs, pix), sizeof(spiffs_page_object_ix_header), (u8_t *)&objix_hdr);
+  SPIFFS_CHECK_RES(res);
+  if (objix_hdr.p_hdr.span_ix == 0 &&
+      (objix_hdr.p_hdr.flags & (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_IXDELE)) ==
+          (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_IXDELE) &&
+      (objix_hdr.type & SPIFFS_TYPE_HIDDEN) == 0) {
+    spiffs_meta_ix_insert(fs->meta_ix, spiffs_meta_ix_key(fs->meta_ix, spiffs_object_hdr_meta(&objix_hdr)),
+        obj_id & ~SPIFFS_OBJ_ID_IX_FLAG, pix);
+  }
+  return SPIFFS_VIS_COUNTINUE;
+}
+
+// Fills the mapped metadata index from all object index headers
+s32_t spiffs_meta_ix_populate(
+    spiffs *fs) {
+  s32_t res;
+  fs->meta_ix->count = 0;
+  fs->meta_ix->overflow = 0;
+  res = spiffs_obj_lu_find_entry_visitor(fs, 0, 0, 0, 0, spiffs_meta_ix_populate_v, 0, 0, 0, 0);
+  if (res == SPIFFS_VIS_END) res = SPIFFS_OK;
+  SPIFFS_CHECK_RES(res);
+  return fs->meta_ix->overflow ? SPIFFS_ERR_META_IX_FULL : SPIFFS_OK;
+}
+#endif // SPIFFS_META_IX
+
 void spiffs_cb_object_event(
     spiffs *fs,
     spiffs_page_object_ix *objix,
@@ -1041,14 +1400,14 @@ void spiffs_cb_object_event(
     spiffs_span_ix spix,
     spiffs_page_ix new_pix,
     u32_t new_size) {
-#if SPIFFS_IX_MAP == 0
+#if SPIFFS_IX_MAP == 0 && SPIFFS_INLINE_DATA == 0
   (void)objix;
 #endif
   // update index caches in all file descriptors
   spiffs_obj_id obj_id = obj_id_raw & ~SPIFFS_OBJ_ID_IX_FLAG;
   u32_t i;
   spiffs_fd *fds = (spiffs_fd *)fs->fd_space;
-  SPIFFS_DBG("       CALLBACK  %s obj_id:"_SPIPRIid" spix:"_SPIPRIsp" npix:"_SPIPRIpg" nsz:"_SPIPRIi"\n", (const char *[]){"UPD", "NEW", "DEL", "MOV", "HUP","???"}[MIN(ev,5)],
+  SPIFFS_DBG("       CALLBACK  %s obj_id:"_SPIPRIid" spix:"_SPIPRIsp" npix:"_SPIPRIpg" nsz:"_SPIPRIi"\n", ((const char *[]){"UPD", "NEW", "DEL", "MOV", "HUP","???"})[MIN(ev,5)],
       obj_id_raw, spix, new_pix, new_size);
   for (i = 0; i < fs->fd_count; i++) {
     spiffs_fd *cur_fd = &fds[i];
@@ -1061,6 +1420,9 @@ void spiffs_cb_object_event(
       if (ev != SPIFFS_EV_IX_DEL) {
         SPIFFS_DBG("       callback: setting fd "_SPIPRIfd":"_SPIPRIid"(fdoffs:"_SPIPRIi" offs:"_SPIPRIi") objix_hdr_pix to "_SPIPRIpg", size:"_SPIPRIi"\n", SPIFFS_FH_OFFS(fs, cur_fd->file_nbr), cur_fd->obj_id, cur_fd->fdoffset, cur_fd->offset, new_pix, new_size);
         cur_fd->objix_hdr_pix = new_pix;
+#if SPIFFS_INLINE_DATA
+        cur_fd->paged = objix ? (objix->p_hdr.flags & SPIFFS_PH_FLAG_INLINE) != 0 : 0;
+#endif
         if (new_size != 0) {
           // update size and offsets for fds to this file
           cur_fd->size = new_size;
@@ -1117,6 +1479,13 @@ void spiffs_cb_object_event(
 
 #endif
 
+#if SPIFFS_META_IX
+  // update metadata index
+  if (fs->meta_ix && spix == 0 && (obj_id_raw & SPIFFS_OBJ_ID_IX_FLAG)) {
+    spiffs_meta_ix_update(fs, objix, ev, obj_id, new_pix);
+  }
+#endif
+
   // callback to user if object index header
   if (fs->file_cb_f && spix == 0 && (obj_id_raw & SPIFFS_OBJ_ID_IX_FLAG)) {
     spiffs_fileop_type op;
@@ -1187,6 +1556,30 @@ s32_t spiffs_object_open_by_page(
 
   SPIFFS_VALIDATE_OBJIX(oix_hdr.p_hdr, fd->obj_id, 0);
 
+#if SPIFFS_INLINE_DATA
+  fd->paged = (oix_hdr.p_hdr.flags & SPIFFS_PH_FLAG_INLINE) != 0;
+#endif
+#if SPIFFS_RING_FILES
+  fd->ring_pages = 0;
+  if (oix_hdr.type == SPIFFS_TYPE_RING) {
+    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_READ,
+        fd->file_nbr, SPIFFS_PAGE_TO_PADDR(fs, pix) + sizeof(spiffs_page_object_ix_header) +
+        SPIFFS_RING_MAX_PAGES(fs) * sizeof(spiffs_page_ix), sizeof(spiffs_span_ix), (u8_t *)&fd->ring_pages);
+    SPIFFS_CHECK_RES(res);
+    if (oix_hdr.size != SPIFFS_UNDEFINED_LEN) {
+      res = spiffs_object_ring_head(fs, fd->file_nbr, pix, oix_hdr.size, &fd->size, 0);
+      SPIFFS_CHECK_RES(res);
+    }
+  }
+#endif
+#if SPIFFS_COMPRESSED_FILES
+  // compression follows the object type, not the open flags
+  fd->flags &= ~SPIFFS_O_COMPRESS;
+  if ((oix_hdr.type & ~SPIFFS_TYPE_HIDDEN) == SPIFFS_TYPE_COMPRESSED) {
+    fd->flags |= SPIFFS_O_COMPRESS;
+  }
+#endif
+
   SPIFFS_DBG("open: fd "_SPIPRIfd" is obj id "_SPIPRIid"\n", SPIFFS_FH_OFFS(fs, fd->file_nbr), fd->obj_id);
 
   return res;
@@ -1644,69 +2037,854 @@ s32_t spiffs_object_modify(spiffs_fd *fd, u32_t offset, u8_t *data, u32_t len) {
 } // spiffs_object_modify
 #endif // !SPIFFS_READ_ONLY
 
-static s32_t spiffs_object_find_object_index_header_by_name_v(
-    spiffs *fs,
-    spiffs_obj_id obj_id,
-    spiffs_block_ix bix,
-    int ix_entry,
-    const void *user_const_p,
-    void *user_var_p) {
-  (void)user_var_p;
-  s32_t res;
-  spiffs_page_object_ix_header objix_hdr;
-  spiffs_page_ix pix = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, ix_entry);
-  if (obj_id == SPIFFS_OBJ_ID_FREE || obj_id == SPIFFS_OBJ_ID_DELETED ||
-      (obj_id & SPIFFS_OBJ_ID_IX_FLAG) == 0) {
-    return SPIFFS_VIS_COUNTINUE;
+#if SPIFFS_INLINE_DATA && !SPIFFS_READ_ONLY
+// Write to an object keeping its data inline in the object index header page.
+// If the object is empty or inline, and still fits in the header after the
+// write, data is stored inline and inlined is set.
+// Otherwise inlined is cleared and the object is left for append/modify; an
+// inline object that outgrows the header is first spilled to a data page.
+s32_t spiffs_object_inline_write(spiffs_fd *fd, u32_t offset, u8_t *data, u32_t len, u8_t *inlined) {
+  spiffs *fs = fd->fs;
+  s32_t res = SPIFFS_OK;
+  spiffs_page_object_ix_header *objix_hdr = (spiffs_page_object_ix_header *)fs->work;
+  u8_t *inline_data;
+  u32_t cur_size = fd->size == SPIFFS_UNDEFINED_LEN ? 0 : fd->size;
+  spiffs_page_ix new_objix_hdr_pix;
+
+  *inlined = 0;
+  if (cur_size > SPIFFS_OBJ_HDR_INLINE_LEN(fs)) {
+    // too large to be inline, nothing to do
+    return res;
   }
-  res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ,
-      0, SPIFFS_PAGE_TO_PADDR(fs, pix), sizeof(spiffs_page_object_ix_header), (u8_t *)&objix_hdr);
-  SPIFFS_CHECK_RES(res);
-  if (objix_hdr.p_hdr.span_ix == 0 &&
-      (objix_hdr.p_hdr.flags & (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_IXDELE)) ==
-          (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_IXDELE)) {
-    if (strcmp((const char*)user_const_p, (char*)objix_hdr.name) == 0) {
-      return SPIFFS_OK;
-    }
+  if (cur_size > 0 && fd->paged) {
+    // object already has data pages, known without loading the header
+    return res;
+  }
+  if (cur_size == 0 && len > SPIFFS_OBJ_HDR_INLINE_LEN(fs)) {
+    // empty object and the data can never fit, let append allocate data pages
+    return res;
   }
 
-  return SPIFFS_VIS_COUNTINUE;
-}
-
-// Finds object index header page by name
-s32_t spiffs_object_find_object_index_header_by_name(
-    spiffs *fs,
-    const u8_t name[SPIFFS_OBJ_NAME_LEN],
-    spiffs_page_ix *pix) {
-  s32_t res;
-  spiffs_block_ix bix;
-  int entry;
+  // make room for spilling before loading the header, gc uses the work buffer
+  res = spiffs_gc_check(fs, len + SPIFFS_DATA_PAGE_SIZE(fs));
+  SPIFFS_CHECK_RES(res);
 
-  res = spiffs_obj_lu_find_entry_visitor(fs,
-      fs->cursor_block_ix,
-      fs->cursor_obj_lu_entry,
-      0,
-      0,
-      spiffs_object_find_object_index_header_by_name_v,
-      name,
-      0,
-      &bix,
-      &entry);
+  res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_READ,
+      fd->file_nbr, SPIFFS_PAGE_TO_PADDR(fs, fd->objix_hdr_pix), SPIFFS_CFG_LOG_PAGE_SZ(fs), fs->work);
+  SPIFFS_CHECK_RES(res);
+  SPIFFS_VALIDATE_OBJIX(objix_hdr->p_hdr, fd->obj_id, 0);
 
-  if (res == SPIFFS_VIS_END) {
-    res = SPIFFS_ERR_NOT_FOUND;
+  u8_t is_inline = (objix_hdr->p_hdr.flags & SPIFFS_PH_FLAG_INLINE) == 0;
+  if (!is_inline && cur_size > 0) {
+    // object already has data pages
+    return res;
   }
-  SPIFFS_CHECK_RES(res);
 
-  if (pix) {
-    *pix = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, entry);
+  if (offset > cur_size) {
+    offset = cur_size;
   }
 
-  fs->cursor_block_ix = bix;
-  fs->cursor_obj_lu_entry = entry;
+  inline_data = fs->work + spiffs_object_hdr_data_offs(objix_hdr);
+  if (inline_data + offset + len > fs->work + SPIFFS_CFG_LOG_PAGE_SZ(fs)) {
+    if (!is_inline) {
+      // empty object, let append allocate data pages right away
+      return res;
+    }
+    // spill inline data to a data page and turn header into a plain index
+    res = spiffs_object_inline_spill(fs, fd->obj_id, fs->work, cur_size);
+    SPIFFS_CHECK_RES(res);
+    res = spiffs_object_update_index_hdr(fs, fd, fd->obj_id,
+        fd->objix_hdr_pix, fs->work, 0, 0, 0, &new_objix_hdr_pix);
+    SPIFFS_CHECK_RES(res);
+    fd->cursor_objix_pix = fd->objix_hdr_pix;
+    fd->cursor_objix_spix = 0;
+    return res;
+  }
 
-  return res;
-}
+  _SPIFFS_MEMCPY(inline_data + offset, data, len);
+  objix_hdr->p_hdr.flags &= ~SPIFFS_PH_FLAG_INLINE;
+  if (objix_hdr->size == SPIFFS_UNDEFINED_LEN) {
+    // fresh object, index entries are still erased so program the page in place
+    objix_hdr->size = offset + len;
+    res = spiffs_page_index_check(fs, fd, fd->objix_hdr_pix, 0);
+    SPIFFS_CHECK_RES(res);
+    res = _spiffs_wr(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_UPDT,
+        fd->file_nbr, SPIFFS_PAGE_TO_PADDR(fs, fd->objix_hdr_pix), SPIFFS_CFG_LOG_PAGE_SZ(fs), fs->work);
+    SPIFFS_CHECK_RES(res);
+    spiffs_cb_object_event(fs, (spiffs_page_object_ix *)fs->work,
+        SPIFFS_EV_IX_UPD_HDR, fd->obj_id, 0, fd->objix_hdr_pix, objix_hdr->size);
+  } else {
+    res = spiffs_object_update_index_hdr(fs, fd, fd->obj_id,
+        fd->objix_hdr_pix, fs->work, 0, 0, MAX(cur_size, offset + len), &new_objix_hdr_pix);
+    SPIFFS_CHECK_RES(res);
+  }
+  SPIFFS_DBG("inline: "_SPIPRIid" stored "_SPIPRIi" bytes @ offs "_SPIPRIi" in objix_hdr "_SPIPRIpg"\n", fd->obj_id,
+      len, offset, fd->objix_hdr_pix);
+
+  fd->size = MAX(cur_size, offset + len);
+  fd->offset = offset + len;
+  fd->cursor_objix_pix = fd->objix_hdr_pix;
+  fd->cursor_objix_spix = 0;
+  *inlined = 1;
+
+  return res;
+}
+#endif // SPIFFS_INLINE_DATA && !SPIFFS_READ_ONLY
+
+#if SPIFFS_RING_FILES
+// Get the stream head of a ring object. Appends within the newest data page
+// leave the object index header in place: each one programs the bytes added
+// since the header was written into the next erased entry after the ring
+// pages. The head is the header size plus the largest count logged, counts a
+// torn program left out of range are skipped. Also returns the next erased
+// entry, or SPIFFS_RING_MAX_PAGES when the log is full.
+s32_t spiffs_object_ring_head(
+    spiffs *fs,
+    spiffs_file file_nbr,
+    spiffs_page_ix objix_hdr_pix,
+    u32_t size,
+    u32_t *head,
+    spiffs_span_ix *log_entry) {
+  s32_t res;
+  u32_t entries_addr = SPIFFS_PAGE_TO_PADDR(fs, objix_hdr_pix) + sizeof(spiffs_page_object_ix_header);
+  u32_t base = size == SPIFFS_UNDEFINED_LEN ? 0 : size;
+  u32_t page_offs = base % SPIFFS_DATA_PAGE_SIZE(fs);
+  // counts only ever fill up the page holding the header size
+  u32_t room = page_offs ? SPIFFS_DATA_PAGE_SIZE(fs) - page_offs : 0;
+  u32_t logged = 0;
+  spiffs_span_ix counts[8];
+  spiffs_span_ix pages;
+  spiffs_span_ix entry;
+
+  res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_READ,
+      file_nbr, entries_addr + SPIFFS_RING_MAX_PAGES(fs) * sizeof(spiffs_page_ix),
+      sizeof(spiffs_span_ix), (u8_t *)&pages);
+  SPIFFS_CHECK_RES(res);
+
+  for (entry = pages; entry < SPIFFS_RING_MAX_PAGES(fs); entry++) {
+    u32_t i = (entry - pages) % (sizeof(counts) / sizeof(counts[0]));
+    if (i == 0) {
+      res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_READ,
+          file_nbr, entries_addr + entry * sizeof(spiffs_page_ix),
+          MIN(sizeof(counts), (SPIFFS_RING_MAX_PAGES(fs) - entry) * sizeof(spiffs_span_ix)), (u8_t *)counts);
+      SPIFFS_CHECK_RES(res);
+    }
+    if (counts[i] == (spiffs_span_ix)-1) break;
+    if (counts[i] > logged && counts[i] <= room) {
+      logged = counts[i];
+    }
+  }
+
+  if (head) {
+    *head = base + logged;
+  }
+  if (log_entry) {
+    *log_entry = entry;
+  }
+  return res;
+}
+
+#if !SPIFFS_READ_ONLY
+// Create a ring object with room for given number of data pages
+s32_t spiffs_object_ring_create(
+    spiffs *fs,
+    spiffs_obj_id obj_id,
+    const u8_t name[],
+    spiffs_span_ix pages,
+    spiffs_page_ix *objix_hdr_pix) {
+  s32_t res;
+  spiffs_page_ix pix;
+  res = spiffs_object_create(fs, obj_id, name, 0, SPIFFS_TYPE_RING, &pix);
+  SPIFFS_CHECK_RES(res);
+  // index entries are still erased, program capacity into the last one
+  res = _spiffs_wr(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_UPDT,
+      0, SPIFFS_PAGE_TO_PADDR(fs, pix) + sizeof(spiffs_page_object_ix_header) +
+      SPIFFS_RING_MAX_PAGES(fs) * sizeof(spiffs_page_ix), sizeof(spiffs_span_ix), (u8_t *)&pages);
+  SPIFFS_CHECK_RES(res);
+  if (objix_hdr_pix) {
+    *objix_hdr_pix = pix;
+  }
+  return res;
+}
+
+// Drops a page a ring object no longer references. When all other pages of
+// its block are deleted the block is erased at once, else a page still in use
+// is deleted.
+static s32_t spiffs_object_ring_drop(spiffs *fs, spiffs_page_ix pix, u8_t in_use) {
+  s32_t res = spiffs_gc_erase_if_dead(fs, pix);
+  if (res == SPIFFS_ERR_NO_DELETED_BLOCKS) {
+    res = in_use ? spiffs_page_delete(fs, pix) : SPIFFS_OK;
+  }
+  return res;
+}
+
+// Rewrites the object index header of a ring object from the work buffer with
+// given head, with an empty log, and drops the former header page.
+static s32_t spiffs_object_ring_update_hdr(spiffs_fd *fd, u32_t head) {
+  spiffs *fs = fd->fs;
+  s32_t res;
+  spiffs_page_ix *objix_entries = (spiffs_page_ix *)(fs->work + sizeof(spiffs_page_object_ix_header));
+  spiffs_page_ix old_objix_hdr_pix = fd->objix_hdr_pix;
+  spiffs_page_ix new_objix_hdr_pix;
+
+  memset(&objix_entries[fd->ring_pages], 0xff,
+      (SPIFFS_RING_MAX_PAGES(fs) - fd->ring_pages) * sizeof(spiffs_page_ix));
+  res = spiffs_object_update_index_hdr(fs, fd, fd->obj_id,
+      fd->objix_hdr_pix, fs->work, 0, 0, head, &new_objix_hdr_pix);
+  SPIFFS_CHECK_RES(res);
+  return spiffs_object_ring_drop(fs, old_objix_hdr_pix, 0);
+}
+
+// Append to a ring object. Each data page starting a new stream page takes
+// the span index of the oldest page: the new page is written, the object
+// index header is rewritten to reference it, and only then is the oldest page
+// dropped, so a power loss always leaves a page referenced. Filling up the
+// newest page only logs the bytes added in the header, see
+// spiffs_object_ring_head; the header is rewritten once per data page, or
+// when its log is full.
+s32_t spiffs_object_ring_append(spiffs_fd *fd, u8_t *data, u32_t len) {
+  spiffs *fs = fd->fs;
+  s32_t res = SPIFFS_OK;
+  spiffs_page_object_ix_header *objix_hdr = (spiffs_page_object_ix_header *)fs->work;
+  spiffs_page_ix *objix_entries = (spiffs_page_ix *)(fs->work + sizeof(spiffs_page_object_ix_header));
+  u32_t head;
+  u32_t written = 0;
+  u8_t filled = 0;
+  spiffs_span_ix log_entry;
+  spiffs_page_ix data_pix;
+
+  // gc uses the work buffer, make room before loading the header: each new
+  // stream page takes a data page and a header copy
+  res = spiffs_gc_check(fs, 2 * (len + SPIFFS_DATA_PAGE_SIZE(fs)));
+  SPIFFS_CHECK_RES(res);
+
+  res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_READ,
+      fd->file_nbr, SPIFFS_PAGE_TO_PADDR(fs, fd->objix_hdr_pix), SPIFFS_CFG_LOG_PAGE_SZ(fs), fs->work);
+  SPIFFS_CHECK_RES(res);
+  SPIFFS_VALIDATE_OBJIX(objix_hdr->p_hdr, fd->obj_id, 0);
+  res = spiffs_object_ring_head(fs, fd->file_nbr, fd->objix_hdr_pix, objix_hdr->size, &head, &log_entry);
+  SPIFFS_CHECK_RES(res);
+
+  while (res == SPIFFS_OK && written < len) {
+    spiffs_span_ix data_spix = (head / SPIFFS_DATA_PAGE_SIZE(fs)) % fd->ring_pages;
+    u32_t page_offs = head % SPIFFS_DATA_PAGE_SIZE(fs);
+    u32_t to_write = MIN(len - written, SPIFFS_DATA_PAGE_SIZE(fs) - page_offs);
+    if (page_offs == 0) {
+      // new stream page, replaces the oldest one if the ring is full
+      spiffs_page_ix old_data_pix = objix_entries[data_spix];
+      spiffs_page_header p_hdr;
+      p_hdr.obj_id = fd->obj_id & ~SPIFFS_OBJ_ID_IX_FLAG;
+      p_hdr.span_ix = data_spix;
+      p_hdr.flags = 0xff;
+      res = spiffs_page_allocate_data(fs, fd->obj_id & ~SPIFFS_OBJ_ID_IX_FLAG,
+          &p_hdr, &data[written], to_write, 0, 1, &data_pix);
+      SPIFFS_DBG("ring: "_SPIPRIid" store new data page, "_SPIPRIpg":"_SPIPRIsp" offset:"_SPIPRIi", len "_SPIPRIi", written "_SPIPRIi"\n", fd->obj_id,
+          data_pix, data_spix, head, to_write, written);
+      SPIFFS_CHECK_RES(res);
+      objix_entries[data_spix] = data_pix;
+      res = spiffs_object_ring_update_hdr(fd, head + to_write);
+      SPIFFS_CHECK_RES(res);
+      log_entry = fd->ring_pages;
+      filled = 0;
+      if (old_data_pix != (spiffs_page_ix)-1) {
+        res = spiffs_page_data_check(fs, fd, old_data_pix, data_spix);
+        SPIFFS_CHECK_RES(res);
+        res = spiffs_object_ring_drop(fs, old_data_pix, 1);
+        SPIFFS_CHECK_RES(res);
+      }
+    } else {
+      // fill up the erased part of the newest page in place
+      data_pix = objix_entries[data_spix];
+      res = spiffs_page_data_check(fs, fd, data_pix, data_spix);
+      SPIFFS_CHECK_RES(res);
+      res = _spiffs_wr(fs, SPIFFS_OP_T_OBJ_DA | SPIFFS_OP_C_UPDT,
+          fd->file_nbr, SPIFFS_PAGE_TO_PADDR(fs, data_pix) + sizeof(spiffs_page_header) + page_offs,
+          to_write, &data[written]);
+      SPIFFS_DBG("ring: "_SPIPRIid" store to existing data page, "_SPIPRIpg":"_SPIPRIsp" offset:"_SPIPRIi", len "_SPIPRIi", written "_SPIPRIi"\n", fd->obj_id,
+          data_pix, data_spix, head, to_write, written);
+      SPIFFS_CHECK_RES(res);
+      filled = 1;
+    }
+    written += to_write;
+    head += to_write;
+  }
+
+  if (filled && log_entry < SPIFFS_RING_MAX_PAGES(fs)) {
+    // log the bytes added since the header was written, in place
+    spiffs_span_ix count = head - objix_hdr->size;
+    res = _spiffs_wr(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_UPDT,
+        fd->file_nbr, SPIFFS_PAGE_TO_PADDR(fs, fd->objix_hdr_pix) + sizeof(spiffs_page_object_ix_header) +
+        log_entry * sizeof(spiffs_page_ix), sizeof(spiffs_span_ix), (u8_t *)&count);
+    SPIFFS_CHECK_RES(res);
+    spiffs_cb_object_event(fs, (spiffs_page_object_ix *)fs->work,
+        SPIFFS_EV_IX_UPD_HDR, fd->obj_id, 0, fd->objix_hdr_pix, head);
+  } else if (filled) {
+    res = spiffs_object_ring_update_hdr(fd, head);
+    SPIFFS_CHECK_RES(res);
+  }
+  fd->size = head;
+  fd->offset = head;
+  fd->cursor_objix_pix = fd->objix_hdr_pix;
+  fd->cursor_objix_spix = 0;
+
+  return res;
+}
+
+// Clears a ring object, or removes it fully
+static s32_t spiffs_object_ring_truncate(spiffs_fd *fd, u8_t remove_full) {
+  spiffs *fs = fd->fs;
+  s32_t res;
+  spiffs_page_object_ix_header *objix_hdr = (spiffs_page_object_ix_header *)fs->work;
+  spiffs_page_ix *objix_entries = (spiffs_page_ix *)(fs->work + sizeof(spiffs_page_object_ix_header));
+  spiffs_span_ix data_spix;
+
+  res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_READ,
+      fd->file_nbr, SPIFFS_PAGE_TO_PADDR(fs, fd->objix_hdr_pix), SPIFFS_CFG_LOG_PAGE_SZ(fs), fs->work);
+  SPIFFS_CHECK_RES(res);
+  SPIFFS_VALIDATE_OBJIX(objix_hdr->p_hdr, fd->obj_id, 0);
+
+  for (data_spix = 0; data_spix < fd->ring_pages; data_spix++) {
+    if (objix_entries[data_spix] == (spiffs_page_ix)-1) continue;
+    res = spiffs_page_data_check(fs, fd, objix_entries[data_spix], data_spix);
+    SPIFFS_CHECK_RES(res);
+    res = spiffs_page_delete(fs, objix_entries[data_spix]);
+    SPIFFS_CHECK_RES(res);
+    objix_entries[data_spix] = (spiffs_page_ix)-1;
+  }
+
+  if (remove_full) {
+    SPIFFS_DBG("ring: remove object index header page "_SPIPRIpg"\n", fd->objix_hdr_pix);
+    res = spiffs_page_index_check(fs, fd, fd->objix_hdr_pix, 0);
+    SPIFFS_CHECK_RES(res);
+    res = spiffs_page_delete(fs, fd->objix_hdr_pix);
+    SPIFFS_CHECK_RES(res);
+    spiffs_cb_object_event(fs, (spiffs_page_object_ix *)0,
+        SPIFFS_EV_IX_DEL, fd->obj_id, 0, fd->objix_hdr_pix, 0);
+  } else {
+    res = spiffs_object_ring_update_hdr(fd, SPIFFS_UNDEFINED_LEN);
+    SPIFFS_CHECK_RES(res);
+  }
+  fd->size = 0;
+  fd->offset = 0;
+  return res;
+}
+#endif // !SPIFFS_READ_ONLY
+
+// Read from a ring object at given stream position. Returns number of bytes
+// read, or error
+s32_t spiffs_object_ring_read(spiffs_fd *fd, u32_t offset, u32_t len, u8_t *dst) {
+  spiffs *fs = fd->fs;
+  s32_t res = SPIFFS_OK;
+  u32_t head = fd->size == SPIFFS_UNDEFINED_LEN ? 0 : fd->size;
+  u32_t cur_offset = offset;
+  spiffs_page_ix data_pix;
+
+  if (offset < SPIFFS_RING_TAIL(fs, head, fd->ring_pages)) {
+    return SPIFFS_ERR_RING_OVERWRITTEN;
+  }
+  if (offset >= head) {
+    return SPIFFS_ERR_END_OF_OBJECT;
+  }
+  len = MIN(len, head - offset);
+
+  while (cur_offset < offset + len) {
+    spiffs_span_ix data_spix = (cur_offset / SPIFFS_DATA_PAGE_SIZE(fs)) % fd->ring_pages;
+    u32_t page_offs = cur_offset % SPIFFS_DATA_PAGE_SIZE(fs);
+    u32_t len_to_read = MIN(offset + len - cur_offset, SPIFFS_DATA_PAGE_SIZE(fs) - page_offs);
+    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_READ,
+        fd->file_nbr, SPIFFS_PAGE_TO_PADDR(fs, fd->objix_hdr_pix) + sizeof(spiffs_page_object_ix_header) +
+        data_spix * sizeof(spiffs_page_ix), sizeof(spiffs_page_ix), (u8_t *)&data_pix);
+    SPIFFS_CHECK_RES(res);
+    res = spiffs_page_data_check(fs, fd, data_pix, data_spix);
+    SPIFFS_CHECK_RES(res);
+    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_DA | SPIFFS_OP_C_READ,
+        fd->file_nbr, SPIFFS_PAGE_TO_PADDR(fs, data_pix) + sizeof(spiffs_page_header) + page_offs,
+        len_to_read, dst);
+    SPIFFS_CHECK_RES(res);
+    dst += len_to_read;
+    cur_offset += len_to_read;
+  }
+  fd->offset = cur_offset;
+
+  return len;
+}
+#endif // SPIFFS_RING_FILES
+
+#if SPIFFS_COMPRESSED_FILES
+// Compressed files are stored as a sequence of frames, one per data page, so
+// frame i starts at object offset i * SPIFFS_DATA_PAGE_SIZE. Each frame is a
+// spiffs_compress_frame_hdr followed by LZ4 style sequences: a token byte with
+// literal and match length nibbles, extra length bytes for nibbles of 15, the
+// literals, a two byte little endian back reference and extra match length
+// bytes. The last sequence may end after its literals. References never reach
+// outside the frame, so each frame is decoded on its own.
+
+#define SPIFFS_COMPRESS_MIN_MATCH 4
+
+#define SPIFFS_COMPRESS_FRAME_LEN(fs) \
+  (SPIFFS_DATA_PAGE_SIZE(fs) - sizeof(spiffs_compress_frame_hdr))
+
+// Decodes a frame payload into dst, returns number of bytes decoded or error
+static s32_t spiffs_compress_decode(const u8_t *src, u32_t src_len, u8_t *dst, u32_t dst_size) {
+  const u8_t *ip = src;
+  const u8_t *iend = src + src_len;
+  u8_t *op = dst;
+  u8_t *oend = dst + dst_size;
+  u8_t b;
+
+  while (ip < iend) {
+    u32_t token = *ip++;
+    u32_t lit = token >> 4;
+    if (lit == 15) {
+      do {
+        if (ip >= iend) return SPIFFS_ERR_COMPRESS_CORRUPT;
+        b = *ip++;
+        lit += b;
+      } while (b == 255);
+    }
+    if (lit > (u32_t)(iend - ip) || lit > (u32_t)(oend - op)) {
+      return SPIFFS_ERR_COMPRESS_CORRUPT;
+    }
+    _SPIFFS_MEMCPY(op, ip, lit);
+    ip += lit;
+    op += lit;
+    if (ip >= iend) {
+      // last sequence, literals only
+      break;
+    }
+    if (iend - ip < 2) return SPIFFS_ERR_COMPRESS_CORRUPT;
+    u32_t ref = ip[0] | (ip[1] << 8);
+    ip += 2;
+    u32_t match = token & 0x0f;
+    if (match == 15) {
+      do {
+        if (ip >= iend) return SPIFFS_ERR_COMPRESS_CORRUPT;
+        b = *ip++;
+        match += b;
+      } while (b == 255);
+    }
+    match += SPIFFS_COMPRESS_MIN_MATCH;
+    if (ref == 0 || ref > (u32_t)(op - dst) || match > (u32_t)(oend - op)) {
+      return SPIFFS_ERR_COMPRESS_CORRUPT;
+    }
+    // byte by byte, the reference may overlap the output
+    const u8_t *mp = op - ref;
+    while (match--) {
+      *op++ = *mp++;
+    }
+  }
+  return (s32_t)(op - dst);
+}
+
+// Reads and decodes given frame into the compression buffer
+static s32_t spiffs_compress_fetch(spiffs_fd *fd, u32_t frame_ix) {
+  spiffs *fs = fd->fs;
+  spiffs_compress *c = spiffs_get_compress(fs);
+  spiffs_compress_frame_hdr *f_hdr = (spiffs_compress_frame_hdr *)c->frame;
+  s32_t res;
+
+  if (frame_ix >= c->frame_count) {
+    // nothing written after the last frame yet
+    c->frame_ix = c->frame_count;
+    c->raw_offset = c->size;
+    c->raw_len = 0;
+    return SPIFFS_OK;
+  }
+  res = spiffs_object_read(fd, frame_ix * SPIFFS_DATA_PAGE_SIZE(fs), SPIFFS_DATA_PAGE_SIZE(fs), c->frame);
+  SPIFFS_CHECK_RES(res);
+  u32_t len = f_hdr->len & ~SPIFFS_COMPRESS_FRAME_SEALED;
+  if (len > SPIFFS_COMPRESS_FRAME_LEN(fs) || f_hdr->raw_len > c->raw_size) {
+    return SPIFFS_ERR_COMPRESS_CORRUPT;
+  }
+  res = spiffs_compress_decode(c->frame + sizeof(spiffs_compress_frame_hdr), len, c->raw, c->raw_size);
+  if (res >= 0 && (u32_t)res != f_hdr->raw_len) {
+    res = SPIFFS_ERR_COMPRESS_CORRUPT;
+  }
+  if (res < 0) {
+    // keep the buffer consistent, holding nothing
+    c->frame_ix = c->frame_count;
+    c->raw_offset = c->size;
+    c->raw_len = 0;
+    return res;
+  }
+  SPIFFS_DBG("compress: "_SPIPRIid" fetched frame "_SPIPRIi", offs "_SPIPRIi", "_SPIPRIi" of "_SPIPRIi" bytes\n",
+      fd->obj_id, frame_ix, f_hdr->offset, len, f_hdr->raw_len);
+  c->frame_ix = frame_ix;
+  c->raw_offset = f_hdr->offset;
+  c->raw_len = f_hdr->raw_len;
+  return SPIFFS_OK;
+}
+
+// Finds the number of frames and the uncompressed size from the last frame
+// header, once after the file was claimed
+static s32_t spiffs_compress_load(spiffs_fd *fd) {
+  spiffs *fs = fd->fs;
+  spiffs_compress *c = spiffs_get_compress(fs);
+  spiffs_compress_frame_hdr f_hdr;
+  s32_t res = SPIFFS_OK;
+
+  if (c == 0 || c->file_nbr != fd->file_nbr) {
+    return SPIFFS_ERR_COMPRESS_BUF;
+  }
+  if (c->frame_count != (u32_t)-1) {
+    return res;
+  }
+  u32_t size = fd->size == SPIFFS_UNDEFINED_LEN ? 0 : fd->size;
+  if (size % SPIFFS_DATA_PAGE_SIZE(fs)) {
+    return SPIFFS_ERR_COMPRESS_CORRUPT;
+  }
+  c->frame_count = size / SPIFFS_DATA_PAGE_SIZE(fs);
+  c->size = 0;
+  c->last_sealed = 1;
+  if (c->frame_count > 0) {
+    res = spiffs_object_read(fd, (c->frame_count - 1) * SPIFFS_DATA_PAGE_SIZE(fs),
+        sizeof(spiffs_compress_frame_hdr), (u8_t *)&f_hdr);
+    SPIFFS_CHECK_RES(res);
+    c->size = f_hdr.offset + f_hdr.raw_len;
+    c->last_sealed = (f_hdr.len & SPIFFS_COMPRESS_FRAME_SEALED) != 0;
+  }
+  c->frame_ix = c->frame_count;
+  c->raw_offset = c->size;
+  c->raw_len = 0;
+  c->dirty = 0;
+  return res;
+}
+
+// Finds the frame holding given uncompressed offset, by a binary search on
+// the frame headers
+static s32_t spiffs_compress_locate(spiffs_fd *fd, u32_t offset, u32_t *frame_ix) {
+  spiffs *fs = fd->fs;
+  spiffs_compress *c = spiffs_get_compress(fs);
+  u32_t frame_offset;
+  u32_t lo = 0;
+  u32_t hi = c->frame_count - 1;
+  s32_t res;
+
+  while (lo < hi) {
+    u32_t mid = (lo + hi + 1) / 2;
+    res = spiffs_object_read(fd, mid * SPIFFS_DATA_PAGE_SIZE(fs),
+        sizeof(u32_t), (u8_t *)&frame_offset);
+    SPIFFS_CHECK_RES(res);
+    if (frame_offset <= offset) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  *frame_ix = lo;
+  return SPIFFS_OK;
+}
+
+s32_t spiffs_object_compress_claim(spiffs_fd *fd) {
+  spiffs_compress *c = spiffs_get_compress(fd->fs);
+  if ((fd->flags & SPIFFS_O_COMPRESS) == 0) {
+    return SPIFFS_OK;
+  }
+  if (c == 0 || c->file_nbr != 0) {
+    return SPIFFS_ERR_COMPRESS_BUF;
+  }
+  c->file_nbr = fd->file_nbr;
+  // loaded on first use, after any truncation when opening
+  c->frame_count = (u32_t)-1;
+  c->dirty = 0;
+  return SPIFFS_OK;
+}
+
+void spiffs_object_compress_release(spiffs *fs, spiffs_fd *fd) {
+  spiffs_compress *c = spiffs_get_compress(fs);
+  if (c && c->file_nbr == fd->file_nbr) {
+    c->file_nbr = 0;
+  }
+}
+
+s32_t spiffs_object_compress_size(spiffs_fd *fd, u32_t *size) {
+  s32_t res = spiffs_compress_load(fd);
+  SPIFFS_CHECK_RES(res);
+  *size = spiffs_get_compress(fd->fs)->size;
+  return res;
+}
+
+// Reads from a compressed object at given uncompressed offset. Returns number
+// of bytes read, or error
+s32_t spiffs_object_compress_read(spiffs_fd *fd, u32_t offset, u32_t len, u8_t *dst) {
+  spiffs *fs = fd->fs;
+  spiffs_compress *c = spiffs_get_compress(fs);
+  u32_t done = 0;
+  u32_t frame_ix;
+  s32_t res;
+
+  res = spiffs_compress_load(fd);
+  SPIFFS_CHECK_RES(res);
+  if (len > 0 && offset >= c->size) {
+    return SPIFFS_ERR_END_OF_OBJECT;
+  }
+  len = MIN(len, c->size - offset);
+
+  while (done < len) {
+    if (offset < c->raw_offset || offset >= c->raw_offset + c->raw_len) {
+#if !SPIFFS_READ_ONLY
+      // appended bytes must be on the medium before the buffer is reused
+      res = spiffs_object_compress_flush(fd);
+      SPIFFS_CHECK_RES(res);
+#endif
+      if (offset == c->raw_offset + c->raw_len && c->frame_ix + 1 < c->frame_count) {
+        // streaming on into the next frame
+        frame_ix = c->frame_ix + 1;
+      } else {
+        res = spiffs_compress_locate(fd, offset, &frame_ix);
+        SPIFFS_CHECK_RES(res);
+      }
+      res = spiffs_compress_fetch(fd, frame_ix);
+      SPIFFS_CHECK_RES(res);
+      if (offset < c->raw_offset || offset >= c->raw_offset + c->raw_len) {
+        return SPIFFS_ERR_COMPRESS_CORRUPT;
+      }
+    }
+    u32_t len_to_read = MIN(len - done, c->raw_offset + c->raw_len - offset);
+    _SPIFFS_MEMCPY(dst + done, c->raw + (offset - c->raw_offset), len_to_read);
+    done += len_to_read;
+    offset += len_to_read;
+  }
+
+  return (s32_t)done;
+}
+
+#if !SPIFFS_READ_ONLY
+static u32_t spiffs_compress_rd32(const u8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32_t)p[3] << 24);
+}
+
+// number of extra bytes needed for a length that does not fit a nibble
+static u32_t spiffs_compress_len_ext(u32_t len) {
+  return len < 15 ? 0 : (len - 15) / 255 + 1;
+}
+
+static u8_t *spiffs_compress_put_len_ext(u8_t *op, u32_t len) {
+  len -= 15;
+  while (len >= 255) {
+    *op++ = 255;
+    len -= 255;
+  }
+  *op++ = (u8_t)len;
+  return op;
+}
+
+// Greedily encodes as much of src as fits in dst_size bytes. Returns the
+// encoded length, consumed is populated with the number of source bytes
+// encoded
+static u32_t spiffs_compress_encode(const u8_t *src, u32_t src_len, u16_t *hash,
+    u8_t *dst, u32_t dst_size, u32_t *consumed) {
+  u8_t *op = dst;
+  u8_t *oend = dst + dst_size;
+  u32_t ip = 0;
+  u32_t anchor = 0;
+  u32_t lit;
+
+  memset(hash, 0, sizeof(u16_t) << SPIFFS_COMPRESS_HASH_BITS);
+  while (ip + SPIFFS_COMPRESS_MIN_MATCH <= src_len) {
+    u32_t seq = spiffs_compress_rd32(&src[ip]);
+    u32_t h = (u32_t)(seq * 2654435761u) >> (32 - SPIFFS_COMPRESS_HASH_BITS);
+    u32_t ref = hash[h];
+    hash[h] = (u16_t)ip;
+    if (ref >= ip || spiffs_compress_rd32(&src[ref]) != seq) {
+      ip++;
+      continue;
+    }
+    u32_t match = SPIFFS_COMPRESS_MIN_MATCH;
+    while (ip + match < src_len && src[ref + match] == src[ip + match]) {
+      match++;
+    }
+    lit = ip - anchor;
+    u32_t m_len = match - SPIFFS_COMPRESS_MIN_MATCH;
+    if (1 + spiffs_compress_len_ext(lit) + lit + 2 + spiffs_compress_len_ext(m_len) > (u32_t)(oend - op)) {
+      // frame full, end with what literals still fit
+      break;
+    }
+    *op++ = (MIN(lit, 15) << 4) | MIN(m_len, 15);
+    if (lit >= 15) op = spiffs_compress_put_len_ext(op, lit);
+    _SPIFFS_MEMCPY(op, &src[anchor], lit);
+    op += lit;
+    *op++ = (u8_t)(ip - ref);
+    *op++ = (u8_t)((ip - ref) >> 8);
+    if (m_len >= 15) op = spiffs_compress_put_len_ext(op, m_len);
+    ip += match;
+    anchor = ip;
+  }
+
+  u32_t room = oend - op;
+  lit = room > 0 ? MIN(src_len - anchor, room - 1) : 0;
+  while (lit > 0 && 1 + spiffs_compress_len_ext(lit) + lit > room) {
+    lit--;
+  }
+  if (lit > 0) {
+    *op++ = MIN(lit, 15) << 4;
+    if (lit >= 15) op = spiffs_compress_put_len_ext(op, lit);
+    _SPIFFS_MEMCPY(op, &src[anchor], lit);
+    op += lit;
+  }
+  *consumed = anchor + lit;
+  return (u32_t)(op - dst);
+}
+
+// Encodes the buffered bytes into the frame held and writes it, appending a
+// data page or rewriting the existing one. If not all buffered bytes fit, or
+// the buffer is full, the frame is sealed and the buffer moves on to the
+// next frame with the remaining bytes.
+static s32_t spiffs_compress_emit(spiffs_fd *fd) {
+  spiffs *fs = fd->fs;
+  spiffs_compress *c = spiffs_get_compress(fs);
+  spiffs_compress_frame_hdr *f_hdr = (spiffs_compress_frame_hdr *)c->frame;
+  u32_t offset = c->frame_ix * SPIFFS_DATA_PAGE_SIZE(fs);
+  u32_t consumed;
+  s32_t res;
+
+  u32_t len = spiffs_compress_encode(c->raw, c->raw_len, c->hash,
+      c->frame + sizeof(spiffs_compress_frame_hdr), SPIFFS_COMPRESS_FRAME_LEN(fs), &consumed);
+  u8_t sealed = consumed < c->raw_len || c->raw_len == c->raw_size;
+  f_hdr->offset = c->raw_offset;
+  f_hdr->raw_len = consumed;
+  f_hdr->len = len | (sealed ? SPIFFS_COMPRESS_FRAME_SEALED : 0);
+  // pad with erased bytes, each frame takes a full data page
+  memset(c->frame + sizeof(spiffs_compress_frame_hdr) + len, 0xff, SPIFFS_COMPRESS_FRAME_LEN(fs) - len);
+
+  SPIFFS_DBG("compress: "_SPIPRIid" emit frame "_SPIPRIi", offs "_SPIPRIi", "_SPIPRIi" of "_SPIPRIi" bytes%s\n",
+      fd->obj_id, c->frame_ix, c->raw_offset, len, consumed, sealed ? ", sealed" : "");
+  if (c->frame_ix < c->frame_count) {
+    res = spiffs_object_modify(fd, offset, c->frame, SPIFFS_DATA_PAGE_SIZE(fs));
+  } else {
+    res = spiffs_object_append(fd, offset, c->frame, SPIFFS_DATA_PAGE_SIZE(fs));
+  }
+  SPIFFS_CHECK_RES(res);
+  if (c->frame_ix >= c->frame_count) {
+    c->frame_count = c->frame_ix + 1;
+  }
+  if (c->frame_ix == c->frame_count - 1) {
+    c->last_sealed = sealed;
+  }
+
+  if (sealed) {
+    memmove(c->raw, c->raw + consumed, c->raw_len - consumed);
+    c->raw_len -= consumed;
+    c->raw_offset += consumed;
+    c->frame_ix++;
+  }
+  c->dirty = c->raw_len > 0 && sealed;
+  return res;
+}
+
+// Appends to a compressed object. Bytes are buffered, and a frame is written
+// each time the buffer fills up
+s32_t spiffs_object_compress_append(spiffs_fd *fd, u8_t *data, u32_t len) {
+  spiffs *fs = fd->fs;
+  spiffs_compress *c = spiffs_get_compress(fs);
+  s32_t res;
+
+  res = spiffs_compress_load(fd);
+  SPIFFS_CHECK_RES(res);
+
+  // bytes go to the last frame unless it is sealed
+  u32_t tail_ix = c->frame_count == 0 || c->last_sealed ? c->frame_count : c->frame_count - 1;
+  if (c->frame_ix != tail_ix) {
+    res = spiffs_object_compress_flush(fd);
+    SPIFFS_CHECK_RES(res);
+    tail_ix = c->frame_count == 0 || c->last_sealed ? c->frame_count : c->frame_count - 1;
+    res = spiffs_compress_fetch(fd, tail_ix);
+    SPIFFS_CHECK_RES(res);
+  }
+
+  while (len > 0) {
+    u32_t to_copy = MIN(len, (u32_t)(c->raw_size - c->raw_len));
+    _SPIFFS_MEMCPY(c->raw + c->raw_len, data, to_copy);
+    c->raw_len += to_copy;
+    c->size += to_copy;
+    c->dirty = 1;
+    data += to_copy;
+    len -= to_copy;
+    if (c->raw_len == c->raw_size) {
+      res = spiffs_compress_emit(fd);
+      SPIFFS_CHECK_RES(res);
+    }
+  }
+  return SPIFFS_OK;
+}
+
+// Writes all buffered bytes of a compressed object to the medium. The
+// buffer keeps the last frame, so following appends rewrite it
+s32_t spiffs_object_compress_flush(spiffs_fd *fd) {
+  spiffs_compress *c = spiffs_get_compress(fd->fs);
+  s32_t res = SPIFFS_OK;
+  if (c == 0 || c->file_nbr != fd->file_nbr) {
+    return res;
+  }
+  while (c->dirty) {
+    res = spiffs_compress_emit(fd);
+    SPIFFS_CHECK_RES(res);
+  }
+  return res;
+}
+#endif // !SPIFFS_READ_ONLY
+#endif // SPIFFS_COMPRESSED_FILES
+
+static s32_t spiffs_object_find_object_index_header_by_name_v(
+    spiffs *fs,
+    spiffs_obj_id obj_id,
+    spiffs_block_ix bix,
+    int ix_entry,
+    const void *user_const_p,
+    void *user_var_p) {
+  (void)user_var_p;
+  s32_t res;
+  spiffs_page_object_ix_header objix_hdr;
+  spiffs_page_ix pix = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, ix_entry);
+  if (obj_id == SPIFFS_OBJ_ID_FREE || obj_id == SPIFFS_OBJ_ID_DELETED ||
+      (obj_id & SPIFFS_OBJ_ID_IX_FLAG) == 0) {
+    return SPIFFS_VIS_COUNTINUE;
+  }
+  res = spiffs_object_hdr_name_match(fs, pix, (const spiffs_name_key *)user_const_p, &objix_hdr);
+  SPIFFS_CHECK_RES(res);
+  if (res && (objix_hdr.p_hdr.flags & SPIFFS_PH_FLAG_IXDELE)) {
+    return SPIFFS_OK;
+  }
+
+  return SPIFFS_VIS_COUNTINUE;
+}
+
+// Finds object index header page by name
+s32_t spiffs_object_find_object_index_header_by_name(
+    spiffs *fs,
+    const u8_t name[SPIFFS_OBJ_NAME_LEN],
+    spiffs_page_ix *pix) {
+  s32_t res;
+  spiffs_block_ix bix;
+  int entry;
+  spiffs_name_key key;
+
+  spiffs_name_key_init(fs, &key, name);
+  res = spiffs_obj_lu_find_entry_visitor(fs,
+      fs->cursor_block_ix,
+      fs->cursor_obj_lu_entry,
+      0,
+      0,
+      spiffs_object_find_object_index_header_by_name_v,
+      &key,
+      0,
+      &bix,
+      &entry);
+
+  if (res == SPIFFS_VIS_END) {
+    res = SPIFFS_ERR_NOT_FOUND;
+  }
+  SPIFFS_CHECK_RES(res);
+
+  if (pix) {
+    *pix = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, entry);
+  }
+
+  fs->cursor_block_ix = bix;
+  fs->cursor_obj_lu_entry = entry;
+
+  return res;
+}
 
 #if !SPIFFS_READ_ONLY
 // Truncates object to new size. If new size is null, object may be removed totally
@@ -1722,6 +2900,16 @@ s32_t spiffs_object_truncate(
     return res;
   }
 
+#if SPIFFS_RING_FILES
+  if (fd->ring_pages) {
+    if (new_size != 0) {
+      // a ring can only be cleared
+      return SPIFFS_ERR_NOT_A_FILE;
+    }
+    return spiffs_object_ring_truncate(fd, remove_full);
+  }
+#endif
+
   // need 2 pages if not removing: object index page + possibly chopped data page
   if (remove_full == 0) {
     res = spiffs_gc_check(fs, SPIFFS_DATA_PAGE_SIZE(fs) * 2);
@@ -1738,6 +2926,48 @@ s32_t spiffs_object_truncate(
   spiffs_page_ix data_pix;
   spiffs_page_ix new_objix_hdr_pix;
 
+#if SPIFFS_INLINE_DATA
+  if (cur_size > 0 && cur_size <= SPIFFS_OBJ_HDR_INLINE_LEN(fs)) {
+    // small object, data may be inline in the object index header page
+    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_READ,
+        fd->file_nbr, SPIFFS_PAGE_TO_PADDR(fs, objix_pix), SPIFFS_CFG_LOG_PAGE_SZ(fs), fs->work);
+    SPIFFS_CHECK_RES(res);
+    SPIFFS_VALIDATE_OBJIX(objix_hdr->p_hdr, fd->obj_id, 0);
+    if ((objix_hdr->p_hdr.flags & SPIFFS_PH_FLAG_INLINE) == 0) {
+      if (remove_full && new_size == 0) {
+        // no data pages, only the header page to remove
+        SPIFFS_DBG("truncate: remove inline object index header page "_SPIPRIpg"\n", objix_pix);
+        res = spiffs_page_index_check(fs, fd, objix_pix, 0);
+        SPIFFS_CHECK_RES(res);
+        res = spiffs_page_delete(fs, objix_pix);
+        SPIFFS_CHECK_RES(res);
+        spiffs_cb_object_event(fs, (spiffs_page_object_ix *)0,
+            SPIFFS_EV_IX_DEL, fd->obj_id, 0, objix_pix, 0);
+        fd->size = 0;
+        return res;
+      }
+      if (new_size >= cur_size) {
+        return res;
+      }
+      u32_t hdr_size = new_size;
+      u32_t data_offs = spiffs_object_hdr_data_offs(objix_hdr);
+      if (new_size == 0) {
+        // make uninitialized object
+        objix_hdr->p_hdr.flags |= SPIFFS_PH_FLAG_INLINE;
+        hdr_size = SPIFFS_UNDEFINED_LEN;
+      }
+      memset(fs->work + data_offs + new_size, 0xff, SPIFFS_CFG_LOG_PAGE_SZ(fs) - data_offs - new_size);
+      SPIFFS_DBG("truncate: inline objix_hdr page "_SPIPRIpg" to size "_SPIPRIi"\n", objix_pix, new_size);
+      res = spiffs_object_update_index_hdr(fs, fd, fd->obj_id,
+          objix_pix, fs->work, 0, 0, hdr_size, &new_objix_hdr_pix);
+      SPIFFS_CHECK_RES(res);
+      fd->size = new_size;
+      fd->offset = new_size;
+      return res;
+    }
+  }
+#endif
+
   // before truncating, check if object is to be fully removed and mark this
   if (remove_full && new_size == 0) {
     u8_t flags = ~( SPIFFS_PH_FLAG_USED | SPIFFS_PH_FLAG_INDEX | SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_IXDELE);
@@ -1949,6 +3179,349 @@ s32_t spiffs_object_truncate(
 } // spiffs_object_truncate
 #endif // !SPIFFS_READ_ONLY
 
+#if SPIFFS_TXN && !SPIFFS_READ_ONLY
+// Removes the current version of an object whose index header is at pix,
+// using a free fd. The header is marked as being deleted first, so that an
+// interrupted removal is finished rather than undone.
+static s32_t spiffs_txn_remove(spiffs *fs, spiffs_page_ix pix) {
+  s32_t res;
+  spiffs_fd *fd;
+  u8_t flags = ~(SPIFFS_PH_FLAG_USED | SPIFFS_PH_FLAG_INDEX | SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_IXDELE);
+  res = _spiffs_wr(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_UPDT,
+      0, SPIFFS_PAGE_TO_PADDR(fs, pix) + offsetof(spiffs_page_header, flags), sizeof(u8_t), &flags);
+  SPIFFS_CHECK_RES(res);
+  res = spiffs_fd_find_new(fs, &fd, 0);
+  SPIFFS_CHECK_RES(res);
+  res = spiffs_object_open_by_page(fs, pix, fd, 0, 0);
+  if (res == SPIFFS_OK) {
+    // closes the fd on success
+    res = spiffs_object_truncate(fd, 0, 1);
+  }
+  if (res != SPIFFS_OK) {
+    spiffs_fd_return(fs, fd->file_nbr);
+  }
+  return res;
+}
+
+static s32_t spiffs_txn_purge_v(
+    spiffs *fs,
+    spiffs_obj_id obj_id,
+    spiffs_block_ix bix,
+    int ix_entry,
+    const void *user_const_p,
+    void *user_var_p) {
+  s32_t res;
+  spiffs_page_ix pix = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, ix_entry);
+  if (obj_id == SPIFFS_OBJ_ID_FREE || obj_id == SPIFFS_OBJ_ID_DELETED ||
+      (obj_id & ~SPIFFS_OBJ_ID_IX_FLAG) != *(const spiffs_obj_id *)user_const_p ||
+      pix == *(spiffs_page_ix *)user_var_p) {
+    return SPIFFS_VIS_COUNTINUE;
+  }
+  res = spiffs_page_delete(fs, pix);
+  SPIFFS_CHECK_RES(res);
+  return SPIFFS_VIS_COUNTINUE_RELOAD;
+}
+
+// Deletes all pages carrying the id of a stale object, whether referenced
+// from its index or not, and the index header at objix_hdr_pix last, so an
+// interrupted purge is picked up again on next mount.
+static s32_t spiffs_txn_purge(spiffs *fs, spiffs_obj_id obj_id, spiffs_page_ix objix_hdr_pix) {
+  s32_t res;
+  obj_id &= ~SPIFFS_OBJ_ID_IX_FLAG;
+  res = spiffs_obj_lu_find_entry_visitor(fs, 0, 0, 0, 0, spiffs_txn_purge_v, &obj_id, &objix_hdr_pix, 0, 0);
+  if (res == SPIFFS_VIS_END) res = SPIFFS_OK;
+  SPIFFS_CHECK_RES(res);
+  res = spiffs_page_delete(fs, objix_hdr_pix);
+  SPIFFS_CHECK_RES(res);
+  spiffs_cb_object_event(fs, (spiffs_page_object_ix *)0,
+      SPIFFS_EV_IX_DEL, obj_id | SPIFFS_OBJ_ID_IX_FLAG, 0, objix_hdr_pix, 0);
+  return res;
+}
+
+// Finds the index header of given shadow object. Returns SPIFFS_ERR_NOT_FOUND
+// if the object is gone or is no longer hidden
+static s32_t spiffs_txn_shadow_find(
+    spiffs *fs,
+    spiffs_obj_id obj_id,
+    spiffs_page_object_ix_header *objix_hdr,
+    spiffs_page_ix *pix) {
+  s32_t res;
+  res = spiffs_obj_lu_find_id_and_span(fs, obj_id | SPIFFS_OBJ_ID_IX_FLAG, 0, 0, pix);
+  SPIFFS_CHECK_RES(res);
+  res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_READ,
+      0, SPIFFS_PAGE_TO_PADDR(fs, *pix), sizeof(spiffs_page_object_ix_header), (u8_t *)objix_hdr);
+  SPIFFS_CHECK_RES(res);
+  return (objix_hdr->type & SPIFFS_TYPE_HIDDEN) ? SPIFFS_OK : SPIFFS_ERR_NOT_FOUND;
+}
+
+// Removes the current version of a shadow's name and unhides the shadow by
+// programming its type in place. Does nothing for shadows that are gone or
+// already replaced, so it may be repeated after power loss.
+static s32_t spiffs_txn_replace(spiffs *fs, spiffs_obj_id obj_id) {
+  s32_t res;
+  spiffs_page_object_ix_header objix_hdr;
+  spiffs_page_ix pix;
+  spiffs_page_ix old_pix;
+  u8_t name[SPIFFS_OBJ_NAME_LEN];
+
+  res = spiffs_txn_shadow_find(fs, obj_id, &objix_hdr, &pix);
+  if (res == SPIFFS_ERR_NOT_FOUND) return SPIFFS_OK;
+  SPIFFS_CHECK_RES(res);
+
+  // hidden objects are never found by name, this is the current version
+  spiffs_object_hdr_name(&objix_hdr, name);
+  res = spiffs_object_find_object_index_header_by_name(fs, name, &old_pix);
+  if (res == SPIFFS_OK) {
+    SPIFFS_DBG("txn: "_SPIPRIid" replaces object at "_SPIPRIpg"\n", obj_id, old_pix);
+    res = spiffs_txn_remove(fs, old_pix);
+  } else if (res == SPIFFS_ERR_NOT_FOUND) {
+    res = SPIFFS_OK;
+  }
+  SPIFFS_CHECK_RES(res);
+
+  objix_hdr.type &= ~SPIFFS_TYPE_HIDDEN;
+  res = _spiffs_wr(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_UPDT,
+      0, SPIFFS_PAGE_TO_PADDR(fs, pix) + offsetof(spiffs_page_object_ix_header, type),
+      sizeof(spiffs_obj_type), (u8_t *)&objix_hdr.type);
+  SPIFFS_CHECK_RES(res);
+  spiffs_cb_object_event(fs, (spiffs_page_object_ix *)&objix_hdr,
+      SPIFFS_EV_IX_UPD_HDR, obj_id | SPIFFS_OBJ_ID_IX_FLAG, 0, pix, objix_hdr.size);
+  return res;
+}
+
+// Replaces current versions by all shadows listed in the marker at
+// marker_pix, then deletes the marker
+static s32_t spiffs_txn_roll_forward(spiffs *fs, spiffs_page_ix marker_pix) {
+  s32_t res;
+  spiffs_page_object_ix_header marker;
+  u32_t i;
+
+  res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_READ,
+      0, SPIFFS_PAGE_TO_PADDR(fs, marker_pix), sizeof(spiffs_page_object_ix_header), (u8_t *)&marker);
+  SPIFFS_CHECK_RES(res);
+  for (i = 0; i < marker.size && i < SPIFFS_OBJ_HDR_IX_LEN(fs); i++) {
+    spiffs_obj_id obj_id;
+    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_READ,
+        0, SPIFFS_PAGE_TO_PADDR(fs, marker_pix) + sizeof(spiffs_page_object_ix_header) + i * sizeof(spiffs_obj_id),
+        sizeof(spiffs_obj_id), (u8_t *)&obj_id);
+    SPIFFS_CHECK_RES(res);
+    res = spiffs_txn_replace(fs, obj_id);
+    SPIFFS_CHECK_RES(res);
+  }
+  SPIFFS_DBG("txn: delete marker "_SPIPRIpg"\n", marker_pix);
+  return spiffs_page_delete(fs, marker_pix);
+}
+
+// Ends the transaction, shadow fds become ordinary fds
+static void spiffs_txn_close(spiffs *fs) {
+  u32_t i;
+  spiffs_fd *fds = (spiffs_fd *)fs->fd_space;
+  for (i = 0; i < fs->fd_count; i++) {
+    fds[i].flags &= ~SPIFFS_O_SHADOW;
+  }
+  fs->txn.count = 0;
+  fs->txn.state = SPIFFS_TXN_STATE_NONE;
+}
+
+// Creates a shadow version of name in the open transaction and opens it in
+// fd. If no transaction is open, an implicit one is opened, committed when
+// the shadow is closed.
+s32_t spiffs_txn_shadow_open(
+    spiffs *fs,
+    spiffs_fd *fd,
+    const u8_t name[],
+    spiffs_flags flags,
+    spiffs_mode mode) {
+  s32_t res;
+  spiffs_obj_id obj_id;
+  spiffs_page_ix pix;
+
+  if (fs->txn.state == SPIFFS_TXN_STATE_IMPLICIT) {
+    return SPIFFS_ERR_TXN_STATE;
+  }
+  if (fs->txn.count >= SPIFFS_TXN_MAX_FILES) {
+    return SPIFFS_ERR_TXN_FULL;
+  }
+
+  // a shadow carries the name of the current version, no conflict check
+  res = spiffs_obj_lu_find_free_obj_id(fs, &obj_id, 0);
+  SPIFFS_CHECK_RES(res);
+  u8_t type = SPIFFS_TYPE_FILE;
+#if SPIFFS_COMPRESSED_FILES
+  if (flags & SPIFFS_O_COMPRESS) {
+    type = SPIFFS_TYPE_COMPRESSED;
+  }
+#endif
+  res = spiffs_object_create(fs, obj_id, name, 0, type | SPIFFS_TYPE_HIDDEN, &pix);
+  SPIFFS_CHECK_RES(res);
+  res = spiffs_object_open_by_page(fs, pix, fd, flags, mode);
+  if (res != SPIFFS_OK) {
+    // not part of the transaction, else removed on next mount
+    (void)spiffs_txn_purge(fs, obj_id, pix);
+    return res;
+  }
+
+  if (fs->txn.state == SPIFFS_TXN_STATE_NONE) {
+    fs->txn.state = SPIFFS_TXN_STATE_IMPLICIT;
+  }
+  fs->txn.obj_ids[fs->txn.count++] = obj_id;
+  return res;
+}
+
+// Commits the open transaction. The marker listing all shadows is written
+// unfinalized, then finalized by a single program of its page header flags;
+// from that point on the shadows replace the current versions, on next mount
+// at the latest.
+s32_t spiffs_txn_commit(
+    spiffs *fs) {
+  s32_t res;
+  spiffs_obj_id obj_id;
+  spiffs_page_ix marker_pix;
+  spiffs_page_object_ix_header *marker = (spiffs_page_object_ix_header *)fs->work;
+  u32_t len = sizeof(spiffs_page_object_ix_header) + fs->txn.count * sizeof(spiffs_obj_id);
+
+  if (fs->txn.count == 0) {
+    spiffs_txn_close(fs);
+    return SPIFFS_OK;
+  }
+
+  // gc uses the work buffer, make room before building the marker
+  res = spiffs_gc_check(fs, SPIFFS_DATA_PAGE_SIZE(fs));
+  SPIFFS_CHECK_RES(res);
+  res = spiffs_obj_lu_find_free_obj_id(fs, &obj_id, 0);
+  SPIFFS_CHECK_RES(res);
+  obj_id |= SPIFFS_OBJ_ID_IX_FLAG;
+
+  memset(fs->work, 0xff, len);
+  marker->p_hdr.obj_id = obj_id;
+  marker->p_hdr.span_ix = 0;
+  marker->p_hdr.flags = 0xff & ~SPIFFS_PH_FLAG_INDEX;
+  marker->type = SPIFFS_TYPE_TXN_MARKER;
+  marker->size = fs->txn.count;
+  marker->name[0] = 0;
+  _SPIFFS_MEMCPY(fs->work + sizeof(spiffs_page_object_ix_header), fs->txn.obj_ids,
+      fs->txn.count * sizeof(spiffs_obj_id));
+  res = spiffs_page_allocate_data(fs, obj_id, &marker->p_hdr, fs->work + sizeof(spiffs_page_header),
+      len - sizeof(spiffs_page_header), 0, 1, &marker_pix);
+  SPIFFS_CHECK_RES(res);
+  SPIFFS_DBG("txn: marker "_SPIPRIpg" commits "_SPIPRIi" shadows\n", marker_pix, fs->txn.count);
+
+  // committed, should replacing fail it is finished on next mount
+  spiffs_txn_close(fs);
+  return spiffs_txn_roll_forward(fs, marker_pix);
+}
+
+// Aborts the open transaction, removing all its shadows
+s32_t spiffs_txn_abort(
+    spiffs *fs) {
+  s32_t res = SPIFFS_OK;
+  spiffs_page_object_ix_header objix_hdr;
+  spiffs_page_ix pix;
+
+  while (fs->txn.count > 0) {
+    res = spiffs_txn_shadow_find(fs, fs->txn.obj_ids[fs->txn.count - 1], &objix_hdr, &pix);
+    if (res == SPIFFS_OK) {
+      res = spiffs_txn_purge(fs, fs->txn.obj_ids[fs->txn.count - 1], pix);
+    } else if (res == SPIFFS_ERR_NOT_FOUND) {
+      res = SPIFFS_OK;
+    }
+    SPIFFS_CHECK_RES(res);
+    fs->txn.count--;
+  }
+  spiffs_txn_close(fs);
+  return res;
+}
+
+typedef struct {
+  // set if a committed marker is found
+  u8_t marker_found;
+  // the committed marker
+  spiffs_page_ix marker_pix;
+  // number of hidden or partly removed objects
+  u32_t stale;
+} spiffs_txn_recover_state;
+
+// Finds object index headers of hidden objects and of objects whose removal
+// was interrupted. If user_var_p is given, all are counted and the committed
+// marker is noted, else the first one is returned.
+static s32_t spiffs_txn_recover_v(
+    spiffs *fs,
+    spiffs_obj_id obj_id,
+    spiffs_block_ix bix,
+    int ix_entry,
+    const void *user_const_p,
+    void *user_var_p) {
+  (void)user_const_p;
+  s32_t res;
+  spiffs_page_object_ix_header objix_hdr;
+  spiffs_txn_recover_state *state = (spiffs_txn_recover_state *)user_var_p;
+  if (obj_id == SPIFFS_OBJ_ID_FREE || obj_id == SPIFFS_OBJ_ID_DELETED ||
+      (obj_id & SPIFFS_OBJ_ID_IX_FLAG) == 0) {
+    return SPIFFS_VIS_COUNTINUE;
+  }
+  spiffs_page_ix pix = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, ix_entry);
+  res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ,
+      0, SPIFFS_PAGE_TO_PADDR(fs, pix), SPIFFS_OBJ_HDR_MIN_LEN, (u8_t *)&objix_hdr);
+  SPIFFS_CHECK_RES(res);
+  // unfinalized markers were never committed, count them along with shadows
+  if (objix_hdr.p_hdr.span_ix != 0 ||
+      (objix_hdr.p_hdr.flags & (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_INDEX | SPIFFS_PH_FLAG_USED)) !=
+          SPIFFS_PH_FLAG_DELET ||
+      ((objix_hdr.type & SPIFFS_TYPE_HIDDEN) == 0 && (objix_hdr.p_hdr.flags & SPIFFS_PH_FLAG_IXDELE))) {
+    return SPIFFS_VIS_COUNTINUE;
+  }
+  if (state == 0) {
+    return SPIFFS_OK;
+  }
+  if (objix_hdr.type == SPIFFS_TYPE_TXN_MARKER && (objix_hdr.p_hdr.flags & SPIFFS_PH_FLAG_FINAL) == 0) {
+    state->marker_found = 1;
+    state->marker_pix = pix;
+  } else {
+    state->stale++;
+  }
+  return SPIFFS_VIS_COUNTINUE;
+}
+
+// Finishes a transaction interrupted by power loss: rolls a committed one
+// forward, then purges any shadows, markers and partly removed objects left
+// over
+s32_t spiffs_txn_recover(
+    spiffs *fs) {
+  s32_t res;
+  spiffs_txn_recover_state state;
+  spiffs_block_ix bix;
+  int entry;
+
+  memset(&state, 0, sizeof(state));
+  res = spiffs_obj_lu_find_entry_visitor(fs, 0, 0, 0, 0, spiffs_txn_recover_v, 0, &state, 0, 0);
+  if (res == SPIFFS_VIS_END) res = SPIFFS_OK;
+  SPIFFS_CHECK_RES(res);
+
+  if (state.marker_found) {
+    SPIFFS_DBG("txn: recover, roll forward marker "_SPIPRIpg"\n", state.marker_pix);
+    res = spiffs_txn_roll_forward(fs, state.marker_pix);
+    SPIFFS_CHECK_RES(res);
+  }
+
+  while (state.stale > 0) {
+    res = spiffs_obj_lu_find_entry_visitor(fs, 0, 0, 0, 0, spiffs_txn_recover_v, 0, 0, &bix, &entry);
+    if (res == SPIFFS_VIS_END) break;
+    SPIFFS_CHECK_RES(res);
+    spiffs_page_ix pix = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, entry);
+    spiffs_obj_id obj_id;
+    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU | SPIFFS_OP_C_READ,
+        0, SPIFFS_BLOCK_TO_PADDR(fs, bix) + entry * sizeof(spiffs_obj_id), sizeof(spiffs_obj_id), (u8_t *)&obj_id);
+    SPIFFS_CHECK_RES(res);
+    SPIFFS_DBG("txn: recover, purge object "_SPIPRIid" at "_SPIPRIpg"\n", obj_id, pix);
+    res = spiffs_txn_purge(fs, obj_id, pix);
+    SPIFFS_CHECK_RES(res);
+    state.stale--;
+  }
+
+  return SPIFFS_OK;
+}
+#endif // SPIFFS_TXN && !SPIFFS_READ_ONLY
+
 s32_t spiffs_object_read(
     spiffs_fd *fd,
     u32_t offset,
@@ -1965,6 +3538,30 @@ s32_t spiffs_object_read(
   spiffs_page_object_ix_header *objix_hdr = (spiffs_page_object_ix_header *)fs->work;
   spiffs_page_object_ix *objix = (spiffs_page_object_ix *)fs->work;
 
+#if SPIFFS_INLINE_DATA
+  if (fd->size != SPIFFS_UNDEFINED_LEN && fd->size <= SPIFFS_OBJ_HDR_INLINE_LEN(fs)) {
+    // small object, data may be inline in the object index header page
+    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_IX | SPIFFS_OP_C_READ,
+        fd->file_nbr, SPIFFS_PAGE_TO_PADDR(fs, fd->objix_hdr_pix), SPIFFS_CFG_LOG_PAGE_SZ(fs), fs->work);
+    SPIFFS_CHECK_RES(res);
+    SPIFFS_VALIDATE_OBJIX(objix_hdr->p_hdr, fd->obj_id, 0);
+    if ((objix_hdr->p_hdr.flags & SPIFFS_PH_FLAG_INLINE) == 0) {
+      if (offset >= fd->size) {
+        return SPIFFS_ERR_END_OF_OBJECT;
+      }
+      u32_t len_to_read = MIN(len, fd->size - offset);
+      _SPIFFS_MEMCPY(dst, fs->work + spiffs_object_hdr_data_offs(objix_hdr) + offset, len_to_read);
+      fd->offset = offset + len_to_read;
+      fd->cursor_objix_pix = fd->objix_hdr_pix;
+      fd->cursor_objix_spix = 0;
+      return len_to_read < len ? SPIFFS_ERR_END_OF_OBJECT : SPIFFS_OK;
+    }
+    prev_objix_spix = 0;
+    fd->cursor_objix_pix = fd->objix_hdr_pix;
+    fd->cursor_objix_spix = 0;
+  }
+#endif
+
   while (cur_offset < offset + len) {
 #if SPIFFS_IX_MAP
     // check if we have a memory, index map and if so, if we're within index map's range
@@ -2046,29 +3643,24 @@ typedef struct {
   spiffs_obj_id min_obj_id;
   spiffs_obj_id max_obj_id;
   u32_t compaction;
-  const u8_t *conflicting_name;
+  const spiffs_name_key *conflicting_name;
 } spiffs_free_obj_id_state;
 
 static s32_t spiffs_obj_lu_find_free_obj_id_bitmap_v(spiffs *fs, spiffs_obj_id id, spiffs_block_ix bix, int ix_entry,
     const void *user_const_p, void *user_var_p) {
   if (id != SPIFFS_OBJ_ID_FREE && id != SPIFFS_OBJ_ID_DELETED) {
     spiffs_obj_id min_obj_id = *((spiffs_obj_id*)user_var_p);
-    const u8_t *conflicting_name = (const u8_t*)user_const_p;
+    const spiffs_name_key *conflicting_name = (const spiffs_name_key*)user_const_p;
 
     // if conflicting name parameter is given, also check if this name is found in object index hdrs
     if (conflicting_name && (id & SPIFFS_OBJ_ID_IX_FLAG)) {
       spiffs_page_ix pix = SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, ix_entry);
-      int res;
+      s32_t res;
       spiffs_page_object_ix_header objix_hdr;
-      res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ,
-          0, SPIFFS_PAGE_TO_PADDR(fs, pix), sizeof(spiffs_page_object_ix_header), (u8_t *)&objix_hdr);
+      res = spiffs_object_hdr_name_match(fs, pix, conflicting_name, &objix_hdr);
       SPIFFS_CHECK_RES(res);
-      if (objix_hdr.p_hdr.span_ix == 0 &&
-          (objix_hdr.p_hdr.flags & (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_IXDELE)) ==
-              (SPIFFS_PH_FLAG_DELET | SPIFFS_PH_FLAG_IXDELE)) {
-        if (strcmp((const char*)user_const_p, (char*)objix_hdr.name) == 0) {
-          return SPIFFS_ERR_CONFLICTING_NAME;
-        }
+      if (res && (objix_hdr.p_hdr.flags & SPIFFS_PH_FLAG_IXDELE)) {
+        return SPIFFS_ERR_CONFLICTING_NAME;
       }
     }
 
@@ -2090,15 +3682,20 @@ static s32_t spiffs_obj_lu_find_free_obj_id_compact_v(spiffs *fs, spiffs_obj_id
     const spiffs_free_obj_id_state *state = (const spiffs_free_obj_id_state*)user_const_p;
     spiffs_page_object_ix_header objix_hdr;
 
-    res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ,
-        0, SPIFFS_OBJ_LOOKUP_ENTRY_TO_PADDR(fs, bix, ix_entry), sizeof(spiffs_page_object_ix_header), (u8_t*)&objix_hdr);
-    if (res == SPIFFS_OK && objix_hdr.p_hdr.span_ix == 0 &&
+    if (state->conflicting_name) {
+      res = spiffs_object_hdr_name_match(fs, SPIFFS_OBJ_LOOKUP_ENTRY_TO_PIX(fs, bix, ix_entry),
+          state->conflicting_name, &objix_hdr);
+      if (res > 0) {
+        return SPIFFS_ERR_CONFLICTING_NAME;
+      }
+    } else {
+      res = _spiffs_rd(fs, SPIFFS_OP_T_OBJ_LU2 | SPIFFS_OP_C_READ,
+          0, SPIFFS_OBJ_LOOKUP_ENTRY_TO_PADDR(fs, bix, ix_entry), sizeof(spiffs_page_header), (u8_t*)&objix_hdr);
+    }
+    if (res >= SPIFFS_OK && objix_hdr.p_hdr.span_ix == 0 &&
         ((objix_hdr.p_hdr.flags & (SPIFFS_PH_FLAG_INDEX | SPIFFS_PH_FLAG_FINAL | SPIFFS_PH_FLAG_DELET)) ==
             (SPIFFS_PH_FLAG_DELET))) {
       // ok object look up entry
-      if (state->conflicting_name && strcmp((const char *)state->conflicting_name, (char *)objix_hdr.name) == 0) {
-        return SPIFFS_ERR_CONFLICTING_NAME;
-      }
 
       id &= ~SPIFFS_OBJ_ID_IX_FLAG;
       if (id >= state->min_obj_id && id <= state->max_obj_id) {
@@ -2121,13 +3718,17 @@ s32_t spiffs_obj_lu_find_free_obj_id(spiffs *fs, spiffs_obj_id *obj_id, const u8
   u32_t max_objects = (fs->block_count * SPIFFS_OBJ_LOOKUP_MAX_ENTRIES(fs)) / 2;
   spiffs_free_obj_id_state state;
   spiffs_obj_id free_obj_id = SPIFFS_OBJ_ID_FREE;
+  spiffs_name_key key;
+  if (conflicting_name) {
+    spiffs_name_key_init(fs, &key, conflicting_name);
+  }
   state.min_obj_id = 1;
   state.max_obj_id = max_objects + 1;
   if (state.max_obj_id & SPIFFS_OBJ_ID_IX_FLAG) {
     state.max_obj_id = ((spiffs_obj_id)-1) & ~SPIFFS_OBJ_ID_IX_FLAG;
   }
   state.compaction = 0;
-  state.conflicting_name = conflicting_name;
+  state.conflicting_name = conflicting_name ? &key : 0;
   while (res == SPIFFS_OK && free_obj_id == SPIFFS_OBJ_ID_FREE) {
     if (state.max_obj_id - state.min_obj_id <= (spiffs_obj_id)SPIFFS_CFG_LOG_PAGE_SZ(fs)*8) {
       // possible to represent in bitmap
@@ -2136,7 +3737,7 @@ s32_t spiffs_obj_lu_find_free_obj_id(spiffs *fs, spiffs_obj_id *obj_id, const u8
 
       memset(fs->work, 0, SPIFFS_CFG_LOG_PAGE_SZ(fs));
       res = spiffs_obj_lu_find_entry_visitor(fs, 0, 0, 0, 0, spiffs_obj_lu_find_free_obj_id_bitmap_v,
-          conflicting_name, &state.min_obj_id, 0, 0);
+          state.conflicting_name, &state.min_obj_id, 0, 0);
       if (res == SPIFFS_VIS_END) res = SPIFFS_OK;
       SPIFFS_CHECK_RES(res);
       // traverse bitmask until found free obj_id
@@ -2211,20 +3812,6 @@ s32_t spiffs_obj_lu_find_free_obj_id(spiffs *fs, spiffs_obj_id *obj_id, const u8
 }
 #endif // !SPIFFS_READ_ONLY
 
-#if SPIFFS_TEMPORAL_FD_CACHE
-// djb2 hash
-static u32_t spiffs_hash(spiffs *fs, const u8_t *name) {
-  (void)fs;
-  u32_t hash = 5381;
-  u8_t c;
-  int i = 0;
-  while ((c = name[i++]) && i < SPIFFS_OBJ_NAME_LEN) {
-    hash = (hash * 33) ^ c;
-  }
-  return hash;
-}
-#endif
-
 s32_t spiffs_fd_find_new(spiffs *fs, spiffs_fd **fd, const char *name) {
 #if SPIFFS_TEMPORAL_FD_CACHE
   u32_t i;
@@ -2312,6 +3899,9 @@ s32_t spiffs_fd_return(spiffs *fs, spiffs_file f) {
   if (fd->file_nbr == 0) {
     return SPIFFS_ERR_FILE_CLOSED;
   }
+#if SPIFFS_COMPRESSED_FILES
+  spiffs_object_compress_release(fs, fd);
+#endif
   fd->file_nbr = 0;
 #if SPIFFS_IX_MAP
   fd->ix_map = 0;
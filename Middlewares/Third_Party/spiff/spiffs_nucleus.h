@@ -243,6 +243,32 @@
 // get data span index for object index span index
 #define SPIFFS_DATA_SPAN_IX_FOR_OBJ_IX_SPAN_IX(fs, spix) \
   ( (spix) == 0 ? 0 : (SPIFFS_OBJ_HDR_IX_LEN(fs) + (((spix)-1) * SPIFFS_OBJ_IX_LEN(fs))) )
+#if SPIFFS_COMPACT_NAMES
+// longest name that can be stored in a compact object index header
+#define SPIFFS_OBJ_COMPACT_NAME_LEN \
+  (sizeof(spiffs_page_object_ix_header) - sizeof(spiffs_page_object_ix_header_compact))
+// smallest possible object index header
+#define SPIFFS_OBJ_HDR_MIN_LEN    sizeof(spiffs_page_object_ix_header_compact)
+#else
+#define SPIFFS_OBJ_HDR_MIN_LEN    sizeof(spiffs_page_object_ix_header)
+#endif
+#if SPIFFS_RING_FILES
+// max number of data pages of a ring file, the last object index header entry
+// holds the ring capacity; the entries between the last ring page and the
+// capacity log the appends within the newest page, see spiffs_object_ring_head
+#define SPIFFS_RING_MAX_PAGES(fs) \
+  (SPIFFS_OBJ_HDR_IX_LEN(fs) - 1)
+// oldest stream position still held by a ring of given pages and head
+#define SPIFFS_RING_TAIL(fs, head, pages) \
+  ( ((head) + SPIFFS_DATA_PAGE_SIZE(fs) - 1) / SPIFFS_DATA_PAGE_SIZE(fs) > (pages) ? \
+    (((head) + SPIFFS_DATA_PAGE_SIZE(fs) - 1) / SPIFFS_DATA_PAGE_SIZE(fs) - (pages)) * SPIFFS_DATA_PAGE_SIZE(fs) : 0 )
+#endif
+#if SPIFFS_INLINE_DATA
+// max bytes of object data an object index header page can hold inline, the
+// actual room depends on the header layout, see spiffs_object_hdr_data_offs
+#define SPIFFS_OBJ_HDR_INLINE_LEN(fs) \
+  (SPIFFS_CFG_LOG_PAGE_SZ(fs) - SPIFFS_OBJ_HDR_MIN_LEN)
+#endif
 
 #if SPIFFS_FILEHDL_OFFSET
 #define SPIFFS_FH_OFFS(fs, fh)   ((fh) != 0 ? ((fh) + (fs)->cfg.fh_ix_offset) : 0)
@@ -279,6 +305,23 @@
 #define SPIFFS_PH_FLAG_DELET  (1<<7)
 // if 0, this index header is being deleted
 #define SPIFFS_PH_FLAG_IXDELE (1<<6)
+// if 0, this index header holds object data inline instead of index entries
+#define SPIFFS_PH_FLAG_INLINE (1<<3)
+// if 0, this index header stores the object name in compact form
+#define SPIFFS_PH_FLAG_COMPACT (1<<4)
+
+// object type bit set for objects that are neither found by name nor listed;
+// cleared in place when a transaction shadow replaces the current version
+#define SPIFFS_TYPE_HIDDEN    (1<<7)
+// object type of a transaction marker, whose index header entries list the
+// object ids of the shadows it commits
+#define SPIFFS_TYPE_TXN_MARKER (SPIFFS_TYPE_HIDDEN | 0x70)
+
+// transaction states
+#define SPIFFS_TXN_STATE_NONE     0
+#define SPIFFS_TXN_STATE_OPEN     1
+// single shadow replaced when closed
+#define SPIFFS_TXN_STATE_IMPLICIT 2
 
 
 #define SPIFFS_CHECK_MOUNT(fs) \
@@ -422,6 +465,53 @@ typedef struct {
 
 #endif
 
+#if SPIFFS_COMPRESSED_FILES
+#define spiffs_get_compress(fs) \
+  ((spiffs_compress *)((fs)->compress))
+
+// set in a frame header's compressed length if no more bytes are added to the
+// frame, and following bytes go to the next frame
+#define SPIFFS_COMPRESS_FRAME_SEALED  0x8000
+
+// compressed file frame header, at the start of each data page
+typedef struct __attribute(( packed )) {
+  // uncompressed file offset of the first byte in this frame
+  u32_t offset;
+  // uncompressed length
+  u16_t raw_len;
+  // compressed length, and SPIFFS_COMPRESS_FRAME_SEALED
+  u16_t len;
+} spiffs_compress_frame_hdr;
+
+// compression buffer struct
+typedef struct {
+  // descriptor of the compressed file using the buffer, 0 if free
+  spiffs_file file_nbr;
+  // set if raw holds bytes not written to the medium
+  u8_t dirty;
+  // set if the last frame on the medium is sealed
+  u8_t last_sealed;
+  // capacity of raw
+  u16_t raw_size;
+  // number of bytes in raw
+  u16_t raw_len;
+  // frame held in raw, may be one past the last frame on the medium
+  u32_t frame_ix;
+  // uncompressed file offset of the first byte in raw
+  u32_t raw_offset;
+  // number of frames on the medium, (u32_t)-1 if not yet loaded
+  u32_t frame_count;
+  // uncompressed size of the file
+  u32_t size;
+  // compressor match table, raw positions by hash of the next four bytes
+  u16_t *hash;
+  // frame page being encoded or decoded
+  u8_t *frame;
+  // uncompressed bytes of the frame held
+  u8_t *raw;
+} spiffs_compress;
+#endif
+
 
 // spiffs nucleus file descriptor
 typedef struct {
@@ -458,6 +548,14 @@ typedef struct {
   // spiffs index map, if 0 it means unmapped
   spiffs_ix_map *ix_map;
 #endif
+#if SPIFFS_RING_FILES
+  // capacity in data pages if this is a ring file, else 0
+  spiffs_span_ix ring_pages;
+#endif
+#if SPIFFS_INLINE_DATA
+  // 1 if the header is not flagged inline, data of a non empty object is in data pages
+  u8_t paged;
+#endif
 } spiffs_fd;
 
 
@@ -497,12 +595,42 @@ typedef struct __attribute(( packed ))
 #endif
 } spiffs_page_object_ix_header;
 
+#if SPIFFS_COMPACT_NAMES
+// compact object index header page header, used when SPIFFS_PH_FLAG_COMPACT
+// is cleared. Object index entries still start at
+// sizeof(spiffs_page_object_ix_header)
+typedef struct __attribute(( packed )) {
+  // common page header
+  spiffs_page_header p_hdr;
+  // alignment
+  u8_t _align[4 - ((sizeof(spiffs_page_header)&3)==0 ? 4 : (sizeof(spiffs_page_header)&3))];
+  // size of object
+  u32_t size;
+  // type of object
+  spiffs_obj_type type;
+  // hash of name
+  u16_t name_hash;
+  // length of name, name follows directly after this struct
+  u8_t name_len;
+#if SPIFFS_OBJ_META_LEN
+  // metadata. not interpreted by SPIFFS in any way.
+  u8_t meta[SPIFFS_OBJ_META_LEN];
+#endif
+} spiffs_page_object_ix_header_compact;
+#endif
+
 // object index page header
 typedef struct __attribute(( packed )) {
  spiffs_page_header p_hdr;
  u8_t _align[4 - ((sizeof(spiffs_page_header)&3)==0 ? 4 : (sizeof(spiffs_page_header)&3))];
 } spiffs_page_object_ix;
 
+// directory entry filter with its user argument
+typedef struct {
+  spiffs_dirent_filter filter;
+  void *arg;
+} spiffs_dirent_filter_arg;
+
 // callback func for object lookup visitor
 typedef s32_t (*spiffs_visitor_f)(spiffs *fs, spiffs_obj_id id, spiffs_block_ix bix, int ix_entry,
     const void *user_const_p, void *user_var_p);
@@ -675,6 +803,17 @@ s32_t spiffs_populate_ix_map(
 
 #endif
 
+#if SPIFFS_META_IX
+
+s32_t spiffs_meta_ix_populate(
+    spiffs *fs);
+
+u32_t spiffs_meta_ix_lower_bound(
+    const spiffs_meta_ix *ix,
+    u32_t key);
+
+#endif
+
 void spiffs_cb_object_event(
     spiffs *fs,
     spiffs_page_object_ix *objix,
@@ -716,11 +855,107 @@ s32_t spiffs_object_read(
     u32_t len,
     u8_t *dst);
 
+#if SPIFFS_INLINE_DATA
+s32_t spiffs_object_inline_write(
+    spiffs_fd *fd,
+    u32_t offset,
+    u8_t *data,
+    u32_t len,
+    u8_t *inlined);
+#endif
+
+void spiffs_object_hdr_name(
+    const spiffs_page_object_ix_header *objix_hdr,
+    u8_t name[SPIFFS_OBJ_NAME_LEN]);
+
+#if SPIFFS_OBJ_META_LEN
+u8_t *spiffs_object_hdr_meta(
+    spiffs_page_object_ix_header *objix_hdr);
+#endif
+
+u32_t spiffs_object_hdr_data_offs(
+    const spiffs_page_object_ix_header *objix_hdr);
+
+#if SPIFFS_RING_FILES
+s32_t spiffs_object_ring_head(
+    spiffs *fs,
+    spiffs_file file_nbr,
+    spiffs_page_ix objix_hdr_pix,
+    u32_t size,
+    u32_t *head,
+    spiffs_span_ix *log_entry);
+
+s32_t spiffs_object_ring_create(
+    spiffs *fs,
+    spiffs_obj_id obj_id,
+    const u8_t name[],
+    spiffs_span_ix pages,
+    spiffs_page_ix *objix_hdr_pix);
+
+s32_t spiffs_object_ring_append(
+    spiffs_fd *fd,
+    u8_t *data,
+    u32_t len);
+
+s32_t spiffs_object_ring_read(
+    spiffs_fd *fd,
+    u32_t offset,
+    u32_t len,
+    u8_t *dst);
+#endif
+
+#if SPIFFS_COMPRESSED_FILES
+s32_t spiffs_object_compress_claim(
+    spiffs_fd *fd);
+
+void spiffs_object_compress_release(
+    spiffs *fs,
+    spiffs_fd *fd);
+
+s32_t spiffs_object_compress_size(
+    spiffs_fd *fd,
+    u32_t *size);
+
+s32_t spiffs_object_compress_read(
+    spiffs_fd *fd,
+    u32_t offset,
+    u32_t len,
+    u8_t *dst);
+
+#if !SPIFFS_READ_ONLY
+s32_t spiffs_object_compress_append(
+    spiffs_fd *fd,
+    u8_t *data,
+    u32_t len);
+
+s32_t spiffs_object_compress_flush(
+    spiffs_fd *fd);
+#endif
+#endif
+
 s32_t spiffs_object_truncate(
     spiffs_fd *fd,
     u32_t new_len,
     u8_t remove_object);
 
+#if SPIFFS_TXN
+s32_t spiffs_txn_shadow_open(
+    spiffs *fs,
+    spiffs_fd *fd,
+    const u8_t name[],
+    spiffs_flags flags,
+    spiffs_mode mode);
+
+s32_t spiffs_txn_commit(
+    spiffs *fs);
+
+s32_t spiffs_txn_abort(
+    spiffs *fs);
+
+s32_t spiffs_txn_recover(
+    spiffs *fs);
+#endif
+
 s32_t spiffs_object_find_object_index_header_by_name(
     spiffs *fs,
     const u8_t name[SPIFFS_OBJ_NAME_LEN],
@@ -749,6 +984,15 @@ s32_t spiffs_gc_clean(
 s32_t spiffs_gc_quick(
     spiffs *fs, u16_t max_free_pages);
 
+s32_t spiffs_gc_reserve(
+    spiffs *fs,
+    u32_t len,
+    u32_t write_len);
+
+s32_t spiffs_gc_erase_if_dead(
+    spiffs *fs,
+    spiffs_page_ix pix);
+
 // ---------------
 
 s32_t spiffs_fd_find_new(
@@ -67,6 +67,9 @@ typedef int8_t (*IO_DeInit_Func)( void);
 typedef void (*IO_Delay_Func)(uint32_t);
 typedef int16_t (*IO_Send_Func)( uint8_t *, uint16_t len, uint32_t);
 typedef int16_t (*IO_Receive_Func)(uint8_t *, uint16_t len, uint32_t);
+typedef uint8_t *(*IO_TxBuffer_Func)(uint16_t len);
+/* Fills len bytes of a streamed payload, returns the number of bytes written */
+typedef int32_t (*ES_WIFI_Fill_Func)(void *Context, uint8_t *pdata, uint16_t len);
 
 
 /* Exported typedef ----------------------------------------------------------*/
@@ -249,12 +252,34 @@ typedef struct {
   uint8_t            Backlog;
 } ES_WIFI_Conn_t;
 
+/* Socket parameters last programmed into the module, used to skip
+   redundant P0/P2/P3/P4/S2 commands on the send path and R1/R2 on receive */
+#define ES_WIFI_SOCKET_NONE             0xFF
+
+#define ES_WIFI_CACHE_LOCAL_PORT        0x01
+#define ES_WIFI_CACHE_REMOTE            0x02
+#define ES_WIFI_CACHE_WRITE_TIMEOUT     0x04
+#define ES_WIFI_CACHE_READ_LENGTH       0x08
+#define ES_WIFI_CACHE_READ_TIMEOUT      0x10
+
+typedef struct {
+  uint8_t            Valid;           /*!< ES_WIFI_CACHE_xxx flags of the fields known to match the module */
+  uint8_t            Connected;       /*!< Destination pinned by ES_WIFI_ConnectUDP */
+  uint16_t           LocalPort;
+  uint16_t           RemotePort;
+  uint8_t            RemoteIP[4];
+  uint32_t           WriteTimeout;
+  uint16_t           ReadLength;
+  uint32_t           ReadTimeout;
+} ES_WIFI_SocketCache_t;
+
 typedef struct {
   IO_Init_Func       IO_Init;
   IO_DeInit_Func     IO_DeInit;
   IO_Delay_Func      IO_Delay;
   IO_Send_Func       IO_Send;
   IO_Receive_Func    IO_Receive;
+  IO_TxBuffer_Func   IO_TxBuffer;
 } ES_WIFI_IO_t;
 
 typedef struct {
@@ -271,7 +296,9 @@ typedef struct {
   ES_WIFI_IO_t       fops;
   uint8_t            CmdData[ES_WIFI_DATA_SIZE];
   uint32_t           Timeout;
-  uint32_t           BufferSize;  
+  uint32_t           BufferSize;
+  uint8_t            CurrentSocket;   /*!< Socket selected by the last P0, ES_WIFI_SOCKET_NONE if unknown */
+  ES_WIFI_SocketCache_t SocketCache[ES_WIFI_MAX_SOCKETS];
 } ES_WIFIObject_t;
 
 
@@ -318,7 +345,10 @@ ES_WIFI_Status_t  ES_WIFI_StartServerMultiConn(ES_WIFIObject_t *Obj, ES_WIFI_Con
 ES_WIFI_Status_t  ES_WIFI_StopServerMultiConn(ES_WIFIObject_t *Obj,ES_WIFI_Conn_t *conn);
 ES_WIFI_Status_t  ES_WIFI_SendData(ES_WIFIObject_t *Obj, uint8_t Socket, uint8_t *pdata, uint16_t Reqlen , uint16_t *SentLen, uint32_t Timeout);
 ES_WIFI_Status_t  ES_WIFI_SendDataTo(ES_WIFIObject_t *Obj, uint8_t Socket, uint8_t *pdata, uint16_t Reqlen , uint16_t *SentLen, uint32_t Timeout, uint8_t *IPaddr, uint16_t Port);
+ES_WIFI_Status_t  ES_WIFI_ConnectUDP(ES_WIFIObject_t *Obj, uint8_t Socket, uint8_t *IPaddr, uint16_t Port);
+ES_WIFI_Status_t  ES_WIFI_SendStream(ES_WIFIObject_t *Obj, uint8_t Socket, ES_WIFI_Fill_Func Fill, void *Context, uint32_t Length, uint32_t *SentLen, uint32_t Timeout);
 ES_WIFI_Status_t  ES_WIFI_ReceiveData(ES_WIFIObject_t *Obj, uint8_t Socket, uint8_t *pdata, uint16_t Reqlen, uint16_t *Receivedlen, uint32_t Timeout);
+ES_WIFI_Status_t  ES_WIFI_ReceiveDataSpan(ES_WIFIObject_t *Obj, uint8_t Socket, uint8_t **pdata, uint16_t Reqlen, uint16_t *Receivedlen, uint32_t Timeout);
 ES_WIFI_Status_t  ES_WIFI_ReceiveDataFrom(ES_WIFIObject_t *Obj, uint8_t Socket, uint8_t *pdata, uint16_t Reqlen, uint16_t *Receivedlen, uint32_t Timeout, uint8_t *IPaddr, uint16_t *pPort);
 ES_WIFI_Status_t  ES_WIFI_ActivateAP(ES_WIFIObject_t *Obj, ES_WIFI_APConfig_t *ApConfig);
 ES_WIFI_APState_t ES_WIFI_WaitAPStateChange(ES_WIFIObject_t *Obj);
@@ -339,6 +369,7 @@ ES_WIFI_Status_t  ES_WIFI_RegisterBusIO(ES_WIFIObject_t *Obj, IO_Init_Func IO_In
                                                               IO_Delay_Func   IO_Delay,
                                                               IO_Send_Func    IO_Send,
                                                               IO_Receive_Func  IO_Receive);
+ES_WIFI_Status_t  ES_WIFI_RegisterTxBuffer(ES_WIFIObject_t *Obj, IO_TxBuffer_Func IO_TxBuffer);
 
 ES_WIFI_Status_t  ES_WIFI_StoreCreds( ES_WIFIObject_t *Obj,
                                       ES_WIFI_CredsFunction_t credsFunction, uint8_t credSet,
@@ -0,0 +1,58 @@
+/**
+  ******************************************************************************
+  * @file    es_wifi_emu.h
+  * @brief   This file contains the functions prototypes of the host-side
+  *          es_wifi module emulator.
+  ******************************************************************************
+  * @attention
+  *
+  * The emulator replaces the SPI IO layer (es_wifi_io.c) when es_wifi.c is
+  * built on a Linux host with ES_WIFI_USE_EMULATOR set to 1. It answers the AT
+  * commands used by es_wifi.c and bridges the module sockets to loopback:
+  *
+  *   ES_WIFI_RegisterBusIO(&Obj, EMU_WIFI_Init, EMU_WIFI_DeInit, EMU_WIFI_Delay,
+  *                         EMU_WIFI_SendData, EMU_WIFI_ReceiveData);
+  *
+  ******************************************************************************
+  */
+
+#ifndef WIFI_EMU_H
+#define WIFI_EMU_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "es_wifi_conf.h"
+
+#if (ES_WIFI_USE_EMULATOR == 1)
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+  uint32_t Commands;            /* AT commands executed */
+  uint32_t Transfers;           /* IO_Send and IO_Receive calls */
+  uint32_t BytesToModule;
+  uint32_t BytesFromModule;
+  uint64_t BusyUs;              /* modelled SPI and module time */
+} EMU_WIFI_Stats_t;
+
+/* Exported functions ------------------------------------------------------- */
+int8_t  EMU_WIFI_Init(uint16_t mode);
+int8_t  EMU_WIFI_DeInit(void);
+int16_t EMU_WIFI_ReceiveData(uint8_t *pData, uint16_t len, uint32_t timeout);
+int16_t EMU_WIFI_SendData(uint8_t *pData, uint16_t len, uint32_t timeout);
+uint8_t *EMU_WIFI_GetTxBuffer(uint16_t len);
+void    EMU_WIFI_Delay(uint32_t Delay);
+void    EMU_WIFI_Configure(uint32_t SpiClock, uint32_t LatencyUs);
+void    EMU_WIFI_ConfigureJoin(uint32_t JoinMs, uint32_t DhcpMs);
+void    EMU_WIFI_SetAccessPoint(uint8_t InRange);
+void    EMU_WIFI_GetStats(EMU_WIFI_Stats_t *Stats);
+void    EMU_WIFI_ResetStats(void);
+#endif /* ES_WIFI_USE_EMULATOR */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_EMU_H */
@@ -55,6 +55,7 @@ int8_t  SPI_WIFI_Init(uint16_t mode);
 int8_t  SPI_WIFI_ResetModule(void);
 int16_t SPI_WIFI_ReceiveData(uint8_t *pData, uint16_t len, uint32_t timeout);
 int16_t SPI_WIFI_SendData( uint8_t *pData, uint16_t len, uint32_t timeout);
+uint8_t *SPI_WIFI_GetTxBuffer(uint16_t len);
 void    SPI_WIFI_Delay(uint32_t Delay);
 void    SPI_WIFI_ISR(void);
 
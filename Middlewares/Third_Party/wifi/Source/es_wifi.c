@@ -75,6 +75,35 @@
 
 #define CHARISNUM(x)                    ((x) >= '0' && (x) <= '9')
 #define CHAR2NUM(x)                     ((x) - '0')
+
+#define AT_ERROR_LINE_STRING            "ERROR"
+#define AT_ERROR_LINE_LEN               5
+
+/* Length of the "S3=%04d\r" header in front of a sent payload */
+#define AT_SEND_HEADER_LEN              8
+
+/* Private typedef -----------------------------------------------------------*/
+/* Response parser, fed with the bytes of one module response as they are
+ * received. Each byte is looked at once: the body is only inspected at line
+ * starts (for ERROR) and the OK trailer and prompt are taken from the last
+ * bytes kept in Tail, so nothing is null-terminated or scanned again. */
+typedef enum {
+  AT_RESPONSE_PENDING = 0,
+  AT_RESPONSE_OK,
+  AT_RESPONSE_ERROR,
+  AT_RESPONSE_PROMPT,
+} AT_Response_t;
+
+typedef struct {
+  uint32_t Length;                      /* bytes fed so far */
+  uint8_t  Binary;                      /* body is payload, do not look for ERROR lines */
+  uint8_t  Head;                        /* bytes of the leading "\r\n" matched, 0xFF on mismatch */
+  uint8_t  Line;                        /* bytes of the current line matched against ERROR */
+  uint8_t  Error;                       /* a line starting with ERROR was seen */
+  uint8_t  TailLen;
+  uint8_t  Tail[AT_OK_STRING_LEN];      /* last bytes of the response */
+} AT_Parser_t;
+
 /* Private function prototypes -----------------------------------------------*/
 static uint8_t Hex2Num(
     char a);
@@ -111,6 +140,8 @@ static ES_WIFI_Status_t AT_ExecuteCommand(
     ES_WIFIObject_t *Obj,
     uint8_t* cmd,
     uint8_t *pdata);
+static void AT_InvalidateSockets(
+    ES_WIFIObject_t *Obj);
 
 uint32_t HAL_GetTick(
     void);
@@ -791,6 +822,124 @@ static void AT_ParsePing(
   }
 }
 
+/**
+ * @brief  Start parsing a new response.
+ * @param  Parser: parser state
+ * @param  Binary: 1 if the response body is socket payload
+ * @retval None.
+ */
+static void AT_ParserInit(
+    AT_Parser_t *Parser,
+    uint8_t Binary)
+{
+  memset(Parser, 0, sizeof(AT_Parser_t));
+  Parser->Binary = Binary;
+}
+
+/**
+ * @brief  Feed received response bytes to the parser.
+ * @param  Parser: parser state
+ * @param  pdata: received bytes
+ * @param  len: number of bytes
+ * @retval None.
+ */
+static void AT_ParserFeed(
+    AT_Parser_t *Parser,
+    const uint8_t *pdata,
+    uint32_t len)
+{
+  const uint8_t *p = pdata;
+  const uint8_t *end = pdata + len;
+  const uint8_t *nl;
+  uint32_t keep;
+
+  while ((Parser->Head < 2) && (p < end))
+  {
+    if (*p++ == "\r\n"[Parser->Head])
+    {
+      Parser->Head++;
+    }
+    else
+    {
+      Parser->Head = 0xFF;
+      Parser->Line = AT_ERROR_LINE_LEN;
+    }
+  }
+
+  while (!Parser->Binary && (p < end))
+  {
+    while ((Parser->Line < AT_ERROR_LINE_LEN) && (p < end))
+    {
+      if (*p != AT_ERROR_LINE_STRING[Parser->Line])
+      {
+        Parser->Line = AT_ERROR_LINE_LEN;
+        break;
+      }
+      p++;
+      if (++Parser->Line == AT_ERROR_LINE_LEN)
+      {
+        Parser->Error = 1;
+      }
+    }
+
+    nl = memchr(p, '\n', end - p);
+    if (nl == NULL)
+    {
+      break;
+    }
+    p = nl + 1;
+    Parser->Line = 0;
+  }
+
+  /* keep the last AT_OK_STRING_LEN bytes for the trailer */
+  if (len >= AT_OK_STRING_LEN)
+  {
+    memcpy(Parser->Tail, end - AT_OK_STRING_LEN, AT_OK_STRING_LEN);
+    Parser->TailLen = AT_OK_STRING_LEN;
+  }
+  else
+  {
+    keep = AT_OK_STRING_LEN - len;
+    if (Parser->TailLen < keep)
+    {
+      keep = Parser->TailLen;
+    }
+    memmove(Parser->Tail, Parser->Tail + Parser->TailLen - keep, keep);
+    memcpy(Parser->Tail + keep, pdata, len);
+    Parser->TailLen = keep + len;
+  }
+
+  Parser->Length += len;
+}
+
+/**
+ * @brief  Tell how the response fed so far ends.
+ * @param  Parser: parser state
+ * @retval AT_RESPONSE_OK on the OK trailer, AT_RESPONSE_ERROR if an ERROR line
+ *         was seen, AT_RESPONSE_PROMPT on a bare prompt, else AT_RESPONSE_PENDING.
+ */
+static AT_Response_t AT_ParserResult(
+    const AT_Parser_t *Parser)
+{
+  const uint8_t *tail = Parser->Tail + Parser->TailLen;
+
+  if ((Parser->TailLen == AT_OK_STRING_LEN)
+      && (memcmp(Parser->Tail, AT_OK_STRING, AT_OK_STRING_LEN) == 0))
+  {
+    return AT_RESPONSE_OK;
+  }
+  if (Parser->Error)
+  {
+    return AT_RESPONSE_ERROR;
+  }
+  if ((Parser->TailLen >= AT_DELIMETER_LEN)
+      && (memcmp(tail - AT_DELIMETER_LEN, AT_DELIMETER_STRING, AT_DELIMETER_LEN) == 0))
+  {
+    return AT_RESPONSE_PROMPT;
+  }
+  return AT_RESPONSE_PENDING;
+}
+
 /**
  * @brief  Execute AT command.
  * @param  Obj: pointer to module handle
@@ -805,6 +954,8 @@ static ES_WIFI_Status_t AT_ExecuteCommand(
 {
   int ret = 0;
   int16_t recv_len = 0;
+  AT_Parser_t parser;
+  AT_Response_t response;
   LOCK_WIFI();
 
   ret = Obj->fops.IO_Send(cmd, strlen((char*) cmd), Obj->Timeout);
@@ -820,12 +971,15 @@ static ES_WIFI_Status_t AT_ExecuteCommand(
         recv_len--;
       }
       *(pdata + recv_len) = 0;
-      if (strstr((char *) pdata, AT_OK_STRING))
+      AT_ParserInit(&parser, 0);
+      AT_ParserFeed(&parser, pdata, recv_len);
+      response = AT_ParserResult(&parser);
+      if (response == AT_RESPONSE_OK)
       {
         UNLOCK_WIFI();
         return ES_WIFI_STATUS_OK;
       }
-      else if (strstr((char *) pdata, AT_ERROR_STRING))
+      else if (response == AT_RESPONSE_ERROR)
       {
         UNLOCK_WIFI();
         return ES_WIFI_STATUS_UNEXPECTED_CLOSED_SOCKET;
@@ -833,13 +987,54 @@ static ES_WIFI_Status_t AT_ExecuteCommand(
     }
     if (recv_len == ES_WIFI_ERROR_STUFFING_FOREVER)
     {
+      AT_InvalidateSockets(Obj);
       UNLOCK_WIFI();
       return ES_WIFI_STATUS_MODULE_CRASH;
     }
-  } UNLOCK_WIFI();
+  }
+  AT_InvalidateSockets(Obj);
+  UNLOCK_WIFI();
   return ES_WIFI_STATUS_IO_ERROR;
 }
 
+/**
+ * @brief  Read and parse the response to a data send.
+ * @param  Obj: pointer to module handle
+ * @param  pdata: pointer to returned data
+ * @retval Operation Status.
+ */
+static ES_WIFI_Status_t AT_ReadSendResponse(
+    ES_WIFIObject_t *Obj,
+    uint8_t *pdata)
+{
+  int16_t recv_len;
+  AT_Parser_t parser;
+  AT_Response_t response;
+
+  recv_len = Obj->fops.IO_Receive(pdata, 0, Obj->Timeout);
+  if (recv_len > 0)
+  {
+    *(pdata + recv_len) = 0;
+    AT_ParserInit(&parser, 0);
+    AT_ParserFeed(&parser, pdata, recv_len);
+    response = AT_ParserResult(&parser);
+    if (response == AT_RESPONSE_OK)
+    {
+      return ES_WIFI_STATUS_OK;
+    }
+    else if (response == AT_RESPONSE_ERROR)
+    {
+      return ES_WIFI_STATUS_UNEXPECTED_CLOSED_SOCKET;
+    }
+    return ES_WIFI_STATUS_ERROR;
+  }
+  if (recv_len == ES_WIFI_ERROR_STUFFING_FOREVER)
+  {
+    return ES_WIFI_STATUS_MODULE_CRASH;
+  }
+  return ES_WIFI_STATUS_ERROR;
+}
+
 /**
  * @brief  Execute AT command with data.
  * @param  Obj: pointer to module handle
@@ -858,9 +1053,9 @@ static ES_WIFI_Status_t AT_RequestSendData(
     uint8_t *pdata)
 {
   int16_t send_len = 0;
-  int16_t recv_len = 0;
   uint16_t cmd_len = 0;
   uint16_t n;
+  ES_WIFI_Status_t ret;
 
   LOCK_WIFI();
   cmd_len = strlen((char*) cmd);
@@ -868,37 +1063,38 @@ static ES_WIFI_Status_t AT_RequestSendData(
   /* can send only even number of byte on first send */
   if (cmd_len & 1)
     return ES_WIFI_STATUS_ERROR;
-  n = Obj->fops.IO_Send(cmd, cmd_len, Obj->Timeout);
+
+  if ((cmd == Obj->CmdData) && (len <= ES_WIFI_PAYLOAD_SIZE))
+  {
+    /* gather command and payload so that they go out in one transfer */
+    memcpy(Obj->CmdData + cmd_len, pcmd_data, len);
+    n = Obj->fops.IO_Send(cmd, cmd_len + len, Obj->Timeout);
+    if (n == cmd_len + len)
+    {
+      n = cmd_len;
+      send_len = len;
+    }
+    else
+    {
+      n = 0;
+    }
+  }
+  else
+  {
+    n = Obj->fops.IO_Send(cmd, cmd_len, Obj->Timeout);
+    if (n == cmd_len)
+    {
+      send_len = Obj->fops.IO_Send(pcmd_data, len, Obj->Timeout);
+    }
+  }
+
   if (n == cmd_len)
   {
-    send_len = Obj->fops.IO_Send(pcmd_data, len, Obj->Timeout);
     if (send_len == len)
     {
-      recv_len = Obj->fops.IO_Receive(pdata, 0, Obj->Timeout);
-      if (recv_len > 0)
-      {
-        *(pdata + recv_len) = 0;
-        if (strstr((char *) pdata, AT_OK_STRING))
-        {
-          UNLOCK_WIFI();
-          return ES_WIFI_STATUS_OK;
-        }
-        else if (strstr((char *) pdata, AT_ERROR_STRING))
-        {
-          UNLOCK_WIFI();
-          return ES_WIFI_STATUS_UNEXPECTED_CLOSED_SOCKET;
-        }
-        else
-        {
-          UNLOCK_WIFI();
-          return ES_WIFI_STATUS_ERROR;
-        }
-      } UNLOCK_WIFI();
-      if (recv_len == ES_WIFI_ERROR_STUFFING_FOREVER)
-      {
-        return ES_WIFI_STATUS_MODULE_CRASH;
-      }
-      return ES_WIFI_STATUS_ERROR;
+      ret = AT_ReadSendResponse(Obj, pdata);
+      UNLOCK_WIFI();
+      return ret;
     }
     else
     {
@@ -912,7 +1108,7 @@ static ES_WIFI_Status_t AT_RequestSendData(
  * @brief  Parses Received data.
  * @param  Obj: pointer to module handle
  * @param  cmd:command formatted string
- * @param  pdata: payload
+ * @param  pdata: set to the payload, inside Obj->CmdData
  * @param  Reqlen : requested Data length.
  * @param  ReadData : pointer to received data length.
  * @retval Operation Status.
@@ -920,58 +1116,310 @@ static ES_WIFI_Status_t AT_RequestSendData(
 static ES_WIFI_Status_t AT_RequestReceiveData(
     ES_WIFIObject_t *Obj,
     uint8_t* cmd,
-    char *pdata,
+    uint8_t **pdata,
     uint16_t Reqlen,
     uint16_t *ReadData)
 {
-  int len;
-  uint8_t *p = Obj->CmdData;
+  int len;
+  AT_Parser_t parser;
+
+  LOCK_WIFI();
+  *ReadData = 0;
+  if (Obj->fops.IO_Send(cmd, strlen((char*) cmd), Obj->Timeout) > 0)
+  {
+    len = Obj->fops.IO_Receive(Obj->CmdData, 0, Obj->Timeout);
+    if (len > 0)
+    {
+      while (len && (Obj->CmdData[len - 1] == 0x15))
+        len--;
+      Obj->CmdData[len] = '\0';
+      AT_ParserInit(&parser, 1);
+      AT_ParserFeed(&parser, Obj->CmdData, len);
+      if (parser.Head != 2)
+      {
+        AT_InvalidateSockets(Obj);
+        UNLOCK_WIFI();
+        return ES_WIFI_STATUS_IO_ERROR;
+      }
+      if (parser.Length >= 2 + AT_OK_STRING_LEN)
+      {
+        if (AT_ParserResult(&parser) == AT_RESPONSE_OK)
+        {
+          /* "\r\n" <payload> "\r\nOK\r\n> " */
+          *ReadData = parser.Length - 2 - AT_OK_STRING_LEN;
+          if (*ReadData > Reqlen)
+          {
+            *ReadData = Reqlen;
+          }
+          *pdata = Obj->CmdData + 2;
+          UNLOCK_WIFI();
+          return ES_WIFI_STATUS_OK;
+        }
+        UNLOCK_WIFI();
+        return ES_WIFI_STATUS_UNEXPECTED_CLOSED_SOCKET;
+      }
+    }
+    else if (len == ES_WIFI_ERROR_STUFFING_FOREVER)
+    {
+      AT_InvalidateSockets(Obj);
+      UNLOCK_WIFI();
+      return ES_WIFI_STATUS_MODULE_CRASH;
+    }
+  }
+  AT_InvalidateSockets(Obj);
+  UNLOCK_WIFI();
+  return ES_WIFI_STATUS_IO_ERROR;
+}
+
+/**
+ * @brief  Forget all socket parameters, e.g. after a module reset.
+ * @param  Obj: pointer to module handle
+ * @retval None.
+ */
+static void AT_ResetSockets(
+    ES_WIFIObject_t *Obj)
+{
+  Obj->CurrentSocket = ES_WIFI_SOCKET_NONE;
+  memset(Obj->SocketCache, 0, sizeof(Obj->SocketCache));
+}
+
+/**
+ * @brief  Mark cached socket parameters as unknown after a failed exchange.
+ *         Pinned destinations are kept and programmed again on next send.
+ * @param  Obj: pointer to module handle
+ * @retval None.
+ */
+static void AT_InvalidateSockets(
+    ES_WIFIObject_t *Obj)
+{
+  uint8_t i;
+
+  Obj->CurrentSocket = ES_WIFI_SOCKET_NONE;
+  for (i = 0; i < ES_WIFI_MAX_SOCKETS; i++)
+  {
+    Obj->SocketCache[i].Valid = 0;
+  }
+}
+
+/**
+ * @brief  Return the parameter cache of a socket.
+ * @param  Obj: pointer to module handle
+ * @param  Socket: number of the socket
+ * @retval Cache entry, NULL if the socket number is out of range.
+ */
+static ES_WIFI_SocketCache_t *AT_SocketCache(
+    ES_WIFIObject_t *Obj,
+    uint8_t Socket)
+{
+  return (Socket < ES_WIFI_MAX_SOCKETS) ? &Obj->SocketCache[Socket] : NULL;
+}
+
+/**
+ * @brief  Forget the cached parameters of a socket being started or stopped.
+ * @param  Obj: pointer to module handle
+ * @param  Socket: number of the socket
+ * @retval None.
+ */
+static void AT_ResetSocket(
+    ES_WIFIObject_t *Obj,
+    uint8_t Socket)
+{
+  ES_WIFI_SocketCache_t *cache = AT_SocketCache(Obj, Socket);
+
+  if (cache != NULL)
+  {
+    memset(cache, 0, sizeof(*cache));
+  }
+}
+
+/**
+ * @brief  Select the socket the following commands apply to (P0).
+ * @param  Obj: pointer to module handle
+ * @param  Socket: number of the socket
+ * @retval Operation Status.
+ */
+static ES_WIFI_Status_t AT_SelectSocket(
+    ES_WIFIObject_t *Obj,
+    uint8_t Socket)
+{
+  ES_WIFI_Status_t ret = ES_WIFI_STATUS_OK;
+
+  if (Obj->CurrentSocket != Socket)
+  {
+    sprintf((char*) Obj->CmdData, "P0=%d\r", Socket);
+    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    Obj->CurrentSocket = (ret == ES_WIFI_STATUS_OK) ? Socket : ES_WIFI_SOCKET_NONE;
+  }
+  return ret;
+}
+
+/**
+ * @brief  Set the local port of the selected socket (P2) unless unchanged.
+ * @param  Obj: pointer to module handle
+ * @param  Socket: number of the selected socket
+ * @param  Port: local port
+ * @retval Operation Status.
+ */
+static ES_WIFI_Status_t AT_SetLocalPort(
+    ES_WIFIObject_t *Obj,
+    uint8_t Socket,
+    uint16_t Port)
+{
+  ES_WIFI_SocketCache_t *cache = AT_SocketCache(Obj, Socket);
+  ES_WIFI_Status_t ret = ES_WIFI_STATUS_OK;
+
+  if ((cache == NULL) || !(cache->Valid & ES_WIFI_CACHE_LOCAL_PORT) || (cache->LocalPort != Port))
+  {
+    sprintf((char*) Obj->CmdData, "P2=%d\r", Port);
+    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    if (cache != NULL)
+    {
+      cache->LocalPort = Port;
+      if (ret == ES_WIFI_STATUS_OK)
+      {
+        cache->Valid |= ES_WIFI_CACHE_LOCAL_PORT;
+      }
+      else
+      {
+        cache->Valid &= ~ES_WIFI_CACHE_LOCAL_PORT;
+      }
+    }
+  }
+  return ret;
+}
+
+/**
+ * @brief  Set the remote port and address of the selected socket (P4, P3)
+ *         unless unchanged.
+ * @param  Obj: pointer to module handle
+ * @param  Socket: number of the selected socket
+ * @param  IPaddr: 4-byte remote IP address
+ * @param  Port: remote port
+ * @retval Operation Status.
+ */
+static ES_WIFI_Status_t AT_SetRemote(
+    ES_WIFIObject_t *Obj,
+    uint8_t Socket,
+    const uint8_t *IPaddr,
+    uint16_t Port)
+{
+  ES_WIFI_SocketCache_t *cache = AT_SocketCache(Obj, Socket);
+  ES_WIFI_Status_t ret = ES_WIFI_STATUS_OK;
+
+  if ((cache != NULL) && (cache->Valid & ES_WIFI_CACHE_REMOTE)
+      && (cache->RemotePort == Port) && (memcmp(cache->RemoteIP, IPaddr, 4) == 0))
+  {
+    return ES_WIFI_STATUS_OK;
+  }
+
+  if (cache != NULL)
+  {
+    cache->Valid &= ~ES_WIFI_CACHE_REMOTE;
+  }
+
+  sprintf((char*) Obj->CmdData, "P4=%d\r", Port);
+  ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+
+  if (ret == ES_WIFI_STATUS_OK)
+  {
+    sprintf((char*) Obj->CmdData, "P3=%d.%d.%d.%d\r", IPaddr[0], IPaddr[1], IPaddr[2], IPaddr[3]);
+    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+  }
+
+  if ((ret == ES_WIFI_STATUS_OK) && (cache != NULL))
+  {
+    memmove(cache->RemoteIP, IPaddr, 4);
+    cache->RemotePort = Port;
+    cache->Valid |= ES_WIFI_CACHE_REMOTE;
+  }
+  return ret;
+}
+
+/**
+ * @brief  Set the write timeout of the selected socket (S2) unless unchanged.
+ * @param  Obj: pointer to module handle
+ * @param  Socket: number of the selected socket
+ * @param  Timeout: write timeout in ms
+ * @retval Operation Status.
+ */
+static ES_WIFI_Status_t AT_SetWriteTimeout(
+    ES_WIFIObject_t *Obj,
+    uint8_t Socket,
+    uint32_t Timeout)
+{
+  ES_WIFI_SocketCache_t *cache = AT_SocketCache(Obj, Socket);
+  ES_WIFI_Status_t ret = ES_WIFI_STATUS_OK;
+
+  if ((cache == NULL) || !(cache->Valid & ES_WIFI_CACHE_WRITE_TIMEOUT) || (cache->WriteTimeout != Timeout))
+  {
+    sprintf((char*) Obj->CmdData, "S2=%lu\r", Timeout);
+    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    if (cache != NULL)
+    {
+      cache->WriteTimeout = Timeout;
+      if (ret == ES_WIFI_STATUS_OK)
+      {
+        cache->Valid |= ES_WIFI_CACHE_WRITE_TIMEOUT;
+      }
+      else
+      {
+        cache->Valid &= ~ES_WIFI_CACHE_WRITE_TIMEOUT;
+      }
+    }
+  }
+  return ret;
+}
+
+/**
+ * @brief  Set the read length (R1) and timeout (R2) of the selected socket
+ *         unless unchanged.
+ * @param  Obj: pointer to module handle
+ * @param  Socket: number of the selected socket
+ * @param  Reqlen: requested data length
+ * @param  Timeout: read timeout in ms
+ * @retval Operation Status.
+ */
+static ES_WIFI_Status_t AT_SetReadParams(
+    ES_WIFIObject_t *Obj,
+    uint8_t Socket,
+    uint16_t Reqlen,
+    uint32_t Timeout)
+{
+  ES_WIFI_SocketCache_t *cache = AT_SocketCache(Obj, Socket);
+  ES_WIFI_Status_t ret = ES_WIFI_STATUS_OK;
 
-  LOCK_WIFI();
-  if (Obj->fops.IO_Send(cmd, strlen((char*) cmd), Obj->Timeout) > 0)
+  if ((cache == NULL) || !(cache->Valid & ES_WIFI_CACHE_READ_LENGTH) || (cache->ReadLength != Reqlen))
   {
-    len = Obj->fops.IO_Receive(p, 0, Obj->Timeout);
-    if ((p[0] != '\r') || (p[1] != '\n'))
+    sprintf((char*) Obj->CmdData, "R1=%d\r", Reqlen);
+    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    if (ret != ES_WIFI_STATUS_OK)
     {
-      return ES_WIFI_STATUS_IO_ERROR;
+      DEBUG("setting requested len failed\n");
+      return ret;
     }
-    len -= 2;
-    p += 2;
-    if (len >= AT_OK_STRING_LEN)
+    if (cache != NULL)
     {
-      while (len && (p[len - 1] == 0x15))
-        len--;
-      p[len] = '\0';
-      if (strstr((char*) p + len - AT_OK_STRING_LEN, AT_OK_STRING))
-      {
-        *ReadData = len - AT_OK_STRING_LEN;
-        if (*ReadData > Reqlen)
-        {
-          *ReadData = Reqlen;
-        }
-        memcpy(pdata, p, *ReadData);
-        UNLOCK_WIFI();
-        return ES_WIFI_STATUS_OK;
-      }
-      else if (memcmp((char *) p + len - AT_DELIMETER_LEN, AT_DELIMETER_STRING, AT_DELIMETER_LEN)
-          == 0)
-      {
-        *ReadData = 0;
-        UNLOCK_WIFI();
-        return ES_WIFI_STATUS_UNEXPECTED_CLOSED_SOCKET;
-      }
+      cache->ReadLength = Reqlen;
+      cache->Valid |= ES_WIFI_CACHE_READ_LENGTH;
+    }
+  }
 
-      UNLOCK_WIFI();
-      *ReadData = 0;
-      return ES_WIFI_STATUS_UNEXPECTED_CLOSED_SOCKET;
+  if ((cache == NULL) || !(cache->Valid & ES_WIFI_CACHE_READ_TIMEOUT) || (cache->ReadTimeout != Timeout))
+  {
+    sprintf((char*) Obj->CmdData, "R2=%lu\r", Timeout);
+    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    if (ret != ES_WIFI_STATUS_OK)
+    {
+      DEBUG("setting timeout failed\n");
+      return ret;
     }
-    if (len == ES_WIFI_ERROR_STUFFING_FOREVER)
+    if (cache != NULL)
     {
-      UNLOCK_WIFI();
-      return ES_WIFI_STATUS_MODULE_CRASH;
+      cache->ReadTimeout = Timeout;
+      cache->Valid |= ES_WIFI_CACHE_READ_TIMEOUT;
     }
-  } UNLOCK_WIFI();
-  return ES_WIFI_STATUS_IO_ERROR;
+  }
+  return ret;
 }
 
 /**
@@ -987,6 +1435,7 @@ ES_WIFI_Status_t ES_WIFI_Init(
   LOCK_WIFI();
 
   Obj->Timeout = ES_WIFI_TIMEOUT;
+  AT_ResetSockets(Obj);
 
   if (Obj->fops.IO_Init(ES_WIFI_INIT) == 0)
   {
@@ -1107,7 +1556,28 @@ ES_WIFI_Status_t ES_WIFI_RegisterBusIO(
   Obj->fops.IO_Send = IO_Send;
   Obj->fops.IO_Receive = IO_Receive;
   Obj->fops.IO_Delay = IO_Delay;
+  Obj->fops.IO_TxBuffer = NULL;
+
+  return ES_WIFI_STATUS_OK;
+}
+
+/**
+ * @brief  Let ES_WIFI_SendStream fill the bus IO transmit buffers in place.
+ * @param  Obj: pointer to module handle
+ * @param  IO_TxBuffer: returns the idle transmit buffer for a transfer of
+ *         len bytes, NULL if it does not fit. Call after ES_WIFI_RegisterBusIO.
+ * @retval Operation Status.
+ */
+ES_WIFI_Status_t ES_WIFI_RegisterTxBuffer(
+    ES_WIFIObject_t *Obj,
+    IO_TxBuffer_Func IO_TxBuffer)
+{
+  if (!Obj)
+  {
+    return ES_WIFI_STATUS_ERROR;
+  }
 
+  Obj->fops.IO_TxBuffer = IO_TxBuffer;
   return ES_WIFI_STATUS_OK;
 }
 
@@ -1138,6 +1608,8 @@ ES_WIFI_Status_t ES_WIFI_ListAccessPoints(
   ES_WIFI_Status_t ret;
   int send_len;
   int16_t recv_len = 0;
+  AT_Parser_t parser;
+  AT_Response_t response;
   uint8_t version[4] =
   { 0 };
   LOCK_WIFI();
@@ -1164,12 +1636,15 @@ ES_WIFI_Status_t ES_WIFI_ListAccessPoints(
         {
           *(Obj->CmdData + recv_len) = 0;
 
-          if (strstr((char *) Obj->CmdData, AT_OK_STRING))
+          AT_ParserInit(&parser, 0);
+          AT_ParserFeed(&parser, Obj->CmdData, recv_len);
+          response = AT_ParserResult(&parser);
+          if (response == AT_RESPONSE_OK)
           {
             UNLOCK_WIFI();
             return ES_WIFI_STATUS_OK;
           }
-          else if (strstr((char *) Obj->CmdData, AT_ERROR_STRING))
+          else if (response == AT_RESPONSE_ERROR)
           {
             UNLOCK_WIFI();
             return ES_WIFI_STATUS_UNEXPECTED_CLOSED_SOCKET;
@@ -1508,6 +1983,7 @@ ES_WIFI_Status_t ES_WIFI_ResetToFactoryDefault(
   LOCK_WIFI();
   sprintf((char*) Obj->CmdData, "Z0\r");
   ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+  AT_ResetSockets(Obj);
   UNLOCK_WIFI();
   return ret;
 }
@@ -1523,6 +1999,7 @@ ES_WIFI_Status_t ES_WIFI_ResetModule(
   int ret;
   LOCK_WIFI();
 
+  AT_ResetSockets(Obj);
   sprintf((char*) Obj->CmdData, "ZR\r");
   ret = Obj->fops.IO_Send(Obj->CmdData, strlen((char*) Obj->CmdData), Obj->Timeout);
 #if (ES_WIFI_USE_UART == 0)
@@ -1546,6 +2023,7 @@ ES_WIFI_Status_t ES_WIFI_HardResetModule(
 {
   int ret;
   LOCK_WIFI();
+  AT_ResetSockets(Obj);
   ret = Obj->fops.IO_Init(ES_WIFI_RESET);
   UNLOCK_WIFI();
   return (ret > 0) ? ES_WIFI_STATUS_OK : ES_WIFI_STATUS_ERROR;
@@ -1750,8 +2228,8 @@ ES_WIFI_Status_t ES_WIFI_StartClientConnection(
 
   LOCK_WIFI();
 
-  sprintf((char*) Obj->CmdData, "P0=%d\r", conn->Number);
-  ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+  AT_ResetSocket(Obj, conn->Number);
+  ret = AT_SelectSocket(Obj, conn->Number);
 
   if (ret == ES_WIFI_STATUS_OK)
   {
@@ -1761,21 +2239,12 @@ ES_WIFI_Status_t ES_WIFI_StartClientConnection(
 
   if (ret == ES_WIFI_STATUS_OK)
   {
-    sprintf((char*) Obj->CmdData, "P2=%d\r", conn->LocalPort);
-    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
-  }
-
-  if ((ret == ES_WIFI_STATUS_OK))
-  {
-    sprintf((char*) Obj->CmdData, "P4=%d\r", conn->RemotePort);
-    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    ret = AT_SetLocalPort(Obj, conn->Number, conn->LocalPort);
   }
 
   if ((ret == ES_WIFI_STATUS_OK))
   {
-    sprintf((char*) Obj->CmdData, "P3=%d.%d.%d.%d\r", conn->RemoteIP[0], conn->RemoteIP[1],
-        conn->RemoteIP[2], conn->RemoteIP[3]);
-    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    ret = AT_SetRemote(Obj, conn->Number, conn->RemoteIP, conn->RemotePort);
   }
 
   if ((ret == ES_WIFI_STATUS_OK) && (conn->Type == ES_WIFI_TCP_SSL_CONNECTION))
@@ -1806,8 +2275,8 @@ ES_WIFI_Status_t ES_WIFI_StopClientConnection(
   ES_WIFI_Status_t ret;
   LOCK_WIFI();
 
-  sprintf((char*) Obj->CmdData, "P0=%d\r", conn->Number);
-  ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+  AT_ResetSocket(Obj, conn->Number);
+  ret = AT_SelectSocket(Obj, conn->Number);
 
   if (ret == ES_WIFI_STATUS_OK)
   {
@@ -1830,8 +2299,8 @@ ES_WIFI_Status_t ES_WIFI_StartAWSClientConnection(ES_WIFIObject_t *Obj, ES_WIFI_
   ES_WIFI_Status_t ret;
   LOCK_WIFI();
 
-  sprintf((char*)Obj->CmdData,"P0=%d\r", conn->Number);
-  ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+  AT_ResetSocket(Obj, conn->Number);
+  ret = AT_SelectSocket(Obj, conn->Number);
 
   if(ret == ES_WIFI_STATUS_OK)
   {
@@ -1895,8 +2364,8 @@ ES_WIFI_Status_t ES_WIFI_StartServerSingleConn(
   ES_WIFI_Status_t ret = ES_WIFI_STATUS_OK;
   LOCK_WIFI();
 
-  sprintf((char*) Obj->CmdData, "P0=%d\r", conn->Number);
-  ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+  AT_ResetSocket(Obj, conn->Number);
+  ret = AT_SelectSocket(Obj, conn->Number);
   if (ret != ES_WIFI_STATUS_OK)
   {
     UNLOCK_WIFI();
@@ -2050,8 +2519,8 @@ ES_WIFI_Status_t ES_WIFI_CloseServerConnection(
 {
   ES_WIFI_Status_t ret;
   LOCK_WIFI();
-  sprintf((char*) Obj->CmdData, "P0=%d\r", socket);
-  ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+  AT_ResetSocket(Obj, socket);
+  ret = AT_SelectSocket(Obj, socket);
   if (ret != ES_WIFI_STATUS_OK)
   {
     DEBUG(" Can not select socket %s\n", Obj->CmdData)
@@ -2081,8 +2550,8 @@ ES_WIFI_Status_t ES_WIFI_StopServerSingleConn(
 {
   ES_WIFI_Status_t ret;
   LOCK_WIFI();
-  sprintf((char*) Obj->CmdData, "P0=%d\r", socket);
-  ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+  AT_ResetSocket(Obj, socket);
+  ret = AT_SelectSocket(Obj, socket);
   if (ret != ES_WIFI_STATUS_OK)
   {
     DEBUG("Selecting socket failed: %s\n", Obj->CmdData)
@@ -2120,8 +2589,8 @@ ES_WIFI_Status_t ES_WIFI_StartServerMultiConn(
   ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
   if (ret == ES_WIFI_STATUS_OK)
   {
-    sprintf((char*) Obj->CmdData, "P0=%d\r", conn->Number);
-    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    AT_ResetSocket(Obj, conn->Number);
+    ret = AT_SelectSocket(Obj, conn->Number);
     if (ret == ES_WIFI_STATUS_OK)
     {
       sprintf((char*) Obj->CmdData, "P1=%d\r", conn->Type);
@@ -2178,8 +2647,8 @@ ES_WIFI_Status_t ES_WIFI_StopServerMultiConn(
   ES_WIFI_Status_t ret = ES_WIFI_STATUS_OK;
   LOCK_WIFI();
 
-  sprintf((char*) Obj->CmdData, "P0=%d\r", conn->Number);
-  ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+  AT_ResetSocket(Obj, conn->Number);
+  ret = AT_SelectSocket(Obj, conn->Number);
   if (ret != ES_WIFI_STATUS_OK)
   {
     UNLOCK_WIFI();
@@ -2248,6 +2717,8 @@ ES_WIFI_Status_t ES_WIFI_SendData(
     uint32_t Timeout)
 {
   uint32_t wkgTimeOut;
+  ES_WIFI_SocketCache_t *cache;
+  uint8_t remoteIP[4];
 
   ES_WIFI_Status_t ret = ES_WIFI_STATUS_ERROR;
 
@@ -2265,12 +2736,20 @@ ES_WIFI_Status_t ES_WIFI_SendData(
     Reqlen = ES_WIFI_PAYLOAD_SIZE;
 
   *SentLen = Reqlen;
-  sprintf((char*) Obj->CmdData, "P0=%d\r", Socket);
-  ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+  ret = AT_SelectSocket(Obj, Socket);
+
+  /* Connected UDP sockets send to their pinned destination, reprogrammed
+     only if a failed exchange left it unknown */
+  cache = AT_SocketCache(Obj, Socket);
+  if ((ret == ES_WIFI_STATUS_OK) && (cache != NULL) && cache->Connected)
+  {
+    memcpy(remoteIP, cache->RemoteIP, sizeof(remoteIP));
+    ret = AT_SetRemote(Obj, Socket, remoteIP, cache->RemotePort);
+  }
+
   if (ret == ES_WIFI_STATUS_OK)
   {
-    sprintf((char*) Obj->CmdData, "S2=%lu\r", wkgTimeOut);
-    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    ret = AT_SetWriteTimeout(Obj, Socket, wkgTimeOut);
 
     if (ret == ES_WIFI_STATUS_OK)
     {
@@ -2300,6 +2779,11 @@ ES_WIFI_Status_t ES_WIFI_SendData(
     DEBUG("P0 command failed\n");
   }
 
+  if (ret != ES_WIFI_STATUS_OK)
+  {
+    AT_InvalidateSockets(Obj);
+  }
+
   if (ret == ES_WIFI_STATUS_ERROR)
   {
     *SentLen = 0;
@@ -2318,6 +2802,7 @@ ES_WIFI_Status_t ES_WIFI_SendDataTo(
     uint16_t Port)
 {
   uint32_t wkgTimeOut;
+  ES_WIFI_SocketCache_t *cache;
 
   ES_WIFI_Status_t ret = ES_WIFI_STATUS_ERROR;
 
@@ -2332,26 +2817,23 @@ ES_WIFI_Status_t ES_WIFI_SendDataTo(
 
   LOCK_WIFI();
 
-  sprintf((char*) Obj->CmdData, "P0=%d\r", Socket);
-  ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
-
-  if (ret == ES_WIFI_STATUS_OK)
+  /* The destination of a connected socket is only changed by ES_WIFI_ConnectUDP */
+  cache = AT_SocketCache(Obj, Socket);
+  if ((cache != NULL) && cache->Connected
+      && ((cache->RemotePort != Port) || (memcmp(cache->RemoteIP, IPaddr, 4) != 0)))
   {
-    sprintf((char*) Obj->CmdData, "P2=%d\r", /*LocalPort*/56830); // WARN: Does not work!
-    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    *SentLen = 0;
+    UNLOCK_WIFI();
+    return ES_WIFI_STATUS_ERROR;
   }
 
-  // ? Are we sure that the Firmware can change the packet destination without stopping the socket?
-  if (ret == ES_WIFI_STATUS_OK)
-  {
-    sprintf((char*) Obj->CmdData, "P4=%d\r", Port);
-    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
-  }
+  /* The socket keeps the local port it was started with */
+  ret = AT_SelectSocket(Obj, Socket);
 
+  // ? Are we sure that the Firmware can change the packet destination without stopping the socket?
   if (ret == ES_WIFI_STATUS_OK)
   {
-    sprintf((char*) Obj->CmdData, "P3=%d.%d.%d.%d\r", IPaddr[0], IPaddr[1], IPaddr[2], IPaddr[3]);
-    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    ret = AT_SetRemote(Obj, Socket, IPaddr, Port);
   }
 
   if (ret == ES_WIFI_STATUS_OK)
@@ -2364,8 +2846,7 @@ ES_WIFI_Status_t ES_WIFI_SendDataTo(
 
   if (ret == ES_WIFI_STATUS_OK)
   {
-    sprintf((char*) Obj->CmdData, "S2=%lu\r", wkgTimeOut);
-    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    ret = AT_SetWriteTimeout(Obj, Socket, wkgTimeOut);
   }
 
   if (ret == ES_WIFI_STATUS_OK)
@@ -2398,25 +2879,238 @@ ES_WIFI_Status_t ES_WIFI_SendDataTo(
   {
     DEBUG("Send error:\n%s\n", Obj->CmdData)
 ;    *SentLen = 0;
+    AT_InvalidateSockets(Obj);
+  }
+
+  UNLOCK_WIFI();
+  return ret;
+}
+
+/**
+ * @brief  Pin the destination of a UDP socket, so that ES_WIFI_SendData
+ *         sends datagrams without reprogramming the remote address.
+ * @param  Obj: pointer to module handle
+ * @param  Socket: number of the socket
+ * @param  IPaddr: 4-byte remote IP address, NULL to unpin the socket
+ * @param  Port: remote port
+ * @retval Operation Status.
+ */
+ES_WIFI_Status_t ES_WIFI_ConnectUDP(
+    ES_WIFIObject_t *Obj,
+    uint8_t Socket,
+    uint8_t *IPaddr,
+    uint16_t Port)
+{
+  ES_WIFI_SocketCache_t *cache;
+  ES_WIFI_Status_t ret = ES_WIFI_STATUS_OK;
+
+  cache = AT_SocketCache(Obj, Socket);
+  if (cache == NULL)
+  {
+    return ES_WIFI_STATUS_ERROR;
+  }
+
+  LOCK_WIFI();
+
+  cache->Connected = 0;
+  if (IPaddr != NULL)
+  {
+    ret = AT_SelectSocket(Obj, Socket);
+
+    if (ret == ES_WIFI_STATUS_OK)
+    {
+      ret = AT_SetRemote(Obj, Socket, IPaddr, Port);
+    }
+
+    if (ret == ES_WIFI_STATUS_OK)
+    {
+      cache->Connected = 1;
+    }
+    else
+    {
+      AT_InvalidateSockets(Obj);
+    }
+  }
+
+  UNLOCK_WIFI();
+  return ret;
+}
+
+/**
+ * @brief  Get the buffer the next chunk of a stream is filled in.
+ * @param  Obj: pointer to module handle
+ * @param  len: payload length
+ * @retval The idle bus IO transmit buffer, NULL to use Obj->CmdData.
+ */
+static uint8_t *AT_StreamBuffer(
+    ES_WIFIObject_t *Obj,
+    uint16_t len)
+{
+  if (Obj->fops.IO_TxBuffer == NULL)
+  {
+    return NULL;
+  }
+  return Obj->fops.IO_TxBuffer(AT_SEND_HEADER_LEN + len);
+}
+
+/**
+ * @brief  Write the S3 header and the payload of a stream chunk.
+ * @param  pdata: buffer of the transfer
+ * @param  len: payload length
+ * @param  Fill: payload source
+ * @param  Context: passed to Fill
+ * @retval Operation Status.
+ */
+static ES_WIFI_Status_t AT_StreamFill(
+    uint8_t *pdata,
+    uint16_t len,
+    ES_WIFI_Fill_Func Fill,
+    void *Context)
+{
+  sprintf((char *) pdata, "S3=%04d\r", len);
+  if (Fill(Context, pdata + AT_SEND_HEADER_LEN, len) != len)
+  {
+    DEBUG("Stream fill failed\n");
+    return ES_WIFI_STATUS_ERROR;
+  }
+  return ES_WIFI_STATUS_OK;
+}
+
+/**
+ * @brief  Send a stream of data over WIFI, ES_WIFI_PAYLOAD_SIZE bytes per
+ *         S3 command. If the bus IO lends its transmit buffers, the next
+ *         chunk is filled in the idle one while the current chunk is sent
+ *         and the module answers.
+ * @param  Obj: pointer to module handle
+ * @param  Socket: number of the socket
+ * @param  Fill: called once per chunk, in order, to write its payload
+ * @param  Context: passed to Fill
+ * @param  Length: length of the stream
+ * @param  SentLen: pointer to the length sent
+ * @param  Timeout: write timeout of each chunk in ms
+ * @retval Operation Status.
+ */
+ES_WIFI_Status_t ES_WIFI_SendStream(
+    ES_WIFIObject_t *Obj,
+    uint8_t Socket,
+    ES_WIFI_Fill_Func Fill,
+    void *Context,
+    uint32_t Length,
+    uint32_t *SentLen,
+    uint32_t Timeout)
+{
+  uint32_t wkgTimeOut;
+  ES_WIFI_SocketCache_t *cache;
+  uint8_t remoteIP[4];
+  uint8_t *buf;
+  uint8_t *next;
+  uint16_t len;
+  uint16_t next_len;
+  int32_t sent;
+  ES_WIFI_Status_t fill;
+
+  ES_WIFI_Status_t ret = ES_WIFI_STATUS_ERROR;
+
+  if (Timeout == 0)
+  {
+    wkgTimeOut = NET_DEFAULT_NOBLOCKING_WRITE_TIMEOUT;
+  }
+  else
+  {
+    wkgTimeOut = Timeout;
+  }
+
+  LOCK_WIFI();
+  *SentLen = 0;
+  ret = AT_SelectSocket(Obj, Socket);
+
+  cache = AT_SocketCache(Obj, Socket);
+  if ((ret == ES_WIFI_STATUS_OK) && (cache != NULL) && cache->Connected)
+  {
+    memcpy(remoteIP, cache->RemoteIP, sizeof(remoteIP));
+    ret = AT_SetRemote(Obj, Socket, remoteIP, cache->RemotePort);
+  }
+
+  if (ret == ES_WIFI_STATUS_OK)
+  {
+    ret = AT_SetWriteTimeout(Obj, Socket, wkgTimeOut);
+  }
+
+  len = MIN(Length, ES_WIFI_PAYLOAD_SIZE);
+  buf = AT_StreamBuffer(Obj, len);
+  if ((ret == ES_WIFI_STATUS_OK) && (len > 0))
+  {
+    ret = AT_StreamFill((buf != NULL) ? buf : Obj->CmdData, len, Fill, Context);
+  }
+
+  while ((ret == ES_WIFI_STATUS_OK) && (len > 0))
+  {
+    if (Obj->fops.IO_Send((buf != NULL) ? buf : Obj->CmdData, AT_SEND_HEADER_LEN + len,
+                          Obj->Timeout) != AT_SEND_HEADER_LEN + len)
+    {
+      ret = ES_WIFI_STATUS_IO_ERROR;
+      break;
+    }
+
+    /* The transfer runs on its own: fill the other buffer meanwhile */
+    next_len = MIN(Length - *SentLen - len, ES_WIFI_PAYLOAD_SIZE);
+    next = NULL;
+    fill = ES_WIFI_STATUS_OK;
+    if ((buf != NULL) && (next_len > 0))
+    {
+      next = AT_StreamBuffer(Obj, next_len);
+      if (next != NULL)
+      {
+        fill = AT_StreamFill(next, next_len, Fill, Context);
+      }
+    }
+
+    ret = AT_ReadSendResponse(Obj, Obj->CmdData);
+    if (ret != ES_WIFI_STATUS_OK)
+    {
+      DEBUG("Send stream failed\n");
+      break;
+    }
+    sent = ParseNumber((char *) Obj->CmdData + 2, NULL);
+    if (sent < len)
+    {
+      DEBUG("Send stream detect error %s\n", (char *)Obj->CmdData);
+      ret = ES_WIFI_STATUS_ERROR;
+      break;
+    }
+    *SentLen += len;
+
+    buf = next;
+    len = next_len;
+    if ((len > 0) && (buf == NULL))
+    {
+      fill = AT_StreamFill(Obj->CmdData, len, Fill, Context);
+    }
+    ret = fill;
   }
 
+  if (ret != ES_WIFI_STATUS_OK)
+  {
+    AT_InvalidateSockets(Obj);
+  }
   UNLOCK_WIFI();
   return ret;
 }
 
 int issue15 = 0;
 /**
- * @brief  Receive an amount data over WIFI.
+ * @brief  Receive an amount data over WIFI without copying it.
  * @param  Obj: pointer to module handle
  * @param  Socket: number of the socket
- * @param  pdata: pointer to data
+ * @param  pdata: set to the received data, which stays in the module handle
+ *         buffer and is valid until the next call on Obj
  * @param  len : pointer to the length of the data to be received
  * @retval Operation Status.
  */
-ES_WIFI_Status_t ES_WIFI_ReceiveData(
+ES_WIFI_Status_t ES_WIFI_ReceiveDataSpan(
     ES_WIFIObject_t *Obj,
     uint8_t Socket,
-    uint8_t *pdata,
+    uint8_t **pdata,
     uint16_t Reqlen,
     uint16_t *Receivedlen,
     uint32_t Timeout)
@@ -2438,34 +3132,22 @@ ES_WIFI_Status_t ES_WIFI_ReceiveData(
 
   if (Reqlen <= ES_WIFI_PAYLOAD_SIZE)
   {
-    sprintf((char*) Obj->CmdData, "P0=%d\r", Socket);
-    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    ret = AT_SelectSocket(Obj, Socket);
 
     if (ret == ES_WIFI_STATUS_OK)
     {
-      sprintf((char*) Obj->CmdData, "R1=%d\r", Reqlen);
-      ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+      ret = AT_SetReadParams(Obj, Socket, Reqlen, wkgTimeOut);
       if (ret == ES_WIFI_STATUS_OK)
       {
-        sprintf((char*) Obj->CmdData, "R2=%lu\r", wkgTimeOut);
-        ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
-        if (ret == ES_WIFI_STATUS_OK)
-        {
-          sprintf((char*) Obj->CmdData, "R0\r");
-          ret = AT_RequestReceiveData(Obj, Obj->CmdData, (char *) pdata, Reqlen, Receivedlen);
-          if (ret != ES_WIFI_STATUS_OK)
-          {
-            DEBUG("AT_RequestReceiveData  failed\n");
-          }
-        }
-        else
+        sprintf((char*) Obj->CmdData, "R0\r");
+        ret = AT_RequestReceiveData(Obj, Obj->CmdData, pdata, Reqlen, Receivedlen);
+        if (ret != ES_WIFI_STATUS_OK)
         {
-          DEBUG("setting timeout failed\n");
+          DEBUG("AT_RequestReceiveData  failed\n");
         }
       }
       else
       {
-        DEBUG("setting requested len failed\n");
         *Receivedlen = 0;
       }
     }
@@ -2479,6 +3161,35 @@ ES_WIFI_Status_t ES_WIFI_ReceiveData(
   return ret;
 }
 
+/**
+ * @brief  Receive an amount data over WIFI.
+ * @param  Obj: pointer to module handle
+ * @param  Socket: number of the socket
+ * @param  pdata: pointer to data
+ * @param  len : pointer to the length of the data to be received
+ * @retval Operation Status.
+ */
+ES_WIFI_Status_t ES_WIFI_ReceiveData(
+    ES_WIFIObject_t *Obj,
+    uint8_t Socket,
+    uint8_t *pdata,
+    uint16_t Reqlen,
+    uint16_t *Receivedlen,
+    uint32_t Timeout)
+{
+  ES_WIFI_Status_t ret;
+  uint8_t *data;
+
+  LOCK_WIFI();
+  ret = ES_WIFI_ReceiveDataSpan(Obj, Socket, &data, Reqlen, Receivedlen, Timeout);
+  if ((ret == ES_WIFI_STATUS_OK) && (*Receivedlen > 0))
+  {
+    memcpy(pdata, data, *Receivedlen);
+  }
+  UNLOCK_WIFI();
+  return ret;
+}
+
 ES_WIFI_Status_t ES_WIFI_ReceiveDataFrom(
     ES_WIFIObject_t *Obj,
     uint8_t Socket,
@@ -2490,6 +3201,7 @@ ES_WIFI_Status_t ES_WIFI_ReceiveDataFrom(
     uint16_t *pPort)
 {
   uint32_t wkgTimeOut;
+  uint8_t *data;
 
   ES_WIFI_Status_t ret = ES_WIFI_STATUS_ERROR;
   *Receivedlen = 0;
@@ -2507,38 +3219,26 @@ ES_WIFI_Status_t ES_WIFI_ReceiveDataFrom(
 
   if (Reqlen <= ES_WIFI_PAYLOAD_SIZE)
   {
-    sprintf((char*) Obj->CmdData, "P0=%d\r", Socket);
-    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    ret = AT_SelectSocket(Obj, Socket);
   }
 
   if (ret == ES_WIFI_STATUS_OK)
   {
-    sprintf((char*) Obj->CmdData, "R1=%d\r", Reqlen);
-    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
+    ret = AT_SetReadParams(Obj, Socket, Reqlen, wkgTimeOut);
   }
   else
   {
     DEBUG("P0 failed.\n")
 ;  }
 
-  if (ret == ES_WIFI_STATUS_OK)
-  {
-    sprintf((char*) Obj->CmdData, "R2=%lu\r", wkgTimeOut);
-    ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
-  }
-  else
-  {
-    DEBUG("R1 failed.\n")
-;  }
-
   if (ret == ES_WIFI_STATUS_OK)
   {
     sprintf((char*) Obj->CmdData, "R0\r");
-    ret = AT_RequestReceiveData(Obj, Obj->CmdData, (char *) pdata, Reqlen, Receivedlen);
+    ret = AT_RequestReceiveData(Obj, Obj->CmdData, &data, Reqlen, Receivedlen);
   }
   else
   {
-    DEBUG("R2 failed.\n")
+    DEBUG("R1/R2 failed.\n")
 ;  }
 
   if (ret == ES_WIFI_STATUS_OK)
@@ -2552,6 +3252,8 @@ ES_WIFI_Status_t ES_WIFI_ReceiveDataFrom(
     {
       if (*Receivedlen > 0)
       {
+        memcpy(pdata, data, *Receivedlen);
+
         /* Get the peer addr */
         sprintf((char*) Obj->CmdData, "P?\r");
         ret = AT_ExecuteCommand(Obj, Obj->CmdData, Obj->CmdData);
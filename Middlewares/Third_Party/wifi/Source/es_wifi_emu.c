@@ -0,0 +1,1068 @@
+/**
+  ******************************************************************************
+  * @file    es_wifi_emu.c
+  * @brief   This file implements a host-side emulator of the es-wifi module
+  *          (ISM43362) behind the es_wifi IO hooks. It answers the AT commands
+  *          used by es_wifi.c and bridges the module sockets to loopback, so
+  *          the driver can be benchmarked and exercised without the board.
+  ******************************************************************************
+  * @attention
+  *
+  * Only built when ES_WIFI_USE_EMULATOR is 1, which needs a POSIX host. Every
+  * remote address is mapped to 127.0.0.1; the address the driver programmed
+  * is kept and reported back by P?.
+  *
+  * Time model: a transfer costs its length at the configured SPI clock
+  * (16-bit frames, so odd lengths are padded), and each response is delayed
+  * by the module latency. The emulator spins for that long, so wall clock
+  * measurements include it; a clock of 0 disables the model.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "../Include/es_wifi_emu.h"
+
+#if (ES_WIFI_USE_EMULATOR == 1)
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "es_wifi.h"
+
+/* Private define ------------------------------------------------------------*/
+#define EMU_OK_STRING           "\r\nOK\r\n> "
+#define EMU_PROMPT_STRING       "\r\n> "
+
+#define EMU_PRODUCT_INFO        "ISM43362-M3G-L44-SPI,C3.5.2.5.STM,v3.5.2,v1.4.0.rc1,v8.2.1,120000000,Inventek eS-WiFi"
+#define EMU_MAC_ADDRESS         "C4:7F:51:00:00:01"
+#define EMU_IP_ADDRESS          "192.168.1.42"
+#define EMU_AP_IP_ADDRESS       "192.168.10.1"
+
+#define EMU_SCAN_COUNT          3
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  uint8_t  Protocol;            /* P1, ES_WIFI_ConnType_t */
+  uint16_t LocalPort;           /* P2 */
+  uint8_t  RemoteIP[4];         /* P3 */
+  uint16_t RemotePort;          /* P4 */
+  uint8_t  Backlog;             /* P8 */
+  uint16_t ReadLen;             /* R1 */
+  uint32_t ReadTimeout;         /* R2, ms */
+  uint32_t WriteTimeout;        /* S2, ms */
+  uint8_t  Client;              /* P6=1 */
+  uint8_t  Server;              /* P5=1 or P5=11 */
+  uint8_t  Notify;              /* accepted client not yet reported by MR */
+  int      Fd;                  /* client, accepted or UDP socket */
+  int      ListenFd;            /* TCP server socket */
+  uint8_t  PeerIP[4];           /* accepted client or last datagram sender */
+  uint16_t PeerPort;
+} EMU_Socket_t;
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t         emu_spi_clock = ES_WIFI_EMU_SPI_CLOCK;
+static uint32_t         emu_latency_us = ES_WIFI_EMU_LATENCY_US;
+static EMU_WIFI_Stats_t emu_stats;
+static EMU_Socket_t     emu_sockets[ES_WIFI_MAX_SOCKETS];
+static uint8_t          emu_current;
+static char             emu_ssid[ES_WIFI_MAX_SSID_NAME_SIZE + 1];
+static char             emu_password[ES_WIFI_MAX_PSWD_NAME_SIZE + 1];
+static uint8_t          emu_security;
+static uint8_t          emu_joined;
+static uint8_t          emu_in_range = 1;
+static uint32_t         emu_join_ms = ES_WIFI_EMU_JOIN_MS;
+static uint32_t         emu_dhcp_ms = ES_WIFI_EMU_DHCP_MS;
+/* C4, and the static C6 address, C7 mask, C8 gateway, C9 DNS */
+static uint8_t          emu_dhcp = 1;
+static uint8_t          emu_static[4][4];
+static uint16_t         emu_ping_count = 1;
+static uint8_t          emu_scan_index;
+static uint8_t          emu_started;
+
+/* command being received, and the response waiting to be read */
+static uint8_t          emu_cmd[ES_WIFI_DATA_SIZE];
+static uint16_t         emu_cmd_len;
+static uint8_t          emu_resp[ES_WIFI_DATA_SIZE];
+static uint16_t         emu_resp_len;
+/* end of the send in flight (ns), and the buffer lent to the driver */
+static uint64_t         emu_busy_until;
+static uint16_t         emu_tx[(ES_WIFI_PAYLOAD_SIZE + 16) / 2];
+
+/* Private function prototypes -----------------------------------------------*/
+static void    EMU_Spin(uint32_t bytes, uint32_t latency_us, int wait);
+static void    EMU_Reply(const char *fmt, ...);
+static void    EMU_ReplyData(const uint8_t *data, int len);
+static void    EMU_ReplyError(const char *reason);
+static int     EMU_Complete(void);
+static void    EMU_Execute(char *cmd, uint16_t len);
+static void    EMU_Close(EMU_Socket_t *s);
+static void    EMU_Accept(EMU_Socket_t *s);
+static int     EMU_Open(int type, uint16_t port);
+static void    EMU_Address(const EMU_Socket_t *s, struct sockaddr_in *addr, int peer);
+static void    EMU_Send(EMU_Socket_t *s, const uint8_t *data, uint16_t len);
+static void    EMU_Receive(EMU_Socket_t *s);
+static void    EMU_ParseIP(const char *str, uint8_t *ip);
+static int     EMU_ScanEntry(char *buf, int index);
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Spend the modelled time of a transfer. A transfer starts when the
+  *         send still in flight, if any, is over.
+  * @param  bytes: bytes moved over SPI
+  * @param  latency_us: module processing time before the transfer
+  * @param  wait: 0 to return at once, as a DMA send does
+  * @retval None
+  */
+static void EMU_Spin(uint32_t bytes, uint32_t latency_us, int wait)
+{
+  struct timespec t;
+  uint64_t now;
+  uint64_t end;
+  uint64_t ns = (uint64_t) latency_us * 1000;
+
+  if (emu_spi_clock != 0)
+  {
+    ns += (uint64_t) ((bytes + 1) & ~1u) * 8 * 1000000000ull / emu_spi_clock;
+  }
+  else
+  {
+    ns = 0;
+  }
+  emu_stats.BusyUs += ns / 1000;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  now = (uint64_t) t.tv_sec * 1000000000ull + t.tv_nsec;
+  end = ((emu_busy_until > now) ? emu_busy_until : now) + ns;
+  if (!wait)
+  {
+    emu_busy_until = end;
+    return;
+  }
+
+  emu_busy_until = 0;
+  while (now < end)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    now = (uint64_t) t.tv_sec * 1000000000ull + t.tv_nsec;
+  }
+}
+
+/**
+  * @brief  Answer a command with a text body followed by OK.
+  * @param  fmt: printf format of the body, NULL for none
+  * @retval None
+  */
+static void EMU_Reply(const char *fmt, ...)
+{
+  va_list ap;
+  int n = 0;
+  const int room = sizeof(emu_resp) - 2 - strlen(EMU_OK_STRING);
+
+  emu_resp_len = 0;
+  if (fmt != NULL)
+  {
+    emu_resp[0] = '\r';
+    emu_resp[1] = '\n';
+    va_start(ap, fmt);
+    n = vsnprintf((char *) emu_resp + 2, room, fmt, ap);
+    va_end(ap);
+    /* vsnprintf returns the length it needed: keep what it wrote */
+    if (n < 0)
+    {
+      n = 0;
+    }
+    else if (n >= room)
+    {
+      n = room - 1;
+    }
+    emu_resp_len = 2 + n;
+  }
+  memcpy(emu_resp + emu_resp_len, EMU_OK_STRING, strlen(EMU_OK_STRING));
+  emu_resp_len += strlen(EMU_OK_STRING);
+}
+
+/**
+  * @brief  Answer R0 with binary data followed by OK.
+  * @param  data: received bytes
+  * @param  len: number of bytes
+  * @retval None
+  */
+static void EMU_ReplyData(const uint8_t *data, int len)
+{
+  emu_resp[0] = '\r';
+  emu_resp[1] = '\n';
+  memcpy(emu_resp + 2, data, len);
+  memcpy(emu_resp + 2 + len, EMU_OK_STRING, strlen(EMU_OK_STRING));
+  emu_resp_len = 2 + len + strlen(EMU_OK_STRING);
+}
+
+/**
+  * @brief  Answer a command with an error.
+  * @param  reason: error text
+  * @retval None
+  */
+static void EMU_ReplyError(const char *reason)
+{
+  emu_resp_len = snprintf((char *) emu_resp, sizeof(emu_resp), "\r\nERROR: %s" EMU_PROMPT_STRING, reason);
+}
+
+/**
+  * @brief  Parse a dotted IPv4 address.
+  * @param  str: address text
+  * @param  ip: parsed address
+  * @retval None
+  */
+static void EMU_ParseIP(const char *str, uint8_t *ip)
+{
+  unsigned int a = 0, b = 0, c = 0, d = 0;
+
+  sscanf(str, "%u.%u.%u.%u", &a, &b, &c, &d);
+  ip[0] = a;
+  ip[1] = b;
+  ip[2] = c;
+  ip[3] = d;
+}
+
+/**
+  * @brief  Format one access point of the scan list.
+  * @param  buf: output, at least 128 bytes
+  * @param  index: access point number
+  * @retval Length of the entry.
+  */
+static int EMU_ScanEntry(char *buf, int index)
+{
+  return sprintf(buf, "#%03d,\"emu-ap-%d\",C4:7F:51:00:10:%02X,-%d,72.2,Infrastructure,WPA2 AES,2.4GHz,%d",
+                 index + 1, index, index, 40 + 10 * index, 1 + 5 * index);
+}
+
+/**
+  * @brief  Close the host sockets behind a module socket.
+  * @param  s: module socket
+  * @retval None
+  */
+static void EMU_Close(EMU_Socket_t *s)
+{
+  if (s->Fd >= 0)
+  {
+    close(s->Fd);
+    s->Fd = -1;
+  }
+  if (s->ListenFd >= 0)
+  {
+    close(s->ListenFd);
+    s->ListenFd = -1;
+  }
+  s->Client = 0;
+  s->Server = 0;
+  s->Notify = 0;
+  memset(s->PeerIP, 0, sizeof(s->PeerIP));
+  s->PeerPort = 0;
+}
+
+/**
+  * @brief  Take the next pending client of a TCP server, if any.
+  * @param  s: module socket
+  * @retval None
+  */
+static void EMU_Accept(EMU_Socket_t *s)
+{
+  struct sockaddr_in addr;
+  socklen_t addrlen = sizeof(addr);
+  int fd;
+
+  if ((s->ListenFd < 0) || (s->Fd >= 0))
+  {
+    return;
+  }
+
+  fd = accept(s->ListenFd, (struct sockaddr *) &addr, &addrlen);
+  if (fd >= 0)
+  {
+    s->Fd = fd;
+    memcpy(s->PeerIP, &addr.sin_addr.s_addr, 4);
+    s->PeerPort = ntohs(addr.sin_port);
+    s->Notify = 1;
+  }
+}
+
+/**
+  * @brief  Create a host socket bound to a loopback port.
+  * @param  type: SOCK_STREAM or SOCK_DGRAM
+  * @param  port: local port, 0 for any
+  * @retval The descriptor, -1 on error.
+  */
+static int EMU_Open(int type, uint16_t port)
+{
+  struct sockaddr_in addr;
+  int one = 1;
+  int fd;
+
+  fd = socket(AF_INET, type, 0);
+  if (fd < 0)
+  {
+    return -1;
+  }
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  if (port != 0)
+  {
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+    {
+      close(fd);
+      return -1;
+    }
+  }
+  return fd;
+}
+
+/**
+  * @brief  Loopback address a module socket sends to.
+  * @param  s: module socket
+  * @param  addr: host address
+  * @param  peer: 1 to answer the last peer (server), 0 for P3/P4
+  * @retval None
+  */
+static void EMU_Address(const EMU_Socket_t *s, struct sockaddr_in *addr, int peer)
+{
+  memset(addr, 0, sizeof(struct sockaddr_in));
+  addr->sin_family = AF_INET;
+  addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr->sin_port = htons(peer ? s->PeerPort : s->RemotePort);
+}
+
+/**
+  * @brief  Execute S3: send a payload on the current socket.
+  * @param  s: module socket
+  * @param  data: payload
+  * @param  len: payload length
+  * @retval None
+  */
+static void EMU_Send(EMU_Socket_t *s, const uint8_t *data, uint16_t len)
+{
+  struct sockaddr_in addr;
+  struct pollfd pfd;
+  int n;
+
+  if (s->Fd < 0)
+  {
+    EMU_ReplyError("Socket not connected");
+    return;
+  }
+
+  pfd.fd = s->Fd;
+  pfd.events = POLLOUT;
+  if (poll(&pfd, 1, s->WriteTimeout) <= 0)
+  {
+    EMU_Reply("0");
+    return;
+  }
+
+  if ((s->Protocol == ES_WIFI_UDP_CONNECTION) || (s->Protocol == ES_WIFI_UDP_LITE_CONNECTION))
+  {
+    EMU_Address(s, &addr, s->Server);
+    n = sendto(s->Fd, data, len, 0, (struct sockaddr *) &addr, sizeof(addr));
+  }
+  else
+  {
+    n = send(s->Fd, data, len, MSG_NOSIGNAL);
+  }
+
+  if (n < 0)
+  {
+    EMU_ReplyError("Send failed");
+    return;
+  }
+  EMU_Reply("%d", n);
+}
+
+/**
+  * @brief  Execute R0: read up to R1 bytes, waiting up to R2 ms.
+  * @param  s: module socket
+  * @retval None
+  */
+static void EMU_Receive(EMU_Socket_t *s)
+{
+  static uint8_t data[ES_WIFI_PAYLOAD_SIZE];
+  struct sockaddr_in addr;
+  socklen_t addrlen = sizeof(addr);
+  struct pollfd pfd;
+  uint16_t len = s->ReadLen;
+  int n;
+
+  EMU_Accept(s);
+  if (s->Fd < 0)
+  {
+    EMU_ReplyError("Socket not connected");
+    return;
+  }
+  if ((len == 0) || (len > ES_WIFI_PAYLOAD_SIZE))
+  {
+    len = ES_WIFI_PAYLOAD_SIZE;
+  }
+
+  pfd.fd = s->Fd;
+  pfd.events = POLLIN;
+  if (poll(&pfd, 1, s->ReadTimeout) <= 0)
+  {
+    EMU_ReplyData(data, 0);
+    return;
+  }
+
+  if ((s->Protocol == ES_WIFI_UDP_CONNECTION) || (s->Protocol == ES_WIFI_UDP_LITE_CONNECTION))
+  {
+    n = recvfrom(s->Fd, data, len, 0, (struct sockaddr *) &addr, &addrlen);
+    if (n >= 0)
+    {
+      memcpy(s->PeerIP, &addr.sin_addr.s_addr, 4);
+      s->PeerPort = ntohs(addr.sin_port);
+    }
+  }
+  else
+  {
+    n = recv(s->Fd, data, len, 0);
+    if (n == 0)
+    {
+      /* peer closed: a server goes back to accepting */
+      close(s->Fd);
+      s->Fd = -1;
+      EMU_ReplyError("Connection closed");
+      return;
+    }
+  }
+
+  if (n < 0)
+  {
+    EMU_ReplyError("Receive failed");
+    return;
+  }
+  EMU_ReplyData(data, n);
+}
+
+/**
+  * @brief  Tell whether the bytes received so far form a whole command.
+  * @retval Length of the command, 0 if more bytes are needed.
+  */
+static int EMU_Complete(void)
+{
+  uint8_t *cr = memchr(emu_cmd, '\r', emu_cmd_len);
+  int hdr;
+  int len;
+
+  if (cr == NULL)
+  {
+    return 0;
+  }
+  hdr = cr - emu_cmd + 1;
+
+  /* S3 carries its payload after the command, in the same or the next send */
+  if ((emu_cmd_len >= 3) && (memcmp(emu_cmd, "S3=", 3) == 0))
+  {
+    len = atoi((char *) emu_cmd + 3);
+    return (emu_cmd_len >= hdr + len) ? hdr + len : 0;
+  }
+  return emu_cmd_len;
+}
+
+/**
+  * @brief  Execute one AT command and prepare its response.
+  * @param  cmd: command, with its payload for S3
+  * @param  len: length of cmd
+  * @retval None
+  */
+static void EMU_Execute(char *cmd, uint16_t len)
+{
+  static char list[ES_WIFI_DATA_SIZE / 2];
+  EMU_Socket_t *s = &emu_sockets[emu_current];
+  char *arg;
+  char *end;
+  struct addrinfo hints;
+  struct addrinfo *res;
+  uint8_t ip[4];
+  int value;
+  int i;
+  int n;
+
+  emu_stats.Commands++;
+
+  end = memchr(cmd, '\r', len);
+  *end = '\0';
+  arg = strchr(cmd, '=');
+  arg = (arg != NULL) ? arg + 1 : cmd + strlen(cmd);
+  value = atoi(arg);
+
+  if (strcmp(cmd, "I?") == 0)
+  {
+    EMU_Reply(EMU_PRODUCT_INFO);
+  }
+  /* Network */
+  else if (strncmp(cmd, "C1=", 3) == 0)
+  {
+    strncpy(emu_ssid, arg, ES_WIFI_MAX_SSID_NAME_SIZE);
+    EMU_Reply(NULL);
+  }
+  else if (strncmp(cmd, "C2=", 3) == 0)
+  {
+    strncpy(emu_password, arg, ES_WIFI_MAX_PSWD_NAME_SIZE);
+    EMU_Reply(NULL);
+  }
+  else if (strncmp(cmd, "C3=", 3) == 0)
+  {
+    emu_security = value;
+    EMU_Reply(NULL);
+  }
+  else if (strncmp(cmd, "C4=", 3) == 0)
+  {
+    emu_dhcp = (value != 0);
+    EMU_Reply(NULL);
+  }
+  else if ((strlen(cmd) > 3) && (strncmp(cmd, "C", 1) == 0) && (cmd[1] >= '6') && (cmd[1] <= '9') && (cmd[2] == '='))
+  {
+    EMU_ParseIP(arg, emu_static[cmd[1] - '6']);
+    EMU_Reply(NULL);
+  }
+  else if (strcmp(cmd, "C0") == 0)
+  {
+    if (emu_ssid[0] == '\0')
+    {
+      EMU_ReplyError("Invalid SSID");
+    }
+    else if (!emu_in_range)
+    {
+      usleep(emu_join_ms * 1000);
+      EMU_ReplyError("Join failed");
+    }
+    else
+    {
+      /* association, then the DHCP exchange unless the address is static */
+      usleep((emu_join_ms + (emu_dhcp ? emu_dhcp_ms : 0)) * 1000);
+      emu_joined = 1;
+      if (emu_dhcp)
+      {
+        EMU_Reply("[JOIN   ] %s," EMU_IP_ADDRESS ",0,0", emu_ssid);
+      }
+      else
+      {
+        EMU_Reply("[JOIN   ] %s,%d.%d.%d.%d,0,0", emu_ssid,
+                  emu_static[0][0], emu_static[0][1], emu_static[0][2], emu_static[0][3]);
+      }
+    }
+  }
+  else if ((strcmp(cmd, "C?") == 0) && emu_dhcp)
+  {
+    EMU_Reply("%s,%s,%d,1,0," EMU_IP_ADDRESS ",255.255.255.0,192.168.1.1,192.168.1.1,0.0.0.0,3,0,0,US,%d",
+              emu_ssid, emu_password, emu_security, emu_joined);
+  }
+  else if (strcmp(cmd, "C?") == 0)
+  {
+    EMU_Reply("%s,%s,%d,0,0,%d.%d.%d.%d,%d.%d.%d.%d,%d.%d.%d.%d,%d.%d.%d.%d,0.0.0.0,3,0,0,US,%d",
+              emu_ssid, emu_password, emu_security,
+              emu_static[0][0], emu_static[0][1], emu_static[0][2], emu_static[0][3],
+              emu_static[1][0], emu_static[1][1], emu_static[1][2], emu_static[1][3],
+              emu_static[2][0], emu_static[2][1], emu_static[2][2], emu_static[2][3],
+              emu_static[3][0], emu_static[3][1], emu_static[3][2], emu_static[3][3], emu_joined);
+  }
+  else if (strcmp(cmd, "CS") == 0)
+  {
+    EMU_Reply("%d", emu_joined);
+  }
+  else if (strcmp(cmd, "CD") == 0)
+  {
+    emu_joined = 0;
+    EMU_Reply(NULL);
+  }
+  else if (strcmp(cmd, "F0") == 0)
+  {
+    n = 0;
+    for (i = 0; i < EMU_SCAN_COUNT; i++)
+    {
+      n += EMU_ScanEntry(list + n, i);
+      list[n++] = '\r';
+      list[n++] = '\n';
+    }
+    EMU_Reply("%.*s", n - 2, list);
+  }
+  else if ((strcmp(cmd, "F0=2") == 0) || ((strcmp(cmd, "MR") == 0) && (emu_scan_index != 0)))
+  {
+    /* one access point per response, the last MR ends with OK */
+    i = (cmd[0] == 'F') ? 0 : emu_scan_index;
+    if (i < EMU_SCAN_COUNT)
+    {
+      n = EMU_ScanEntry(list, i);
+      emu_resp_len = snprintf((char *) emu_resp, sizeof(emu_resp), "\r\n%.*s" EMU_PROMPT_STRING, n, list);
+      emu_scan_index = i + 1;
+    }
+    else
+    {
+      emu_scan_index = 0;
+      EMU_Reply(NULL);
+    }
+  }
+  else if (strncmp(cmd, "D0=", 3) == 0)
+  {
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    if (getaddrinfo(arg, NULL, &hints, &res) != 0)
+    {
+      EMU_ReplyError("DNS lookup failed");
+    }
+    else
+    {
+      memcpy(ip, &((struct sockaddr_in *) res->ai_addr)->sin_addr.s_addr, 4);
+      freeaddrinfo(res);
+      EMU_Reply("%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+    }
+  }
+  /* Ping: the loopback answers at once */
+  else if (strncmp(cmd, "T2=", 3) == 0)
+  {
+    emu_ping_count = value;
+    EMU_Reply(NULL);
+  }
+  else if (strncmp(cmd, "T0", 2) == 0)
+  {
+    n = 0;
+    for (i = 0; (i < emu_ping_count) && (n < (int) sizeof(list) - 32); i++)
+    {
+      n += snprintf(list + n, 32, "%s%d,0", i ? "\r\n" : "", i + 1);
+    }
+    EMU_Reply("%.*s", n, list);
+  }
+  /* Soft AP */
+  else if (strcmp(cmd, "A0") == 0)
+  {
+    EMU_Reply("[AP     ] %s," EMU_AP_IP_ADDRESS, emu_ssid);
+  }
+  /* System */
+  else if (strcmp(cmd, "Z5") == 0)
+  {
+    EMU_Reply(EMU_MAC_ADDRESS);
+  }
+  else if (strcmp(cmd, "ZR") == 0)
+  {
+    for (i = 0; i < ES_WIFI_MAX_SOCKETS; i++)
+    {
+      EMU_Close(&emu_sockets[i]);
+    }
+    emu_joined = 0;
+    emu_resp_len = strlen(EMU_PROMPT_STRING);
+    memcpy(emu_resp, EMU_PROMPT_STRING, emu_resp_len);
+  }
+  /* Sockets */
+  else if (strncmp(cmd, "P0=", 3) == 0)
+  {
+    if ((value < 0) || (value >= ES_WIFI_MAX_SOCKETS))
+    {
+      EMU_ReplyError("Invalid socket number");
+    }
+    else
+    {
+      emu_current = value;
+      EMU_Reply(NULL);
+    }
+  }
+  else if (strncmp(cmd, "P1=", 3) == 0)
+  {
+    s->Protocol = value;
+    EMU_Reply(NULL);
+  }
+  else if (strncmp(cmd, "P2=", 3) == 0)
+  {
+    s->LocalPort = value;
+    EMU_Reply(NULL);
+  }
+  else if (strncmp(cmd, "P3=", 3) == 0)
+  {
+    EMU_ParseIP(arg, s->RemoteIP);
+    EMU_Reply(NULL);
+  }
+  else if (strncmp(cmd, "P4=", 3) == 0)
+  {
+    s->RemotePort = value;
+    EMU_Reply(NULL);
+  }
+  else if (strncmp(cmd, "P8=", 3) == 0)
+  {
+    s->Backlog = value;
+    EMU_Reply(NULL);
+  }
+  else if ((strcmp(cmd, "P5=1") == 0) || (strcmp(cmd, "P5=11") == 0))
+  {
+    EMU_Close(s);
+    if ((s->Protocol == ES_WIFI_UDP_CONNECTION) || (s->Protocol == ES_WIFI_UDP_LITE_CONNECTION))
+    {
+      s->Fd = EMU_Open(SOCK_DGRAM, s->LocalPort);
+      n = s->Fd;
+    }
+    else
+    {
+      s->ListenFd = EMU_Open(SOCK_STREAM, s->LocalPort);
+      n = s->ListenFd;
+      if ((n >= 0) && (listen(n, s->Backlog ? s->Backlog : 1) == 0))
+      {
+        fcntl(n, F_SETFL, fcntl(n, F_GETFL) | O_NONBLOCK);
+      }
+      else
+      {
+        EMU_Close(s);
+        n = -1;
+      }
+    }
+    if (n < 0)
+    {
+      EMU_ReplyError("Server start failed");
+    }
+    else
+    {
+      s->Server = 1;
+      EMU_Reply(NULL);
+    }
+  }
+  else if ((strcmp(cmd, "P5=10") == 0) || (strcmp(cmd, "P7=2") == 0))
+  {
+    /* close the current client, the next one is accepted on demand */
+    if ((s->ListenFd >= 0) && (s->Fd >= 0))
+    {
+      close(s->Fd);
+      s->Fd = -1;
+    }
+    EMU_Reply(NULL);
+  }
+  else if (strcmp(cmd, "P5=0") == 0)
+  {
+    EMU_Close(s);
+    EMU_Reply(NULL);
+  }
+  else if (strcmp(cmd, "P7=3") == 0)
+  {
+    EMU_Accept(s);
+    EMU_Reply(NULL);
+  }
+  else if (strcmp(cmd, "P6=1") == 0)
+  {
+    struct sockaddr_in addr;
+
+    EMU_Close(s);
+    if ((s->Protocol == ES_WIFI_UDP_CONNECTION) || (s->Protocol == ES_WIFI_UDP_LITE_CONNECTION))
+    {
+      s->Fd = EMU_Open(SOCK_DGRAM, s->LocalPort);
+    }
+    else
+    {
+      s->Fd = EMU_Open(SOCK_STREAM, s->LocalPort);
+      EMU_Address(s, &addr, 0);
+      if ((s->Fd >= 0) && (connect(s->Fd, (struct sockaddr *) &addr, sizeof(addr)) != 0))
+      {
+        EMU_Close(s);
+      }
+      memcpy(s->PeerIP, s->RemoteIP, 4);
+      s->PeerPort = s->RemotePort;
+    }
+    if (s->Fd < 0)
+    {
+      EMU_ReplyError("Connection failed");
+    }
+    else
+    {
+      s->Client = 1;
+      EMU_Reply(NULL);
+    }
+  }
+  else if (strcmp(cmd, "P6=0") == 0)
+  {
+    EMU_Close(s);
+    EMU_Reply(NULL);
+  }
+  else if (strcmp(cmd, "P?") == 0)
+  {
+    /* the address field reads 0.0.0.0 until a server accepts a client */
+    EMU_Accept(s);
+    if (s->Server && (s->PeerPort != 0))
+    {
+      memcpy(ip, s->PeerIP, 4);
+    }
+    else if (s->Client)
+    {
+      EMU_ParseIP(EMU_IP_ADDRESS, ip);
+    }
+    else
+    {
+      memset(ip, 0, 4);
+    }
+    EMU_Reply("%d,%d.%d.%d.%d,%d,%d.%d.%d.%d,%d,%d,%d,%d,0,0",
+              s->Protocol, ip[0], ip[1], ip[2], ip[3], s->LocalPort,
+              s->Server ? s->PeerIP[0] : s->RemoteIP[0], s->Server ? s->PeerIP[1] : s->RemoteIP[1],
+              s->Server ? s->PeerIP[2] : s->RemoteIP[2], s->Server ? s->PeerIP[3] : s->RemoteIP[3],
+              s->Server ? s->PeerPort : s->RemotePort,
+              s->Server && (s->ListenFd >= 0), s->Server && (s->ListenFd < 0), s->Backlog);
+  }
+  else if (strcmp(cmd, "MR") == 0)
+  {
+    for (i = 0; i < ES_WIFI_MAX_SOCKETS; i++)
+    {
+      EMU_Accept(&emu_sockets[i]);
+      if (emu_sockets[i].Notify)
+      {
+        emu_sockets[i].Notify = 0;
+        EMU_Reply("[SOMA]Accepted %d.%d.%d.%d:%d[EOMA]",
+                  emu_sockets[i].PeerIP[0], emu_sockets[i].PeerIP[1], emu_sockets[i].PeerIP[2],
+                  emu_sockets[i].PeerIP[3], emu_sockets[i].PeerPort);
+        return;
+      }
+    }
+    EMU_Reply("[SOMA][EOMA]");
+  }
+  else if (strncmp(cmd, "R1=", 3) == 0)
+  {
+    s->ReadLen = value;
+    EMU_Reply(NULL);
+  }
+  else if (strncmp(cmd, "R2=", 3) == 0)
+  {
+    s->ReadTimeout = value;
+    EMU_Reply(NULL);
+  }
+  else if (strcmp(cmd, "R0") == 0)
+  {
+    EMU_Receive(s);
+  }
+  else if (strncmp(cmd, "S2=", 3) == 0)
+  {
+    s->WriteTimeout = value;
+    EMU_Reply(NULL);
+  }
+  else if (strncmp(cmd, "S3=", 3) == 0)
+  {
+    EMU_Send(s, (uint8_t *) end + 1, value);
+  }
+  /* Accepted and ignored: names, MAC, SSL, keep-alive, AP and ping settings */
+  else if ((strncmp(cmd, "Z", 1) == 0) || (strncmp(cmd, "P6", 2) == 0)
+           || (strncmp(cmd, "P9=", 3) == 0) || (strncmp(cmd, "PK=", 3) == 0) || (strncmp(cmd, "P7=1", 4) == 0)
+           || (strncmp(cmd, "A", 1) == 0) || (strncmp(cmd, "T", 1) == 0))
+  {
+    EMU_Reply(NULL);
+  }
+  else
+  {
+    EMU_ReplyError("Invalid command");
+  }
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Reset the emulated module, closing its sockets
+  * @param  mode: ES_WIFI_INIT or ES_WIFI_RESET
+  * @retval 0
+  */
+int8_t EMU_WIFI_Init(uint16_t mode)
+{
+  int i;
+
+  (void) mode;
+  for (i = 0; i < ES_WIFI_MAX_SOCKETS; i++)
+  {
+    if (emu_started)
+    {
+      EMU_Close(&emu_sockets[i]);
+    }
+    memset(&emu_sockets[i], 0, sizeof(EMU_Socket_t));
+    emu_sockets[i].Fd = -1;
+    emu_sockets[i].ListenFd = -1;
+  }
+  emu_started = 1;
+  emu_current = 0;
+  emu_joined = 0;
+  emu_scan_index = 0;
+  emu_cmd_len = 0;
+  emu_resp_len = 0;
+  return 0;
+}
+
+/**
+  * @brief  Close all emulated sockets
+  * @param  None
+  * @retval 0
+  */
+int8_t EMU_WIFI_DeInit(void)
+{
+  int i;
+
+  for (i = 0; i < ES_WIFI_MAX_SOCKETS; i++)
+  {
+    EMU_Close(&emu_sockets[i]);
+  }
+  return 0;
+}
+
+/**
+  * @brief  Set the SPI clock and module latency of the time model
+  * @param  SpiClock: SPI clock in Hz, 0 to run without delays
+  * @param  LatencyUs: module processing time per response
+  * @retval None
+  */
+void EMU_WIFI_Configure(uint32_t SpiClock, uint32_t LatencyUs)
+{
+  emu_spi_clock = SpiClock;
+  emu_latency_us = LatencyUs;
+}
+
+/**
+  * @brief  Set the modelled time of a join
+  * @param  JoinMs: association time
+  * @param  DhcpMs: DHCP time, added when the address is not static
+  * @retval None
+  */
+void EMU_WIFI_ConfigureJoin(uint32_t JoinMs, uint32_t DhcpMs)
+{
+  emu_join_ms = JoinMs;
+  emu_dhcp_ms = DhcpMs;
+}
+
+/**
+  * @brief  Move the access point in or out of range. Out of range, the
+  *         module leaves the network and joins fail.
+  * @param  InRange: 0 or 1
+  * @retval None
+  */
+void EMU_WIFI_SetAccessPoint(uint8_t InRange)
+{
+  emu_in_range = InRange;
+  if (!InRange)
+  {
+    emu_joined = 0;
+  }
+}
+
+/**
+  * @brief  Read the transfer counters
+  * @param  Stats: counters
+  * @retval None
+  */
+void EMU_WIFI_GetStats(EMU_WIFI_Stats_t *Stats)
+{
+  *Stats = emu_stats;
+}
+
+/**
+  * @brief  Clear the transfer counters
+  * @param  None
+  * @retval None
+  */
+void EMU_WIFI_ResetStats(void)
+{
+  memset(&emu_stats, 0, sizeof(emu_stats));
+}
+
+/**
+  * @brief  Send bytes to the emulated module; a complete command is executed
+  * @param  pData: pointer to data
+  * @param  len: data length
+  * @param  timeout: send timeout (unused)
+  * @retval Length of sent data, -1 on overflow
+  */
+int16_t EMU_WIFI_SendData(uint8_t *pData, uint16_t len, uint32_t timeout)
+{
+  int cmd_len;
+
+  (void) timeout;
+  emu_stats.Transfers++;
+  emu_stats.BytesToModule += len;
+  EMU_Spin(len, 0, ES_WIFI_USE_SPI_DMA == 0);
+
+  if (emu_cmd_len + len > sizeof(emu_cmd))
+  {
+    emu_cmd_len = 0;
+    return -1;
+  }
+  memcpy(emu_cmd + emu_cmd_len, pData, len);
+  emu_cmd_len += len;
+
+  cmd_len = EMU_Complete();
+  if (cmd_len > 0)
+  {
+    EMU_Execute((char *) emu_cmd, cmd_len);
+    emu_cmd_len = 0;
+  }
+  return len;
+}
+
+/**
+  * @brief  Lend a transmit buffer; sends are copied in at once, so the same
+  *         buffer is always idle
+  * @param  len: length of the next send
+  * @retval Buffer, NULL if len does not fit
+  */
+uint8_t *EMU_WIFI_GetTxBuffer(uint16_t len)
+{
+  if ((len == 0) || (len > sizeof(emu_tx)))
+  {
+    return NULL;
+  }
+  return (uint8_t *) emu_tx;
+}
+
+/**
+  * @brief  Read the response of the last command
+  * @param  pData: pointer to data
+  * @param  len: maximum length, 0 for the whole response
+  * @param  timeout: receive timeout (unused)
+  * @retval Length of received data, ES_WIFI_ERROR_WAITING_DRDY_RISING if no
+  *         response is pending
+  */
+int16_t EMU_WIFI_ReceiveData(uint8_t *pData, uint16_t len, uint32_t timeout)
+{
+  uint16_t n = emu_resp_len;
+
+  (void) timeout;
+  emu_stats.Transfers++;
+  if (n == 0)
+  {
+    return ES_WIFI_ERROR_WAITING_DRDY_RISING;
+  }
+  if ((len != 0) && (n > len))
+  {
+    n = len;
+  }
+  EMU_Spin(n, emu_latency_us, 1);
+  emu_stats.BytesFromModule += n;
+
+  memcpy(pData, emu_resp, n);
+  emu_resp_len = 0;
+  return n;
+}
+
+/**
+  * @brief  Delay
+  * @param  Delay in ms
+  * @retval None
+  */
+void EMU_WIFI_Delay(uint32_t Delay)
+{
+  usleep(Delay * 1000);
+}
+
+/**
+  * @brief  Millisecond tick used by es_wifi.c, from the host clock
+  * @param  None
+  * @retval Tick in ms
+  */
+uint32_t HAL_GetTick(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint32_t) (t.tv_sec * 1000 + t.tv_nsec / 1000000);
+}
+#endif /* ES_WIFI_USE_EMULATOR */
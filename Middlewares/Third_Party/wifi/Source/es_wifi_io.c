@@ -26,9 +26,19 @@
 #include "es_wifi_conf.h"
 #include <core_cm4.h>
 #include "es_wifi.h"
+#if (ES_WIFI_USE_SPI_DMA == 1) && defined(C_BOARD_USE_FREE_RTOS) && !defined(SEM_WAIT)
+#include "FreeRTOS.h"
+#include "semphr.h"
+/* The DMA receive sleeps on a semaphore given by the end of transfer interrupts */
+#define SPI_WIFI_RX_DMA_SEM
+#endif
 
 /* Private define ------------------------------------------------------------*/
 #define MIN(a, b)  ((a) < (b) ? (a) : (b))
+/* Filler the module clocks out when it has no data */
+#define SPI_WIFI_STUFFING_BYTE  0x15
+/* A full payload behind its S3 command, plus padding */
+#define SPI_WIFI_TX_STAGING_SIZE  (ES_WIFI_PAYLOAD_SIZE + 16)
 /* Private typedef -----------------------------------------------------------*/
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
@@ -36,8 +46,46 @@ SPI_HandleTypeDef hspi;
 static  int volatile spi_rx_event = 0;
 static  int volatile spi_tx_event = 0;
 static  int volatile cmddata_rdy_rising_event = 0;
+#if (ES_WIFI_USE_SPI_DMA == 1)
+static  DMA_HandleTypeDef hdma_spi_rx;
+static  DMA_HandleTypeDef hdma_spi_tx;
+static  int volatile spi_rx_dma_event = 0;
+static  int volatile spi_tx_dma_pending = 0;
+/* two staging buffers: one is filled while the other is transmitted */
+static  uint16_t spi_tx_staging[2][SPI_WIFI_TX_STAGING_SIZE / 2];
+static  int      spi_tx_staging_ix = 0;
+#ifdef SPI_WIFI_RX_DMA_SEM
+static  SemaphoreHandle_t spi_rx_dma_sem = NULL;
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static  StaticSemaphore_t spi_rx_dma_sem_cb;
+#endif
+#endif
+#endif
 
 #ifdef WIFI_USE_CMSIS_OS
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+/* Control blocks placed at link time, no heap. */
+static    osStaticMutexDef_t es_wifi_mutex_cb;
+static    osStaticMutexDef_t spi_mutex_cb;
+static    osStaticSemaphoreDef_t spi_rx_sem_cb;
+static    osStaticSemaphoreDef_t spi_tx_sem_cb;
+static    osStaticSemaphoreDef_t cmddata_rdy_rising_sem_cb;
+
+osMutexId es_wifi_mutex;
+osMutexStaticDef(es_wifi_mutex, &es_wifi_mutex_cb);
+
+static    osMutexId spi_mutex;
+osMutexStaticDef(spi_mutex, &spi_mutex_cb);
+
+static    osSemaphoreId spi_rx_sem;
+osSemaphoreStaticDef(spi_rx_sem, &spi_rx_sem_cb);
+
+static    osSemaphoreId spi_tx_sem;
+osSemaphoreStaticDef(spi_tx_sem, &spi_tx_sem_cb);
+
+static    osSemaphoreId cmddata_rdy_rising_sem;
+osSemaphoreStaticDef(cmddata_rdy_rising_sem, &cmddata_rdy_rising_sem_cb);
+#else
 osMutexId es_wifi_mutex;
 osMutexDef(es_wifi_mutex);
 
@@ -52,6 +100,7 @@ osSemaphoreDef(spi_tx_sem);
 
 static    osSemaphoreId cmddata_rdy_rising_sem;
 osSemaphoreDef(cmddata_rdy_rising_sem);
+#endif
 
 #endif
 
@@ -62,6 +111,14 @@ static  int wait_cmddata_rdy_rising_event(int timeout);
 static  int wait_spi_tx_event(int timeout);
 static  int wait_spi_rx_event(int timeout);
 static  void SPI_WIFI_DelayUs(uint32_t);
+static  int16_t SPI_WIFI_ReceiveWords(uint8_t *pData, uint16_t len, uint32_t timeout);
+#if (ES_WIFI_USE_SPI_DMA == 1)
+static  int8_t  SPI_WIFI_DMAInit(void);
+static  int16_t SPI_WIFI_ReceiveDMA(uint8_t *pData, uint16_t len, uint32_t timeout);
+static  int     SPI_WIFI_HaltReceiveDMA(void);
+static  void    SPI_WIFI_EndReceiveDMAFromISR(void);
+#endif
+static  int     SPI_WIFI_WaitTransmitDMA(uint32_t timeout);
 /* Private functions ---------------------------------------------------------*/
 /*******************************************************************************
                        COM Driver Interface (SPI)
@@ -107,6 +164,13 @@ int8_t SPI_WIFI_Init(uint16_t mode)
       return -1;
     }
 
+#if (ES_WIFI_USE_SPI_DMA == 1)
+    if(SPI_WIFI_DMAInit() != 0)
+    {
+      return -1;
+    }
+#endif
+
     /* Enable Interrupt for Data Ready pin , GPIO_PIN1 */
     HAL_NVIC_SetPriority((IRQn_Type)EXTI1_IRQn, SPI_INTERFACE_PRIO, 0x00);
     HAL_NVIC_EnableIRQ((IRQn_Type)EXTI1_IRQn);
@@ -137,6 +201,70 @@ int8_t SPI_WIFI_Init(uint16_t mode)
   return rc;
 }
 
+#if (ES_WIFI_USE_SPI_DMA == 1)
+/**
+  * @brief  Initialize the DMA channels of SPI3 (DMA2 channel 1 RX, channel 2 TX)
+  * @param  None
+  * @retval 0 on success, -1 on error
+  */
+static int8_t SPI_WIFI_DMAInit(void)
+{
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  hdma_spi_rx.Instance                 = DMA2_Channel1;
+  hdma_spi_rx.Init.Request             = DMA_REQUEST_3;
+  hdma_spi_rx.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+  hdma_spi_rx.Init.PeriphInc           = DMA_PINC_DISABLE;
+  hdma_spi_rx.Init.MemInc              = DMA_MINC_ENABLE;
+  hdma_spi_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_spi_rx.Init.MemDataAlignment    = DMA_MDATAALIGN_HALFWORD;
+  hdma_spi_rx.Init.Mode                = DMA_NORMAL;
+  hdma_spi_rx.Init.Priority            = DMA_PRIORITY_HIGH;
+  if(HAL_DMA_Init(&hdma_spi_rx) != HAL_OK)
+  {
+    return -1;
+  }
+  __HAL_LINKDMA(&hspi, hdmarx, hdma_spi_rx);
+
+  /* A master receive clocks the bus by transmitting, so TX needs a channel too */
+  hdma_spi_tx.Instance                 = DMA2_Channel2;
+  hdma_spi_tx.Init.Request             = DMA_REQUEST_3;
+  hdma_spi_tx.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+  hdma_spi_tx.Init.PeriphInc           = DMA_PINC_DISABLE;
+  hdma_spi_tx.Init.MemInc              = DMA_MINC_ENABLE;
+  hdma_spi_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_spi_tx.Init.MemDataAlignment    = DMA_MDATAALIGN_HALFWORD;
+  hdma_spi_tx.Init.Mode                = DMA_NORMAL;
+  hdma_spi_tx.Init.Priority            = DMA_PRIORITY_MEDIUM;
+  if(HAL_DMA_Init(&hdma_spi_tx) != HAL_OK)
+  {
+    return -1;
+  }
+  __HAL_LINKDMA(&hspi, hdmatx, hdma_spi_tx);
+
+#ifdef SPI_WIFI_RX_DMA_SEM
+  if (spi_rx_dma_sem == NULL)
+  {
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    spi_rx_dma_sem = xSemaphoreCreateBinaryStatic(&spi_rx_dma_sem_cb);
+#else
+    spi_rx_dma_sem = xSemaphoreCreateBinary();
+#endif
+  }
+  if (spi_rx_dma_sem == NULL)
+  {
+    return -1;
+  }
+#endif
+
+  HAL_NVIC_SetPriority((IRQn_Type)DMA2_Channel1_IRQn, SPI_INTERFACE_PRIO, 0);
+  HAL_NVIC_EnableIRQ((IRQn_Type)DMA2_Channel1_IRQn);
+  HAL_NVIC_SetPriority((IRQn_Type)DMA2_Channel2_IRQn, SPI_INTERFACE_PRIO, 0);
+  HAL_NVIC_EnableIRQ((IRQn_Type)DMA2_Channel2_IRQn);
+
+  return 0;
+}
+#endif
 
 int8_t SPI_WIFI_ResetModule(void)
 {
@@ -177,6 +305,14 @@ int8_t SPI_WIFI_ResetModule(void)
 int8_t SPI_WIFI_DeInit(void)
 {
   HAL_SPI_DeInit( &hspi );
+#if (ES_WIFI_USE_SPI_DMA == 1)
+  HAL_DMA_DeInit(&hdma_spi_rx);
+  HAL_DMA_DeInit(&hdma_spi_tx);
+#endif
+#ifdef SPI_WIFI_RX_DMA_SEM
+  vSemaphoreDelete(spi_rx_dma_sem);
+  spi_rx_dma_sem = NULL;
+#endif
 #ifdef  WIFI_USE_CMSIS_OS
   osMutexDelete(spi_mutex);
   osMutexDelete(es_wifi_mutex);
@@ -265,32 +401,24 @@ int wait_spi_tx_event(int timeout)
 
 
 
-int16_t SPI_WIFI_ReceiveData(uint8_t *pData, uint16_t len, uint32_t timeout)
+/**
+  * @brief  Read words while CMDDATA_READY is high, one interrupt per word
+  * @param  pData : pointer to data
+  * @param  len : maximum length, 0 for no limit
+  * @param  timeout : receive timeout in mS
+  * @retval Length of received data, negative on error
+  */
+static int16_t SPI_WIFI_ReceiveWords(uint8_t *pData, uint16_t len, uint32_t timeout)
 {
   int16_t length = 0;
   uint8_t tmp[2];
 
-  WIFI_DISABLE_NSS();
-  UNLOCK_SPI();
-  SPI_WIFI_DelayUs(3);
-
-
-  if (wait_cmddata_rdy_rising_event(timeout)<0)
-  {
-      return ES_WIFI_ERROR_WAITING_DRDY_FALLING;
-  }
-
-  LOCK_SPI();
-  WIFI_ENABLE_NSS();
-  SPI_WIFI_DelayUs(15);
   while (WIFI_IS_CMDDATA_READY())
   {
     if((length < len) || (!len))
     {
       spi_rx_event=1;
       if (HAL_SPI_Receive_IT(&hspi, tmp, 1) != HAL_OK) {
-        WIFI_DISABLE_NSS();
-        UNLOCK_SPI();
         return ES_WIFI_ERROR_SPI_FAILED;
       }
 
@@ -302,9 +430,6 @@ int16_t SPI_WIFI_ReceiveData(uint8_t *pData, uint16_t len, uint32_t timeout)
       pData  += 2;
 
       if (length >= ES_WIFI_DATA_SIZE) {
-        WIFI_DISABLE_NSS();
-        SPI_WIFI_ResetModule();
-        UNLOCK_SPI();
         return ES_WIFI_ERROR_STUFFING_FOREVER;
       }
     }
@@ -313,10 +438,208 @@ int16_t SPI_WIFI_ReceiveData(uint8_t *pData, uint16_t len, uint32_t timeout)
       break;
     }
   }
+  return length;
+}
+
+#if (ES_WIFI_USE_SPI_DMA == 1)
+/**
+  * @brief  Read by DMA until CMDDATA_READY falls or the buffer is full
+  * @param  pData : pointer to data, 16-bit aligned
+  * @param  len : maximum length, 0 for no limit
+  * @param  timeout : receive timeout in mS
+  * @retval Length of received data, negative on error
+  */
+static int16_t SPI_WIFI_ReceiveDMA(uint8_t *pData, uint16_t len, uint32_t timeout)
+{
+  uint16_t words;
+  int16_t  length;
+  uint32_t tickstart;
+
+  if ((len == 0) || (len > ES_WIFI_DATA_SIZE))
+  {
+    len = ES_WIFI_DATA_SIZE;
+  }
+  words = (len + 1) / 2;
+
+  /* drop what the FIFO kept while transmitting */
+  HAL_SPIEx_FlushRxFifo(&hspi);
+
+#ifdef SPI_WIFI_RX_DMA_SEM
+  /* drop a give that came after the timeout of the previous receive */
+  (void)xSemaphoreTake(spi_rx_dma_sem, 0);
+#endif
+  spi_rx_dma_event = 1;
+  if (HAL_SPI_Receive_DMA(&hspi, pData, words) != HAL_OK)
+  {
+    spi_rx_dma_event = 0;
+    return ES_WIFI_ERROR_SPI_FAILED;
+  }
+
+  /* The falling edge may have come before the DMA was armed */
+  if (!WIFI_IS_CMDDATA_READY())
+  {
+    SPI_WIFI_HaltReceiveDMA();
+  }
+
+#if defined(SEM_WAIT)
+  if (spi_rx_dma_event == 1)
+  {
+    SEM_WAIT(spi_rx_sem, timeout);
+  }
+#elif defined(SPI_WIFI_RX_DMA_SEM)
+  /* sleep until the falling edge or the end of the buffer, other tasks run */
+  if (spi_rx_dma_event == 1)
+  {
+    (void)xSemaphoreTake(spi_rx_dma_sem, pdMS_TO_TICKS(timeout));
+  }
+#else
+  tickstart = HAL_GetTick();
+  while (spi_rx_dma_event == 1)
+  {
+    /* polling fallback if the falling edge interrupt is not seen */
+    if (!WIFI_IS_CMDDATA_READY() || ((HAL_GetTick() - tickstart) > timeout))
+    {
+      break;
+    }
+  }
+#endif
+  /* the interrupts only halt the requests, the channels are stopped here */
+  SPI_WIFI_HaltReceiveDMA();
+  HAL_SPI_DMAStop(&hspi);
+
+  /* let the words already pushed by the TX channel out, then drop their echo */
+  tickstart = HAL_GetTick();
+  while (__HAL_SPI_GET_FLAG(&hspi, SPI_FLAG_BSY) && ((HAL_GetTick() - tickstart) <= 1))
+  {
+  }
+  HAL_SPIEx_FlushRxFifo(&hspi);
+
+  length = (int16_t)((words - __HAL_DMA_GET_COUNTER(hspi.hdmarx)) * 2);
+  if (length >= ES_WIFI_DATA_SIZE)
+  {
+    return ES_WIFI_ERROR_STUFFING_FOREVER;
+  }
+  return length;
+}
+
+/**
+  * @brief  Halt the DMA receive in progress, if any: clears the DMA requests of
+  *         the SPI, which stops clocking the bus and freezes the RX counter.
+  *         Short enough for the interrupts; HAL_SPI_DMAStop is left to the task
+  * @param  None
+  * @retval 1 if a receive was in progress, 0 otherwise
+  */
+static int SPI_WIFI_HaltReceiveDMA(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  int      halted = 0;
+
+  __disable_irq();
+  if (spi_rx_dma_event == 1)
+  {
+    spi_rx_dma_event = 0;
+    CLEAR_BIT(hspi.Instance->CR2, SPI_CR2_TXDMAEN | SPI_CR2_RXDMAEN);
+    halted = 1;
+  }
+  __set_PRIMASK(primask);
+  return halted;
+}
+
+/**
+  * @brief  End the DMA receive in progress from an interrupt and wake up the
+  *         waiting task
+  * @param  None
+  * @retval None
+  */
+static void SPI_WIFI_EndReceiveDMAFromISR(void)
+{
+  if (SPI_WIFI_HaltReceiveDMA())
+  {
+#ifdef SPI_WIFI_RX_DMA_SEM
+    BaseType_t woken = pdFALSE;
+
+    (void)xSemaphoreGiveFromISR(spi_rx_dma_sem, &woken);
+    portYIELD_FROM_ISR(woken);
+#else
+    SEM_SIGNAL(spi_rx_sem);
+#endif
+  }
+}
+#endif
+
+/**
+  * @brief  Receive wifi Data from SPI
+  * @param  pdata : pointer to data
+  * @param  len : Data length, 0 to read until the module stops
+  * @param  timeout : receive timeout in mS
+  * @retval Length of received data without the trailing stuffing bytes
+  */
+int16_t SPI_WIFI_ReceiveData(uint8_t *pData, uint16_t len, uint32_t timeout)
+{
+  int16_t length = 0;
+
+  if (SPI_WIFI_WaitTransmitDMA(timeout) < 0)
+  {
+    WIFI_DISABLE_NSS();
+    UNLOCK_SPI();
+    return ES_WIFI_ERROR_SPI_FAILED;
+  }
+
   WIFI_DISABLE_NSS();
   UNLOCK_SPI();
+  SPI_WIFI_DelayUs(3);
+
+
+  if (wait_cmddata_rdy_rising_event(timeout)<0)
+  {
+      return ES_WIFI_ERROR_WAITING_DRDY_FALLING;
+  }
+
+  LOCK_SPI();
+  WIFI_ENABLE_NSS();
+  SPI_WIFI_DelayUs(15);
+#if (ES_WIFI_USE_SPI_DMA == 1)
+  /* the DMA moves half-words, an odd buffer takes the interrupt path */
+  if (((uintptr_t)pData & 1) == 0)
+  {
+    length = SPI_WIFI_ReceiveDMA(pData, len, timeout);
+  }
+  else
+#endif
+  {
+    length = SPI_WIFI_ReceiveWords(pData, len, timeout);
+  }
+  WIFI_DISABLE_NSS();
+
+  if (length == ES_WIFI_ERROR_STUFFING_FOREVER)
+  {
+    SPI_WIFI_ResetModule();
+  }
+  UNLOCK_SPI();
+
+  while ((length > 0) && (pData[length - 1] == SPI_WIFI_STUFFING_BYTE))
+  {
+    length--;
+  }
   return length;
 }
+/**
+  * @brief  Lend the idle staging buffer, so that the data of the next send
+  *         is written in place while the current transfer runs
+  * @param  len : length of the next send
+  * @retval Buffer to pass to SPI_WIFI_SendData, NULL if len does not fit
+  */
+uint8_t *SPI_WIFI_GetTxBuffer(uint16_t len)
+{
+#if (ES_WIFI_USE_SPI_DMA == 1)
+  if ((len > 0) && (((len + 1) & ~1) <= SPI_WIFI_TX_STAGING_SIZE))
+  {
+    return (uint8_t *) spi_tx_staging[spi_tx_staging_ix];
+  }
+#endif
+  return NULL;
+}
+
 /**
   * @brief  Send wifi Data thru SPI
   * @param  pdata : pointer to data
@@ -327,8 +650,51 @@ int16_t SPI_WIFI_ReceiveData(uint8_t *pData, uint16_t len, uint32_t timeout)
 int16_t SPI_WIFI_SendData( uint8_t *pdata,  uint16_t len, uint32_t timeout)
 {
   uint8_t Padding[2];
+#if (ES_WIFI_USE_SPI_DMA == 1)
+  uint8_t *staging;
 
-  if (wait_cmddata_rdy_high(timeout)<0)
+  if ((len > 0) && (((len + 1) & ~1) <= SPI_WIFI_TX_STAGING_SIZE))
+  {
+    /* fill the idle staging buffer while the previous transfer may still
+       be in flight; odd lengths are padded in place */
+    staging = (uint8_t *) spi_tx_staging[spi_tx_staging_ix];
+    spi_tx_staging_ix ^= 1;
+    if (pdata != staging)
+    {
+      memcpy(staging, pdata, len);
+    }
+    if (len & 1)
+    {
+      staging[len] = '\n';
+    }
+
+    if ((SPI_WIFI_WaitTransmitDMA(timeout) < 0) || (wait_cmddata_rdy_high(timeout) < 0))
+    {
+      return ES_WIFI_ERROR_SPI_FAILED;
+    }
+
+    /* arm to detect rising event */
+    cmddata_rdy_rising_event=1;
+    LOCK_SPI();
+    WIFI_ENABLE_NSS();
+    SPI_WIFI_DelayUs(15);
+
+    spi_tx_event=1;
+    spi_tx_dma_pending=1;
+    if (HAL_SPI_Transmit_DMA(&hspi, staging, (len + 1) / 2) != HAL_OK)
+    {
+      spi_tx_event=0;
+      spi_tx_dma_pending=0;
+      WIFI_DISABLE_NSS();
+      UNLOCK_SPI();
+      return ES_WIFI_ERROR_SPI_FAILED;
+    }
+    /* the next send or receive waits for the end of the transfer */
+    return len;
+  }
+#endif
+
+  if ((SPI_WIFI_WaitTransmitDMA(timeout) < 0) || (wait_cmddata_rdy_high(timeout) < 0))
   {
     return ES_WIFI_ERROR_SPI_FAILED;
   }
@@ -368,6 +734,30 @@ int16_t SPI_WIFI_SendData( uint8_t *pdata,  uint16_t len, uint32_t timeout)
   return len;
 }
 
+/**
+  * @brief  Wait for the end of the DMA transmit in flight, if any
+  * @param  timeout : timeout in mS
+  * @retval 0 on success, negative on timeout
+  */
+static int SPI_WIFI_WaitTransmitDMA(uint32_t timeout)
+{
+  int ret = 0;
+
+#if (ES_WIFI_USE_SPI_DMA == 1)
+  if (spi_tx_dma_pending)
+  {
+    ret = wait_spi_tx_event(timeout);
+    spi_tx_dma_pending = 0;
+    if (ret < 0)
+    {
+      HAL_SPI_DMAStop(&hspi);
+      spi_tx_event = 0;
+    }
+  }
+#endif
+  return ret;
+}
+
 /**
   * @brief  Delay
   * @param  Delay in ms
@@ -439,6 +829,36 @@ void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
   }
 }
 
+#if (ES_WIFI_USE_SPI_DMA == 1)
+/**
+  * @brief Tx and Rx Transfer completed callback, ends a DMA receive
+  *        that filled the whole buffer.
+  * @param  hspi: pointer to a SPI_HandleTypeDef structure that contains
+  *               the configuration information for SPI module.
+  * @retval None
+  */
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+  SPI_WIFI_EndReceiveDMAFromISR();
+}
+
+/**
+  * @brief SPI error callback, ends the DMA transfer in progress.
+  * @param  hspi: pointer to a SPI_HandleTypeDef structure that contains
+  *               the configuration information for SPI module.
+  * @retval None
+  */
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+  SPI_WIFI_EndReceiveDMAFromISR();
+  if (spi_tx_event)
+  {
+    SEM_SIGNAL(spi_tx_sem);
+    spi_tx_event = 0;
+  }
+}
+#endif
+
 
 /**
   * @brief  Interrupt handler for  Data RDY signal
@@ -447,11 +867,21 @@ void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
   */
 void    SPI_WIFI_ISR(void)
 {
-   if (cmddata_rdy_rising_event==1)
+   if (WIFI_IS_CMDDATA_READY())
    {
-     SEM_SIGNAL(cmddata_rdy_rising_sem);
-     cmddata_rdy_rising_event = 0;
+     if (cmddata_rdy_rising_event==1)
+     {
+       SEM_SIGNAL(cmddata_rdy_rising_sem);
+       cmddata_rdy_rising_event = 0;
+     }
    }
+#if (ES_WIFI_USE_SPI_DMA == 1)
+   else
+   {
+     /* falling edge: the module has clocked out all its data */
+     SPI_WIFI_EndReceiveDMAFromISR();
+   }
+#endif
 }
 /**
   * @}
@@ -430,6 +430,25 @@ WIFI_Status_t WIFI_SendDataTo(uint8_t socket, uint8_t *pdata, uint16_t Reqlen, u
   return ret;
 }
 
+/**
+  * @brief  Pin the destination of a UDP socket for WIFI_SendData
+  * @param  socket : socket number
+  * @param  ipaddr : (IN) 4-byte array containing the IP address of the remote host, NULL to unpin
+  * @param  port : (IN) port number of the remote host
+  * @retval Operation status
+  */
+WIFI_Status_t WIFI_ConnectUDP(uint8_t socket, uint8_t *ipaddr, uint16_t port)
+{
+  WIFI_Status_t ret = WIFI_STATUS_ERROR;
+
+  if(ES_WIFI_ConnectUDP(&EsWifiObj, socket, ipaddr, port) == ES_WIFI_STATUS_OK)
+  {
+    ret = WIFI_STATUS_OK;
+  }
+
+  return ret;
+}
+
 /**
   * @brief  Receive Data from a socket
   * @param  pdata : pointer to Rx buffer
@@ -60,7 +60,7 @@
 #define configTICK_RATE_HZ                ((TickType_t)1000)
 #define configMAX_PRIORITIES              (7)
 #define configMINIMAL_STACK_SIZE          ((uint16_t)128)
-#define configTOTAL_HEAP_SIZE             ((size_t)(64 * 1024))
+#define configTOTAL_HEAP_SIZE             ((size_t)(8 * 1024))
 #define configMAX_TASK_NAME_LEN           (16)
 #define configUSE_TRACE_FACILITY          1
 #define configUSE_16_BIT_TICKS            0
@@ -74,13 +74,21 @@
 #define configUSE_COUNTING_SEMAPHORES     1
 #define configGENERATE_RUN_TIME_STATS     0
 
+/* Tickless idle: with no task due, the idle task stops the tick and sleeps
+until the next one is, or an interrupt comes. The low power policy (power.h)
+runs before each sleep. */
+#define configUSE_TICKLESS_IDLE           1
+
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES           0
 #define configMAX_CO_ROUTINE_PRIORITIES (2)
 
-/* Software timer definitions. */
-#define configUSE_TIMERS             0
-#define configTIMER_TASK_PRIORITY    (2)
+/* Software timer definitions. The timer task runs the event group bits set
+from interrupts (xEventGroupSetBitsFromISR): it gets the highest priority so
+that they are not delayed by the application tasks, which are all created at
+tskIDLE_PRIORITY + 3 or below. */
+#define configUSE_TIMERS             1
+#define configTIMER_TASK_PRIORITY    (configMAX_PRIORITIES - 1)
 #define configTIMER_QUEUE_LENGTH     10
 #define configTIMER_TASK_STACK_DEPTH (configMINIMAL_STACK_SIZE * 2)
 
@@ -94,12 +102,17 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelayUntil        0
 #define INCLUDE_vTaskDelay             1
 #define INCLUDE_xTaskGetSchedulerState 1
+#define INCLUDE_xTimerPendFunctionCall 1
+#define INCLUDE_xTaskGetCurrentTaskHandle 1
 
 /* When using CMSIS-RTOSv2 set configSUPPORT_STATIC_ALLOCATION to 1
  * is mandatory to avoid compile errors.
  */
 /*#define configSUPPORT_STATIC_ALLOCATION 1 */
-#define configSUPPORT_STATIC_ALLOCATION 0
+/* Tasks, queues and semaphores are placed at link time: the heap only serves
+the fallback of the block pools (pool.h). Set to 0, and configTOTAL_HEAP_SIZE
+back to 64 KB, to create them on the heap. */
+#define configSUPPORT_STATIC_ALLOCATION 1
 
 /* Cortex-M specific definitions. */
 #ifdef __NVIC_PRIO_BITS
@@ -140,5 +153,28 @@ header file. */
  */
 /* #define xPortSysTickHandler SysTick_Handler */
 
+/* Runtime statistics (rtstats.h), counted in CPU cycles. The trace macros
+expand in tasks.c, where pxCurrentTCB and xSchedulerRunning are visible; the
+kernel's own run time counter is left off, it wraps after 53 s of cycles. */
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+ #include "rtstats.h"
+ #if (C_RTSTATS_ENABLE == 1)
+  #define traceTASK_INCREMENT_TICK( xTickCount ) rtstatsTick()
+  #define traceINCREASE_TICK_COUNT( xTicks ) \
+    rtstatsSleepExit( ( xTicks ) * ( configCPU_CLOCK_HZ / configTICK_RATE_HZ ) )
+  #define traceTASK_SWITCHED_OUT() rtstatsTaskOut()
+  #define traceTASK_SWITCHED_IN() rtstatsTaskIn( pxCurrentTCB, pxCurrentTCB->uxTCBNumber )
+  #define traceMOVED_TASK_TO_READY_STATE( pxTCB ) \
+    do { if( ( xSchedulerRunning != pdFALSE ) && ( ( pxTCB ) != pxCurrentTCB ) ) { \
+      rtstatsTaskReady( ( pxTCB )->uxTCBNumber ); } } while( 0 )
+ #endif
+#endif
+
+/* Low power policy (power.h), with the interrupts masked before the wfi. */
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+ #include "power.h"
+ #define configPRE_SLEEP_PROCESSING( pxIdle ) powerPreSleep( pxIdle )
+#endif
+
 #endif /* FREERTOS_CONFIG_H */
 
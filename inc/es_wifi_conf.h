@@ -59,6 +59,7 @@ extern osMutexId es_wifi_mutex;
 
 #define ES_WIFI_DATA_SIZE                           2000
 #define ES_WIFI_MAX_DETECTED_AP                     10
+#define ES_WIFI_MAX_SOCKETS                         4
 
 #define ES_WIFI_TIMEOUT                             30000
 
@@ -70,6 +71,21 @@ extern osMutexId es_wifi_mutex;
 #define ES_WIFI_USE_SPI                             1
 #define ES_WIFI_USE_UART                            (!ES_WIFI_USE_SPI)
 
+/* SPI transfers by DMA (SPI3 on DMA2 channels 1/2): receives end on the falling
+   edge of CMDDATA_READY, sends go through two staging buffers. Set to 0 to
+   move one word per interrupt. */
+#define ES_WIFI_USE_SPI_DMA                         1
+
+/* Host-side module emulator (es_wifi_emu.c) in place of the SPI IO layer, for
+   running es_wifi.c on a Linux host; the timings are its defaults. */
+#ifndef ES_WIFI_USE_EMULATOR
+#define ES_WIFI_USE_EMULATOR                        0
+#endif
+#define ES_WIFI_EMU_SPI_CLOCK                       10000000
+#define ES_WIFI_EMU_LATENCY_US                      250
+#define ES_WIFI_EMU_JOIN_MS                         1500
+#define ES_WIFI_EMU_DHCP_MS                         1000
+
 
 
 #ifdef __cplusplus
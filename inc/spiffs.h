@@ -62,8 +62,21 @@ extern "C" {
 
 #define SPIFFS_ERR_SEEK_BOUNDS          -10040
 
+#define SPIFFS_ERR_META_IX_UNMAPPED     -10041
+#define SPIFFS_ERR_META_IX_MAPPED       -10042
+#define SPIFFS_ERR_META_IX_FULL         -10043
+#define SPIFFS_ERR_META_IX_BAD_FIELD    -10044
 
-#define SPIFFS_ERR_INTERNAL             -10050
+#define SPIFFS_ERR_RING_OVERWRITTEN     -10045
+#define SPIFFS_ERR_RING_CAPACITY        -10046
+
+#define SPIFFS_ERR_TXN_STATE            -10047
+#define SPIFFS_ERR_TXN_FULL             -10048
+
+#define SPIFFS_ERR_COMPRESS_BUF         -10049
+#define SPIFFS_ERR_COMPRESS_CORRUPT     -10050
+
+#define SPIFFS_ERR_INTERNAL             -10051
 
 #define SPIFFS_ERR_TEST                 -10100
 
@@ -176,6 +189,15 @@ typedef void (*spiffs_file_callback)(struct spiffs_t *fs, spiffs_fileop_type op,
 /* If SPIFFS_O_CREAT and SPIFFS_O_EXCL are set, SPIFFS_open() shall fail if the file exists */
 #define SPIFFS_EXCL                     (1<<6)
 #define SPIFFS_O_EXCL                   SPIFFS_EXCL
+/* The opened file is a new, empty shadow version of the path, replacing the
+   current version when the transaction commits, see SPIFFS_txn_begin. Outside
+   of a transaction, the file is replaced when the shadow is closed */
+#define SPIFFS_SHADOW                   (1<<7)
+#define SPIFFS_O_SHADOW                 SPIFFS_SHADOW
+/* If the file is created, its data is stored compressed, see
+   SPIFFS_compress_buffer. Existing files keep the form they were created in */
+#define SPIFFS_COMPRESS                 (1<<8)
+#define SPIFFS_O_COMPRESS               SPIFFS_COMPRESS
 
 #define SPIFFS_SEEK_SET                 (0)
 #define SPIFFS_SEEK_CUR                 (1)
@@ -185,6 +207,8 @@ typedef void (*spiffs_file_callback)(struct spiffs_t *fs, spiffs_fileop_type op,
 #define SPIFFS_TYPE_DIR                 (2)
 #define SPIFFS_TYPE_HARD_LINK           (3)
 #define SPIFFS_TYPE_SOFT_LINK           (4)
+#define SPIFFS_TYPE_RING                (5)
+#define SPIFFS_TYPE_COMPRESSED          (6)
 
 #ifndef SPIFFS_LOCK
 #define SPIFFS_LOCK(fs)
@@ -228,6 +252,46 @@ typedef struct {
 #endif
 } spiffs_config;
 
+#if SPIFFS_META_IX
+// secondary index entry, one per object
+typedef struct {
+  // value of the indexed metadata field
+  u32_t key;
+  // object id
+  spiffs_obj_id obj_id;
+  // object index header page
+  spiffs_page_ix pix;
+} spiffs_meta_ix_entry;
+
+// secondary index on a metadata field
+typedef struct {
+  // entries, kept sorted by key
+  spiffs_meta_ix_entry *entries;
+  // number of entries in use
+  u32_t count;
+  // number of entries available
+  u32_t max_count;
+  // byte offset of indexed field in metadata
+  u8_t key_offs;
+  // byte length of indexed field, 1 to 4, little endian
+  u8_t key_len;
+  // set if there were more objects than entries
+  u8_t overflow;
+} spiffs_meta_ix;
+#endif
+
+#if SPIFFS_TXN
+// open transaction
+typedef struct {
+  // object ids of shadow versions written so far
+  spiffs_obj_id obj_ids[SPIFFS_TXN_MAX_FILES];
+  // number of shadow versions
+  u8_t count;
+  // transaction state, 0 if none open
+  u8_t state;
+} spiffs_txn;
+#endif
+
 typedef struct spiffs_t {
   // file system configuration
   spiffs_config cfg;
@@ -285,6 +349,18 @@ typedef struct spiffs_t {
   spiffs_check_callback check_cb_f;
   // file callback function
   spiffs_file_callback file_cb_f;
+#if SPIFFS_META_IX
+  // mapped metadata index, if any
+  spiffs_meta_ix *meta_ix;
+#endif
+#if SPIFFS_TXN
+  // open transaction, if any
+  spiffs_txn txn;
+#endif
+#if SPIFFS_COMPRESSED_FILES
+  // compression buffer, if any
+  void *compress;
+#endif
   // mounted flag
   u8_t mounted;
   // user data
@@ -322,6 +398,9 @@ typedef struct {
   int entry;
 } spiffs_DIR;
 
+/* directory entry filter, return non-zero to accept given entry */
+typedef int (*spiffs_dirent_filter)(spiffs *fs, const struct spiffs_dirent *e, void *arg);
+
 #if SPIFFS_IX_MAP
 
 typedef struct {
@@ -589,6 +668,21 @@ s32_t SPIFFS_closedir(spiffs_DIR *d);
  */
 struct spiffs_dirent *SPIFFS_readdir(spiffs_DIR *d, struct spiffs_dirent *e);
 
+/**
+ * Reads next directory entry accepted by given filter into given spiffs_dirent
+ * struct. The filter is evaluated on name and metadata during the same sweep
+ * over the object index headers that SPIFFS_readdir does, so no files need to
+ * be opened to select on metadata.
+ * @param d             pointer to the directory stream
+ * @param e             the dirent struct to be populated
+ * @param filter        the filter, called with populated dirent, or null to
+ *                      accept all entries
+ * @param arg           user argument passed to filter
+ * @returns null if error or end of stream, else given dirent is returned
+ */
+struct spiffs_dirent *SPIFFS_readdir_filter(spiffs_DIR *d, struct spiffs_dirent *e,
+    spiffs_dirent_filter filter, void *arg);
+
 /**
  * Runs a consistency check on given filesystem.
  * @param fs            the file system struct
@@ -674,6 +768,23 @@ s32_t SPIFFS_gc_quick(spiffs *fs, u16_t max_free_pages);
  */
 s32_t SPIFFS_gc(spiffs *fs, u32_t size);
 
+/**
+ * Makes room in free blocks for appending given amount of bytes to a file,
+ * so that the garbage collector does not run during the appends. Blocks with
+ * deleted pages only are erased first, then pages are moved as SPIFFS_gc
+ * does. Each append rewrites the object index header to a new page: the
+ * reservation accounts for one per write_size bytes.
+ * Call it after opening the file, as truncating the file deletes its pages.
+ * Other writes to the file system meanwhile consume the reservation.
+ * If the blocks cannot be freed, err_no will be set to SPIFFS_ERR_FULL.
+ *
+ * @param fs            the file system struct
+ * @param size          amount of bytes to be appended
+ * @param write_size    smallest amount of bytes of one SPIFFS_write, or 0
+ *                      to assume one write per data page
+ */
+s32_t SPIFFS_reserve(spiffs *fs, u32_t size, u32_t write_size);
+
 /**
  * Check if EOF reached.
  * @param fs            the file system struct
@@ -782,6 +893,153 @@ s32_t SPIFFS_ix_map_entries_to_bytes(spiffs *fs, u32_t map_page_ix_entries);
 
 #endif // SPIFFS_IX_MAP
 
+#if SPIFFS_RING_FILES
+
+/**
+ * Creates a new ring file. A ring file holds at least the most recently
+ * written capacity bytes of an endless stream.
+ * All writes append to the stream regardless of file offset; once the ring
+ * is full, starting a new page drops the oldest page of the stream. The ring
+ * keeps the capacity rounded up to whole data pages plus one data page, so
+ * that head - tail never falls below the capacity once that much is written,
+ * and never occupies more than these pages plus the object index header on
+ * the medium.
+ * Ring files are opened, read, seeked and removed like ordinary files, but
+ * file offsets and size are stream positions: the size is the head of the
+ * stream, i.e. number of bytes ever written. Reading from a position that has
+ * been overwritten fails with SPIFFS_ERR_RING_OVERWRITTEN, see
+ * SPIFFS_ring_cursors. Truncating is only possible to zero, clearing the ring.
+ * @param fs            the file system struct
+ * @param path          the path of the new file
+ * @param capacity      the capacity in bytes, at most
+ *                      (SPIFFS_OBJ_HDR_IX_LEN - 2) data pages
+ */
+s32_t SPIFFS_ring_create(spiffs *fs, const char *path, u32_t capacity);
+
+/**
+ * Returns the stream positions of the oldest byte still held by a ring file
+ * and of the next byte to be written. Bytes in between can be read.
+ * @param fs            the file system struct
+ * @param fh            the file handle of an opened ring file
+ * @param tail          populated with the position of the oldest byte
+ * @param head          populated with the position of the next byte
+ */
+s32_t SPIFFS_ring_cursors(spiffs *fs, spiffs_file fh, u32_t *tail, u32_t *head);
+
+#endif // SPIFFS_RING_FILES
+
+#if SPIFFS_META_IX
+
+/**
+ * Maps a secondary index on a metadata field to given memory. All object index
+ * headers are swept once and the field value, object id and header page of
+ * each object are stored in the entry array, sorted on the field value.
+ * While mapped, the index is kept up to date on file creation, metadata
+ * updates, removal and garbage collection, so objects can be selected on
+ * the field without touching the medium at all.
+ * If there are more objects than entries, the index is not mapped and
+ * SPIFFS_ERR_META_IX_FULL is returned. Should the objects outgrow the array
+ * while mapped, queries fail with SPIFFS_ERR_META_IX_FULL until the index is
+ * unmapped and mapped again with a larger array.
+ * @param fs          the file system struct
+ * @param ix          a spiffs_meta_ix struct, describing the index
+ * @param key_offs    byte offset of the field in the metadata
+ * @param key_len     byte length of the field, 1 to 4, read little endian
+ * @param entries     the entry array
+ * @param max_count   number of elements in the entry array
+ */
+s32_t SPIFFS_meta_ix_map(spiffs *fs, spiffs_meta_ix *ix,
+    u32_t key_offs, u32_t key_len, spiffs_meta_ix_entry *entries, u32_t max_count);
+
+/**
+ * Unmaps the metadata index. The index and entry array given in function
+ * SPIFFS_meta_ix_map will no longer be referenced by spiffs.
+ * @param fs          the file system struct
+ */
+s32_t SPIFFS_meta_ix_unmap(spiffs *fs);
+
+/**
+ * Finds all objects whose indexed metadata field lies within given range.
+ * Matching entries are consecutive in the entry array; the first one is
+ * returned by reference and may be opened with SPIFFS_open_by_page. The
+ * array may change on any following file system operation.
+ * @param fs          the file system struct
+ * @param key_min     lowest field value to match, inclusive
+ * @param key_max     highest field value to match, inclusive
+ * @param first       populated with first matching entry
+ * @returns number of matching entries, or error
+ */
+s32_t SPIFFS_meta_ix_find(spiffs *fs, u32_t key_min, u32_t key_max,
+    spiffs_meta_ix_entry **first);
+
+#endif // SPIFFS_META_IX
+
+#if SPIFFS_TXN
+
+/**
+ * Opens a transaction. Files opened with SPIFFS_O_SHADOW until the transaction
+ * is committed or aborted are written as hidden shadow versions, leaving the
+ * current versions untouched and visible. On commit, a single marker page
+ * listing the shadows is programmed; from that point on all shadows replace
+ * their current versions, also if power is lost before the commit completes,
+ * in which case the replacement is finished on next mount. Shadows of a
+ * transaction never committed are removed on next mount.
+ * Only one transaction may be open at a time, holding at most
+ * SPIFFS_TXN_MAX_FILES shadows. Shadowing the same path twice in one
+ * transaction makes the last shadow win.
+ * @param fs            the file system struct
+ */
+s32_t SPIFFS_txn_begin(spiffs *fs);
+
+/**
+ * Commits the open transaction. Cached writes to shadows are flushed, the
+ * marker page is programmed, then the current versions are removed and the
+ * shadows take their place. The old versions' pages are left for the garbage
+ * collector. File handles to replaced versions are closed, handles to shadows
+ * stay open.
+ * Needs a free file descriptor.
+ * @param fs            the file system struct
+ */
+s32_t SPIFFS_txn_commit(spiffs *fs);
+
+/**
+ * Aborts the open transaction, removing all shadows written in it. File
+ * handles to shadows are closed.
+ * Needs a free file descriptor.
+ * @param fs            the file system struct
+ */
+s32_t SPIFFS_txn_abort(spiffs *fs);
+
+#endif // SPIFFS_TXN
+
+#if SPIFFS_COMPRESSED_FILES
+
+/**
+ * Gives spiffs memory for reading and writing compressed files. Files created
+ * with SPIFFS_O_COMPRESS store their data in frames of exactly one data page,
+ * each holding a small header and the compressed form of a run of bytes.
+ * Frames are decoded independently, so sequential reads and appends stream
+ * one frame at a time and seeking locates the frame holding the offset by a
+ * binary search on the frame headers.
+ * Writes to a compressed file always append, regardless of file offset.
+ * Appended bytes are held in memory until a frame is full or the file is
+ * flushed or closed; flushing rewrites the last, partly filled frame. File
+ * offsets and the size given by SPIFFS_fstat are uncompressed byte counts,
+ * while SPIFFS_stat and SPIFFS_readdir give the bytes taken on the medium.
+ * The buffer serves one open compressed file at a time; opening a compressed
+ * file without a buffer, or while another one is open, fails with
+ * SPIFFS_ERR_COMPRESS_BUF. What remains of the buffer after the compressor's
+ * state and a frame page bounds the uncompressed bytes per frame, see
+ * SPIFFS_buffer_bytes_for_compress; about four data pages allow a ratio of
+ * four to one. Must be called after mounting, and not while a compressed file
+ * is open.
+ * @param fs            the file system struct
+ * @param buf           the buffer, or 0 to take it back
+ * @param size          size of the buffer
+ */
+s32_t SPIFFS_compress_buffer(spiffs *fs, void *buf, u32_t size);
+
+#endif // SPIFFS_COMPRESSED_FILES
 
 #if SPIFFS_TEST_VISUALISATION
 /**
@@ -805,6 +1063,14 @@ u32_t SPIFFS_buffer_bytes_for_filedescs(spiffs *fs, u32_t num_descs);
  */
 u32_t SPIFFS_buffer_bytes_for_cache(spiffs *fs, u32_t num_pages);
 #endif
+
+#if SPIFFS_COMPRESSED_FILES
+/**
+ * Returns number of bytes needed for the compression buffer given
+ * amount of uncompressed bytes per frame.
+ */
+u32_t SPIFFS_buffer_bytes_for_compress(spiffs *fs, u32_t raw_len);
+#endif
 #endif
 
 #if SPIFFS_CACHE
@@ -28,26 +28,48 @@ typedef unsigned char u8_t;
 
 // compile time switches
 
+// Binary records, decoded on the host: cheap enough to stay on. The cache and
+// api calls log on every access and are only sent to the log when asked for.
+// Without the kernel no log task sends the records, the calls print instead.
+#ifdef C_BOARD_USE_FREE_RTOS
+#include "binlog.h"
+#define SPIFFS_LOG(_f, ...) M_BINLOG(_f, ## __VA_ARGS__)
+#else
+#include <stdio.h>
+#define SPIFFS_LOG(_f, ...) printf(_f, ## __VA_ARGS__)
+#endif
+#ifndef SPIFFS_DBG_VERBOSE
+#define SPIFFS_DBG_VERBOSE 0
+#endif
+
 // Set generic spiffs debug output call.
 #ifndef SPIFFS_DBG
-#define SPIFFS_DBG(_f, ...) //printf(_f, ## __VA_ARGS__)
+#define SPIFFS_DBG(_f, ...) SPIFFS_LOG(_f, ## __VA_ARGS__)
 #endif
 // Set spiffs debug output call for garbage collecting.
 #ifndef SPIFFS_GC_DBG
-#define SPIFFS_GC_DBG(_f, ...) //printf(_f, ## __VA_ARGS__)
+#define SPIFFS_GC_DBG(_f, ...) SPIFFS_LOG(_f, ## __VA_ARGS__)
 #endif
 // Set spiffs debug output call for caching.
 #ifndef SPIFFS_CACHE_DBG
+#if SPIFFS_DBG_VERBOSE
+#define SPIFFS_CACHE_DBG(_f, ...) SPIFFS_LOG(_f, ## __VA_ARGS__)
+#else
 #define SPIFFS_CACHE_DBG(_f, ...) //printf(_f, ## __VA_ARGS__)
 #endif
+#endif
 // Set spiffs debug output call for system consistency checks.
 #ifndef SPIFFS_CHECK_DBG
-#define SPIFFS_CHECK_DBG(_f, ...) //printf(_f, ## __VA_ARGS__)
+#define SPIFFS_CHECK_DBG(_f, ...) SPIFFS_LOG(_f, ## __VA_ARGS__)
 #endif
 // Set spiffs debug output call for all api invocations.
 #ifndef SPIFFS_API_DBG
+#if SPIFFS_DBG_VERBOSE
+#define SPIFFS_API_DBG(_f, ...) SPIFFS_LOG(_f, ## __VA_ARGS__)
+#else
 #define SPIFFS_API_DBG(_f, ...) //printf(_f, ## __VA_ARGS__)
 #endif
+#endif
 
 
 
@@ -200,11 +222,13 @@ typedef unsigned char u8_t;
 
 // define this to enter a mutex if you're running on a multithreaded system
 #ifndef SPIFFS_LOCK
-#define SPIFFS_LOCK(fs)
+void spiffsLock(void);
+#define SPIFFS_LOCK(fs) spiffsLock()
 #endif
 // define this to exit a mutex if you're running on a multithreaded system
 #ifndef SPIFFS_UNLOCK
-#define SPIFFS_UNLOCK(fs)
+void spiffsUnlock(void);
+#define SPIFFS_UNLOCK(fs) spiffsUnlock()
 #endif
 
 // Enable if only one spiffs instance with constant configuration will exist
@@ -315,6 +339,82 @@ typedef unsigned char u8_t;
 #define SPIFFS_IX_MAP                         0
 #endif
 
+// Enable to store the content of small files inline in their object index
+// header page, in the space otherwise taken by the header's index entries.
+// A file stays inline as long as its size fits in
+// logical_page_size - sizeof(spiffs_page_object_ix_header) bytes, halving
+// the page count and program cost of tiny files. Once it grows beyond that,
+// the data is spilled to a regular data page and the file behaves as usual.
+// Inline headers are tagged with a page header flag that older builds do not
+// know about, so a file system holding inline files must not be mounted by a
+// build with this disabled.
+#ifndef SPIFFS_INLINE_DATA
+#define SPIFFS_INLINE_DATA                    1
+#endif
+
+// Enable to store object names in a compact form in the object index header:
+// a length byte and a 16 bit hash of the name, followed by the name itself
+// without padding. Lookups by name read the fixed part of each header first
+// and only fetch the name when hash and length match. Names longer than
+// sizeof(spiffs_page_object_ix_header) - sizeof(spiffs_page_object_ix_header_compact)
+// keep the classic fixed size layout. Each header is tagged by a page header
+// flag, so both layouts may coexist on the same file system, but a build with
+// this disabled cannot read names from compact headers.
+#ifndef SPIFFS_COMPACT_NAMES
+#define SPIFFS_COMPACT_NAMES                  1
+#endif
+
+// Enable this to be able to map a secondary index on one field of the object
+// metadata to a RAM array, see SPIFFS_meta_ix_map. Objects can then be
+// selected on that field without sweeping the object index headers. The
+// index is updated along with the headers. Requires SPIFFS_OBJ_META_LEN.
+// Costs nothing but code space unless an index is mapped.
+#ifndef SPIFFS_META_IX
+#define SPIFFS_META_IX                        1
+#endif
+
+// Enable this to be able to create ring files, see SPIFFS_ring_create. A ring
+// file has a fixed capacity of whole data pages, plus one for the page being
+// filled; writes always append, and once full each new page replaces the
+// oldest one. All data pages are referenced from the object index header,
+// which limits the capacity to SPIFFS_OBJ_HDR_IX_LEN - 2 pages; the last
+// header entry holds the number of pages. The free entries in between log the
+// appends within the newest page, so that the header is only rewritten once
+// per data page; a ring of the largest capacity has none and rewrites it on
+// every append.
+#ifndef SPIFFS_RING_FILES
+#define SPIFFS_RING_FILES                     1
+#endif
+
+// Enable this to be able to replace several files atomically, see
+// SPIFFS_txn_begin. New versions are written as hidden shadow objects and
+// switched in by programming one marker page. Any unfinished transaction is
+// rolled forward or back when mounting, which adds a sweep of all object
+// index headers to SPIFFS_mount.
+#ifndef SPIFFS_TXN
+#define SPIFFS_TXN                            1
+#endif
+// Max number of files replaced in one transaction. Costs
+// sizeof(spiffs_obj_id) bytes of ram each in the spiffs struct, and must not
+// exceed SPIFFS_OBJ_HDR_IX_LEN.
+#ifndef SPIFFS_TXN_MAX_FILES
+#define SPIFFS_TXN_MAX_FILES                  8
+#endif
+
+// Enable this to be able to store files compressed, see SPIFFS_O_COMPRESS
+// and SPIFFS_compress_buffer. Compressed data is packed in frames of one data
+// page each, encoded as LZ4 style sequences of literals and back references
+// within the frame.
+#ifndef SPIFFS_COMPRESSED_FILES
+#define SPIFFS_COMPRESSED_FILES               1
+#endif
+// log2 of the number of entries in the compressor's match table. Each entry
+// costs two bytes of the compression buffer; fewer entries find fewer
+// matches.
+#ifndef SPIFFS_COMPRESS_HASH_BITS
+#define SPIFFS_COMPRESS_HASH_BITS             8
+#endif
+
 // Set SPIFFS_TEST_VISUALISATION to non-zero to enable SPIFFS_vis function
 // in the api. This function will visualize all filesystem using given printf
 // function.
@@ -0,0 +1,771 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef C_BOARD_USE_FREE_RTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
+
+#include "board.h"
+#include "bench.h"
+#include "boottime.h"
+#include "memory_qspi.h"
+#include "pool.h"
+#include "rtstats.h"
+#include "spiffs_fs.h"
+#include "spi_wifi.h"
+
+#define C_BENCH_SAMPLES 256 //!< Latencies kept for the percentiles, drawn at random
+                            //   when there are more operations.
+
+#define C_BENCH_BUFFER_SIZE ES_WIFI_PAYLOAD_SIZE //!< Largest chunk or datagram.
+
+#define C_BENCH_MAX_ARGS 8 //!< Most words of a command line.
+
+#define C_BENCH_FILE_PREFIX "bench." //!< Files of the file system benchmark.
+
+#define C_BENCH_FILES      4     //!< Default number of files written.
+#define C_BENCH_FILE_SIZE  16384 //!< Default size of a file.
+#define C_BENCH_CHUNK_SIZE 256   //!< Default size of a write or read.
+
+#define C_BENCH_SOCKET    3    //!< Socket of the network benchmark.
+#define C_BENCH_UDP_PORT  5001 //!< Local port of the network benchmark.
+#define C_BENCH_UDP_SIZE  512  //!< Default size of a datagram.
+#define C_BENCH_UDP_COUNT 100  //!< Default number of datagrams.
+
+#define C_BENCH_SEND_TIMEOUT_MS 1000 //!< Timeout of a datagram.
+
+/**
+ * @brief  Latencies of the operations of a benchmark
+ */
+typedef struct
+{
+  uint32_t count;                 /**< operations */
+  uint32_t failed;                /**< operations that failed */
+  uint32_t maxUs;                 /**< longest operation */
+  uint32_t seed;                  /**< state of the random draw */
+  uint32_t us[C_BENCH_SAMPLES];   /**< samples, min(count, C_BENCH_SAMPLES) */
+} BENCH_Latency;
+
+static BENCH_Latency benchLatency; //!< Latencies of the benchmark running.
+
+static BOARD_QspiStats benchQspi; //!< Flash counters at the start of the benchmark.
+
+static uint32_t benchStart; //!< Tick at the start of the benchmark.
+
+static uint32_t benchChunk = C_BENCH_CHUNK_SIZE; //!< Chunk of the last write, read uses it.
+
+static uint8_t* benchBuffer = NULL; //!< Data written, read or sent, a pool block while
+                                    //   a benchmark runs.
+
+/*
+ * @brief   starts measuring a benchmark
+ * @return  none
+ */
+static void benchBegin
+(
+  void
+)
+{
+  uint32_t seed = benchLatency.seed;
+
+  memset(&benchLatency, 0, sizeof(benchLatency));
+  benchLatency.seed = (0 == seed) ? 0x2545F491 : seed;
+  boardMemoryQspiGetStats(&benchQspi);
+  benchStart = boardGetTick();
+} /* benchBegin() */
+
+/*
+ * @brief               adds the latency of an operation
+ * @param[in] xCycles   duration of the operation in CPU cycles
+ * @param[in] xFailed   1 when the operation failed
+ * @return              none
+ */
+static void benchAdd
+(
+  uint32_t xCycles,
+  int      xFailed
+)
+{
+  uint32_t us = boardCyclesToUs(xCycles);
+  uint32_t slot;
+
+  if (us > benchLatency.maxUs)
+  {
+    benchLatency.maxUs = us;
+  } /* if */
+  if (0 != xFailed)
+  {
+    benchLatency.failed++;
+  } /* if */
+
+  /* Reservoir sampling: every operation has the same chance to be kept. */
+  slot = benchLatency.count;
+  if (slot >= C_BENCH_SAMPLES)
+  {
+    benchLatency.seed ^= benchLatency.seed << 13;
+    benchLatency.seed ^= benchLatency.seed >> 17;
+    benchLatency.seed ^= benchLatency.seed << 5;
+    slot = benchLatency.seed % (benchLatency.count + 1);
+  } /* if */
+  if (slot < C_BENCH_SAMPLES)
+  {
+    benchLatency.us[slot] = us;
+  } /* if */
+  benchLatency.count++;
+} /* benchAdd() */
+
+/*
+ * @brief   orders two latencies, for qsort
+ */
+static int benchCompare
+(
+  const void* xpLeft,
+  const void* xpRight
+)
+{
+  uint32_t left = *(const uint32_t*) xpLeft;
+  uint32_t right = *(const uint32_t*) xpRight;
+
+  return (left > right) - (left < right);
+} /* benchCompare() */
+
+/*
+ * @brief               prints the report of the benchmark
+ * @param[in] xpName    name of the benchmark
+ * @param[in] xBytes    bytes processed, 0 when the throughput makes no sense
+ * @return              none
+ */
+static void benchReport
+(
+  const char* xpName,
+  uint32_t    xBytes
+)
+{
+  uint32_t        elapsed = boardGetTick() - benchStart;
+  uint32_t        samples = benchLatency.count;
+  BOARD_QspiStats qspi;
+
+  boardMemoryQspiGetStats(&qspi);
+  if (samples > C_BENCH_SAMPLES)
+  {
+    samples = C_BENCH_SAMPLES;
+  } /* if */
+
+  printf("%s: %lu ops, %lu failed, %lu ms", xpName, (unsigned long) benchLatency.count,
+         (unsigned long) benchLatency.failed, (unsigned long) elapsed);
+  if ((0 != xBytes) && (0 != elapsed))
+  {
+    printf(", %lu B, %lu B/s", (unsigned long) xBytes,
+           (unsigned long) (((uint64_t) xBytes * 1000) / elapsed));
+  } /* if */
+  printf("\n");
+
+  if (0 != samples)
+  {
+    qsort(benchLatency.us, samples, sizeof(benchLatency.us[0]), benchCompare);
+    printf("  latency us: p50 %lu p90 %lu p99 %lu max %lu\n",
+           (unsigned long) benchLatency.us[(samples * 50) / 100],
+           (unsigned long) benchLatency.us[(samples * 90) / 100],
+           (unsigned long) benchLatency.us[(samples * 99) / 100],
+           (unsigned long) benchLatency.maxUs);
+  } /* if */
+
+  printf("  flash: %lu reads %lu B, %lu programs %lu B, %lu erases\n",
+         (unsigned long) (qspi.reads - benchQspi.reads),
+         (unsigned long) (qspi.readBytes - benchQspi.readBytes),
+         (unsigned long) (qspi.programs - benchQspi.programs),
+         (unsigned long) (qspi.writeBytes - benchQspi.writeBytes),
+         (unsigned long) (qspi.erases - benchQspi.erases));
+  printf("  flash power: %lu downs, %lu wake-ups, %lu us waking\n",
+         (unsigned long) (qspi.powerDowns - benchQspi.powerDowns),
+         (unsigned long) (qspi.wakeUps - benchQspi.wakeUps),
+         (unsigned long) boardCyclesToUs(qspi.wakeCycles - benchQspi.wakeCycles));
+} /* benchReport() */
+
+/*
+ * @brief               fills or checks a chunk of a benchmark file
+ * @param[in] xFile     number of the file
+ * @param[in] xOffset   offset of the chunk in the file
+ * @param[in] xLength   length of the chunk
+ * @param[in] xCheck    0 to fill benchBuffer, 1 to compare it
+ * @return              number of bytes that differ
+ */
+static uint32_t benchPattern
+(
+  uint32_t xFile,
+  uint32_t xOffset,
+  uint32_t xLength,
+  int      xCheck
+)
+{
+  uint32_t errors = 0;
+  uint32_t i;
+  uint8_t  value;
+
+  for (i = 0; i < xLength; i++)
+  {
+    value = (uint8_t) (((xOffset + i) * 7) + ((xOffset + i) >> 8) + xFile);
+    if (0 == xCheck)
+    {
+      benchBuffer[i] = value;
+    }
+    else if (benchBuffer[i] != value)
+    {
+      errors++;
+    } /* if */
+  } /* for */
+
+  return errors;
+} /* benchPattern() */
+
+/*
+ * @brief               reads a number argument
+ * @param[in] xpArg     argument, NULL when missing
+ * @param[in] xDefault  value when the argument is missing
+ * @param[in] xMax      largest value
+ * @param[out] pxValue  value
+ * @return              BOARD_OK or BOARD_BAD_PARAMETER
+ */
+static BOARD_Status benchNumber
+(
+  const char* xpArg,
+  uint32_t    xDefault,
+  uint32_t    xMax,
+  uint32_t*   pxValue
+)
+{
+  char* end;
+
+  if (NULL == xpArg)
+  {
+    *pxValue = xDefault;
+    return BOARD_OK;
+  } /* if */
+
+  *pxValue = strtoul(xpArg, &end, 0);
+  if (('\0' != *end) || (0 == *pxValue) || (*pxValue > xMax))
+  {
+    printf("Bad number: %s\n", xpArg);
+    return BOARD_BAD_PARAMETER;
+  } /* if */
+
+  return BOARD_OK;
+} /* benchNumber() */
+
+/*
+ * @brief               writes the benchmark files
+ * @param[in] xFiles    number of files
+ * @param[in] xSize     size of a file
+ * @param[in] xChunk    size of a write
+ * @return              BOARD_OK or BOARD_ERROR
+ */
+static BOARD_Status benchFsWrite
+(
+  uint32_t xFiles,
+  uint32_t xSize,
+  uint32_t xChunk
+)
+{
+  char        name[SPIFFS_OBJ_NAME_LEN];
+  spiffs_file fd;
+  uint32_t    file;
+  uint32_t    offset;
+  uint32_t    length;
+  uint32_t    start;
+  s32_t       result;
+
+  benchChunk = xChunk;
+  benchBegin();
+
+  for (file = 0; file < xFiles; file++)
+  {
+    snprintf(name, sizeof(name), C_BENCH_FILE_PREFIX "%lu", (unsigned long) file);
+    SPIFFS_clearerr(&gSpiffsFs);
+    fd = SPIFFS_open(&gSpiffsFs, name, SPIFFS_CREAT | SPIFFS_TRUNC | SPIFFS_WRONLY, 0);
+    if (fd < 0)
+    {
+      printf("Could not open %s: %d\n", name, (int) fd);
+      return BOARD_ERROR;
+    } /* if */
+
+    for (offset = 0; offset < xSize; offset += length)
+    {
+      length = ((xSize - offset) < xChunk) ? (xSize - offset) : xChunk;
+      benchPattern(file, offset, length, 0);
+
+      start = boardGetCycles();
+      result = SPIFFS_write(&gSpiffsFs, fd, benchBuffer, length);
+      benchAdd(boardGetCycles() - start, (s32_t) length != result);
+
+      if ((s32_t) length != result)
+      {
+        printf("Could not write %s at %lu: %d\n", name, (unsigned long) offset, (int) result);
+        SPIFFS_close(&gSpiffsFs, fd);
+        benchReport("bench fs write", 0);
+        return BOARD_ERROR;
+      } /* if */
+    } /* for */
+
+    SPIFFS_close(&gSpiffsFs, fd);
+  } /* for */
+
+  benchReport("bench fs write", xFiles * xSize);
+  return BOARD_OK;
+} /* benchFsWrite() */
+
+/*
+ * @brief               reads the benchmark files back and checks them
+ * @param[in] xChunk    size of a read
+ * @return              BOARD_OK or BOARD_ERROR
+ */
+static BOARD_Status benchFsRead
+(
+  uint32_t xChunk
+)
+{
+  char        name[SPIFFS_OBJ_NAME_LEN];
+  spiffs_file fd;
+  spiffs_stat stat;
+  uint32_t    file;
+  uint32_t    offset;
+  uint32_t    length;
+  uint32_t    start;
+  uint32_t    bytes = 0;
+  uint32_t    errors = 0;
+  s32_t       result;
+
+  benchBegin();
+
+  for (file = 0; ; file++)
+  {
+    snprintf(name, sizeof(name), C_BENCH_FILE_PREFIX "%lu", (unsigned long) file);
+    SPIFFS_clearerr(&gSpiffsFs);
+    fd = SPIFFS_open(&gSpiffsFs, name, SPIFFS_RDONLY, 0);
+    if (fd < 0)
+    {
+      break;
+    } /* if */
+    SPIFFS_fstat(&gSpiffsFs, fd, &stat);
+
+    for (offset = 0; offset < stat.size; offset += length)
+    {
+      length = ((stat.size - offset) < xChunk) ? (stat.size - offset) : xChunk;
+
+      start = boardGetCycles();
+      result = SPIFFS_read(&gSpiffsFs, fd, benchBuffer, length);
+      benchAdd(boardGetCycles() - start, (s32_t) length != result);
+
+      if ((s32_t) length != result)
+      {
+        printf("Could not read %s at %lu: %d\n", name, (unsigned long) offset, (int) result);
+        break;
+      } /* if */
+      errors += benchPattern(file, offset, length, 1);
+      bytes += length;
+    } /* for */
+
+    SPIFFS_close(&gSpiffsFs, fd);
+  } /* for */
+
+  if (0 == file)
+  {
+    printf("No " C_BENCH_FILE_PREFIX "* file, run bench fs write first.\n");
+    return BOARD_ERROR;
+  } /* if */
+
+  benchReport("bench fs read", bytes);
+  printf("  %lu files, %lu bytes differ\n", (unsigned long) file, (unsigned long) errors);
+  return ((0 == errors) && (0 == benchLatency.failed)) ? BOARD_OK : BOARD_ERROR;
+} /* benchFsRead() */
+
+/*
+ * @brief               removes the benchmark files, then erases the blocks left
+ *                      with deleted pages only, and collects xBytes if not 0
+ * @param[in] xBytes    bytes SPIFFS_gc must free, moving pages, 0 to skip it
+ * @return              BOARD_OK or BOARD_ERROR
+ */
+static BOARD_Status benchFsGc
+(
+  uint32_t xBytes
+)
+{
+  char     name[SPIFFS_OBJ_NAME_LEN];
+  uint32_t file;
+  uint32_t start;
+  uint32_t total = 0;
+  uint32_t used = 0;
+  s32_t    result;
+
+  benchBegin();
+  for (file = 0; ; file++)
+  {
+    snprintf(name, sizeof(name), C_BENCH_FILE_PREFIX "%lu", (unsigned long) file);
+    start = boardGetCycles();
+    result = SPIFFS_remove(&gSpiffsFs, name);
+    if (SPIFFS_OK != result)
+    {
+      break;
+    } /* if */
+    benchAdd(boardGetCycles() - start, 0);
+  } /* for */
+  benchReport("bench fs remove", 0);
+
+  benchBegin();
+  do
+  {
+    start = boardGetCycles();
+    result = SPIFFS_gc_quick(&gSpiffsFs, 0);
+    benchAdd(boardGetCycles() - start, 0);
+  } while (SPIFFS_OK == result);
+  benchReport("bench fs gc quick", 0);
+
+  if (0 != xBytes)
+  {
+    benchBegin();
+    start = boardGetCycles();
+    result = SPIFFS_gc(&gSpiffsFs, xBytes);
+    benchAdd(boardGetCycles() - start, SPIFFS_OK != result);
+    benchReport("bench fs gc", 0);
+  } /* if */
+
+  SPIFFS_info(&gSpiffsFs, &total, &used);
+  printf("  file system: %lu of %lu B used\n", (unsigned long) used, (unsigned long) total);
+
+  return BOARD_OK;
+} /* benchFsGc() */
+
+/*
+ * @brief               sends datagrams to a host
+ * @param[in] xpTarget  a.b.c.d:port
+ * @param[in] xSize     size of a datagram
+ * @param[in] xCount    number of datagrams
+ * @return              BOARD_OK, BOARD_BAD_PARAMETER or BOARD_ERROR
+ */
+static BOARD_Status benchNetUdp
+(
+  const char* xpTarget,
+  uint32_t    xSize,
+  uint32_t    xCount
+)
+{
+  uint8_t          address[4];
+  unsigned int     ip[4];
+  unsigned int     port;
+  uint16_t         sent;
+  uint32_t         bytes = 0;
+  uint32_t         start;
+  uint32_t         i;
+  ES_WIFI_Status_t wifiResult;
+
+  if ((NULL == xpTarget) ||
+      (5 != sscanf(xpTarget, "%u.%u.%u.%u:%u", &ip[0], &ip[1], &ip[2], &ip[3], &port)) ||
+      (ip[0] > 255) || (ip[1] > 255) || (ip[2] > 255) || (ip[3] > 255) ||
+      (0 == port) || (port > 65535))
+  {
+    printf("Expected a.b.c.d:port\n");
+    return BOARD_BAD_PARAMETER;
+  } /* if */
+
+  for (i = 0; i < 4; i++)
+  {
+    address[i] = (uint8_t) ip[i];
+  } /* for */
+
+#ifdef C_BOARD_USE_FREE_RTOS
+  wifiResult = wifiLinkWaitUp(0);
+#else
+  wifiResult = wifiIsConnected();
+#endif
+  if (ES_WIFI_STATUS_OK != wifiResult)
+  {
+    printf("Wi-Fi is not connected.\n");
+    return BOARD_ERROR;
+  } /* if */
+
+  if ((ES_WIFI_STATUS_OK != wifiBindToUdp(C_BENCH_SOCKET, C_BENCH_UDP_PORT)) ||
+      (ES_WIFI_STATUS_OK != wifiConnectUdp(C_BENCH_SOCKET, address, (uint16_t) port)))
+  {
+    printf("Could not open socket %d.\n", C_BENCH_SOCKET);
+    wifiCloseSocket(C_BENCH_SOCKET);
+    return BOARD_ERROR;
+  } /* if */
+
+  benchBegin();
+  for (i = 0; i < xCount; i++)
+  {
+    /* Sequence number first, for the receiver to count the losses. */
+    memset(benchBuffer, (int) (i & 0xFF), xSize);
+    memcpy(benchBuffer, &i, (xSize < sizeof(i)) ? xSize : sizeof(i));
+
+    sent = 0;
+    start = boardGetCycles();
+    wifiResult = wifiSendData(C_BENCH_SOCKET, benchBuffer, (uint16_t) xSize, &sent,
+                              C_BENCH_SEND_TIMEOUT_MS);
+    benchAdd(boardGetCycles() - start, (ES_WIFI_STATUS_OK != wifiResult) || (sent != xSize));
+    bytes += sent;
+  } /* for */
+  benchReport("bench net udp", bytes);
+
+  wifiConnectUdp(C_BENCH_SOCKET, NULL, 0);
+  wifiCloseSocket(C_BENCH_SOCKET);
+
+  return (0 == benchLatency.failed) ? BOARD_OK : BOARD_ERROR;
+} /* benchNetUdp() */
+
+/*
+ * @brief   prints the counters of the block pools and of the heap
+ * @return  BOARD_OK
+ */
+static BOARD_Status benchMem
+(
+  void
+)
+{
+  POOL_Stats stats;
+  uint32_t   i;
+
+  for (i = 0; BOARD_OK == poolGetStats(i, &stats); i++)
+  {
+    printf("pool %lu B: %lu of %lu used, max %lu, %lu allocs, %lu fallbacks\n",
+           (unsigned long) stats.size, (unsigned long) stats.used, (unsigned long) stats.blocks,
+           (unsigned long) stats.maxUsed, (unsigned long) stats.allocs,
+           (unsigned long) stats.fallbacks);
+  } /* for */
+
+#ifdef C_BOARD_USE_FREE_RTOS
+  printf("heap: %lu B free, %lu B at least\n", (unsigned long) xPortGetFreeHeapSize(),
+         (unsigned long) xPortGetMinimumEverFreeHeapSize());
+#endif
+
+  return BOARD_OK;
+} /* benchMem() */
+
+/*
+ * @brief               share of a time window, in tenths of a percent
+ * @param[in] xCycles   cycles
+ * @param[in] xWindow   cycles of the window
+ * @return              permille
+ */
+static uint32_t benchPermille
+(
+  uint64_t xCycles,
+  uint64_t xWindow
+)
+{
+  return (0 == xWindow) ? 0 : (uint32_t) ((xCycles * 1000) / xWindow);
+} /* benchPermille() */
+
+/*
+ * @brief   prints the CPU time of the tasks and interrupts since the last call,
+ *          and starts a new window
+ * @return  BOARD_OK
+ */
+static BOARD_Status benchCpu
+(
+  void
+)
+{
+  static const char* const irqNames[RTSTATS_IRQ_COUNT] = { "SPI3", "EXTI", "QUADSPI", "USART1" };
+  RTSTATS_Total total;
+  RTSTATS_Task  task;
+  RTSTATS_Irq   irq;
+  const char*   name;
+  uint32_t      permille;
+  uint32_t      i;
+
+  rtstatsGetTotal(&total);
+  printf("window %lu ms, %lu switches, worst ready latency %lu us\n",
+         (unsigned long) (total.window / (SystemCoreClock / 1000)),
+         (unsigned long) total.switches, (unsigned long) boardCyclesToUs(total.maxReadyCycles));
+
+  for (i = 0; i < C_RTSTATS_TASKS; i++)
+  {
+    if (0 == rtstatsGetTask(i, &task))
+    {
+      continue;
+    } /* if */
+#ifdef C_BOARD_USE_FREE_RTOS
+    name = (0 == i) ? "(others)" : pcTaskGetName((TaskHandle_t) task.task);
+#else
+    name = "?";
+#endif
+    permille = benchPermille(task.cycles, total.window);
+    printf("  %-16s %3lu.%lu %%  %8lu switches  ready max %lu us\n", name,
+           (unsigned long) (permille / 10), (unsigned long) (permille % 10),
+           (unsigned long) task.switches, (unsigned long) boardCyclesToUs(task.maxReadyCycles));
+  } /* for */
+
+  for (i = 0; i < RTSTATS_IRQ_COUNT; i++)
+  {
+    rtstatsGetIrq((RTSTATS_IrqId) i, &irq);
+    permille = benchPermille(irq.cycles, total.window);
+    printf("  irq %-12s %3lu.%lu %%  %8lu calls     max %lu us\n", irqNames[i],
+           (unsigned long) (permille / 10), (unsigned long) (permille % 10),
+           (unsigned long) irq.count, (unsigned long) boardCyclesToUs(irq.maxCycles));
+  } /* for */
+
+  permille = benchPermille(total.irqCycles, total.window);
+  printf("  interrupts       %3lu.%lu %%\n", (unsigned long) (permille / 10),
+         (unsigned long) (permille % 10));
+
+  permille = benchPermille(total.sleepCycles, total.window);
+  printf("  asleep           %3lu.%lu %%  (in the idle task)\n", (unsigned long) (permille / 10),
+         (unsigned long) (permille % 10));
+
+  rtstatsReset();
+  return BOARD_OK;
+} /* benchCpu() */
+
+/*
+ * @brief   prints the end of each boot step reached, from the start of the cycle
+ *          counter
+ * @return  BOARD_OK
+ */
+static BOARD_Status benchBoot
+(
+  void
+)
+{
+  static const char* const stepNames[BOOTTIME_COUNT] =
+  {
+    "board", "scheduler", "mount", "list", "log", "wifi", "first write", "network"
+  };
+  uint64_t cycles;
+  uint32_t us;
+  uint32_t i;
+
+  for (i = 0; i < BOOTTIME_COUNT; i++)
+  {
+    if (0 == boottimeGet((BOOTTIME_Step) i, &cycles))
+    {
+      printf("  %-12s          -\n", stepNames[i]);
+      continue;
+    } /* if */
+    us = (uint32_t) (cycles / (SystemCoreClock / 1000000));
+    printf("  %-12s %6lu.%03lu ms\n", stepNames[i], (unsigned long) (us / 1000),
+           (unsigned long) (us % 1000));
+  } /* for */
+
+  printf("time to first write: ");
+  if (0 != boottimeGet(BOOTTIME_FIRST_WRITE, &cycles))
+  {
+    printf("%lu ms", (unsigned long) (cycles / (SystemCoreClock / 1000)));
+  }
+  else
+  {
+    printf("-");
+  } /* if */
+  printf(", time to network ready: ");
+  if (0 != boottimeGet(BOOTTIME_NETWORK, &cycles))
+  {
+    printf("%lu ms\n", (unsigned long) (cycles / (SystemCoreClock / 1000)));
+  }
+  else
+  {
+    printf("-\n");
+  } /* if */
+
+  return BOARD_OK;
+} /* benchBoot() */
+
+/*
+ * @brief                runs a benchmark typed on the console
+ * @param[in] xpLine     command line, starting with "bench"
+ * @return               BOARD_OK, BOARD_BAD_PARAMETER or BOARD_ERROR
+ */
+BOARD_Status benchCommand
+(
+  const char* xpLine
+)
+{
+  char         line[C_BENCH_MAX_ARGS * 16];
+  char*        argv[C_BENCH_MAX_ARGS + 1] = { NULL };
+  char*        save = NULL;
+  uint32_t     argc = 0;
+  uint32_t     a;
+  uint32_t     b;
+  uint32_t     c;
+  BOARD_Status status = BOARD_BAD_PARAMETER;
+
+  strncpy(line, xpLine, sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\0';
+  for (argv[0] = strtok_r(line, " ", &save);
+       (NULL != argv[argc]) && (argc < C_BENCH_MAX_ARGS);
+       argv[argc] = strtok_r(NULL, " ", &save))
+  {
+    argc++;
+  } /* for */
+
+  if ((2 == argc) && (0 == strcmp(argv[1], "mem")))
+  {
+    return benchMem();
+  } /* if */
+
+  if ((2 == argc) && (0 == strcmp(argv[1], "cpu")))
+  {
+    return benchCpu();
+  } /* if */
+
+  if ((2 == argc) && (0 == strcmp(argv[1], "boot")))
+  {
+    return benchBoot();
+  } /* if */
+
+  benchBuffer = poolAlloc(C_BENCH_BUFFER_SIZE);
+  if (NULL == benchBuffer)
+  {
+    printf("No memory for the benchmark.\n");
+    return BOARD_ERROR;
+  } /* if */
+
+  if ((3 <= argc) && (0 == strcmp(argv[1], "fs")) && (0 == strcmp(argv[2], "write")))
+  {
+    if ((BOARD_OK == benchNumber(argv[3], C_BENCH_FILES, 100, &a)) &&
+        (BOARD_OK == benchNumber(argv[4], C_BENCH_FILE_SIZE, 0x100000, &b)) &&
+        (BOARD_OK == benchNumber(argv[5], C_BENCH_CHUNK_SIZE, C_BENCH_BUFFER_SIZE, &c)))
+    {
+      status = benchFsWrite(a, b, c);
+    } /* if */
+  }
+  else if ((3 <= argc) && (0 == strcmp(argv[1], "fs")) && (0 == strcmp(argv[2], "read")))
+  {
+    if (BOARD_OK == benchNumber(argv[3], benchChunk, C_BENCH_BUFFER_SIZE, &a))
+    {
+      status = benchFsRead(a);
+    } /* if */
+  }
+  else if ((3 <= argc) && (0 == strcmp(argv[1], "fs")) && (0 == strcmp(argv[2], "gc")))
+  {
+    a = 0;
+    if ((NULL == argv[3]) || (BOARD_OK == benchNumber(argv[3], 0, 0x1000000, &a)))
+    {
+      status = benchFsGc(a);
+    } /* if */
+  }
+  else if ((4 <= argc) && (0 == strcmp(argv[1], "net")) && (0 == strcmp(argv[2], "udp")))
+  {
+    if ((BOARD_OK == benchNumber(argv[4], C_BENCH_UDP_SIZE, C_BENCH_BUFFER_SIZE, &a)) &&
+        (BOARD_OK == benchNumber(argv[5], C_BENCH_UDP_COUNT, 100000, &b)))
+    {
+      status = benchNetUdp(argv[3], a, b);
+    } /* if */
+  }
+  else
+  {
+    printf("bench fs write [files] [size] [chunk]\n"
+           "bench fs read [chunk]\n"
+           "bench fs gc [bytes]\n"
+           "bench net udp <a.b.c.d:port> [size] [count]\n"
+           "bench mem\n"
+           "bench cpu\n"
+           "bench boot\n");
+  } /* if */
+
+  poolFree(benchBuffer);
+  benchBuffer = NULL;
+
+  return status;
+} /* benchCommand() */
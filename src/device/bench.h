@@ -0,0 +1,29 @@
+#ifndef DEVICE_BENCH_H_
+#define DEVICE_BENCH_H_
+
+#include <stdint.h>
+
+#include "board.h"
+
+/**
+ * @brief                runs a benchmark typed on the console and prints its report:
+ *                       throughput, latency percentiles of the operations (DWT cycle
+ *                       counter) and the QSPI flash operations they caused.
+ *                         bench fs write [files] [size] [chunk]  writes bench.<n> files
+ *                         bench fs read [chunk]                  reads them back, checks them
+ *                         bench fs gc [bytes]                    removes them, then collects
+ *                         bench net udp <a.b.c.d:port> [size] [count]
+ *                         bench mem                              block pools and heap
+ *                         bench cpu                              CPU time of the tasks and
+ *                                                                interrupts since the last one
+ *                         bench boot                             end of the boot steps
+ * @param[in] xpLine     command line, starting with "bench"
+ * @return               BOARD_OK, BOARD_BAD_PARAMETER on a wrong command line,
+ *                       BOARD_ERROR when the benchmark failed
+ */
+BOARD_Status benchCommand
+(
+  const char* xpLine
+);
+
+#endif /* DEVICE_BENCH_H_ */
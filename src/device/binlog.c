@@ -0,0 +1,401 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef C_BOARD_USE_FREE_RTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
+
+#include "stm32l4xx_hal.h"
+#include "board.h"
+#include "binlog.h"
+#include "logstore.h"
+
+#define C_BINLOG_RING_WORDS 1024 //!< Size of the log ring in words, power of two.
+
+#define C_BINLOG_RECORD_WORDS (2 + (C_BINLOG_MAX_ARGS * (1 + (C_BINLOG_STRING_MAX / 4))))
+                                 //!< Longest record, in words.
+
+#define C_BINLOG_CHUNK_SIZE (C_BINLOG_RECORD_WORDS * 4) //!< Bytes sent to the sink at once.
+
+#define C_BINLOG_LINE_SIZE 48 //!< Bytes of records per console line, 64 base64 characters.
+
+#define C_BINLOG_FLUSH_MS 1000 //!< Longest time a record waits in the ring once the log
+                               //   task is started.
+
+#define C_BINLOG_TASK_STACK 512 //!< Stack of the log task, in words.
+
+#define C_BINLOG_TASK_PRIORITY (tskIDLE_PRIORITY + 1) //!< Priority of the log task.
+
+#ifndef C_BINLOG_ROM_START
+#define C_BINLOG_ROM_START FLASH_BASE //!< Strings in flash are logged by address.
+#endif
+
+#ifndef C_BINLOG_ROM_END
+#define C_BINLOG_ROM_END FLASH_END //!< Last address of the flash.
+#endif
+
+static uint32_t binlogRing[C_BINLOG_RING_WORDS]; //!< Records not sent yet.
+
+static volatile uint32_t binlogHead = 0; //!< Words written to the ring. Runs free.
+
+static volatile uint32_t binlogTail = 0; //!< Words read from the ring. Runs free.
+
+static BINLOG_Stats binlogStats; //!< Counters of the binary log.
+
+static uint32_t binlogDroppedRead = 0; //!< Value of binlogStats.dropped in the last notice.
+
+static const char binlogDroppedFormat[] = "binlog: %u records dropped\n";
+//!< Format of the record telling that records were dropped.
+
+#ifdef C_BOARD_USE_FREE_RTOS
+static TaskHandle_t binlogTask = NULL; //!< Log task, NULL until binlogStart.
+
+static BINLOG_Sink binlogSink = BINLOG_SINK_CONSOLE; //!< Where the log task sends the records.
+
+static uint8_t binlogBuffer[C_BINLOG_CHUNK_SIZE]; //!< Records read by the log task.
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static StaticTask_t binlogTaskBuffer; //!< Control block of the log task.
+
+static StackType_t binlogTaskStack[C_BINLOG_TASK_STACK]; //!< Stack of the log task.
+#endif
+#endif
+
+/*
+ * @brief               copies words between the ring and a linear buffer
+ * @param[in,out] pxLinear  linear buffer
+ * @param[in] xWords    number of words
+ * @param[in] xOffset   position in the ring
+ * @param[in] xToRing   1 to write the ring, 0 to read it
+ * @return              none
+ */
+static void binlogCopy
+(
+  uint32_t* pxLinear,
+  uint32_t  xWords,
+  uint32_t  xOffset,
+  int       xToRing
+)
+{
+  uint32_t first = C_BINLOG_RING_WORDS - xOffset;
+
+  if (first > xWords)
+  {
+    first = xWords;
+  } /* if */
+
+  if (0 != xToRing)
+  {
+    memcpy(&binlogRing[xOffset], pxLinear, first * 4);
+    memcpy(binlogRing, &pxLinear[first], (xWords - first) * 4);
+  }
+  else
+  {
+    memcpy(pxLinear, &binlogRing[xOffset], first * 4);
+    memcpy(&pxLinear[first], binlogRing, (xWords - first) * 4);
+  } /* if */
+} /* binlogCopy() */
+
+void binlogRecord
+(
+  const char* xpFormat,
+  uint32_t    xStrings,
+  uint32_t    xCount,
+  ...
+)
+{
+  uint32_t    record[C_BINLOG_RECORD_WORDS + 1];
+  uint32_t    words = 2;
+  uint32_t    length;
+  uint32_t    fill;
+  uint32_t    primask;
+  uint32_t    i;
+  const char* string;
+  va_list     args;
+
+#ifdef C_BOARD_USE_FREE_RTOS
+  /* What the log task does to write a file would log again, without end. */
+  if ((NULL != binlogTask) && (0 == __get_IPSR()) && (binlogTask == xTaskGetCurrentTaskHandle()))
+  {
+    return;
+  } /* if */
+#endif
+
+  if (xCount > C_BINLOG_MAX_ARGS)
+  {
+    xCount = C_BINLOG_MAX_ARGS;
+  } /* if */
+
+  va_start(args, xCount);
+  for (i = 0; i < xCount; i++)
+  {
+    if (0 == (xStrings & (1u << i)))
+    {
+      record[words++] = va_arg(args, uint32_t);
+      continue;
+    } /* if */
+
+    string = va_arg(args, const char*);
+    if (((uintptr_t) string >= C_BINLOG_ROM_START) && ((uintptr_t) string <= C_BINLOG_ROM_END))
+    {
+      /* The decoder reads it from the ELF file, like the format. */
+      record[words++] = (uint32_t) (uintptr_t) string;
+      continue;
+    } /* if */
+
+    length = (NULL == string) ? 0 : strnlen(string, C_BINLOG_STRING_MAX);
+    record[words++] = C_BINLOG_INLINE | length;
+    record[words + (length / 4)] = 0;
+    memcpy(&record[words], string, length);
+    words += (length + 3) / 4;
+  } /* for */
+  va_end(args);
+
+  record[0] = (uint32_t) (uintptr_t) xpFormat;
+  record[1] = (words << 24) | (boardGetTick() & 0x00FFFFFF);
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+
+  fill = binlogHead - binlogTail;
+  if ((C_BINLOG_RING_WORDS - fill) < words)
+  {
+    binlogStats.dropped++;
+    __set_PRIMASK(primask);
+    return;
+  } /* if */
+
+  binlogCopy(record, words, binlogHead & (C_BINLOG_RING_WORDS - 1), 1);
+  binlogHead += words;
+  binlogStats.records++;
+
+  __set_PRIMASK(primask);
+
+#ifdef C_BOARD_USE_FREE_RTOS
+  /* Wake the log task on the first record, it waits for more, and when half full. */
+  if ((NULL != binlogTask) &&
+      ((0 == fill) ||
+       ((fill < (C_BINLOG_RING_WORDS / 2)) && ((fill + words) >= (C_BINLOG_RING_WORDS / 2)))))
+  {
+    if (0 != __get_IPSR())
+    {
+      BaseType_t woken = pdFALSE;
+
+      vTaskNotifyGiveFromISR(binlogTask, &woken);
+      portYIELD_FROM_ISR(woken);
+    }
+    else
+    {
+      xTaskNotifyGive(binlogTask);
+    } /* if */
+  } /* if */
+#endif
+} /* binlogRecord() */
+
+uint32_t binlogRead
+(
+  uint8_t* pxBuffer,
+  uint32_t xSize
+)
+{
+  uint32_t done = 0;
+  uint32_t words;
+  uint32_t dropped;
+  uint32_t notice[3];
+
+  while (binlogTail != binlogHead)
+  {
+    words = binlogRing[(binlogTail + 1) & (C_BINLOG_RING_WORDS - 1)] >> 24;
+    if ((done + (words * 4)) > xSize)
+    {
+      break;
+    } /* if */
+
+    binlogCopy((uint32_t*) &pxBuffer[done], words, binlogTail & (C_BINLOG_RING_WORDS - 1), 0);
+    done += words * 4;
+    binlogTail += words;
+  } /* while */
+
+  /* After the records stored before the drops. */
+  dropped = binlogStats.dropped;
+  if ((dropped != binlogDroppedRead) && ((done + sizeof(notice)) <= xSize))
+  {
+    notice[0] = (uint32_t) (uintptr_t) binlogDroppedFormat;
+    notice[1] = (3 << 24) | (boardGetTick() & 0x00FFFFFF);
+    notice[2] = dropped - binlogDroppedRead;
+    memcpy(&pxBuffer[done], notice, sizeof(notice));
+    done += sizeof(notice);
+    binlogDroppedRead = dropped;
+  } /* if */
+
+  return done;
+} /* binlogRead() */
+
+#ifdef C_BOARD_USE_FREE_RTOS
+/*
+ * @brief               sends records on the console, as lines "#BL:" and base64
+ * @param[in] pxData    records
+ * @param[in] xLength   length of the records
+ * @return              none
+ */
+static void binlogSendConsole
+(
+  const uint8_t* pxData,
+  uint32_t       xLength
+)
+{
+  static const char alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  char     line[4 + ((C_BINLOG_LINE_SIZE / 3) * 4) + 2];
+  uint32_t length;
+  uint32_t value;
+  uint32_t i;
+  uint32_t n;
+
+  while (0 < xLength)
+  {
+    length = (xLength < C_BINLOG_LINE_SIZE) ? xLength : C_BINLOG_LINE_SIZE;
+    memcpy(line, "#BL:", 4);
+    n = 4;
+
+    /* Records are whole words: no padding needed beyond the last group. */
+    for (i = 0; i < length; i += 3)
+    {
+      value = (uint32_t) pxData[i] << 16;
+      if ((i + 1) < length)
+      {
+        value |= (uint32_t) pxData[i + 1] << 8;
+      } /* if */
+      if ((i + 2) < length)
+      {
+        value |= pxData[i + 2];
+      } /* if */
+
+      line[n++] = alphabet[(value >> 18) & 0x3F];
+      line[n++] = alphabet[(value >> 12) & 0x3F];
+      line[n++] = ((i + 1) < length) ? alphabet[(value >> 6) & 0x3F] : '=';
+      line[n++] = ((i + 2) < length) ? alphabet[value & 0x3F] : '=';
+    } /* for */
+
+    line[n++] = '\r';
+    line[n++] = '\n';
+    boardWrite(line, n);
+
+    pxData += length;
+    xLength -= length;
+  } /* while */
+} /* binlogSendConsole() */
+
+/*
+ * @brief                  log task: sleeps until a record is stored, gives the others
+ *                         C_BINLOG_FLUSH_MS to come, and sends them all to the sink.
+ *                         Also wakes up when the log store must write its buffer.
+ * @param[in] pParameters  Unused parameter list for the task
+ * @return                 none.
+ */
+static void binlogTaskFunction
+(
+  void* pParameters
+)
+{
+  TickType_t wait;
+  uint32_t   flushIn;
+  uint32_t   length;
+
+  (void) pParameters;
+
+  for (;;)
+  {
+    if (binlogTail == binlogHead)
+    {
+      wait = portMAX_DELAY;
+      flushIn = (BINLOG_SINK_FILE == binlogSink) ? logstoreFlushIn() : C_LOGSTORE_IDLE;
+      if (C_LOGSTORE_IDLE != flushIn)
+      {
+        wait = pdMS_TO_TICKS(flushIn);
+      } /* if */
+      ulTaskNotifyTake(pdTRUE, wait);
+    } /* if */
+
+    if (binlogTail != binlogHead)
+    {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(C_BINLOG_FLUSH_MS));
+    } /* if */
+
+    for (;;)
+    {
+      length = binlogRead(binlogBuffer, sizeof(binlogBuffer));
+      if (0 == length)
+      {
+        break;
+      } /* if */
+
+      if (BINLOG_SINK_FILE == binlogSink)
+      {
+        logstoreWrite(binlogBuffer, length);
+      }
+      else
+      {
+        binlogSendConsole(binlogBuffer, length);
+      } /* if */
+      binlogStats.bytes += length;
+    } /* for */
+
+    if ((BINLOG_SINK_FILE == binlogSink) && (0 == logstoreFlushIn()))
+    {
+      logstoreFlush();
+    } /* if */
+  } /* for */
+} /* binlogTaskFunction() */
+#endif
+
+BOARD_Status binlogStart
+(
+  BINLOG_Sink xSink,
+  const char* xpPath
+)
+{
+#ifdef C_BOARD_USE_FREE_RTOS
+  if (NULL != binlogTask)
+  {
+    return BOARD_ERROR;
+  } /* if */
+
+  if ((BINLOG_SINK_FILE == xSink) && (BOARD_OK != logstoreOpen(xpPath)))
+  {
+    return BOARD_ERROR;
+  } /* if */
+  binlogSink = xSink;
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  binlogTask = xTaskCreateStatic(binlogTaskFunction, "Log", C_BINLOG_TASK_STACK,
+      NULL /* parameters */, C_BINLOG_TASK_PRIORITY, binlogTaskStack, &binlogTaskBuffer);
+  if (NULL == binlogTask)
+  {
+    return BOARD_ERROR;
+  } /* if */
+#else
+  if (pdPASS != xTaskCreate(binlogTaskFunction, "Log", C_BINLOG_TASK_STACK,
+      NULL /* parameters */, C_BINLOG_TASK_PRIORITY, &binlogTask))
+  {
+    return BOARD_ERROR;
+  } /* if */
+#endif
+
+  return BOARD_OK;
+#else
+  (void) xSink;
+  (void) xpPath;
+  return BOARD_ERROR;
+#endif
+} /* binlogStart() */
+
+void binlogGetStats
+(
+  BINLOG_Stats* pxStats
+)
+{
+  *pxStats = binlogStats;
+} /* binlogGetStats() */
@@ -0,0 +1,133 @@
+#ifndef DEVICE_BINLOG_H_
+#define DEVICE_BINLOG_H_
+
+#include <stdint.h>
+
+#include "board.h"
+
+/*
+ * Binary log: a record holds the address of its format string, a timestamp and
+ * the raw arguments. Nothing is formatted on the board; tools/binlog_decode.py
+ * reads the format strings from the ELF file and prints the text.
+ *
+ * Record, in 32-bit words:
+ *   0       address of the format string
+ *   1       length of the record in words (bits 31..24), tick in ms (bits 23..0)
+ *   2..     one word per argument. A string argument is its address when it is
+ *           in flash, otherwise C_BINLOG_INLINE | length followed by the
+ *           characters, padded to a word.
+ */
+
+#define C_BINLOG_MAX_ARGS   12         //!< Most arguments of a record.
+#define C_BINLOG_STRING_MAX 32         //!< Longest string copied in a record.
+#define C_BINLOG_INLINE     0xFFFF0000 //!< Marks a string copied in the record.
+
+/**
+ * @brief  Where the records are sent by the log task
+ */
+typedef enum
+{
+  BINLOG_SINK_CONSOLE = 0x00U, /**< console lines "#BL:" followed by base64 */
+  BINLOG_SINK_FILE    = 0x01U  /**< SPIFFS log store (logstore.h), rotating files */
+} BINLOG_Sink;
+
+/**
+ * @brief  Counters of the binary log
+ */
+typedef struct
+{
+  uint32_t records; /**< records stored */
+  uint32_t dropped; /**< records dropped, the ring was full */
+  uint32_t bytes;   /**< bytes sent to the sink */
+} BINLOG_Stats;
+
+/* 1 for the arguments that are strings, copied or referenced instead of cast. */
+#define M_BINLOG_IS_STR(x) _Generic((x), char*: 1u, const char*: 1u, \
+  unsigned char*: 1u, const unsigned char*: 1u, default: 0u)
+
+#define M_BINLOG_S0(...) 0u
+#define M_BINLOG_S1(a) M_BINLOG_IS_STR(a)
+#define M_BINLOG_S2(a, ...) (M_BINLOG_IS_STR(a) | (M_BINLOG_S1(__VA_ARGS__) << 1))
+#define M_BINLOG_S3(a, ...) (M_BINLOG_IS_STR(a) | (M_BINLOG_S2(__VA_ARGS__) << 1))
+#define M_BINLOG_S4(a, ...) (M_BINLOG_IS_STR(a) | (M_BINLOG_S3(__VA_ARGS__) << 1))
+#define M_BINLOG_S5(a, ...) (M_BINLOG_IS_STR(a) | (M_BINLOG_S4(__VA_ARGS__) << 1))
+#define M_BINLOG_S6(a, ...) (M_BINLOG_IS_STR(a) | (M_BINLOG_S5(__VA_ARGS__) << 1))
+#define M_BINLOG_S7(a, ...) (M_BINLOG_IS_STR(a) | (M_BINLOG_S6(__VA_ARGS__) << 1))
+#define M_BINLOG_S8(a, ...) (M_BINLOG_IS_STR(a) | (M_BINLOG_S7(__VA_ARGS__) << 1))
+#define M_BINLOG_S9(a, ...) (M_BINLOG_IS_STR(a) | (M_BINLOG_S8(__VA_ARGS__) << 1))
+#define M_BINLOG_S10(a, ...) (M_BINLOG_IS_STR(a) | (M_BINLOG_S9(__VA_ARGS__) << 1))
+#define M_BINLOG_S11(a, ...) (M_BINLOG_IS_STR(a) | (M_BINLOG_S10(__VA_ARGS__) << 1))
+#define M_BINLOG_S12(a, ...) (M_BINLOG_IS_STR(a) | (M_BINLOG_S11(__VA_ARGS__) << 1))
+
+#define M_BINLOG_NTH(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, N, ...) N
+
+/* Number of arguments, and the mask of the string arguments, of a call. */
+#define M_BINLOG_COUNT(...) M_BINLOG_NTH(_, ## __VA_ARGS__, \
+  12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define M_BINLOG_STRINGS(...) M_BINLOG_NTH(_, ## __VA_ARGS__, \
+  M_BINLOG_S12, M_BINLOG_S11, M_BINLOG_S10, M_BINLOG_S9, M_BINLOG_S8, M_BINLOG_S7, \
+  M_BINLOG_S6, M_BINLOG_S5, M_BINLOG_S4, M_BINLOG_S3, M_BINLOG_S2, M_BINLOG_S1, \
+  M_BINLOG_S0)(__VA_ARGS__)
+
+/*
+ * @brief Logs a printf-like message as a binary record. The format must be a
+ *        string literal; the arguments are 32-bit integers, pointers or strings.
+ */
+#define M_BINLOG(xpFormat, ...) \
+  binlogRecord(xpFormat, M_BINLOG_STRINGS(__VA_ARGS__), M_BINLOG_COUNT(__VA_ARGS__), \
+               ## __VA_ARGS__)
+
+/**
+ * @brief                stores a record in the log ring. Called through M_BINLOG.
+ *                       Can be called from interrupts. The record is dropped when
+ *                       the ring is full.
+ * @param[in] xpFormat   format string, in flash
+ * @param[in] xStrings   bit i set when the argument i is a string
+ * @param[in] xCount     number of arguments
+ * @return               none
+ */
+void binlogRecord
+(
+  const char* xpFormat,
+  uint32_t    xStrings,
+  uint32_t    xCount,
+  ...
+);
+
+/**
+ * @brief                copies whole records out of the ring
+ * @param[out] pxBuffer  destination
+ * @param[in] xSize      size of the destination, at least 4 * (2 + C_BINLOG_MAX_ARGS * 9)
+ * @return               number of bytes copied
+ */
+uint32_t binlogRead
+(
+  uint8_t* pxBuffer,
+  uint32_t xSize
+);
+
+/**
+ * @brief               starts the log task, which sends the records to the sink
+ *                      every C_BINLOG_FLUSH_MS, or sooner when the ring fills up.
+ *                      Records stored before are kept.
+ * @param[in] xSink     where to send the records
+ * @param[in] xpPath    prefix of the log store segments for BINLOG_SINK_FILE
+ * @return              BOARD_OK or BOARD_ERROR
+ */
+BOARD_Status binlogStart
+(
+  BINLOG_Sink xSink,
+  const char* xpPath
+);
+
+/**
+ * @brief               gets the counters of the binary log
+ * @param[out] pxStats  counters
+ * @return              none
+ */
+void binlogGetStats
+(
+  BINLOG_Stats* pxStats
+);
+
+#endif /* DEVICE_BINLOG_H_ */
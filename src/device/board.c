@@ -3,12 +3,84 @@
 
 #include "FreeRTOS.h"
 #include "task.h"
+#ifdef C_BOARD_USE_FREE_RTOS
+#include "semphr.h"
+#include "queue.h"
+#include "timers.h"
+#endif
 
 #include "stm32l4xx_hal.h"
 #include "board.h"
+#include "console.h"
+#include "rtstats.h"
+
+#define C_BOARD_UART_TX_DROP      0 //!< Overflow policy: drop what does not fit in the ring.
+#define C_BOARD_UART_TX_BLOCK     1 //!< Overflow policy: wait for room, up to
+                                    //   C_BOARD_UART_TX_BLOCK_MS, then drop.
+#define C_BOARD_UART_TX_OVERWRITE 2 //!< Overflow policy: discard the bytes waiting for the DMA,
+                                    //   the newest output is kept.
+
+#ifndef C_BOARD_UART_TX_POLICY
+#define C_BOARD_UART_TX_POLICY C_BOARD_UART_TX_BLOCK //!< Overflow policy of the console.
+#endif
+
+#define C_BOARD_UART_TX_RING_SIZE 2048 //!< Size of the console TX ring, power of two.
+
+#define C_BOARD_UART_TX_BLOCK_MS 100 //!< Longest wait for room in the ring, as the
+                                     //   timeout of the former HAL_UART_Transmit.
+
+#define C_BOARD_UART_IRQ_PRIORITY 7 //!< Priority of the console DMA interrupt. Must not be above
+                                    //   configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY.
 
 static UART_HandleTypeDef hUart1; //!< UART HAL Structure */
 
+static DMA_HandleTypeDef hDmaUart1Tx; //!< DMA1 channel 4, USART1 TX. Driven without hUart1:
+                                      //   a blocking receive holds the UART handle lock.
+
+static uint8_t uartTxRing[C_BOARD_UART_TX_RING_SIZE]; //!< Console output not sent yet.
+
+static volatile uint32_t uartTxHead = 0; //!< Bytes written to the ring. Runs free.
+
+static volatile uint32_t uartTxTail = 0; //!< Bytes sent by the DMA. Runs free.
+
+static volatile uint32_t uartTxLength = 0; //!< Length of the DMA transfer in progress, 0 if idle.
+
+static BOARD_UartStats uartTxStats; //!< Counters of the console TX ring.
+
+#ifdef C_BOARD_USE_FREE_RTOS
+static SemaphoreHandle_t uartTxSpace = NULL; //!< Given at the end of each DMA transfer, for the
+                                             //   writers waiting for room.
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static StaticSemaphore_t uartTxSpaceBuffer; //!< Storage of uartTxSpace.
+#endif
+
+#define C_BOARD_UART_RX_RING_SIZE 64 //!< Size of the console RX ring, power of two.
+
+#define C_BOARD_CONSOLE_QUEUE_LENGTH 4 //!< Command lines waiting for the reader.
+
+static uint8_t uartRxRing[C_BOARD_UART_RX_RING_SIZE]; //!< Characters received, not assembled yet.
+
+static volatile uint32_t uartRxHead = 0; //!< Written by the USART1 interrupt. Runs free.
+
+static volatile uint32_t uartRxTail = 0; //!< Read by the line assembler. Runs free.
+
+static volatile uint8_t uartRxPending = 0; //!< The line assembler is queued on the timer task.
+
+static CONSOLE_Line consoleLine; //!< Command line being typed.
+
+static QueueHandle_t consoleLines = NULL; //!< Complete command lines, C_CONSOLE_LINE_SIZE each.
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static StaticQueue_t consoleLinesBuffer; //!< Storage of consoleLines.
+
+static uint8_t consoleLinesStorage[C_BOARD_CONSOLE_QUEUE_LENGTH * C_CONSOLE_LINE_SIZE];
+//!< Items of consoleLines.
+#endif
+
+static BOARD_ConsoleStats consoleStats; //!< Counters of the console input.
+#endif
+
 
 /*
  * @brief              Initialize system clocks and GPIO clocks
@@ -150,9 +222,9 @@ static void initGpio
   gpio_init.Speed     = GPIO_SPEED_FREQ_LOW;
   HAL_GPIO_Init(GPIOB, &gpio_init );
 
-  /* configure Data ready pin PE1*/
+  /* configure Data ready pin PE1, the falling edge ends DMA receives */
   gpio_init.Pin       = GPIO_PIN_1;
-  gpio_init.Mode      = GPIO_MODE_IT_RISING;
+  gpio_init.Mode      = GPIO_MODE_IT_RISING_FALLING;
   gpio_init.Pull      = GPIO_NOPULL;
   gpio_init.Speed     = GPIO_SPEED_FREQ_LOW;
   HAL_GPIO_Init(GPIOE, &gpio_init );
@@ -216,6 +288,136 @@ static void initIrq
 
 } /* initIRQ() */
 
+/*
+ * @brief              Starts the DWT cycle counter, read by boardGetCycles.
+ * @return             none.
+ */
+static void initCycleCounter
+(
+  void
+)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+} /* initCycleCounter() */
+
+/*
+ * @brief              Starts the DMA on the next bytes of the ring, unless a transfer is in
+ *                     progress. Called with the interrupts disabled.
+ * @return             none.
+ */
+static void uartTxStart
+(
+  void
+)
+{
+  uint32_t offset = uartTxTail & (C_BOARD_UART_TX_RING_SIZE - 1);
+  uint32_t length = uartTxHead - uartTxTail;
+
+  if ((0 != uartTxLength) || (0 == length))
+  {
+    return;
+  } /* if */
+
+  /* Up to the end of the ring, the rest goes with the next transfer. */
+  if (length > (C_BOARD_UART_TX_RING_SIZE - offset))
+  {
+    length = C_BOARD_UART_TX_RING_SIZE - offset;
+  } /* if */
+
+  uartTxLength = length;
+  HAL_DMA_Start_IT(&hDmaUart1Tx, (uint32_t) &uartTxRing[offset], (uint32_t) &USART1->TDR, length);
+} /* uartTxStart() */
+
+/*
+ * @brief              Called by the HAL at the end of a DMA transfer: frees its bytes and
+ *                     sends the next ones.
+ * @param[in] hdma     DMA handle.
+ * @return             none.
+ */
+static void uartTxDone
+(
+  DMA_HandleTypeDef* hdma
+)
+{
+  (void) hdma;
+
+  uartTxTail += uartTxLength;
+  uartTxLength = 0;
+  uartTxStart();
+
+#ifdef C_BOARD_USE_FREE_RTOS
+  if ((0 != __get_IPSR()) && (taskSCHEDULER_RUNNING == xTaskGetSchedulerState()))
+  {
+    BaseType_t woken = pdFALSE;
+
+    xSemaphoreGiveFromISR(uartTxSpace, &woken);
+    portYIELD_FROM_ISR(woken);
+  } /* if */
+#endif
+} /* uartTxDone() */
+
+/*
+ * @brief              Serves the DMA interrupt in place, when it cannot be taken: the kernel
+ *                     masks it until the scheduler starts, or the caller masked it.
+ * @return             none.
+ */
+static void uartTxPoll
+(
+  void
+)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  HAL_DMA_IRQHandler(&hDmaUart1Tx);
+  __set_PRIMASK(primask);
+} /* uartTxPoll() */
+
+/*
+ * @brief              Waits for the DMA to free room in the ring.
+ * @param[in] xStart   tick of the first wait of the write.
+ * @return             1 when some room may be free, 0 to drop the rest of the write.
+ */
+static int uartTxWait
+(
+  uint32_t xStart
+)
+{
+#if (C_BOARD_UART_TX_POLICY == C_BOARD_UART_TX_BLOCK)
+  /* An interrupt handler does not wait. */
+  if (0 != __get_IPSR())
+  {
+    return 0;
+  } /* if */
+
+#ifdef C_BOARD_USE_FREE_RTOS
+  if ((taskSCHEDULER_RUNNING == xTaskGetSchedulerState()) &&
+      (0 == __get_PRIMASK()) && (0 == __get_BASEPRI()))
+  {
+    uint32_t elapsed = boardGetTick() - xStart;
+
+    if ((elapsed >= C_BOARD_UART_TX_BLOCK_MS) ||
+        (pdTRUE != xSemaphoreTake(uartTxSpace, pdMS_TO_TICKS(C_BOARD_UART_TX_BLOCK_MS - elapsed))))
+    {
+      return 0;
+    } /* if */
+    return 1;
+  } /* if */
+#else
+  (void) xStart;
+#endif
+
+  /* Before the scheduler, or in a critical section: the DMA always ends. */
+  uartTxPoll();
+  return 1;
+#else
+  (void) xStart;
+  return 0;
+#endif
+} /* uartTxWait() */
+
 /*
  * @brief              Initialize UART interface
  * @return             BOARD_OK on success. BOARD_ERROR_FATAL on error.
@@ -234,12 +436,55 @@ static BOARD_Status initUart()
   hUart1.Init.HwFlowCtl = UART_HWCONTROL_NONE;
   hUart1.Init.OverSampling = UART_OVERSAMPLING_16;
 
-  halStatus = HAL_UART_Init(&hUart1);
-
-  if (HAL_OK != halStatus)
+  for (;;)
   {
-    status = BOARD_ERROR_FATAL;
-  } /* if */
+    halStatus = HAL_UART_Init(&hUart1);
+    if (HAL_OK != halStatus)
+    {
+      status = BOARD_ERROR_FATAL;
+      break;
+    } /* if */
+
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    hDmaUart1Tx.Instance = DMA1_Channel4;
+    hDmaUart1Tx.Init.Request = DMA_REQUEST_2;
+    hDmaUart1Tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hDmaUart1Tx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hDmaUart1Tx.Init.MemInc = DMA_MINC_ENABLE;
+    hDmaUart1Tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hDmaUart1Tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hDmaUart1Tx.Init.Mode = DMA_NORMAL;
+    hDmaUart1Tx.Init.Priority = DMA_PRIORITY_LOW;
+
+    halStatus = HAL_DMA_Init(&hDmaUart1Tx);
+    if (HAL_OK != halStatus)
+    {
+      status = BOARD_ERROR_FATAL;
+      break;
+    } /* if */
+
+    hDmaUart1Tx.XferCpltCallback = uartTxDone;
+    SET_BIT(USART1->CR3, USART_CR3_DMAT);
+
+#ifdef C_BOARD_USE_FREE_RTOS
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    uartTxSpace = xSemaphoreCreateBinaryStatic(&uartTxSpaceBuffer);
+#else
+    uartTxSpace = xSemaphoreCreateBinary();
+#endif
+    if (NULL == uartTxSpace)
+    {
+      status = BOARD_ERROR_FATAL;
+      break;
+    } /* if */
+#endif
+
+    HAL_NVIC_SetPriority(DMA1_Channel4_IRQn, C_BOARD_UART_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Channel4_IRQn);
+
+    break;
+  }
 
   return status;
 } /* initUART() */
@@ -272,6 +517,8 @@ BOARD_Status boardInit
       break;
     } /* if */
 
+    initCycleCounter();
+
     initGpio();
 
     /* HAL boot, switch on the GREEN LED */
@@ -327,11 +574,349 @@ void boardPutChar
   char xCh
 )
 {
-  HAL_UART_Transmit(&hUart1, (uint8_t*) &xCh, sizeof(xCh), 100);
+  boardWrite(&xCh, sizeof(xCh));
 } /* boardPutChar() */
 
 /*
- * @brief              gets character from console
+ * @brief              DMA1 channel 4 interrupt: end of a console transfer.
+ * @return             none.
+ */
+void DMA1_Channel4_IRQHandler
+(
+  void
+)
+{
+  M_RTSTATS_IRQ_ENTER();
+
+  HAL_DMA_IRQHandler(&hDmaUart1Tx);
+
+  M_RTSTATS_IRQ_EXIT(RTSTATS_IRQ_USART1);
+} /* DMA1_Channel4_IRQHandler() */
+
+/*
+ * @brief              queues text in the console TX ring.
+ * @param[in] xpData   text to print.
+ * @param[in] xLength  length of the text.
+ * @param[in] xWait    0 drops what does not fit in the ring at once, whatever
+ *                     C_BOARD_UART_TX_POLICY says.
+ * @return             number of bytes queued.
+ */
+static uint32_t uartTxQueue
+(
+  const char* xpData,
+  uint32_t    xLength,
+  int         xWait
+)
+{
+  uint32_t done = 0;
+  uint32_t room;
+  uint32_t chunk;
+  uint32_t offset;
+  uint32_t primask;
+  uint32_t start = 0;
+  uint32_t stall;
+  int      waited = 0;
+
+  for (;;)
+  {
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    room = C_BOARD_UART_TX_RING_SIZE - (uartTxHead - uartTxTail);
+#if (C_BOARD_UART_TX_POLICY == C_BOARD_UART_TX_OVERWRITE)
+    if (room < (xLength - done))
+    {
+      /* Only the bytes handed to the DMA have to stay. */
+      uartTxStats.overwritten += uartTxHead - (uartTxTail + uartTxLength);
+      uartTxHead = uartTxTail + uartTxLength;
+      room = C_BOARD_UART_TX_RING_SIZE - uartTxLength;
+    } /* if */
+#endif
+    chunk = xLength - done;
+    if (chunk > room)
+    {
+      chunk = room;
+    } /* if */
+
+    offset = uartTxHead & (C_BOARD_UART_TX_RING_SIZE - 1);
+    if (chunk > (C_BOARD_UART_TX_RING_SIZE - offset))
+    {
+      memcpy(&uartTxRing[offset], &xpData[done], C_BOARD_UART_TX_RING_SIZE - offset);
+      memcpy(uartTxRing, &xpData[done + C_BOARD_UART_TX_RING_SIZE - offset],
+             chunk - (C_BOARD_UART_TX_RING_SIZE - offset));
+    }
+    else
+    {
+      memcpy(&uartTxRing[offset], &xpData[done], chunk);
+    } /* if */
+
+    uartTxHead += chunk;
+    done += chunk;
+    uartTxStart();
+
+    __set_PRIMASK(primask);
+
+    if ((done == xLength) || (0 == xWait))
+    {
+      break;
+    } /* if */
+
+    if (0 == waited)
+    {
+      start = boardGetTick();
+      waited = 1;
+    } /* if */
+
+    if (0 == uartTxWait(start))
+    {
+      break;
+    } /* if */
+  }
+
+  uartTxStats.written += done;
+  uartTxStats.dropped += xLength - done;
+
+  if (0 != waited)
+  {
+    stall = boardGetTick() - start;
+    if (stall > uartTxStats.maxStallMs)
+    {
+      uartTxStats.maxStallMs = stall;
+    } /* if */
+#ifdef C_BOARD_USE_FREE_RTOS
+    /* Room may be left for another waiter. */
+    if ((0 == __get_IPSR()) && (taskSCHEDULER_RUNNING == xTaskGetSchedulerState()))
+    {
+      xSemaphoreGive(uartTxSpace);
+    } /* if */
+#endif
+  } /* if */
+
+#ifdef C_BOARD_USE_FREE_RTOS
+  /* The kernel masks the DMA interrupt until the scheduler starts. */
+  if (taskSCHEDULER_RUNNING != xTaskGetSchedulerState())
+  {
+    while (uartTxHead != uartTxTail)
+    {
+      uartTxPoll();
+    } /* while */
+  } /* if */
+#endif
+
+  return done;
+} /* uartTxQueue() */
+
+/*
+ * @brief              queues text for the console. The DMA sends it from the ring while
+ *                     the caller goes on. When the ring is full, C_BOARD_UART_TX_POLICY
+ *                     decides. Before the scheduler starts, waits until the text is sent.
+ * @param[in] xpData   text to print.
+ * @param[in] xLength  length of the text.
+ * @return             number of bytes queued.
+ */
+uint32_t boardWrite
+(
+  const char* xpData,
+  uint32_t    xLength
+)
+{
+  return uartTxQueue(xpData, xLength, 1);
+} /* boardWrite() */
+
+#ifdef C_BOARD_USE_FREE_RTOS
+/*
+ * @brief                  Assembles the characters of the RX ring into command lines and
+ *                         echoes them. Runs in the timer task, queued by the USART1 interrupt:
+ *                         the echo never waits for room in the TX ring, it is dropped.
+ * @param[in] pParameters  unused
+ * @param[in] xParameter   unused
+ * @return                 none.
+ */
+static void consoleAssemble
+(
+  void*    pParameters,
+  uint32_t xParameter
+)
+{
+  char     echo[C_CONSOLE_ECHO_SIZE];
+  uint32_t echoLength;
+
+  (void) pParameters;
+  (void) xParameter;
+
+  /* Characters received from now on queue the assembler again. */
+  uartRxPending = 0;
+
+  while (uartRxTail != uartRxHead)
+  {
+    if (0 != consoleLineFeed(&consoleLine,
+        (char) uartRxRing[uartRxTail & (C_BOARD_UART_RX_RING_SIZE - 1)], echo, &echoLength))
+    {
+      if (pdTRUE == xQueueSend(consoleLines, consoleLine.text, 0))
+      {
+        consoleStats.lines++;
+      }
+      else
+      {
+        consoleStats.dropped++;
+      } /* if */
+    } /* if */
+    uartRxTail++;
+
+    if (0 != echoLength)
+    {
+      uartTxQueue(echo, echoLength, 0);
+    } /* if */
+  } /* while */
+} /* consoleAssemble() */
+
+/*
+ * @brief              USART1 interrupt: stores the character received in the RX ring.
+ * @return             none.
+ */
+void USART1_IRQHandler
+(
+  void
+)
+{
+  M_RTSTATS_IRQ_ENTER();
+  BaseType_t woken = pdFALSE;
+  uint32_t   isr = USART1->ISR;
+
+  if (0 != (isr & (USART_ISR_ORE | USART_ISR_FE | USART_ISR_NE)))
+  {
+    USART1->ICR = USART_ICR_ORECF | USART_ICR_FECF | USART_ICR_NCF;
+    consoleStats.errors++;
+  } /* if */
+
+  if (0 != (isr & USART_ISR_RXNE))
+  {
+    uint8_t ch = (uint8_t) USART1->RDR;
+
+    if ((uartRxHead - uartRxTail) < C_BOARD_UART_RX_RING_SIZE)
+    {
+      uartRxRing[uartRxHead & (C_BOARD_UART_RX_RING_SIZE - 1)] = ch;
+      uartRxHead++;
+    }
+    else
+    {
+      consoleStats.overruns++;
+    } /* if */
+
+    if (0 == uartRxPending)
+    {
+      uartRxPending = 1;
+      if (pdPASS != xTimerPendFunctionCallFromISR(consoleAssemble, NULL, 0, &woken))
+      {
+        /* Timer queue full: the next character tries again. */
+        uartRxPending = 0;
+      } /* if */
+    } /* if */
+  } /* if */
+
+  M_RTSTATS_IRQ_EXIT(RTSTATS_IRQ_USART1);
+  portYIELD_FROM_ISR(woken);
+} /* USART1_IRQHandler() */
+
+/*
+ * @brief              starts the console input: the characters are received by interrupt
+ *                     and assembled into lines, read with boardConsoleReadLine.
+ *                     boardGetChar must not be used afterwards.
+ * @return             BOARD_OK on success. BOARD_ERROR_FATAL on error.
+ */
+BOARD_Status boardConsoleStart
+(
+  void
+)
+{
+  if (NULL != consoleLines)
+  {
+    return BOARD_OK;
+  } /* if */
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  consoleLines = xQueueCreateStatic(C_BOARD_CONSOLE_QUEUE_LENGTH, C_CONSOLE_LINE_SIZE,
+                                    consoleLinesStorage, &consoleLinesBuffer);
+#else
+  consoleLines = xQueueCreate(C_BOARD_CONSOLE_QUEUE_LENGTH, C_CONSOLE_LINE_SIZE);
+#endif
+  if (NULL == consoleLines)
+  {
+    return BOARD_ERROR_FATAL;
+  } /* if */
+
+  consoleLineReset(&consoleLine);
+
+  USART1->ICR = USART_ICR_ORECF | USART_ICR_FECF | USART_ICR_NCF;
+  SET_BIT(USART1->CR1, USART_CR1_RXNEIE);
+  HAL_NVIC_SetPriority(USART1_IRQn, C_BOARD_UART_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(USART1_IRQn);
+
+  return BOARD_OK;
+} /* boardConsoleStart() */
+
+/*
+ * @brief               waits for a command line typed on the console
+ * @param[out] pxLine   line, 0-terminated, truncated to xSize
+ * @param[in] xSize     size of pxLine
+ * @param[in] xTimeout  time to wait in ms, portMAX_DELAY forever
+ * @return              BOARD_OK, BOARD_TIMEOUT, or BOARD_ERROR if the console is not started.
+ */
+BOARD_Status boardConsoleReadLine
+(
+  char*    pxLine,
+  uint32_t xSize,
+  uint32_t xTimeout
+)
+{
+  char line[C_CONSOLE_LINE_SIZE];
+
+  if ((NULL == consoleLines) || (0 == xSize))
+  {
+    return BOARD_ERROR;
+  } /* if */
+
+  if (pdTRUE != xQueueReceive(consoleLines, line,
+      (portMAX_DELAY == xTimeout) ? portMAX_DELAY : pdMS_TO_TICKS(xTimeout)))
+  {
+    return BOARD_TIMEOUT;
+  } /* if */
+
+  strncpy(pxLine, line, xSize - 1);
+  pxLine[xSize - 1] = '\0';
+
+  return BOARD_OK;
+} /* boardConsoleReadLine() */
+
+/*
+ * @brief               gets the counters of the console input
+ * @param[out] pxStats  counters
+ * @return              none.
+ */
+void boardConsoleGetStats
+(
+  BOARD_ConsoleStats* pxStats
+)
+{
+  *pxStats = consoleStats;
+} /* boardConsoleGetStats() */
+#endif
+
+/*
+ * @brief               gets the counters of the console TX ring
+ * @param[out] pxStats  counters
+ * @return              none.
+ */
+void boardUartGetStats
+(
+  BOARD_UartStats* pxStats
+)
+{
+  *pxStats = uartTxStats;
+} /* boardUartGetStats() */
+
+/*
+ * @brief              gets character from console. Not after boardConsoleStart.
  * @return             character key code or 0 if no key has been pressed
  */
 char boardGetChar()
@@ -391,3 +976,28 @@ uint32_t boardGetTick(void)
   return HAL_GetTick();
 #endif
 } /* boardGetTick() */
+
+/*
+ * @brief              get the CPU cycle counter
+ * @return             cycles since boardInit, wraps around
+ */
+uint32_t boardGetCycles
+(
+  void
+)
+{
+  return DWT->CYCCNT;
+} /* boardGetCycles() */
+
+/*
+ * @brief              converts CPU cycles to microseconds
+ * @param[in] xCycles  cycles
+ * @return             microseconds
+ */
+uint32_t boardCyclesToUs
+(
+  uint32_t xCycles
+)
+{
+  return xCycles / (SystemCoreClock / 1000000);
+} /* boardCyclesToUs() */
@@ -16,6 +16,28 @@ typedef enum
   BOARD_BUSY           = 0x05U
 } BOARD_Status;
 
+/**
+ * @brief  Counters of the console TX ring
+ */
+typedef struct
+{
+  uint32_t written;     /**< bytes queued */
+  uint32_t dropped;     /**< bytes dropped, the ring was full */
+  uint32_t overwritten; /**< bytes discarded to make room (C_BOARD_UART_TX_OVERWRITE) */
+  uint32_t maxStallMs;  /**< longest wait of a writer for room in the ring */
+} BOARD_UartStats;
+
+/**
+ * @brief  Counters of the console input
+ */
+typedef struct
+{
+  uint32_t lines;    /**< command lines queued */
+  uint32_t dropped;  /**< command lines dropped, the queue was full */
+  uint32_t overruns; /**< characters dropped, the RX ring was full */
+  uint32_t errors;   /**< overrun, framing and noise errors of the UART */
+} BOARD_ConsoleStats;
+
 /**
  * @brief    initialize the IoT device
  * @return   BOARD_OK or appropriate error code
@@ -33,11 +55,81 @@ void     boardPutChar
 );
 
 /**
- * @brief              gets character from console
+ * @brief              queues text for the console, sent by DMA. Does not wait for
+ *                     the UART, only for room in the ring when it is full.
+ * @param[in] xpData   text to print
+ * @param[in] xLength  length of the text
+ * @return             number of bytes queued, the rest is dropped
+ */
+uint32_t boardWrite
+(
+  const char* xpData,
+  uint32_t    xLength
+);
+
+/**
+ * @brief               gets the counters of the console TX ring
+ * @param[out] pxStats  counters
+ * @return              none
+ */
+void boardUartGetStats
+(
+  BOARD_UartStats* pxStats
+);
+
+void DMA1_Channel4_IRQHandler
+(
+  void
+);
+
+/**
+ * @brief              gets character from console, waiting for it.
+ *                     Not after boardConsoleStart.
  * @return             character key code or 0 if no key has been pressed
  */
 char     boardGetChar();
 
+#ifdef C_BOARD_USE_FREE_RTOS
+/**
+ * @brief              starts the console input: characters are received by interrupt,
+ *                     edited and assembled into command lines in the timer task
+ * @return             BOARD_OK or BOARD_ERROR_FATAL
+ */
+BOARD_Status boardConsoleStart
+(
+  void
+);
+
+/**
+ * @brief               waits for a command line typed on the console
+ * @param[out] pxLine   line, 0-terminated, truncated to xSize
+ * @param[in] xSize     size of pxLine
+ * @param[in] xTimeout  time to wait in ms, portMAX_DELAY forever
+ * @return              BOARD_OK, BOARD_TIMEOUT, or BOARD_ERROR before boardConsoleStart
+ */
+BOARD_Status boardConsoleReadLine
+(
+  char*    pxLine,
+  uint32_t xSize,
+  uint32_t xTimeout
+);
+
+/**
+ * @brief               gets the counters of the console input
+ * @param[out] pxStats  counters
+ * @return              none
+ */
+void boardConsoleGetStats
+(
+  BOARD_ConsoleStats* pxStats
+);
+
+void USART1_IRQHandler
+(
+  void
+);
+#endif
+
 /**
  * @brief              waits for a while
  * @param[in] xDelay   delay in ms
@@ -54,6 +146,26 @@ void     boardDelay
  */
 uint32_t boardGetTick();
 
+/**
+ * @brief              get the CPU cycle counter (DWT), for short durations: it
+ *                     wraps around after 2^32 cycles, 53 s at 80 MHz
+ * @return             cycles since boardInit
+ */
+uint32_t boardGetCycles
+(
+  void
+);
+
+/**
+ * @brief              converts CPU cycles to microseconds
+ * @param[in] xCycles  cycles
+ * @return             microseconds
+ */
+uint32_t boardCyclesToUs
+(
+  uint32_t xCycles
+);
+
 /**
  * @brief              sets the color of the LED
  * @param[in] xStatus  On or Off
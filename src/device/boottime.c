@@ -0,0 +1,47 @@
+#include <stdint.h>
+
+#include "stm32l4xx_hal.h"
+#include "board.h"
+#include "rtstats.h"
+#include "boottime.h"
+
+static uint64_t boottimeCycles[BOOTTIME_COUNT]; //!< End of each step.
+
+static uint8_t boottimeDone[BOOTTIME_COUNT]; //!< 1 once the step is marked.
+
+void boottimeMark
+(
+  BOOTTIME_Step xStep
+)
+{
+  uint32_t primask;
+
+  if ((xStep >= BOOTTIME_COUNT) || (0 != boottimeDone[xStep]))
+  {
+    return;
+  } /* if */
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if (0 == boottimeDone[xStep])
+  {
+    boottimeCycles[xStep] = rtstatsNow();
+    boottimeDone[xStep] = 1;
+  } /* if */
+  __set_PRIMASK(primask);
+} /* boottimeMark() */
+
+int boottimeGet
+(
+  BOOTTIME_Step xStep,
+  uint64_t*     pxCycles
+)
+{
+  if ((xStep >= BOOTTIME_COUNT) || (0 == boottimeDone[xStep]))
+  {
+    return 0;
+  } /* if */
+
+  *pxCycles = boottimeCycles[xStep];
+  return 1;
+} /* boottimeGet() */
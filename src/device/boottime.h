@@ -0,0 +1,52 @@
+#ifndef DEVICE_BOOTTIME_H_
+#define DEVICE_BOOTTIME_H_
+
+#include <stdint.h>
+
+/*
+ * Boot profile: the time each step of the bring-up ends, in CPU cycles from the
+ * start of the cycle counter, right after the clock setup of boardInit. Read
+ * with rtstatsNow, so the tickless sleeps of the boot count, to the tick. A step
+ * keeps its first time only: the marks can stay in paths that run again.
+ */
+
+/**
+ * @brief  Steps of the bring-up. The storage and the Wi-Fi module come up in
+ *         parallel tasks: the order of their steps varies.
+ */
+typedef enum
+{
+  BOOTTIME_BOARD       = 0x00U, /**< boardInit done: GPIO, console, QSPI memory */
+  BOOTTIME_SCHEDULER   = 0x01U, /**< first task running */
+  BOOTTIME_MOUNT       = 0x02U, /**< SPIFFS mounted, the memory scanned */
+  BOOTTIME_LIST        = 0x03U, /**< files listed, when C_MAIN_BOOT_LIST_FILES is set */
+  BOOTTIME_LOG         = 0x04U, /**< binary log started */
+  BOOTTIME_WIFI        = 0x05U, /**< Wi-Fi module reset and initialized */
+  BOOTTIME_FIRST_WRITE = 0x06U, /**< first program of the QSPI memory */
+  BOOTTIME_NETWORK     = 0x07U, /**< first Wi-Fi link up, address leased */
+  BOOTTIME_COUNT       = 0x08U  /**< number of steps */
+} BOOTTIME_Step;
+
+/**
+ * @brief                marks the end of a step, the first time only
+ * @param[in] xStep      step
+ * @return               none
+ */
+void boottimeMark
+(
+  BOOTTIME_Step xStep
+);
+
+/**
+ * @brief                gets the end of a step
+ * @param[in] xStep      step
+ * @param[out] pxCycles  cycles from the start of the cycle counter
+ * @return               0 when the step is not reached yet, 1 otherwise
+ */
+int boottimeGet
+(
+  BOOTTIME_Step xStep,
+  uint64_t*     pxCycles
+);
+
+#endif /* DEVICE_BOOTTIME_H_ */
@@ -5,6 +5,10 @@
 
 #include "button.h"
 #include "board.h"
+#include "rtstats.h"
+#ifdef C_BOARD_USE_FREE_RTOS
+#include "spi_wifi.h"
+#endif
 
 volatile uint32_t gUserButtonEventNb = 0;   /*!< counter of event */
 volatile uint8_t wifiControl = 0;
@@ -18,6 +22,8 @@ void EXTI15_10_IRQHandler
   void
 )
 {
+  M_RTSTATS_IRQ_ENTER();
+
   if (RESET != __HAL_GPIO_EXTI_GET_IT(GPIO_PIN_13))
   {
     /* Serve interrupt. */
@@ -26,6 +32,8 @@ void EXTI15_10_IRQHandler
     __HAL_GPIO_EXTI_CLEAR_IT(GPIO_PIN_13);
     HAL_NVIC_ClearPendingIRQ(EXTI15_10_IRQn);
   }
+
+  M_RTSTATS_IRQ_EXIT(RTSTATS_IRQ_EXTI);
 }
 
 /*
@@ -71,6 +79,9 @@ void boardUserButtonTickHandler
     {
       wifiControl = 0;
     }
+#ifdef C_BOARD_USE_FREE_RTOS
+    wifiLinkRequestFromISR(wifiControl);
+#endif
 
     /* Register the event */
     gUserButtonEventNb++;
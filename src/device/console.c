@@ -0,0 +1,109 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "console.h"
+
+#define C_CONSOLE_BACKSPACE 0x08 //!< Backspace, sent by some terminals.
+#define C_CONSOLE_DELETE    0x7F //!< DEL, sent by Putty for backspace.
+#define C_CONSOLE_KILL      0x15 //!< Ctrl-U, erases the line.
+#define C_CONSOLE_ESCAPE    0x1B //!< Start of an escape sequence.
+
+/*
+ * @brief               empties a command line
+ * @param[out] pxLine   line
+ * @return              none
+ */
+void consoleLineReset
+(
+  CONSOLE_Line* pxLine
+)
+{
+  memset(pxLine, 0, sizeof(*pxLine));
+} /* consoleLineReset() */
+
+/*
+ * @brief                     adds a received character to a command line
+ * @param[in,out] pxLine      line
+ * @param[in] xCh             character received
+ * @param[out] pxEcho         text to send back to the terminal, C_CONSOLE_ECHO_SIZE bytes
+ * @param[out] pxEchoLength   length of that text
+ * @return                    1 when the line is complete, 0 otherwise
+ */
+int consoleLineFeed
+(
+  CONSOLE_Line* pxLine,
+  char          xCh,
+  char*         pxEcho,
+  uint32_t*     pxEchoLength
+)
+{
+  uint8_t ch = (uint8_t) xCh;
+  uint8_t lastCr = pxLine->lastCr;
+
+  *pxEchoLength = 0;
+  pxLine->lastCr = 0;
+
+  /* ESC [ parameters final: the final byte is in 0x40..0x7E. */
+  if (0 != pxLine->escape)
+  {
+    if ((1 == pxLine->escape) && ('[' == ch))
+    {
+      pxLine->escape = 2;
+    }
+    else if ((1 == pxLine->escape) || ((ch >= 0x40) && (ch <= 0x7E)))
+    {
+      pxLine->escape = 0;
+    } /* if */
+    return 0;
+  } /* if */
+
+  switch (ch)
+  {
+  case '\n':
+    if (0 != lastCr)
+    {
+      /* Second half of CR LF. */
+      return 0;
+    } /* if */
+    /* falls through */
+  case '\r':
+    pxLine->lastCr = ('\r' == ch) ? 1 : 0;
+    pxLine->text[pxLine->length] = 0;
+    memcpy(pxEcho, "\r\n", 2);
+    *pxEchoLength = 2;
+    pxLine->length = 0;
+    return 1;
+
+  case C_CONSOLE_BACKSPACE:
+  case C_CONSOLE_DELETE:
+    if (0 < pxLine->length)
+    {
+      pxLine->length--;
+      memcpy(pxEcho, "\b \b", 3);
+      *pxEchoLength = 3;
+    } /* if */
+    break;
+
+  case C_CONSOLE_KILL:
+    pxLine->length = 0;
+    /* Back to the start of the terminal line, erase to its end. */
+    memcpy(pxEcho, "\r\x1b[K", 4);
+    *pxEchoLength = 4;
+    break;
+
+  case C_CONSOLE_ESCAPE:
+    pxLine->escape = 1;
+    break;
+
+  default:
+    if ((ch >= 0x20) && (ch < 0x7F) && (pxLine->length < (C_CONSOLE_LINE_SIZE - 1)))
+    {
+      pxLine->text[pxLine->length++] = (char) ch;
+      pxEcho[0] = (char) ch;
+      *pxEchoLength = 1;
+    } /* if */
+    break;
+  } /* switch */
+
+  return 0;
+} /* consoleLineFeed() */
@@ -0,0 +1,50 @@
+#ifndef DEVICE_CONSOLE_H_
+#define DEVICE_CONSOLE_H_
+
+#include <stdint.h>
+
+#define C_CONSOLE_LINE_SIZE 64 //!< Longest command line, with its terminating 0.
+#define C_CONSOLE_ECHO_SIZE 4  //!< Longest echo of one character.
+
+/**
+ * @brief  Command line being typed on the console
+ */
+typedef struct
+{
+  char     text[C_CONSOLE_LINE_SIZE]; /**< characters typed, 0-terminated when complete */
+  uint16_t length;                    /**< number of characters typed */
+  uint8_t  lastCr;                    /**< last character was a CR, a LF after it is skipped */
+  uint8_t  escape;                    /**< position in an escape sequence, ignored */
+} CONSOLE_Line;
+
+/**
+ * @brief               empties a command line
+ * @param[out] pxLine   line
+ * @return              none
+ */
+void consoleLineReset
+(
+  CONSOLE_Line* pxLine
+);
+
+/**
+ * @brief                     adds a received character to a command line. Printable
+ *                            characters are appended while there is room, backspace and
+ *                            DEL erase the last one, Ctrl-U the whole line, escape
+ *                            sequences (arrow keys) are ignored. CR, LF or CR LF end it.
+ * @param[in,out] pxLine      line
+ * @param[in] xCh             character received
+ * @param[out] pxEcho         text to send back to the terminal, C_CONSOLE_ECHO_SIZE bytes
+ * @param[out] pxEchoLength   length of that text
+ * @return                    1 when the line is complete, 0 otherwise. A complete line
+ *                            stays in pxLine->text until the next character.
+ */
+int consoleLineFeed
+(
+  CONSOLE_Line* pxLine,
+  char          xCh,
+  char*         pxEcho,
+  uint32_t*     pxEchoLength
+);
+
+#endif /* DEVICE_CONSOLE_H_ */
@@ -0,0 +1,360 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "board.h"
+#include "logstore.h"
+#include "spiffs.h"
+#include "spiffs_nucleus.h"
+#include "spiffs_fs.h"
+
+#define C_LOGSTORE_PAGE_DATA (SPIFFS_CFG_LOG_PAGE_SZ() - sizeof(spiffs_page_header))
+                                    //!< Data bytes of a SPIFFS page.
+
+#ifndef C_LOGSTORE_BUFFER_PAGES
+#define C_LOGSTORE_BUFFER_PAGES 4 //!< Data pages held in RAM: SPIFFS rewrites the file
+                                  //   index on each write, once per 4 pages here.
+#endif
+
+#define C_LOGSTORE_BUFFER_SIZE (C_LOGSTORE_BUFFER_PAGES * C_LOGSTORE_PAGE_DATA)
+                                    //!< Size of the RAM buffer.
+
+#define C_LOGSTORE_SEGMENT_SIZE (240 * C_LOGSTORE_PAGE_DATA)
+                                    //!< Size of a segment. A 64 KB block holds 254 pages
+                                    //   after its lookup pages, the rest is for the index.
+
+#define C_LOGSTORE_NUMBER_SIZE 8 //!< Hex digits of the segment number in its name.
+
+static char logstorePrefix[SPIFFS_OBJ_NAME_LEN - C_LOGSTORE_NUMBER_SIZE];
+//!< Name of the segments before their number.
+
+static uint32_t logstoreOldest = 0; //!< Number of the oldest segment.
+
+static uint32_t logstoreNewest = 0; //!< Number of the segment written.
+
+static uint32_t logstoreCount = 0; //!< Segments on the file system, 0 while closed.
+
+static spiffs_file logstoreFile = -1; //!< Segment written.
+
+static uint32_t logstoreSegmentSize = 0; //!< Bytes in the segment written.
+
+static uint8_t logstoreBuffer[C_LOGSTORE_BUFFER_SIZE]; //!< Bytes not written yet.
+
+static uint32_t logstoreLength = 0; //!< Bytes in logstoreBuffer.
+
+static uint32_t logstoreSince = 0; //!< Tick of the oldest byte in logstoreBuffer.
+
+static LOGSTORE_Stats logstoreStats; //!< Counters of the log store.
+
+/*
+ * @brief               builds the name of a segment
+ * @param[out] pxName   name, SPIFFS_OBJ_NAME_LEN bytes
+ * @param[in] xNumber   number of the segment
+ * @return              none
+ */
+static void logstoreName
+(
+  char*    pxName,
+  uint32_t xNumber
+)
+{
+  snprintf(pxName, SPIFFS_OBJ_NAME_LEN, "%s%08lx", logstorePrefix, (unsigned long) xNumber);
+} /* logstoreName() */
+
+/*
+ * @brief               reads the number of a segment from its name
+ * @param[in] xpName    name of a file
+ * @param[out] pxNumber number of the segment
+ * @return              1 when the file is a segment, 0 otherwise
+ */
+static int logstoreParse
+(
+  const char* xpName,
+  uint32_t*   pxNumber
+)
+{
+  uint32_t length = strlen(logstorePrefix);
+  uint32_t number = 0;
+  uint32_t i;
+  char     ch;
+
+  if ((strlen(xpName) != (length + C_LOGSTORE_NUMBER_SIZE)) ||
+      (0 != strncmp(xpName, logstorePrefix, length)))
+  {
+    return 0;
+  } /* if */
+
+  for (i = length; i < (length + C_LOGSTORE_NUMBER_SIZE); i++)
+  {
+    ch = xpName[i];
+    if ((ch >= '0') && (ch <= '9'))
+    {
+      number = (number << 4) | (uint32_t) (ch - '0');
+    }
+    else if ((ch >= 'a') && (ch <= 'f'))
+    {
+      number = (number << 4) | (uint32_t) (ch - 'a' + 10);
+    }
+    else
+    {
+      return 0;
+    } /* if */
+  } /* for */
+
+  *pxNumber = number;
+  return 1;
+} /* logstoreParse() */
+
+/*
+ * @brief   deletes the oldest segment, never the one written
+ * @return  none
+ */
+static void logstoreDeleteOldest
+(
+  void
+)
+{
+  char name[SPIFFS_OBJ_NAME_LEN];
+
+  /* Numbers can be missing after a reset during a rotation. */
+  while (logstoreOldest < logstoreNewest)
+  {
+    logstoreName(name, logstoreOldest++);
+    if (SPIFFS_OK == SPIFFS_remove(&gSpiffsFs, name))
+    {
+      logstoreCount--;
+      logstoreStats.deleted++;
+      return;
+    } /* if */
+  } /* while */
+} /* logstoreDeleteOldest() */
+
+/*
+ * @brief               starts a new segment, and ages out the oldest beyond
+ *                      C_LOGSTORE_SEGMENTS
+ * @param[in] xNumber   number of the segment
+ * @return              BOARD_OK or BOARD_ERROR
+ */
+static BOARD_Status logstoreStart
+(
+  uint32_t xNumber
+)
+{
+  char name[SPIFFS_OBJ_NAME_LEN];
+
+  logstoreName(name, xNumber);
+  logstoreFile = SPIFFS_open(&gSpiffsFs, name,
+                             SPIFFS_CREAT | SPIFFS_TRUNC | SPIFFS_APPEND | SPIFFS_WRONLY, 0);
+  if (logstoreFile < 0)
+  {
+    return BOARD_ERROR;
+  } /* if */
+
+  logstoreNewest = xNumber;
+  logstoreSegmentSize = 0;
+  logstoreCount++;
+  logstoreStats.segments++;
+
+  while (logstoreCount > C_LOGSTORE_SEGMENTS)
+  {
+    logstoreDeleteOldest();
+  } /* while */
+
+  return BOARD_OK;
+} /* logstoreStart() */
+
+/*
+ * @brief   writes the RAM buffer to the segment, starting the next one when it is
+ *          full. The buffer is emptied, its bytes lost on an error.
+ * @return  BOARD_OK or BOARD_ERROR
+ */
+static BOARD_Status logstoreOutput
+(
+  void
+)
+{
+  BOARD_Status status = BOARD_OK;
+  s32_t        result;
+
+  if (logstoreSegmentSize >= C_LOGSTORE_SEGMENT_SIZE)
+  {
+    SPIFFS_close(&gSpiffsFs, logstoreFile);
+    status = logstoreStart(logstoreNewest + 1);
+  } /* if */
+
+  if (BOARD_OK == status)
+  {
+    result = SPIFFS_write(&gSpiffsFs, logstoreFile, logstoreBuffer, logstoreLength);
+    if ((SPIFFS_ERR_FULL == result) && (logstoreCount > 1))
+    {
+      /* The file system is shared: make room at the expense of the log. */
+      logstoreDeleteOldest();
+      result = SPIFFS_write(&gSpiffsFs, logstoreFile, logstoreBuffer, logstoreLength);
+    } /* if */
+
+    if (result < 0)
+    {
+      status = BOARD_ERROR;
+    }
+    else
+    {
+      logstoreStats.written += logstoreLength;
+      logstoreStats.writes++;
+      logstoreSegmentSize += logstoreLength;
+    } /* if */
+  } /* if */
+
+  if (BOARD_OK != status)
+  {
+    logstoreStats.errors++;
+  } /* if */
+  logstoreLength = 0;
+
+  return status;
+} /* logstoreOutput() */
+
+BOARD_Status logstoreOpen
+(
+  const char* xpPrefix
+)
+{
+  spiffs_DIR           dir;
+  struct spiffs_dirent dirEntry;
+  spiffs_stat          stat;
+  char                 name[SPIFFS_OBJ_NAME_LEN];
+  uint32_t             number;
+
+  if ((0 != logstoreCount) || (strlen(xpPrefix) >= sizeof(logstorePrefix)))
+  {
+    return BOARD_ERROR;
+  } /* if */
+  strcpy(logstorePrefix, xpPrefix);
+
+  logstoreOldest = 0xFFFFFFFF;
+  logstoreNewest = 0;
+  if (NULL != SPIFFS_opendir(&gSpiffsFs, "" /* root */, &dir))
+  {
+    while (NULL != SPIFFS_readdir(&dir, &dirEntry))
+    {
+      if (0 != logstoreParse((const char*) dirEntry.name, &number))
+      {
+        logstoreCount++;
+        if (number < logstoreOldest)
+        {
+          logstoreOldest = number;
+        } /* if */
+        if (number >= logstoreNewest)
+        {
+          logstoreNewest = number;
+        } /* if */
+      } /* if */
+    } /* while */
+    SPIFFS_closedir(&dir);
+  } /* if */
+
+  if (0 == logstoreCount)
+  {
+    logstoreOldest = 0;
+    return logstoreStart(0);
+  } /* if */
+
+  /* Go on with the newest segment, after what the last run wrote. */
+  logstoreName(name, logstoreNewest);
+  logstoreFile = SPIFFS_open(&gSpiffsFs, name, SPIFFS_APPEND | SPIFFS_WRONLY, 0);
+  if ((logstoreFile < 0) || (SPIFFS_OK != SPIFFS_fstat(&gSpiffsFs, logstoreFile, &stat)))
+  {
+    logstoreCount = 0;
+    return BOARD_ERROR;
+  } /* if */
+  logstoreSegmentSize = stat.size;
+
+  while (logstoreCount > C_LOGSTORE_SEGMENTS)
+  {
+    logstoreDeleteOldest();
+  } /* while */
+
+  return BOARD_OK;
+} /* logstoreOpen() */
+
+BOARD_Status logstoreWrite
+(
+  const uint8_t* pxData,
+  uint32_t       xLength
+)
+{
+  BOARD_Status status = BOARD_OK;
+  uint32_t     target;
+  uint32_t     length;
+
+  if (0 == logstoreCount)
+  {
+    return BOARD_ERROR;
+  } /* if */
+  logstoreStats.bytes += xLength;
+
+  while (0 < xLength)
+  {
+    if (0 == logstoreLength)
+    {
+      logstoreSince = boardGetTick();
+    } /* if */
+
+    /* Up to a page boundary of the file, also after a partial flush. */
+    target = C_LOGSTORE_BUFFER_SIZE - (logstoreSegmentSize % C_LOGSTORE_PAGE_DATA);
+    length = target - logstoreLength;
+    if (length > xLength)
+    {
+      length = xLength;
+    } /* if */
+
+    memcpy(&logstoreBuffer[logstoreLength], pxData, length);
+    logstoreLength += length;
+    pxData += length;
+    xLength -= length;
+
+    if ((logstoreLength == target) && (BOARD_OK != logstoreOutput()))
+    {
+      status = BOARD_ERROR;
+    } /* if */
+  } /* while */
+
+  return status;
+} /* logstoreWrite() */
+
+BOARD_Status logstoreFlush
+(
+  void
+)
+{
+  if ((0 == logstoreCount) || (0 == logstoreLength))
+  {
+    return BOARD_OK;
+  } /* if */
+
+  logstoreStats.flushes++;
+  return logstoreOutput();
+} /* logstoreFlush() */
+
+uint32_t logstoreFlushIn
+(
+  void
+)
+{
+  uint32_t elapsed;
+
+  if (0 == logstoreLength)
+  {
+    return C_LOGSTORE_IDLE;
+  } /* if */
+
+  elapsed = boardGetTick() - logstoreSince;
+  return (elapsed >= C_LOGSTORE_FLUSH_MS) ? 0 : (C_LOGSTORE_FLUSH_MS - elapsed);
+} /* logstoreFlushIn() */
+
+void logstoreGetStats
+(
+  LOGSTORE_Stats* pxStats
+)
+{
+  *pxStats = logstoreStats;
+} /* logstoreGetStats() */
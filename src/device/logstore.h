@@ -0,0 +1,93 @@
+#ifndef DEVICE_LOGSTORE_H_
+#define DEVICE_LOGSTORE_H_
+
+#include <stdint.h>
+
+#include "board.h"
+
+/*
+ * Log store: a stream of bytes kept in the last C_LOGSTORE_SEGMENTS files of
+ * SPIFFS named <prefix><8 hex digits>, the number counting up. Bytes are kept
+ * in RAM until C_LOGSTORE_BUFFER_PAGES data pages are full, so SPIFFS programs
+ * whole pages and updates the file index once per buffer. A segment is about
+ * one erase block; the oldest is deleted as a whole, which leaves blocks the
+ * garbage collection erases without moving anything.
+ *
+ * Reading back: concatenate the segments in name order.
+ * Not reentrant: one task writes, the log task of binlog.c.
+ */
+
+#define C_LOGSTORE_SEGMENTS 4 //!< Segments kept, the oldest is deleted beyond.
+
+#define C_LOGSTORE_FLUSH_MS 5000 //!< Longest time bytes stay in RAM.
+
+#define C_LOGSTORE_IDLE 0xFFFFFFFFU //!< Returned by logstoreFlushIn with nothing to write.
+
+/**
+ * @brief  Counters of the log store
+ */
+typedef struct
+{
+  uint32_t bytes;    /**< bytes given to logstoreWrite */
+  uint32_t written;  /**< bytes written to SPIFFS */
+  uint32_t writes;   /**< calls to SPIFFS_write */
+  uint32_t flushes;  /**< writes of a partial buffer, timer or logstoreFlush */
+  uint32_t segments; /**< segments started */
+  uint32_t deleted;  /**< segments deleted */
+  uint32_t errors;   /**< failed writes, their bytes are lost */
+} LOGSTORE_Stats;
+
+/**
+ * @brief                opens the log store. Appends to the newest segment
+ *                       found, deletes the segments beyond C_LOGSTORE_SEGMENTS.
+ * @param[in] xpPrefix   name of the segments before their number
+ * @return               BOARD_OK or BOARD_ERROR
+ */
+BOARD_Status logstoreOpen
+(
+  const char* xpPrefix
+);
+
+/**
+ * @brief                appends bytes to the log store. SPIFFS is written when
+ *                       the RAM buffer is full.
+ * @param[in] pxData     bytes to append
+ * @param[in] xLength    number of bytes
+ * @return               BOARD_OK, BOARD_ERROR when bytes were lost
+ */
+BOARD_Status logstoreWrite
+(
+  const uint8_t* pxData,
+  uint32_t       xLength
+);
+
+/**
+ * @brief                writes the bytes held in RAM, before a reset for instance
+ * @return               BOARD_OK, BOARD_ERROR when bytes were lost
+ */
+BOARD_Status logstoreFlush
+(
+  void
+);
+
+/**
+ * @brief                tells when the bytes held in RAM must be written
+ * @return               ms before logstoreFlush is due, 0 when it is,
+ *                       C_LOGSTORE_IDLE when RAM holds nothing
+ */
+uint32_t logstoreFlushIn
+(
+  void
+);
+
+/**
+ * @brief               gets the counters of the log store
+ * @param[out] pxStats  counters
+ * @return              none
+ */
+void logstoreGetStats
+(
+  LOGSTORE_Stats* pxStats
+);
+
+#endif /* DEVICE_LOGSTORE_H_ */
@@ -1,12 +1,260 @@
 #include "memory_qspi.h"
 #include "stm32l4xx_hal.h"
 #include "stm32l475e_iot01_qspi.h"
+#include "rtstats.h"
+#include "boottime.h"
+
+#ifdef C_BOARD_USE_FREE_RTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#endif
 
 static uint8_t isInit = 0; //!< Indicate if the flash memory has been initialized.
 
+static BOARD_QspiStats qspiStats; //!< Counters of the memory operations.
+
+static volatile uint8_t qspiBusy = 0; //!< Set while an operation is in progress.
+
+static uint8_t qspiDown = 0; //!< Set while the memory is in deep power-down.
+
+static uint32_t qspiDownAt = 0; //!< Cycle counter when the memory entered deep power-down.
+
+static uint32_t qspiDownTick = 0; //!< Tick when the memory entered deep power-down.
+
+static uint32_t qspiLastUse = 0; //!< Tick of the end of the last operation.
+
 #define C_BOARD_QSPI_ENABLE_MEMORY_MAPPED 0 //!< Indicate that the Flash memory can be accessed
                                             //   with direct memory read.
 
+#ifdef C_BOARD_USE_FREE_RTOS
+#define C_BOARD_QSPI_IRQ_PRIORITY 6 //!< Priority of the QUADSPI interrupt. Must not be above
+                                    //   configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY.
+
+#define C_BOARD_QSPI_PROGRAM_MAX_MS 10 //!< Longest page program of the memory, 10 ms.
+
+#define C_BOARD_QSPI_PROGRAM_TIMEOUT_MS (2 * C_BOARD_QSPI_PROGRAM_MAX_MS) //!< Wait for the end of
+                                                                        //   a page program.
+
+extern QSPI_HandleTypeDef QSPIHandle; //!< QSPI handle of the memory. Defined in the BSP.
+
+static SemaphoreHandle_t qspiReady = NULL; //!< Given by the QUADSPI interrupt at the end of a
+                                           //   program, or on error.
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static StaticSemaphore_t qspiReadyBuffer; //!< Storage of qspiReady.
+#endif
+
+static volatile uint8_t qspiError = 0; //!< Set by the QUADSPI interrupt on error.
+
+/*
+ * @brief   QUADSPI interrupt: ends the status polling of a page program.
+ * @return  none.
+ */
+void QUADSPI_IRQHandler
+(
+  void
+)
+{
+  M_RTSTATS_IRQ_ENTER();
+
+  HAL_QSPI_IRQHandler(&QSPIHandle);
+
+  M_RTSTATS_IRQ_EXIT(RTSTATS_IRQ_QUADSPI);
+} /* QUADSPI_IRQHandler() */
+
+/*
+ * @brief               Called by the HAL when the memory reports the end of a program.
+ * @param[in]    hqspi  QSPI handle.
+ * @return              none.
+ */
+void HAL_QSPI_StatusMatchCallback
+(
+  QSPI_HandleTypeDef* hqspi
+)
+{
+  BaseType_t woken = pdFALSE;
+
+  (void) hqspi;
+  xSemaphoreGiveFromISR(qspiReady, &woken);
+  portYIELD_FROM_ISR(woken);
+} /* HAL_QSPI_StatusMatchCallback() */
+
+/*
+ * @brief               Called by the HAL on a transfer error.
+ * @param[in]    hqspi  QSPI handle.
+ * @return              none.
+ */
+void HAL_QSPI_ErrorCallback
+(
+  QSPI_HandleTypeDef* hqspi
+)
+{
+  BaseType_t woken = pdFALSE;
+
+  (void) hqspi;
+  qspiError = 1;
+  xSemaphoreGiveFromISR(qspiReady, &woken);
+  portYIELD_FROM_ISR(woken);
+} /* HAL_QSPI_ErrorCallback() */
+
+/*
+ * @brief            Program one page of the memory. The caller blocks on a semaphore
+ *                   while the memory programs the page, which lets the other tasks run
+ *                   instead of spinning on the status register as BSP_QSPI_Write does.
+ * @param[in] pxData Data to be written.
+ * @param[in]  xAddr Address where to write the data.
+ * @param[in]  xSize Size of the data to be written, not crossing a page boundary.
+ * @return           BOARD_OK on success. BOARD_ERROR on error.
+ */
+static BOARD_Status boardMemoryQspiProgramPage
+(
+  const uint8_t* pxData,
+        uint32_t  xAddr,
+        uint32_t  xSize
+)
+{
+  QSPI_CommandTypeDef command = {0};
+  QSPI_AutoPollingTypeDef polling = {0};
+
+  command.InstructionMode   = QSPI_INSTRUCTION_1_LINE;
+  command.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+  command.DdrMode           = QSPI_DDR_MODE_DISABLE;
+  command.DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
+  command.SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
+
+  polling.MatchMode       = QSPI_MATCH_MODE_AND;
+  polling.StatusBytesSize = 1;
+  polling.Interval        = 0x10;
+  polling.AutomaticStop   = QSPI_AUTOMATIC_STOP_ENABLE;
+
+  /* Enable write operations, the latch is set at once. */
+  command.Instruction = WRITE_ENABLE_CMD;
+  command.AddressMode = QSPI_ADDRESS_NONE;
+  command.DataMode    = QSPI_DATA_NONE;
+  if (HAL_OK != HAL_QSPI_Command(&QSPIHandle, &command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE))
+  {
+    return BOARD_ERROR;
+  }
+
+  command.Instruction = READ_STATUS_REG_CMD;
+  command.DataMode    = QSPI_DATA_1_LINE;
+  polling.Match       = MX25R6435F_SR_WEL;
+  polling.Mask        = MX25R6435F_SR_WEL;
+  if (HAL_OK != HAL_QSPI_AutoPolling(&QSPIHandle, &command, &polling, HAL_QPSI_TIMEOUT_DEFAULT_VALUE))
+  {
+    return BOARD_ERROR;
+  }
+
+  /* Send the page. */
+  command.Instruction = QUAD_PAGE_PROG_CMD;
+  command.AddressMode = QSPI_ADDRESS_4_LINES;
+  command.AddressSize = QSPI_ADDRESS_24_BITS;
+  command.Address     = xAddr;
+  command.DataMode    = QSPI_DATA_4_LINES;
+  command.NbData      = xSize;
+  if ((HAL_OK != HAL_QSPI_Command(&QSPIHandle, &command, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)) ||
+      (HAL_OK != HAL_QSPI_Transmit(&QSPIHandle, (uint8_t*) pxData, HAL_QPSI_TIMEOUT_DEFAULT_VALUE)))
+  {
+    return BOARD_ERROR;
+  }
+
+  /* Wait for the end of the program in the interrupt. */
+  command.Instruction = READ_STATUS_REG_CMD;
+  command.AddressMode = QSPI_ADDRESS_NONE;
+  command.DataMode    = QSPI_DATA_1_LINE;
+  command.NbData      = 0;
+  polling.Match       = 0;
+  polling.Mask        = MX25R6435F_SR_WIP;
+  qspiError = 0;
+  if (HAL_OK != HAL_QSPI_AutoPolling_IT(&QSPIHandle, &command, &polling))
+  {
+    return BOARD_ERROR;
+  }
+
+  /* One tick more: the wait can start at the end of the current tick. */
+  if (pdTRUE != xSemaphoreTake(qspiReady, pdMS_TO_TICKS(C_BOARD_QSPI_PROGRAM_TIMEOUT_MS) + 1))
+  {
+    (void) HAL_QSPI_Abort(&QSPIHandle);
+    /* Drop a give racing with the abort. */
+    (void) xSemaphoreTake(qspiReady, 0);
+    return BOARD_ERROR;
+  }
+
+  return (0 == qspiError) ? BOARD_OK : BOARD_ERROR;
+} /* boardMemoryQspiProgramPage() */
+#endif
+
+/*
+ * @brief             Spin on the cycle counter, for the deep power-down timings:
+ *                    a few us, far below a tick.
+ * @param[in] xStart  Cycle counter at the start of the wait.
+ * @param[in] xUs     Time to wait from xStart, in us.
+ * @return            none.
+ */
+static void boardMemoryQspiWaitUs
+(
+  uint32_t xStart,
+  uint32_t xUs
+)
+{
+  while (boardCyclesToUs(boardGetCycles() - xStart) < xUs)
+  {
+  }
+} /* boardMemoryQspiWaitUs() */
+
+/*
+ * @brief   Start an operation: wake the memory up when it is in deep power-down.
+ *          The operation pays the wake-up, counted in qspiStats.
+ * @return  BOARD_OK on success. BOARD_ERROR when the memory could not be woken up.
+ */
+static BOARD_Status boardMemoryQspiBegin
+(
+  void
+)
+{
+  uint32_t start;
+
+  qspiBusy = 1;
+  if (0 == qspiDown)
+  {
+    return BOARD_OK;
+  }
+
+  start = boardGetCycles();
+
+  /* Two ticks apart, the shortest stay is over: the cycle counter may have wrapped. */
+  if ((boardGetTick() - qspiDownTick) < 2)
+  {
+    boardMemoryQspiWaitUs(qspiDownAt, C_BOARD_QSPI_DOWN_MIN_US);
+  }
+
+  if (QSPI_OK != BSP_QSPI_LeaveDeepPowerDown())
+  {
+    return BOARD_ERROR;
+  }
+  boardMemoryQspiWaitUs(boardGetCycles(), C_BOARD_QSPI_WAKE_US);
+
+  qspiDown = 0;
+  qspiStats.wakeUps++;
+  qspiStats.wakeCycles += boardGetCycles() - start;
+
+  return BOARD_OK;
+} /* boardMemoryQspiBegin() */
+
+/*
+ * @brief   End an operation: the idle time of the memory starts.
+ * @return  none.
+ */
+static void boardMemoryQspiEnd
+(
+  void
+)
+{
+  qspiLastUse = boardGetTick();
+  qspiBusy = 0;
+} /* boardMemoryQspiEnd() */
+
 /*
  * @brief   Initialize the QSPI memory
  * @return  BOARD_OK on success. BOARD_ERROR_FATAL on failure.
@@ -49,6 +297,22 @@ BOARD_Status boardMemoryQspiInit
     BSP_QSPI_EnableMemoryMappedMode();
 #endif
 
+#ifdef C_BOARD_USE_FREE_RTOS
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    qspiReady = xSemaphoreCreateBinaryStatic(&qspiReadyBuffer);
+#else
+    qspiReady = xSemaphoreCreateBinary();
+#endif
+    if (NULL == qspiReady)
+    {
+      status = BOARD_ERROR_FATAL;
+      break;
+    }
+
+    HAL_NVIC_SetPriority(QUADSPI_IRQn, C_BOARD_QSPI_IRQ_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(QUADSPI_IRQn);
+#endif
+
     isInit = 1;
     break;
   }
@@ -87,19 +351,27 @@ BOARD_Status boardMemoryQspiStatus
 {
   BOARD_Status status = BOARD_OK;
 
-  if (NULL == xpIsInit)
+  if (NULL != xpIsInit)
   {
     *xpIsInit = isInit;
-    switch (BSP_QSPI_GetStatus()) {
-    case QSPI_BUSY:
-      status = BOARD_BUSY;
-      break;
-    case QSPI_ERROR:
+    if (BOARD_OK != boardMemoryQspiBegin())
+    {
       status = BOARD_ERROR;
-      break;
-    default:
-      break;
     }
+    else
+    {
+      switch (BSP_QSPI_GetStatus()) {
+      case QSPI_BUSY:
+        status = BOARD_BUSY;
+        break;
+      case QSPI_ERROR:
+        status = BOARD_ERROR;
+        break;
+      default:
+        break;
+      }
+    }
+    boardMemoryQspiEnd();
   }
 
   return status;
@@ -120,12 +392,49 @@ BOARD_Status boardMemoryQspiWrite
 )
 {
   BOARD_Status status = BOARD_OK;
-  if (QSPI_OK != BSP_QSPI_Write(pxData, xAddr, xSize))
+#ifdef C_BOARD_USE_FREE_RTOS
+  uint32_t size;
+#endif
+
+  qspiStats.programs += ((xAddr % C_BOARD_QSPI_MEMORY_PAGE_SIZE) + xSize +
+                         C_BOARD_QSPI_MEMORY_PAGE_SIZE - 1) / C_BOARD_QSPI_MEMORY_PAGE_SIZE;
+  qspiStats.writeBytes += xSize;
+
+  if (BOARD_OK != boardMemoryQspiBegin())
+  {
+    status = BOARD_ERROR;
+  }
+#ifdef C_BOARD_USE_FREE_RTOS
+  else if (taskSCHEDULER_RUNNING == xTaskGetSchedulerState())
+  {
+    /* Program page by page, the other tasks run while a page is programmed. */
+    while ((BOARD_OK == status) && (0 < xSize))
+    {
+      size = C_BOARD_QSPI_MEMORY_PAGE_SIZE - (xAddr % C_BOARD_QSPI_MEMORY_PAGE_SIZE);
+      if (size > xSize)
+      {
+        size = xSize;
+      }
+
+      status = boardMemoryQspiProgramPage(pxData, xAddr, size);
+      pxData += size;
+      xAddr += size;
+      xSize -= size;
+    }
+  }
+#endif
+  else if (QSPI_OK != BSP_QSPI_Write(pxData, xAddr, xSize))
   {
-    printf("Write error.");
     status = BOARD_ERROR;
   }
 
+  if (BOARD_OK != status)
+  {
+    printf("Write error.");
+  }
+  boardMemoryQspiEnd();
+  boottimeMark(BOOTTIME_FIRST_WRITE);
+
   return status;
 } /* boardMemoryQspiWrite() */
 
@@ -141,12 +450,16 @@ BOARD_Status boardMemoryQspiErase
 {
   BOARD_Status status = BOARD_OK;
 
+  qspiStats.erases++;
+
 #if (C_BOARD_QSPI_ENABLE_MEMORY_MAPPED == 0)
-  if (QSPI_OK != BSP_QSPI_Erase_Block(xAddr))
+  if ((BOARD_OK != boardMemoryQspiBegin()) ||
+      (QSPI_OK != BSP_QSPI_Erase_Block(xAddr)))
   {
     printf("Erase error.");
     status = BOARD_ERROR;
   }
+  boardMemoryQspiEnd();
 #endif
 
   return status;
@@ -168,14 +481,19 @@ BOARD_Status boardMemoryQspiRead
 {
   BOARD_Status status = BOARD_OK;
 
+  qspiStats.reads++;
+  qspiStats.readBytes += xSize;
+
 #if (C_BOARD_QSPI_ENABLE_MEMORY_MAPPED == 1)
   memcpy(pData, C_BOARD_QSPI_MEMORY_ADDRESS + addr, size);
 #else
-  if (QSPI_OK != BSP_QSPI_Read(pxData, xAddr, xSize))
+  if ((BOARD_OK != boardMemoryQspiBegin()) ||
+      (QSPI_OK != BSP_QSPI_Read(pxData, xAddr, xSize)))
   {
     printf("Read error.");
     status = BOARD_ERROR;
   }
+  boardMemoryQspiEnd();
 #endif
 
   return status;
@@ -194,12 +512,83 @@ BOARD_Status boardMemoryQspiWipe
   BOARD_Status status = BOARD_OK;
 
 #if (C_BOARD_QSPI_ENABLE_MEMORY_MAPPED == 0)
-  if (QSPI_OK != BSP_QSPI_Erase_Chip())
+  if ((BOARD_OK != boardMemoryQspiBegin()) ||
+      (QSPI_OK != BSP_QSPI_Erase_Chip()))
   {
     printf("Erase error.");
     status = BOARD_ERROR;
   }
+  boardMemoryQspiEnd();
 #endif
 
   return status;
 } /* boardMemoryQspiErase() */
+
+/*
+ * @brief   Put the memory in deep power-down. The next operation wakes it up.
+ * @return  BOARD_OK when the memory is in deep power-down. BOARD_BUSY while an
+ *          operation is in progress. Other errors
+ */
+BOARD_Status boardMemoryQspiPowerDown
+(
+  void
+)
+{
+#if (C_BOARD_QSPI_ENABLE_MEMORY_MAPPED == 1)
+  /* Read by the bus, the memory would not be woken up. */
+  return BOARD_BUSY;
+#else
+  if ((0 == isInit) || (0 != qspiBusy))
+  {
+    return BOARD_BUSY;
+  }
+
+  if (0 != qspiDown)
+  {
+    return BOARD_OK;
+  }
+
+  /* The operations wait for the end of their program or erase: the memory is idle. */
+  if (QSPI_OK != BSP_QSPI_EnterDeepPowerDown())
+  {
+    return BOARD_ERROR;
+  }
+
+  qspiDown = 1;
+  qspiDownAt = boardGetCycles();
+  qspiDownTick = boardGetTick();
+  qspiStats.powerDowns++;
+
+  return BOARD_OK;
+#endif
+} /* boardMemoryQspiPowerDown() */
+
+/*
+ * @brief   Time since the last operation of the memory
+ * @return  ms, 0 while an operation is in progress or the memory is not initialized
+ */
+uint32_t boardMemoryQspiIdleTime
+(
+  void
+)
+{
+  if ((0 == isInit) || (0 != qspiBusy))
+  {
+    return 0;
+  }
+
+  return boardGetTick() - qspiLastUse;
+} /* boardMemoryQspiIdleTime() */
+
+/*
+ * @brief               Get the counters of the memory operations
+ * @param[out] pxStats  counters
+ * @return              none
+ */
+void boardMemoryQspiGetStats
+(
+  BOARD_QspiStats* pxStats
+)
+{
+  *pxStats = qspiStats;
+} /* boardMemoryQspiGetStats() */
@@ -17,6 +17,24 @@
 #define C_BOARD_QSPI_MEMORY_PAGE_NUMBER   (MX25R6435F_FLASH_SIZE / MX25R6435F_PAGE_SIZE)
 //!< Number of pages (32768 pages of 256 bytes)
 
+#define C_BOARD_QSPI_WAKE_US     35 //!< Release from deep power-down: the memory takes 35us.
+#define C_BOARD_QSPI_DOWN_MIN_US 30 //!< Shortest stay in deep power-down.
+
+/**
+ * @brief  Counters of the QSPI memory operations
+ */
+typedef struct
+{
+  uint32_t reads;      /**< read operations */
+  uint32_t readBytes;  /**< bytes read */
+  uint32_t programs;   /**< page programs */
+  uint32_t writeBytes; /**< bytes programmed */
+  uint32_t erases;     /**< block erases */
+  uint32_t powerDowns; /**< entries in deep power-down */
+  uint32_t wakeUps;    /**< operations that woke the memory up first */
+  uint32_t wakeCycles; /**< CPU cycles spent by the operations waiting for the wake-up */
+} BOARD_QspiStats;
+
 /**
  * @brief   Initialize the QSPI memory
  * @return  BOARD_OK on success. BOARD_ERROR_FATAL on failure.
@@ -84,4 +102,37 @@ BOARD_Status boardMemoryQspiRead
   uint32_t  xSize
 );
 
+/**
+ * @brief   Put the memory in deep power-down, where it draws below 1 uA instead
+ *          of the 5 to 8 uA of standby. The next operation wakes it up and waits
+ *          C_BOARD_QSPI_WAKE_US first. Not callable while an operation is in
+ *          progress in another task: the sleep hook calls it with the scheduler
+ *          suspended.
+ * @return  BOARD_OK when the memory is in deep power-down. BOARD_BUSY while an
+ *          operation is in progress. Other errors
+ */
+BOARD_Status boardMemoryQspiPowerDown
+(
+  void
+);
+
+/**
+ * @brief   Time since the last operation of the memory
+ * @return  ms, 0 while an operation is in progress or the memory is not initialized
+ */
+uint32_t boardMemoryQspiIdleTime
+(
+  void
+);
+
+/**
+ * @brief               Get the counters of the memory operations
+ * @param[out] pxStats  counters
+ * @return              none
+ */
+void boardMemoryQspiGetStats
+(
+  BOARD_QspiStats* pxStats
+);
+
 #endif /* DEVICE_MEMORY_QSPI_H_ */
@@ -0,0 +1,185 @@
+#include <stdint.h>
+
+#ifdef C_BOARD_USE_FREE_RTOS
+#include "FreeRTOS.h"
+#endif
+
+#include "stm32l4xx_hal.h"
+#include "board.h"
+#include "pool.h"
+
+#define C_POOL_SMALL_SIZE   32   //!< Bytes of a small block.
+#define C_POOL_PAGE_SIZE    256  //!< Bytes of a page block.
+#define C_POOL_PAYLOAD_SIZE 1200 //!< Bytes of a payload block, ES_WIFI_PAYLOAD_SIZE.
+
+/**
+ * @brief  Pool of a size class
+ */
+typedef struct
+{
+  uint8_t* base;     /**< first block */
+  uint32_t size;     /**< bytes of a block, multiple of 8 */
+  uint32_t blocks;   /**< blocks of the pool */
+  void*    freeList; /**< freed blocks, each one holds the next */
+  uint32_t fresh;    /**< blocks never allocated, at the end of the pool */
+  POOL_Stats stats;  /**< counters */
+} POOL_Class;
+
+static uint64_t poolSmall[(C_POOL_SMALL_SIZE / 8) * C_POOL_SMALL_COUNT];
+//!< Blocks of the small class.
+
+static uint64_t poolPage[(C_POOL_PAGE_SIZE / 8) * C_POOL_PAGE_COUNT];
+//!< Blocks of the page class.
+
+static uint64_t poolPayload[(C_POOL_PAYLOAD_SIZE / 8) * C_POOL_PAYLOAD_COUNT];
+//!< Blocks of the payload class.
+
+#define M_POOL_CLASS(xStorage, xSize, xCount) \
+  { (uint8_t*) (xStorage), (xSize), (xCount), NULL, (xCount), { (xSize), (xCount), 0, 0, 0, 0 } }
+
+static POOL_Class poolClasses[C_POOL_CLASSES] =
+{
+  M_POOL_CLASS(poolSmall, C_POOL_SMALL_SIZE, C_POOL_SMALL_COUNT),
+  M_POOL_CLASS(poolPage, C_POOL_PAGE_SIZE, C_POOL_PAGE_COUNT),
+  M_POOL_CLASS(poolPayload, C_POOL_PAYLOAD_SIZE, C_POOL_PAYLOAD_COUNT)
+}; //!< Size classes, smallest first.
+
+/*
+ * @brief               finds the pool holding a block
+ * @param[in] pxBlock   block
+ * @return              pool, NULL when the block is not in a pool
+ */
+static POOL_Class* poolOwner
+(
+  const void* pxBlock
+)
+{
+  const uint8_t* block = (const uint8_t*) pxBlock;
+  uint32_t       i;
+
+  for (i = 0; i < C_POOL_CLASSES; i++)
+  {
+    if ((block >= poolClasses[i].base) &&
+        (block < (poolClasses[i].base + (poolClasses[i].size * poolClasses[i].blocks))))
+    {
+      return &poolClasses[i];
+    } /* if */
+  } /* for */
+
+  return NULL;
+} /* poolOwner() */
+
+void* poolAlloc
+(
+  uint32_t xSize
+)
+{
+  POOL_Class* pool = NULL;
+  void*       block = NULL;
+  uint32_t    primask;
+  uint32_t    i;
+
+  for (i = 0; i < C_POOL_CLASSES; i++)
+  {
+    if (xSize <= poolClasses[i].size)
+    {
+      pool = &poolClasses[i];
+      break;
+    } /* if */
+  } /* for */
+
+  if (NULL != pool)
+  {
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (NULL != pool->freeList)
+    {
+      block = pool->freeList;
+      pool->freeList = *(void**) block;
+    }
+    else if (0 != pool->fresh)
+    {
+      block = pool->base + ((pool->blocks - pool->fresh) * pool->size);
+      pool->fresh--;
+    }
+    else
+    {
+      pool->stats.fallbacks++;
+    } /* if */
+
+    if (NULL != block)
+    {
+      pool->stats.allocs++;
+      pool->stats.used++;
+      if (pool->stats.used > pool->stats.maxUsed)
+      {
+        pool->stats.maxUsed = pool->stats.used;
+      } /* if */
+    } /* if */
+
+    __set_PRIMASK(primask);
+  } /* if */
+
+#ifdef C_BOARD_USE_FREE_RTOS
+  if ((NULL == block) && (0 == __get_IPSR()))
+  {
+    block = pvPortMalloc(xSize);
+  } /* if */
+#endif
+
+  return block;
+} /* poolAlloc() */
+
+void poolFree
+(
+  void* pxBlock
+)
+{
+  POOL_Class* pool;
+  uint32_t    primask;
+
+  if (NULL == pxBlock)
+  {
+    return;
+  } /* if */
+
+  pool = poolOwner(pxBlock);
+  if (NULL == pool)
+  {
+#ifdef C_BOARD_USE_FREE_RTOS
+    vPortFree(pxBlock);
+#endif
+    return;
+  } /* if */
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+
+  *(void**) pxBlock = pool->freeList;
+  pool->freeList = pxBlock;
+  pool->stats.used--;
+
+  __set_PRIMASK(primask);
+} /* poolFree() */
+
+BOARD_Status poolGetStats
+(
+  uint32_t    xClass,
+  POOL_Stats* pxStats
+)
+{
+  uint32_t primask;
+
+  if (xClass >= C_POOL_CLASSES)
+  {
+    return BOARD_BAD_PARAMETER;
+  } /* if */
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  *pxStats = poolClasses[xClass].stats;
+  __set_PRIMASK(primask);
+
+  return BOARD_OK;
+} /* poolGetStats() */
@@ -0,0 +1,81 @@
+#ifndef DEVICE_POOL_H_
+#define DEVICE_POOL_H_
+
+#include <stdint.h>
+
+#include "board.h"
+
+/*
+ * Block pools: fixed-size blocks in static RAM, one pool per size class. A
+ * request takes a block of the smallest class that fits, from the free list
+ * of the class or else from its blocks never used: both O(1), with the
+ * interrupts masked for a few instructions only, so tasks and interrupt
+ * handlers can allocate and free. Blocks never move and never split: no
+ * fragmentation whatever the uptime.
+ *
+ * When the class is empty, or the request is larger than the largest class,
+ * the block comes from the FreeRTOS heap (heap_4), from a task only.
+ */
+
+#ifndef C_POOL_SMALL_COUNT
+#define C_POOL_SMALL_COUNT 16 //!< Blocks of 32 bytes: AT commands, short answers.
+#endif
+
+#ifndef C_POOL_PAGE_COUNT
+#define C_POOL_PAGE_COUNT 8 //!< Blocks of 256 bytes: SPIFFS pages.
+#endif
+
+#ifndef C_POOL_PAYLOAD_COUNT
+#define C_POOL_PAYLOAD_COUNT 4 //!< Blocks of 1200 bytes: Wi-Fi payloads.
+#endif
+
+#define C_POOL_CLASSES 3 //!< Number of size classes.
+
+/**
+ * @brief  Counters of a pool
+ */
+typedef struct
+{
+  uint32_t size;      /**< bytes of a block */
+  uint32_t blocks;    /**< blocks of the pool */
+  uint32_t used;      /**< blocks allocated now */
+  uint32_t maxUsed;   /**< most blocks allocated at once, high-water mark */
+  uint32_t allocs;    /**< blocks given by the pool */
+  uint32_t fallbacks; /**< requests of this class given to the heap, or failed */
+} POOL_Stats;
+
+/**
+ * @brief                allocates a block. Callable from an interrupt handler,
+ *                       where the heap is never used.
+ * @param[in] xSize      bytes needed
+ * @return               block, aligned on 8 bytes, NULL when none is left
+ */
+void* poolAlloc
+(
+  uint32_t xSize
+);
+
+/**
+ * @brief                frees a block of poolAlloc. Callable from an interrupt
+ *                       handler for the blocks of the pools.
+ * @param[in] pxBlock    block, NULL is ignored
+ * @return               none
+ */
+void poolFree
+(
+  void* pxBlock
+);
+
+/**
+ * @brief                gets the counters of a pool
+ * @param[in] xClass     size class, 0 to C_POOL_CLASSES - 1, smallest first
+ * @param[out] pxStats   counters
+ * @return               BOARD_OK, BOARD_BAD_PARAMETER on a wrong class
+ */
+BOARD_Status poolGetStats
+(
+  uint32_t    xClass,
+  POOL_Stats* pxStats
+);
+
+#endif /* DEVICE_POOL_H_ */
@@ -0,0 +1,31 @@
+#include <stdint.h>
+
+#ifdef C_BOARD_USE_FREE_RTOS
+#include "FreeRTOS.h"
+#endif
+
+#include "stm32l4xx_hal.h"
+#include "board.h"
+#include "memory_qspi.h"
+#include "rtstats.h"
+#include "power.h"
+
+#ifndef portTICK_PERIOD_MS
+#define portTICK_PERIOD_MS 1 //!< Without the kernel, the tick is the HAL one of 1 ms.
+#endif
+
+void powerPreSleep
+(
+  uint32_t* pxIdle
+)
+{
+  /* Ahead of the timeout when the sleep reaches it: nothing runs until the wake-up. */
+  if ((boardMemoryQspiIdleTime() + (*pxIdle * portTICK_PERIOD_MS)) >= C_POWER_QSPI_IDLE_MS)
+  {
+    (void) boardMemoryQspiPowerDown();
+  } /* if */
+
+#if (C_RTSTATS_ENABLE == 1)
+  rtstatsSleepEnter();
+#endif
+} /* powerPreSleep() */
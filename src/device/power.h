@@ -0,0 +1,34 @@
+#ifndef DEVICE_POWER_H_
+#define DEVICE_POWER_H_
+
+#include <stdint.h>
+
+/*
+ * Low power policy. With tickless idle (configUSE_TICKLESS_IDLE), the idle task
+ * stops the tick and sleeps until the next task is due or an interrupt comes:
+ * the Wi-Fi data ready line, the UART, the user button. Before the CPU sleeps,
+ * the QSPI memory goes to deep power-down when it will have been idle for
+ * C_POWER_QSPI_IDLE_MS by the expected wake-up; the next flash operation wakes
+ * it up and pays the 35 us. The Wi-Fi module keeps its own power state.
+ *
+ * Called by the kernel with the interrupts masked, through configPRE_SLEEP_PROCESSING
+ * of FreeRTOSConfig.h, which includes this header: nothing but types here.
+ */
+
+#ifndef C_POWER_QSPI_IDLE_MS
+#define C_POWER_QSPI_IDLE_MS 100 //!< Idle time of the flash before deep power-down. A wake-up
+                                 //   spins 35 us at about 10 mA, deep power-down saves 5 to
+                                 //   8 uA: it pays off after 45 to 70 ms.
+#endif
+
+/**
+ * @brief                   kernel hook, before the CPU sleeps
+ * @param[in,out] pxIdle    ticks the kernel expects to sleep, 0 to skip the wfi
+ * @return                  none
+ */
+void powerPreSleep
+(
+  uint32_t* pxIdle
+);
+
+#endif /* DEVICE_POWER_H_ */
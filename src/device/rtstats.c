@@ -0,0 +1,330 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "stm32l4xx_hal.h"
+#include "board.h"
+#include "rtstats.h"
+
+#define C_RTSTATS_NONE C_RTSTATS_TASKS //!< Slot of the running task before the first switch.
+
+static uint64_t rtstatsCycles = 0; //!< Cycle counter extended to 64 bits, at the last read.
+
+static uint32_t rtstatsLast = 0; //!< Cycle counter at the last read.
+
+static uint64_t rtstatsWindowStart = 0; //!< Cycles at the last rtstatsReset.
+
+static RTSTATS_Task rtstatsTasks[C_RTSTATS_TASKS]; //!< Counters of the tasks, by trace number.
+
+static uint32_t rtstatsReadyAt[C_RTSTATS_TASKS]; //!< Cycle counter when the task got ready.
+
+static uint8_t rtstatsReady[C_RTSTATS_TASKS]; //!< 1 while rtstatsReadyAt is valid.
+
+static uint32_t rtstatsRunning = C_RTSTATS_NONE; //!< Slot of the running task.
+
+static void* rtstatsCurrent = NULL; //!< Running task.
+
+static uint64_t rtstatsSwitchedIn = 0; //!< Cycles when the running task was switched in.
+
+static uint64_t rtstatsIrqInSlice = 0; //!< Interrupt cycles since the running task was switched in.
+
+static volatile uint32_t rtstatsNesting = 0; //!< Interrupts timed in progress.
+
+static RTSTATS_Irq rtstatsIrqs[RTSTATS_IRQ_COUNT]; //!< Counters of the interrupts.
+
+static RTSTATS_Total rtstatsTotal; //!< Counters of the system, window excepted.
+
+static uint32_t rtstatsSleptAt = 0; //!< Cycle counter when the CPU went to sleep.
+
+static uint8_t rtstatsAsleep = 0; //!< 1 from rtstatsSleepEnter to rtstatsSleepExit.
+
+/*
+ * @brief               slot of a task
+ * @param[in] xNumber   trace number of the task
+ * @return              slot
+ */
+static uint32_t rtstatsSlot
+(
+  uint32_t xNumber
+)
+{
+  return (xNumber < C_RTSTATS_TASKS) ? xNumber : 0;
+} /* rtstatsSlot() */
+
+/*
+ * @brief   extends the cycle counter, interrupts masked
+ * @return  cycles since boot
+ */
+static uint64_t rtstatsNowMasked
+(
+  void
+)
+{
+  uint32_t now = boardGetCycles();
+
+  rtstatsCycles += (uint32_t) (now - rtstatsLast);
+  rtstatsLast = now;
+
+  return rtstatsCycles;
+} /* rtstatsNowMasked() */
+
+/*
+ * @brief               cycles of the running task not counted yet
+ * @param[in] xNow      cycles since boot
+ * @return              cycles
+ */
+static uint64_t rtstatsSlice
+(
+  uint64_t xNow
+)
+{
+  uint64_t elapsed = xNow - rtstatsSwitchedIn;
+
+  return (elapsed > rtstatsIrqInSlice) ? (elapsed - rtstatsIrqInSlice) : 0;
+} /* rtstatsSlice() */
+
+uint64_t rtstatsNow
+(
+  void
+)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint64_t now;
+
+  __disable_irq();
+  now = rtstatsNowMasked();
+  __set_PRIMASK(primask);
+
+  return now;
+} /* rtstatsNow() */
+
+void rtstatsTick
+(
+  void
+)
+{
+  rtstatsNow();
+} /* rtstatsTick() */
+
+void rtstatsTaskOut
+(
+  void
+)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint64_t now;
+
+  __disable_irq();
+  now = rtstatsNowMasked();
+  if (C_RTSTATS_NONE != rtstatsRunning)
+  {
+    rtstatsTasks[rtstatsRunning].cycles += rtstatsSlice(now);
+  } /* if */
+  rtstatsSwitchedIn = now;
+  rtstatsIrqInSlice = 0;
+  __set_PRIMASK(primask);
+} /* rtstatsTaskOut() */
+
+void rtstatsTaskIn
+(
+  void*    pxTask,
+  uint32_t xNumber
+)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t slot = rtstatsSlot(xNumber);
+  uint32_t latency;
+
+  __disable_irq();
+
+  /* The kernel switches out and in the same task when nothing else is ready. */
+  if (pxTask != rtstatsCurrent)
+  {
+    rtstatsCurrent = pxTask;
+    rtstatsTasks[slot].task = pxTask;
+    rtstatsTasks[slot].switches++;
+    rtstatsTotal.switches++;
+  } /* if */
+  rtstatsRunning = slot;
+
+  if (0 != rtstatsReady[slot])
+  {
+    latency = boardGetCycles() - rtstatsReadyAt[slot];
+    rtstatsReady[slot] = 0;
+    if (latency > rtstatsTasks[slot].maxReadyCycles)
+    {
+      rtstatsTasks[slot].maxReadyCycles = latency;
+    } /* if */
+    if (latency > rtstatsTotal.maxReadyCycles)
+    {
+      rtstatsTotal.maxReadyCycles = latency;
+    } /* if */
+  } /* if */
+
+  __set_PRIMASK(primask);
+} /* rtstatsTaskIn() */
+
+void rtstatsTaskReady
+(
+  uint32_t xNumber
+)
+{
+  uint32_t slot = rtstatsSlot(xNumber);
+
+  /* Called with the kernel data locked: the first time it got ready counts. */
+  if (0 == rtstatsReady[slot])
+  {
+    rtstatsReadyAt[slot] = boardGetCycles();
+    rtstatsReady[slot] = 1;
+  } /* if */
+} /* rtstatsTaskReady() */
+
+void rtstatsSleepEnter
+(
+  void
+)
+{
+  rtstatsSleptAt = boardGetCycles();
+  rtstatsAsleep = 1;
+} /* rtstatsSleepEnter() */
+
+void rtstatsSleepExit
+(
+  uint32_t xCycles
+)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t counted;
+
+  __disable_irq();
+
+  if (0 != rtstatsAsleep)
+  {
+    rtstatsAsleep = 0;
+    rtstatsTotal.sleepCycles += xCycles;
+
+    /* The counter runs on in sleep under a debugger: add what it missed only. */
+    counted = boardGetCycles() - rtstatsSleptAt;
+    (void) rtstatsNowMasked();
+    if (xCycles > counted)
+    {
+      rtstatsCycles += xCycles - counted;
+    } /* if */
+  } /* if */
+
+  __set_PRIMASK(primask);
+} /* rtstatsSleepExit() */
+
+uint32_t rtstatsIrqEnter
+(
+  void
+)
+{
+  rtstatsNesting++;
+  return boardGetCycles();
+} /* rtstatsIrqEnter() */
+
+void rtstatsIrqExit
+(
+  RTSTATS_IrqId xIrq,
+  uint32_t      xStart
+)
+{
+  uint32_t     primask = __get_PRIMASK();
+  uint32_t     cycles = boardGetCycles() - xStart;
+  RTSTATS_Irq* irq = &rtstatsIrqs[xIrq];
+
+  __disable_irq();
+
+  irq->count++;
+  irq->cycles += cycles;
+  if (cycles > irq->maxCycles)
+  {
+    irq->maxCycles = cycles;
+  } /* if */
+
+  /* Nested interrupts are already in the time of the outermost one. */
+  rtstatsNesting--;
+  if (0 == rtstatsNesting)
+  {
+    rtstatsTotal.irqCycles += cycles;
+    rtstatsIrqInSlice += cycles;
+  } /* if */
+
+  __set_PRIMASK(primask);
+} /* rtstatsIrqExit() */
+
+void rtstatsReset
+(
+  void
+)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t i;
+
+  __disable_irq();
+
+  for (i = 0; i < C_RTSTATS_TASKS; i++)
+  {
+    rtstatsTasks[i].cycles = 0;
+    rtstatsTasks[i].switches = 0;
+    rtstatsTasks[i].maxReadyCycles = 0;
+  } /* for */
+  memset(rtstatsIrqs, 0, sizeof(rtstatsIrqs));
+  memset(&rtstatsTotal, 0, sizeof(rtstatsTotal));
+
+  rtstatsWindowStart = rtstatsNowMasked();
+  rtstatsSwitchedIn = rtstatsWindowStart;
+  rtstatsIrqInSlice = 0;
+
+  __set_PRIMASK(primask);
+} /* rtstatsReset() */
+
+int rtstatsGetTask
+(
+  uint32_t      xSlot,
+  RTSTATS_Task* pxTask
+)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  if ((xSlot >= C_RTSTATS_TASKS) || (NULL == rtstatsTasks[xSlot].task))
+  {
+    return 0;
+  } /* if */
+
+  __disable_irq();
+  *pxTask = rtstatsTasks[xSlot];
+  if (xSlot == rtstatsRunning)
+  {
+    pxTask->cycles += rtstatsSlice(rtstatsNowMasked());
+  } /* if */
+  __set_PRIMASK(primask);
+
+  return 1;
+} /* rtstatsGetTask() */
+
+void rtstatsGetIrq
+(
+  RTSTATS_IrqId xIrq,
+  RTSTATS_Irq*  pxIrq
+)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  *pxIrq = rtstatsIrqs[xIrq];
+  __set_PRIMASK(primask);
+} /* rtstatsGetIrq() */
+
+void rtstatsGetTotal
+(
+  RTSTATS_Total* pxTotal
+)
+{
+  uint32_t primask = __get_PRIMASK();
+
+  __disable_irq();
+  *pxTotal = rtstatsTotal;
+  pxTotal->window = rtstatsNowMasked() - rtstatsWindowStart;
+  __set_PRIMASK(primask);
+} /* rtstatsGetTotal() */
@@ -0,0 +1,214 @@
+#ifndef DEVICE_RTSTATS_H_
+#define DEVICE_RTSTATS_H_
+
+#include <stdint.h>
+
+/*
+ * Runtime statistics, counted in CPU cycles with the DWT cycle counter,
+ * extended to 64 bits: time each task runs, the times it is switched in, its
+ * longest wait between ready and running, and the time spent in the
+ * interrupts of the drivers. Interrupt time is not counted in the task it
+ * interrupted.
+ *
+ * The FreeRTOS trace macros of FreeRTOSConfig.h call the task hooks from the
+ * kernel: tasks are told apart by their trace number (uxTCBNumber), so the
+ * hooks do no search. The cycle counter stops while the CPU sleeps: the tickless
+ * sleeps are added back, to the tick, and counted in the idle task. Included by
+ * FreeRTOSConfig.h: nothing but types here.
+ */
+
+#ifndef C_RTSTATS_ENABLE
+#define C_RTSTATS_ENABLE 1 //!< 0 removes the hooks from the kernel and the drivers.
+#endif
+
+#define C_RTSTATS_TASKS 16 //!< Tasks counted apart, by trace number. Slot 0 counts the
+                           //   tasks beyond.
+
+/**
+ * @brief  Interrupts timed, one per driver: its DMA channels and lines count with it
+ */
+typedef enum
+{
+  RTSTATS_IRQ_SPI3    = 0x00U, /**< Wi-Fi module: SPI3, its DMA channels */
+  RTSTATS_IRQ_EXTI    = 0x01U, /**< Wi-Fi data ready and user button lines */
+  RTSTATS_IRQ_QUADSPI = 0x02U, /**< QSPI flash */
+  RTSTATS_IRQ_USART1  = 0x03U, /**< console: USART1, its TX DMA channel */
+  RTSTATS_IRQ_COUNT   = 0x04U  /**< number of interrupts timed */
+} RTSTATS_IrqId;
+
+/**
+ * @brief  Counters of a task
+ */
+typedef struct
+{
+  void*    task;           /**< handle of the task, NULL for a free slot */
+  uint64_t cycles;         /**< cycles run, interrupts excluded */
+  uint32_t switches;       /**< times switched in */
+  uint32_t maxReadyCycles; /**< longest time from ready to running */
+} RTSTATS_Task;
+
+/**
+ * @brief  Counters of an interrupt
+ */
+typedef struct
+{
+  uint32_t count;     /**< times entered */
+  uint64_t cycles;    /**< cycles spent, nested interrupts included */
+  uint32_t maxCycles; /**< longest run */
+} RTSTATS_Irq;
+
+/**
+ * @brief  Counters of the whole system
+ */
+typedef struct
+{
+  uint64_t window;         /**< cycles since rtstatsReset */
+  uint64_t irqCycles;      /**< cycles in the interrupts timed, outermost only */
+  uint32_t switches;       /**< context switches to another task */
+  uint32_t maxReadyCycles; /**< longest time from ready to running of any task */
+  uint64_t sleepCycles;    /**< cycles asleep in tickless idle, to the tick */
+} RTSTATS_Total;
+
+/**
+ * @brief   reads the cycle counter, extended to 64 bits. Must be called at
+ *          least once per wrap of the 32-bit counter: the tick does it.
+ * @return  cycles since boot
+ */
+uint64_t rtstatsNow
+(
+  void
+);
+
+/**
+ * @brief   kernel hook, on each tick
+ * @return  none
+ */
+void rtstatsTick
+(
+  void
+);
+
+/**
+ * @brief   kernel hook, before the running task is switched out
+ * @return  none
+ */
+void rtstatsTaskOut
+(
+  void
+);
+
+/**
+ * @brief                kernel hook, after a task is selected to run
+ * @param[in] pxTask     task
+ * @param[in] xNumber    trace number of the task
+ * @return               none
+ */
+void rtstatsTaskIn
+(
+  void*    pxTask,
+  uint32_t xNumber
+);
+
+/**
+ * @brief                kernel hook, when a task is put in a ready list
+ * @param[in] xNumber    trace number of the task
+ * @return               none
+ */
+void rtstatsTaskReady
+(
+  uint32_t xNumber
+);
+
+/**
+ * @brief   to call with the interrupts masked, right before the CPU sleeps
+ * @return  none
+ */
+void rtstatsSleepEnter
+(
+  void
+);
+
+/**
+ * @brief                kernel hook, when the tick count steps over a tickless sleep
+ * @param[in] xCycles    cycles of the ticks slept
+ * @return               none
+ */
+void rtstatsSleepExit
+(
+  uint32_t xCycles
+);
+
+/**
+ * @brief   to call first in an interrupt handler
+ * @return  value for rtstatsIrqExit
+ */
+uint32_t rtstatsIrqEnter
+(
+  void
+);
+
+/**
+ * @brief                to call last in an interrupt handler
+ * @param[in] xIrq       interrupt
+ * @param[in] xStart     value of rtstatsIrqEnter
+ * @return               none
+ */
+void rtstatsIrqExit
+(
+  RTSTATS_IrqId xIrq,
+  uint32_t      xStart
+);
+
+/**
+ * @brief   clears the counters and starts a new window
+ * @return  none
+ */
+void rtstatsReset
+(
+  void
+);
+
+/**
+ * @brief                gets the counters of a task
+ * @param[in] xSlot      0 to C_RTSTATS_TASKS - 1
+ * @param[out] pxTask    counters
+ * @return               0 when the slot is free or out of range, 1 otherwise
+ */
+int rtstatsGetTask
+(
+  uint32_t      xSlot,
+  RTSTATS_Task* pxTask
+);
+
+/**
+ * @brief                gets the counters of an interrupt
+ * @param[in] xIrq       interrupt
+ * @param[out] pxIrq     counters
+ * @return               none
+ */
+void rtstatsGetIrq
+(
+  RTSTATS_IrqId xIrq,
+  RTSTATS_Irq*  pxIrq
+);
+
+/**
+ * @brief                gets the counters of the system
+ * @param[out] pxTotal   counters
+ * @return               none
+ */
+void rtstatsGetTotal
+(
+  RTSTATS_Total* pxTotal
+);
+
+#if (C_RTSTATS_ENABLE == 1)
+/* Statements of the handlers, around the HAL handler. */
+#define M_RTSTATS_IRQ_ENTER() uint32_t rtstatsStart = rtstatsIrqEnter()
+#define M_RTSTATS_IRQ_EXIT(xIrq) rtstatsIrqExit((xIrq), rtstatsStart)
+#else
+#define M_RTSTATS_IRQ_ENTER()
+#define M_RTSTATS_IRQ_EXIT(xIrq)
+#endif
+
+#endif /* DEVICE_RTSTATS_H_ */
@@ -1,12 +1,29 @@
 #include "es_wifi_io.h"
 #include "es_wifi.h"
 #include "spi_wifi.h"
+#include "spiffs_fs.h"
+#include "binlog.h"
+#include "rtstats.h"
+#include "boottime.h"
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
-/** To enable or disable log for this module. */
+#ifdef C_BOARD_USE_FREE_RTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "event_groups.h"
+#endif
+
+/** Log of this module: 0 off, 1 printf, 2 binary records (binlog.h). Without the
+ *  kernel no log task sends the records: printf. */
+#ifdef C_BOARD_USE_FREE_RTOS
+#define C_SPI_WIFI_ENABLE_LOG  2
+#else
 #define C_SPI_WIFI_ENABLE_LOG  1
+#endif
 /** Module name to display. */
 #define C_SPI_WIFI_MODULE_NAME "WIFI"
 
@@ -16,15 +33,105 @@
 #define C_SPI_WIFI_PASSWORD ""
 /** Number of attempts to bind to a connection. */
 #define C_SPI_WIFI_MAX_CONNECTION_TRIAL 10
+/** Size of the buffer of wifiReceiveToFile. It is written to the file once
+ *  the next datagram may not fit, in one SPIFFS_write. */
+#define C_SPI_WIFI_FILE_CHUNK_SIZE 4096
 
 /** Module structure containing the state of the WIFI. */
 static ES_WIFIObject_t gWifiModuleStructure;
+/** Data received by wifiReceiveToFile, not written to the file yet. */
+static uint8_t gWifiFileBuffer[C_SPI_WIFI_FILE_CHUNK_SIZE];
+
+#ifdef C_BOARD_USE_FREE_RTOS
+/** Size of the RX ring of a socket, power of two. */
+#define C_SPI_WIFI_RX_RING_SIZE       4096
+/** Size of the header of a datagram in a RX ring: length, port, IP address. */
+#define C_SPI_WIFI_RX_RECORD_HEADER   8
+/** R2 timeout of a poll (ms): the module answers at once when idle. */
+#define C_SPI_WIFI_RX_READ_TIMEOUT_MS 1
+/** Delay between polls after a datagram (ms). */
+#define C_SPI_WIFI_RX_POLL_MIN_MS     1
+/** Delay between polls is doubled up to this value when idle (ms). */
+#define C_SPI_WIFI_RX_POLL_MAX_MS     64
+/** Stack of the RX task, in words. */
+#define C_SPI_WIFI_RX_TASK_STACK      512
+/** Priority of the RX task, below the consumers. */
+#define C_SPI_WIFI_RX_TASK_PRIORITY   (tskIDLE_PRIORITY + 1)
+
+/** Ring of the datagrams of a socket, written by the RX task only and read
+ *  by one consumer. head and tail run free and are masked on access. */
+typedef struct
+{
+  uint8_t           used;
+  uint8_t           sourceAddress;
+  TaskHandle_t      waiter;
+  volatile uint32_t head;
+  volatile uint32_t tail;
+  uint8_t           data[C_SPI_WIFI_RX_RING_SIZE];
+} WIFI_RxRing;
+
+/** Serializes the accesses to gWifiModuleStructure. */
+static SemaphoreHandle_t gWifiMutex;
+/** RX task, NULL until wifiRxStart. */
+static TaskHandle_t gWifiRxTask;
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+/** Storage of gWifiMutex. */
+static StaticSemaphore_t gWifiMutexBuffer;
+/** Control block of the RX task. */
+static StaticTask_t gWifiRxTaskBuffer;
+/** Stack of the RX task. */
+static StackType_t gWifiRxTaskStack[C_SPI_WIFI_RX_TASK_STACK];
+#endif
+/** One ring per module socket. */
+static WIFI_RxRing gWifiRxRings[ES_WIFI_MAX_SOCKETS];
+/** Counters of the RX task. */
+static WIFI_RxStats gWifiRxStats;
+/** Staging buffer of the RX task when the remote address is queried. */
+static uint8_t gWifiRxBuffer[ES_WIFI_PAYLOAD_SIZE];
+
+/** Period of the link check while joined (ms): the module does not report a
+ *  lost link over SPI. */
+#define C_SPI_WIFI_LINK_CHECK_MS      10000
+/** Delay before the second join attempt (ms), doubled after each failure. */
+#define C_SPI_WIFI_LINK_RETRY_MIN_MS  250
+/** Maximum delay between two join attempts (ms). */
+#define C_SPI_WIFI_LINK_RETRY_MAX_MS  16000
+/** Event: the wanted state of the link changed. */
+#define C_SPI_WIFI_LINK_EV_REQUEST    (1 << 0)
+/** Event: a command failed, the link may be down. */
+#define C_SPI_WIFI_LINK_EV_CHECK      (1 << 1)
+/** State: joined to the access point. */
+#define C_SPI_WIFI_LINK_EV_UP         (1 << 2)
+
+/** Events of the connection manager, created by wifiInit. */
+static EventGroupHandle_t gWifiLinkEvents;
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+/** Storage of gWifiLinkEvents. */
+static StaticEventGroup_t gWifiLinkEventsBuffer;
+#endif
+/** Link wanted by the last request. */
+static volatile uint8_t gWifiLinkWanted;
+/** Settings of the last DHCP lease, a hint only: every join runs DHCP. */
+static ES_WIFI_Network_t gWifiLinkLease;
+/** gWifiLinkLease holds a lease. */
+static uint8_t gWifiLinkLeaseValid;
+/** Counters of the connection manager. */
+static WIFI_LinkStats gWifiLinkStats;
+
+  #define M_SPI_WIFI_LOCK()   xSemaphoreTake(gWifiMutex, portMAX_DELAY)
+  #define M_SPI_WIFI_UNLOCK() xSemaphoreGive(gWifiMutex)
+#else
+  #define M_SPI_WIFI_LOCK()
+  #define M_SPI_WIFI_UNLOCK()
+#endif
 
 /*
  * @brief Display a text if log is enabled.
  */
 #if (C_SPI_WIFI_ENABLE_LOG == 1)
   #define M_SPI_WIFI_LOG printf
+#elif (C_SPI_WIFI_ENABLE_LOG == 2)
+  #define M_SPI_WIFI_LOG M_BINLOG
 #else
   #define M_SPI_WIFI_LOG //
 #endif
@@ -53,7 +160,439 @@ void SPI3_IRQHandler
   void
 )
 {
+  M_RTSTATS_IRQ_ENTER();
   HAL_SPI_IRQHandler(&hspi);
+  M_RTSTATS_IRQ_EXIT(RTSTATS_IRQ_SPI3);
+}
+
+#if (ES_WIFI_USE_SPI_DMA == 1)
+void DMA2_Channel1_IRQHandler
+(
+  void
+)
+{
+  M_RTSTATS_IRQ_ENTER();
+  HAL_DMA_IRQHandler(hspi.hdmarx);
+  M_RTSTATS_IRQ_EXIT(RTSTATS_IRQ_SPI3);
+}
+
+void DMA2_Channel2_IRQHandler
+(
+  void
+)
+{
+  M_RTSTATS_IRQ_ENTER();
+  HAL_DMA_IRQHandler(hspi.hdmatx);
+  M_RTSTATS_IRQ_EXIT(RTSTATS_IRQ_SPI3);
+}
+#endif
+
+#ifdef C_BOARD_USE_FREE_RTOS
+/*
+ * @brief              copies data into a RX ring, wrapping around its end
+ * @param[in] pxRing   ring to write
+ * @param[in] xIndex   free-running index of the first byte
+ * @param[in] pxData   data to copy
+ * @param[in] xLength  length of the data
+ * @return             none
+ */
+static void wifiRxRingWrite
+(
+  WIFI_RxRing*   pxRing,
+  uint32_t       xIndex,
+  const uint8_t* pxData,
+  uint32_t       xLength
+)
+{
+  uint32_t offset = xIndex & (C_SPI_WIFI_RX_RING_SIZE - 1);
+  uint32_t first = C_SPI_WIFI_RX_RING_SIZE - offset;
+
+  if (first > xLength)
+  {
+    first = xLength;
+  }
+  memcpy(&pxRing->data[offset], pxData, first);
+  memcpy(pxRing->data, &pxData[first], xLength - first);
+}
+
+/*
+ * @brief              copies data out of a RX ring, wrapping around its end
+ * @param[in] pxRing   ring to read
+ * @param[in] xIndex   free-running index of the first byte
+ * @param[out] pxData  destination
+ * @param[in] xLength  length of the data
+ * @return             none
+ */
+static void wifiRxRingRead
+(
+  WIFI_RxRing* pxRing,
+  uint32_t     xIndex,
+  uint8_t*     pxData,
+  uint32_t     xLength
+)
+{
+  uint32_t offset = xIndex & (C_SPI_WIFI_RX_RING_SIZE - 1);
+  uint32_t first = C_SPI_WIFI_RX_RING_SIZE - offset;
+
+  if (first > xLength)
+  {
+    first = xLength;
+  }
+  memcpy(pxData, &pxRing->data[offset], first);
+  memcpy(&pxData[first], pxRing->data, xLength - first);
+}
+
+/*
+ * @brief                 stores a datagram in the ring of a socket and wakes its reader
+ * @param[in] pxRing      ring of the socket, with room for the datagram
+ * @param[in] pxData      datagram
+ * @param[in] xLength     length of the datagram
+ * @param[in] pxAddress   4-byte IP address of the remote host
+ * @param[in] xPort       port number of the remote host
+ * @return                none
+ */
+static void wifiRxRingPush
+(
+  WIFI_RxRing*   pxRing,
+  const uint8_t* pxData,
+  uint16_t       xLength,
+  const uint8_t* pxAddress,
+  uint16_t       xPort
+)
+{
+  uint8_t header[C_SPI_WIFI_RX_RECORD_HEADER];
+  uint32_t head = pxRing->head;
+
+  header[0] = (uint8_t) xLength;
+  header[1] = (uint8_t) (xLength >> 8);
+  header[2] = (uint8_t) xPort;
+  header[3] = (uint8_t) (xPort >> 8);
+  memcpy(&header[4], pxAddress, 4);
+
+  wifiRxRingWrite(pxRing, head, header, sizeof(header));
+  wifiRxRingWrite(pxRing, head + sizeof(header), pxData, xLength);
+  /* The record must be in memory before the reader sees the new head. */
+  __DMB();
+  pxRing->head = head + sizeof(header) + xLength;
+
+  gWifiRxStats.datagrams++;
+  if (NULL != pxRing->waiter)
+  {
+    xTaskNotifyGive(pxRing->waiter);
+  }
+}
+
+/*
+ * @brief                    reads the next datagram of a serviced socket
+ * @param[in] pxRing         ring of the socket
+ * @param[out] pxData        buffer, the end of a longer datagram is dropped
+ * @param[in] xBufferSize    size of the buffer
+ * @param[out] pxReceived    length of the data copied, 0 on timeout
+ * @param[in] xTimeout       time to wait for a datagram (ms)
+ * @param[out] pxAddress     4-byte IP address of the remote host
+ * @param[out] pxPort        port number of the remote host
+ * @return                   ES_WIFI_STATUS_ERROR if the socket is closed meanwhile
+ */
+static ES_WIFI_Status_t wifiRxRead
+(
+  WIFI_RxRing* pxRing,
+  uint8_t*     pxData,
+  uint16_t     xBufferSize,
+  uint16_t*    pxReceived,
+  uint32_t     xTimeout,
+  uint8_t*     pxAddress,
+  uint16_t*    pxPort
+)
+{
+  uint8_t header[C_SPI_WIFI_RX_RECORD_HEADER];
+  const TickType_t start = xTaskGetTickCount();
+  const TickType_t wait = pdMS_TO_TICKS(xTimeout);
+  TickType_t elapsed;
+  uint32_t tail = pxRing->tail;
+  uint16_t length;
+
+  *pxReceived = 0;
+
+  /* Register before looking at the ring: a datagram stored in between leaves
+   * a pending notification and the take below returns at once. */
+  pxRing->waiter = xTaskGetCurrentTaskHandle();
+  while (pxRing->head == tail)
+  {
+    elapsed = xTaskGetTickCount() - start;
+    if ((0 == pxRing->used) || (elapsed >= wait))
+    {
+      pxRing->waiter = NULL;
+      return (0 == pxRing->used) ? ES_WIFI_STATUS_ERROR : ES_WIFI_STATUS_OK;
+    }
+    ulTaskNotifyTake(pdTRUE, wait - elapsed);
+  }
+  pxRing->waiter = NULL;
+  __DMB();
+
+  wifiRxRingRead(pxRing, tail, header, sizeof(header));
+  length = (uint16_t) (header[0] | (header[1] << 8));
+  *pxReceived = (length < xBufferSize) ? length : xBufferSize;
+  wifiRxRingRead(pxRing, tail + sizeof(header), pxData, *pxReceived);
+  if (NULL != pxPort)
+  {
+    *pxPort = (uint16_t) (header[2] | (header[3] << 8));
+  }
+  if (NULL != pxAddress)
+  {
+    memcpy(pxAddress, &header[4], 4);
+  }
+
+  /* The record is copied out before the RX task may reuse it. */
+  __DMB();
+  pxRing->tail = tail + sizeof(header) + length;
+
+  /* The RX task sleeps while no ring has room for a datagram: wake it up. */
+  if ((C_SPI_WIFI_RX_RING_SIZE - (pxRing->head - tail)) <
+      (C_SPI_WIFI_RX_RECORD_HEADER + ES_WIFI_PAYLOAD_SIZE))
+  {
+    xTaskNotifyGive(gWifiRxTask);
+  }
+
+  return ES_WIFI_STATUS_OK;
+}
+
+/*
+ * @brief                RX task: drains the serviced sockets into their rings.
+ *                       It runs below the consumers, which preempt it as soon
+ *                       as a datagram is stored. The delay between polls
+ *                       doubles while the sockets stay idle and is reset when
+ *                       data arrives or a datagram is sent. With no socket
+ *                       to poll, it sleeps until one is opened or a ring has
+ *                       room again, so the tick can stop.
+ * @param[in] pParameters Unused parameter list for the task
+ * @return                none.
+ */
+static void wifiRxTaskFunction
+(
+  void* pParameters
+)
+{
+  uint32_t pollDelay = C_SPI_WIFI_RX_POLL_MIN_MS;
+  uint8_t address[4];
+  uint16_t port;
+  uint8_t* data;
+  uint16_t length;
+  uint8_t received;
+  uint8_t polled;
+  uint8_t socketId;
+  WIFI_RxRing* ring;
+  ES_WIFI_Status_t wifiResult;
+
+  (void) pParameters;
+
+  for (;;)
+  {
+    received = 0;
+    polled = 0;
+
+    for (socketId = 0; socketId < ES_WIFI_MAX_SOCKETS; socketId++)
+    {
+      ring = &gWifiRxRings[socketId];
+
+      M_SPI_WIFI_LOCK();
+      if (0 == ring->used)
+      {
+        M_SPI_WIFI_UNLOCK();
+        continue;
+      }
+
+      /* Leave the data in the module until the reader makes room. */
+      if ((C_SPI_WIFI_RX_RING_SIZE - (ring->head - ring->tail)) <
+          (C_SPI_WIFI_RX_RECORD_HEADER + ES_WIFI_PAYLOAD_SIZE))
+      {
+        M_SPI_WIFI_UNLOCK();
+        gWifiRxStats.full++;
+        continue;
+      }
+
+      gWifiRxStats.polls++;
+      polled = 1;
+      if (0 != ring->sourceAddress)
+      {
+        data = gWifiRxBuffer;
+        wifiResult = ES_WIFI_ReceiveDataFrom(&gWifiModuleStructure, socketId, data,
+            ES_WIFI_PAYLOAD_SIZE, &length, C_SPI_WIFI_RX_READ_TIMEOUT_MS, address, &port);
+      }
+      else
+      {
+        memset(address, 0, sizeof(address));
+        port = 0;
+        wifiResult = ES_WIFI_ReceiveDataSpan(&gWifiModuleStructure, socketId, &data,
+            ES_WIFI_PAYLOAD_SIZE, &length, C_SPI_WIFI_RX_READ_TIMEOUT_MS);
+      }
+
+      if (ES_WIFI_STATUS_OK != wifiResult)
+      {
+        gWifiRxStats.errors++;
+      }
+      else if (0 < length)
+      {
+        /* data may point into the module structure: push under the mutex. */
+        wifiRxRingPush(ring, data, length, address, port);
+        received = 1;
+      }
+      M_SPI_WIFI_UNLOCK();
+    }
+
+    if (0 != received)
+    {
+      /* More may be queued in the module: poll again at once. */
+      pollDelay = C_SPI_WIFI_RX_POLL_MIN_MS;
+      continue;
+    }
+
+    /* The module does not signal a datagram: poll the open sockets, and wait
+       for wifiRxOpen or a reader when there is nothing to poll. */
+    if (0 != ulTaskNotifyTake(pdTRUE, (0 != polled) ? pdMS_TO_TICKS(pollDelay) : portMAX_DELAY))
+    {
+      pollDelay = C_SPI_WIFI_RX_POLL_MIN_MS;
+    }
+    else if (pollDelay < C_SPI_WIFI_RX_POLL_MAX_MS)
+    {
+      pollDelay *= 2;
+    }
+  }
+}
+#endif
+
+/*
+ * @brief                 reads the next chunk of a file sent by wifiSendFile
+ * @param[in] pContext    pointer to the file descriptor
+ * @param[out] pxData     destination, in the SPI staging buffer
+ * @param[in] xLength     length of the chunk
+ * @return                number of bytes read, negative on error
+ */
+static int32_t wifiFillFromFile
+(
+  void*    pContext,
+  uint8_t* pxData,
+  uint16_t xLength
+)
+{
+  return SPIFFS_read(&gSpiffsFs, *(spiffs_file*) pContext, pxData, xLength);
+}
+
+/*
+ * @brief              restarts the RX task polling at its shortest delay,
+ *                     as a reply usually follows a sent datagram
+ * @return             none
+ */
+static void wifiRxKick
+(
+  void
+)
+{
+#ifdef C_BOARD_USE_FREE_RTOS
+  if (NULL != gWifiRxTask)
+  {
+    xTaskNotifyGive(gWifiRxTask);
+  }
+#endif
+}
+
+/*
+ * @brief              has the connection manager check the link after a
+ *                     failed command
+ * @param[in] xResult  status of the command
+ * @return             none
+ */
+static void wifiLinkCheck
+(
+  ES_WIFI_Status_t xResult
+)
+{
+#ifdef C_BOARD_USE_FREE_RTOS
+  if ((ES_WIFI_STATUS_ERROR == xResult) && (NULL != gWifiLinkEvents))
+  {
+    xEventGroupSetBits(gWifiLinkEvents, C_SPI_WIFI_LINK_EV_CHECK);
+  }
+#else
+  (void) xResult;
+#endif
+}
+
+#ifdef C_BOARD_USE_FREE_RTOS
+/*
+ * @brief   joins the access point for the connection manager, always with
+ *          DHCP: the module does not report the lease time, so the address of
+ *          the last lease may have been given to another station. That lease
+ *          is only compared with the new one, a changed address is counted.
+ * @return  operation status
+ */
+static ES_WIFI_Status_t wifiLinkJoin
+(
+  void
+)
+{
+  ES_WIFI_Status_t wifiResult;
+
+  wifiResult = wifiConnectTo();
+  if (ES_WIFI_STATUS_OK == wifiResult)
+  {
+    M_SPI_WIFI_LOCK();
+    if ((0 != gWifiLinkLeaseValid) && (0 != memcmp(gWifiLinkLease.IP_Addr,
+        gWifiModuleStructure.NetSettings.IP_Addr, sizeof(gWifiLinkLease.IP_Addr))))
+    {
+      gWifiLinkStats.addressChanges++;
+      M_SPI_WIFI_LOG("Address changed from %d.%d.%d.%d.",
+          gWifiLinkLease.IP_Addr[0], gWifiLinkLease.IP_Addr[1],
+          gWifiLinkLease.IP_Addr[2], gWifiLinkLease.IP_Addr[3]);
+    }
+    gWifiLinkLease = gWifiModuleStructure.NetSettings;
+    gWifiLinkLeaseValid = 1;
+    M_SPI_WIFI_UNLOCK();
+  }
+
+  return wifiResult;
+}
+#endif
+
+/*
+ * @brief                 receives the next data of a socket for wifiReceiveToFile.
+ *                        A socket serviced by the RX task is read from its ring,
+ *                        which the task refills while the caller programs the flash.
+ * @param[in] xSocketId   ID of the socket
+ * @param[out] pxData     destination
+ * @param[in] xSize       room in the destination, at least ES_WIFI_PAYLOAD_SIZE
+ * @param[out] pxReceived length received, 0 on timeout
+ * @param[in] xTimeout    time to wait for data (ms)
+ * @return                operation status
+ */
+static ES_WIFI_Status_t wifiReceiveChunk
+(
+  uint8_t   xSocketId,
+  uint8_t*  pxData,
+  uint16_t  xSize,
+  uint16_t* pxReceived,
+  uint32_t  xTimeout
+)
+{
+  uint8_t* span;
+  ES_WIFI_Status_t wifiResult;
+
+#ifdef C_BOARD_USE_FREE_RTOS
+  if (0 != gWifiRxRings[xSocketId].used)
+  {
+    return wifiRxRead(&gWifiRxRings[xSocketId], pxData, xSize, pxReceived, xTimeout,
+        NULL, NULL);
+  }
+#endif
+
+  M_SPI_WIFI_LOCK();
+  wifiResult = ES_WIFI_ReceiveDataSpan(&gWifiModuleStructure, xSocketId, &span,
+      MIN(xSize, ES_WIFI_PAYLOAD_SIZE), pxReceived, xTimeout);
+  if ((ES_WIFI_STATUS_OK == wifiResult) && (0 < *pxReceived))
+  {
+    memcpy(pxData, span, *pxReceived);
+  }
+  M_SPI_WIFI_UNLOCK();
+
+  return wifiResult;
 }
 
 ES_WIFI_Status_t wifiInit
@@ -64,6 +603,35 @@ ES_WIFI_Status_t wifiInit
   uint8_t macAddress[6] = {0};
   ES_WIFI_Status_t wifiResult = ES_WIFI_STATUS_OK;
 
+#ifdef C_BOARD_USE_FREE_RTOS
+  if (NULL == gWifiMutex)
+  {
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    gWifiMutex = xSemaphoreCreateMutexStatic(&gWifiMutexBuffer);
+#else
+    gWifiMutex = xSemaphoreCreateMutex();
+#endif
+    if (NULL == gWifiMutex)
+    {
+      return ES_WIFI_STATUS_ERROR;
+    }
+  }
+
+  if (NULL == gWifiLinkEvents)
+  {
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    gWifiLinkEvents = xEventGroupCreateStatic(&gWifiLinkEventsBuffer);
+#else
+    gWifiLinkEvents = xEventGroupCreate();
+#endif
+    if (NULL == gWifiLinkEvents)
+    {
+      return ES_WIFI_STATUS_ERROR;
+    }
+  }
+#endif
+
+  M_SPI_WIFI_LOCK();
   for (;;)
   {
 
@@ -75,6 +643,13 @@ ES_WIFI_Status_t wifiInit
       break;
     }
 
+    /* Let ES_WIFI_SendStream fill the SPI staging buffers in place. */
+    wifiResult = ES_WIFI_RegisterTxBuffer(&gWifiModuleStructure, SPI_WIFI_GetTxBuffer);
+    if(ES_WIFI_STATUS_OK != wifiResult)
+    {
+      break;
+    }
+
     wifiResult = ES_WIFI_Init(&gWifiModuleStructure);
     if(ES_WIFI_STATUS_OK != wifiResult)
     {
@@ -94,6 +669,7 @@ ES_WIFI_Status_t wifiInit
 
     break;
   }
+  M_SPI_WIFI_UNLOCK();
 
   return wifiResult;
 }
@@ -106,6 +682,7 @@ ES_WIFI_Status_t wifiConnectTo
   uint8_t ipaddrV4[4] = {0};
   ES_WIFI_Status_t wifiResult = ES_WIFI_STATUS_ERROR;
 
+  M_SPI_WIFI_LOCK();
   for (;;)
   {
     wifiResult = ES_WIFI_Connect(&gWifiModuleStructure, C_SPI_WIFI_SSID,
@@ -141,6 +718,7 @@ ES_WIFI_Status_t wifiConnectTo
 
     break;
   }
+  M_SPI_WIFI_UNLOCK();
 
   return wifiResult;
 }
@@ -170,7 +748,9 @@ ES_WIFI_Status_t wifiBindToUdp
 
   while (trials--)
   {
+    M_SPI_WIFI_LOCK();
     wifiResult = ES_WIFI_StartClientConnection(&gWifiModuleStructure, &connection);
+    M_SPI_WIFI_UNLOCK();
     if(ES_WIFI_STATUS_OK == wifiResult)
     {
       M_SPI_WIFI_LOG("Connection opened successfully.");
@@ -180,6 +760,13 @@ ES_WIFI_Status_t wifiBindToUdp
     HAL_Delay(100);
   }
 
+#ifdef C_BOARD_USE_FREE_RTOS
+  if ((ES_WIFI_STATUS_OK == wifiResult) && (NULL != gWifiRxTask))
+  {
+    wifiResult = wifiRxOpen(xSocketId, 1);
+  }
+#endif
+
   return wifiResult;
 }
 
@@ -194,8 +781,22 @@ ES_WIFI_Status_t wifiReceiveDataFrom
   uint16_t*  xRecepientPort
 )
 {
-  return ES_WIFI_ReceiveDataFrom(&gWifiModuleStructure, xSocketId, pxDataReceive, xBufferSize,
+  ES_WIFI_Status_t wifiResult;
+
+#ifdef C_BOARD_USE_FREE_RTOS
+  if ((xSocketId < ES_WIFI_MAX_SOCKETS) && (0 != gWifiRxRings[xSocketId].used))
+  {
+    return wifiRxRead(&gWifiRxRings[xSocketId], pxDataReceive, xBufferSize, pxDataReceived,
+        xTimeout, pxRecepientAddress, xRecepientPort);
+  }
+#endif
+
+  M_SPI_WIFI_LOCK();
+  wifiResult = ES_WIFI_ReceiveDataFrom(&gWifiModuleStructure, xSocketId, pxDataReceive, xBufferSize,
       pxDataReceived, xTimeout, pxRecepientAddress, xRecepientPort);
+  M_SPI_WIFI_UNLOCK();
+
+  return wifiResult;
 }
 
 ES_WIFI_Status_t wifiSendDataTo
@@ -209,8 +810,175 @@ ES_WIFI_Status_t wifiSendDataTo
   uint16_t   xRecepientPort
 )
 {
-  return ES_WIFI_SendDataTo(&gWifiModuleStructure, xSocketId, pxDataToSend, xSizeData, pxDataSent,
+  ES_WIFI_Status_t wifiResult;
+
+  M_SPI_WIFI_LOCK();
+  wifiResult = ES_WIFI_SendDataTo(&gWifiModuleStructure, xSocketId, pxDataToSend, xSizeData, pxDataSent,
       xTimeoutSend, pxRecepientAddress, xRecepientPort);
+  M_SPI_WIFI_UNLOCK();
+  wifiRxKick();
+  wifiLinkCheck(wifiResult);
+
+  return wifiResult;
+}
+
+ES_WIFI_Status_t wifiConnectUdp
+(
+  uint8_t    xSocketId,
+  uint8_t*  pxRecepientAddress,
+  uint16_t   xRecepientPort
+)
+{
+  ES_WIFI_Status_t wifiResult;
+
+  M_SPI_WIFI_LOCK();
+  wifiResult = ES_WIFI_ConnectUDP(&gWifiModuleStructure, xSocketId, pxRecepientAddress, xRecepientPort);
+  M_SPI_WIFI_UNLOCK();
+
+  return wifiResult;
+}
+
+ES_WIFI_Status_t wifiSendData
+(
+  uint8_t    xSocketId,
+  uint8_t*  pxDataToSend,
+  uint16_t   xSizeData,
+  uint16_t* pxDataSent,
+  uint32_t   xTimeoutSend
+)
+{
+  ES_WIFI_Status_t wifiResult;
+
+  M_SPI_WIFI_LOCK();
+  wifiResult = ES_WIFI_SendData(&gWifiModuleStructure, xSocketId, pxDataToSend, xSizeData, pxDataSent,
+      xTimeoutSend);
+  M_SPI_WIFI_UNLOCK();
+  wifiRxKick();
+  wifiLinkCheck(wifiResult);
+
+  return wifiResult;
+}
+
+ES_WIFI_Status_t wifiSendFile
+(
+  uint8_t     xSocketId,
+  const char* xpPath,
+  uint32_t*   pxDataSent,
+  uint32_t    xTimeoutSend
+)
+{
+  spiffs_file fd;
+  spiffs_stat fileStat;
+  ES_WIFI_Status_t wifiResult = ES_WIFI_STATUS_ERROR;
+
+  *pxDataSent = 0;
+
+  SPIFFS_clearerr(&gSpiffsFs);
+  fd = SPIFFS_open(&gSpiffsFs, xpPath, SPIFFS_RDONLY, 0);
+  if (fd < 0)
+  {
+    M_SPI_WIFI_LOG("Could not open %s.", xpPath);
+    return ES_WIFI_STATUS_ERROR;
+  }
+
+  if (SPIFFS_OK == SPIFFS_fstat(&gSpiffsFs, fd, &fileStat))
+  {
+    M_SPI_WIFI_LOCK();
+    wifiResult = ES_WIFI_SendStream(&gWifiModuleStructure, xSocketId, wifiFillFromFile, &fd,
+        fileStat.size, pxDataSent, xTimeoutSend);
+    M_SPI_WIFI_UNLOCK();
+    wifiRxKick();
+  }
+
+  SPIFFS_close(&gSpiffsFs, fd);
+
+  return wifiResult;
+}
+
+ES_WIFI_Status_t wifiReceiveToFile
+(
+  uint8_t     xSocketId,
+  const char* xpPath,
+  uint32_t    xLength,
+  uint32_t*   pxReceived,
+  uint32_t    xTimeout
+)
+{
+  spiffs_file fd;
+  uint32_t fill = 0;
+  uint16_t length;
+  ES_WIFI_Status_t wifiResult = ES_WIFI_STATUS_OK;
+
+  *pxReceived = 0;
+
+  if (xSocketId >= ES_WIFI_MAX_SOCKETS)
+  {
+    return ES_WIFI_STATUS_ERROR;
+  }
+
+  SPIFFS_clearerr(&gSpiffsFs);
+  fd = SPIFFS_open(&gSpiffsFs, xpPath, SPIFFS_CREAT | SPIFFS_TRUNC | SPIFFS_RDWR, 0);
+  if (fd < 0)
+  {
+    M_SPI_WIFI_LOG("Could not open %s.", xpPath);
+    return ES_WIFI_STATUS_ERROR;
+  }
+
+  /* Free the blocks of the whole file now: a garbage collection in the middle
+   * would stop the transfer for as long as it moves pages and erases blocks. */
+  if (SPIFFS_OK != SPIFFS_reserve(&gSpiffsFs, xLength,
+      C_SPI_WIFI_FILE_CHUNK_SIZE - ES_WIFI_PAYLOAD_SIZE))
+  {
+    M_SPI_WIFI_LOG("No room for %lu bytes in %s.", (unsigned long) xLength, xpPath);
+    SPIFFS_close(&gSpiffsFs, fd);
+    return ES_WIFI_STATUS_ERROR;
+  }
+
+  while (*pxReceived < xLength)
+  {
+    wifiResult = wifiReceiveChunk(xSocketId, &gWifiFileBuffer[fill],
+        sizeof(gWifiFileBuffer) - fill, &length, xTimeout);
+    if (ES_WIFI_STATUS_OK != wifiResult)
+    {
+      break;
+    }
+    if (0 == length)
+    {
+      wifiResult = ES_WIFI_STATUS_TIMEOUT;
+      break;
+    }
+
+    /* Drop what follows the end of the file. */
+    if (length > (xLength - *pxReceived))
+    {
+      length = xLength - *pxReceived;
+    }
+    fill += length;
+    *pxReceived += length;
+
+    if ((sizeof(gWifiFileBuffer) - fill) < ES_WIFI_PAYLOAD_SIZE)
+    {
+      if (SPIFFS_write(&gSpiffsFs, fd, gWifiFileBuffer, fill) != (s32_t) fill)
+      {
+        wifiResult = ES_WIFI_STATUS_ERROR;
+        break;
+      }
+      fill = 0;
+    }
+  }
+
+  /* Keep what was received before a timeout. */
+  if ((0 < fill) && (SPIFFS_write(&gSpiffsFs, fd, gWifiFileBuffer, fill) != (s32_t) fill))
+  {
+    wifiResult = ES_WIFI_STATUS_ERROR;
+  }
+
+  if (SPIFFS_OK != SPIFFS_close(&gSpiffsFs, fd))
+  {
+    wifiResult = ES_WIFI_STATUS_ERROR;
+  }
+
+  return wifiResult;
 }
 
 ES_WIFI_Status_t wifiCloseSocket
@@ -219,8 +987,25 @@ ES_WIFI_Status_t wifiCloseSocket
 )
 {
   ES_WIFI_Conn_t conn;
+  ES_WIFI_Status_t wifiResult;
+
   conn.Number = xSocketId;
-  return ES_WIFI_StopClientConnection(&gWifiModuleStructure, &conn);
+  M_SPI_WIFI_LOCK();
+#ifdef C_BOARD_USE_FREE_RTOS
+  if ((xSocketId < ES_WIFI_MAX_SOCKETS) && (0 != gWifiRxRings[xSocketId].used))
+  {
+    /* The RX task checks used with the mutex held: it is done with the socket. */
+    gWifiRxRings[xSocketId].used = 0;
+    if (NULL != gWifiRxRings[xSocketId].waiter)
+    {
+      xTaskNotifyGive(gWifiRxRings[xSocketId].waiter);
+    }
+  }
+#endif
+  wifiResult = ES_WIFI_StopClientConnection(&gWifiModuleStructure, &conn);
+  M_SPI_WIFI_UNLOCK();
+
+  return wifiResult;
 }
 
 ES_WIFI_Status_t wifiDisconnect
@@ -228,7 +1013,13 @@ ES_WIFI_Status_t wifiDisconnect
   void
 )
 {
-  return ES_WIFI_Disconnect(&gWifiModuleStructure);
+  ES_WIFI_Status_t wifiResult;
+
+  M_SPI_WIFI_LOCK();
+  wifiResult = ES_WIFI_Disconnect(&gWifiModuleStructure);
+  M_SPI_WIFI_UNLOCK();
+
+  return wifiResult;
 }
 
 ES_WIFI_Status_t wifiIsConnected
@@ -236,5 +1027,260 @@ ES_WIFI_Status_t wifiIsConnected
   void
 )
 {
-  return (ES_WIFI_IsConnected(&gWifiModuleStructure) != 0) ? ES_WIFI_STATUS_OK : ES_WIFI_STATUS_TIMEOUT;
+  uint8_t connected;
+
+  M_SPI_WIFI_LOCK();
+  connected = ES_WIFI_IsConnected(&gWifiModuleStructure);
+  M_SPI_WIFI_UNLOCK();
+
+  return (connected != 0) ? ES_WIFI_STATUS_OK : ES_WIFI_STATUS_TIMEOUT;
 }
+
+#ifdef C_BOARD_USE_FREE_RTOS
+ES_WIFI_Status_t wifiRxStart
+(
+  void
+)
+{
+  if (NULL != gWifiRxTask)
+  {
+    return ES_WIFI_STATUS_OK;
+  }
+
+  if (NULL == gWifiMutex)
+  {
+    return ES_WIFI_STATUS_ERROR;
+  }
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  gWifiRxTask = xTaskCreateStatic(wifiRxTaskFunction, "Wifi RX", C_SPI_WIFI_RX_TASK_STACK,
+      NULL /* parameters */, C_SPI_WIFI_RX_TASK_PRIORITY, gWifiRxTaskStack, &gWifiRxTaskBuffer);
+  if (NULL == gWifiRxTask)
+  {
+    return ES_WIFI_STATUS_ERROR;
+  }
+#else
+  if (pdPASS != xTaskCreate(wifiRxTaskFunction, "Wifi RX", C_SPI_WIFI_RX_TASK_STACK,
+      NULL /* parameters */, C_SPI_WIFI_RX_TASK_PRIORITY, &gWifiRxTask))
+  {
+    return ES_WIFI_STATUS_ERROR;
+  }
+#endif
+
+  return ES_WIFI_STATUS_OK;
+}
+
+ES_WIFI_Status_t wifiRxOpen
+(
+  uint8_t xSocketId,
+  uint8_t xSourceAddress
+)
+{
+  WIFI_RxRing* ring;
+
+  if ((xSocketId >= ES_WIFI_MAX_SOCKETS) || (NULL == gWifiRxTask))
+  {
+    return ES_WIFI_STATUS_ERROR;
+  }
+
+  ring = &gWifiRxRings[xSocketId];
+
+  M_SPI_WIFI_LOCK();
+  ring->head = 0;
+  ring->tail = 0;
+  ring->waiter = NULL;
+  ring->sourceAddress = xSourceAddress;
+  ring->used = 1;
+  M_SPI_WIFI_UNLOCK();
+
+  wifiRxKick();
+
+  return ES_WIFI_STATUS_OK;
+}
+
+void wifiRxGetStats
+(
+  WIFI_RxStats* pxStats
+)
+{
+  *pxStats = gWifiRxStats;
+}
+
+void wifiLinkRequest
+(
+  uint8_t xEnable
+)
+{
+  gWifiLinkWanted = (0 != xEnable) ? 1 : 0;
+  if (NULL != gWifiLinkEvents)
+  {
+    xEventGroupSetBits(gWifiLinkEvents, C_SPI_WIFI_LINK_EV_REQUEST);
+  }
+}
+
+void wifiLinkRequestFromISR
+(
+  uint8_t xEnable
+)
+{
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+  gWifiLinkWanted = (0 != xEnable) ? 1 : 0;
+  if (NULL != gWifiLinkEvents)
+  {
+    /* Deferred to the timer task, above all the application tasks. */
+    if (pdPASS == xEventGroupSetBitsFromISR(gWifiLinkEvents, C_SPI_WIFI_LINK_EV_REQUEST,
+        &higherPriorityTaskWoken))
+    {
+      portYIELD_FROM_ISR(higherPriorityTaskWoken);
+    }
+  }
+}
+
+void wifiLinkRun
+(
+  void
+)
+{
+  EventBits_t events;
+  TickType_t wait = portMAX_DELAY;
+  TickType_t start = 0;
+  TickType_t next = 0;
+  TickType_t now;
+  uint32_t elapsed;
+  uint32_t retry = C_SPI_WIFI_LINK_RETRY_MIN_MS;
+  uint8_t up = 0;
+  uint8_t lost = 0;
+
+  if (NULL == gWifiLinkEvents)
+  {
+    return;
+  }
+
+  /* A request may have come before the events were created. */
+  if (0 != gWifiLinkWanted)
+  {
+    xEventGroupSetBits(gWifiLinkEvents, C_SPI_WIFI_LINK_EV_REQUEST);
+  }
+
+  for (;;)
+  {
+    events = xEventGroupWaitBits(gWifiLinkEvents,
+        C_SPI_WIFI_LINK_EV_REQUEST | C_SPI_WIFI_LINK_EV_CHECK, pdTRUE, pdFALSE, wait);
+    now = xTaskGetTickCount();
+
+    if (0 == gWifiLinkWanted)
+    {
+      if (0 != up)
+      {
+        M_SPI_WIFI_LOG("Disable Wifi");
+        up = 0;
+        xEventGroupClearBits(gWifiLinkEvents, C_SPI_WIFI_LINK_EV_UP);
+        if (ES_WIFI_STATUS_OK != wifiDisconnect())
+        {
+          M_SPI_WIFI_LOG("Failure to disable Wifi");
+        }
+      }
+      /* Nothing to do until the next request. */
+      wait = portMAX_DELAY;
+      continue;
+    }
+
+    if (0 != up)
+    {
+      if (C_SPI_WIFI_LINK_EV_REQUEST == events)
+      {
+        /* Disabled and enabled again before this task ran. */
+        continue;
+      }
+
+      if (ES_WIFI_STATUS_OK == wifiIsConnected())
+      {
+        wait = pdMS_TO_TICKS(C_SPI_WIFI_LINK_CHECK_MS);
+        continue;
+      }
+
+      M_SPI_WIFI_LOG("Link lost.");
+      up = 0;
+      xEventGroupClearBits(gWifiLinkEvents, C_SPI_WIFI_LINK_EV_UP);
+      gWifiLinkStats.losses++;
+      lost = 1;
+      start = now;
+      retry = C_SPI_WIFI_LINK_RETRY_MIN_MS;
+    }
+    else if (0 != (events & C_SPI_WIFI_LINK_EV_REQUEST))
+    {
+      M_SPI_WIFI_LOG("Enable Wifi");
+      lost = 0;
+      start = now;
+      retry = C_SPI_WIFI_LINK_RETRY_MIN_MS;
+    }
+    else if ((0 != events) && ((TickType_t) (next - now) <= pdMS_TO_TICKS(C_SPI_WIFI_LINK_RETRY_MAX_MS)))
+    {
+      /* A command failed while joining: keep to the backoff. */
+      wait = next - now;
+      continue;
+    }
+
+    if (ES_WIFI_STATUS_OK == wifiLinkJoin())
+    {
+      elapsed = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+      up = 1;
+      xEventGroupSetBits(gWifiLinkEvents, C_SPI_WIFI_LINK_EV_UP);
+      boottimeMark(BOOTTIME_NETWORK);
+      if (0 != lost)
+      {
+        gWifiLinkStats.reconnects++;
+        gWifiLinkStats.lastReconnectMs = elapsed;
+        if (elapsed > gWifiLinkStats.maxReconnectMs)
+        {
+          gWifiLinkStats.maxReconnectMs = elapsed;
+        }
+      }
+      else
+      {
+        gWifiLinkStats.connects++;
+        gWifiLinkStats.lastConnectMs = elapsed;
+      }
+      M_SPI_WIFI_LOG("Link up in %lu ms: %lu connects, %lu reconnects, %lu failures.",
+          elapsed, gWifiLinkStats.connects, gWifiLinkStats.reconnects,
+          gWifiLinkStats.failures);
+      wait = pdMS_TO_TICKS(C_SPI_WIFI_LINK_CHECK_MS);
+    }
+    else
+    {
+      gWifiLinkStats.failures++;
+      M_SPI_WIFI_LOG("Failure to enable Wifi, retry in %lu ms.", retry);
+      wait = pdMS_TO_TICKS(retry);
+      next = xTaskGetTickCount() + wait;
+      retry = MIN(2 * retry, C_SPI_WIFI_LINK_RETRY_MAX_MS);
+    }
+  }
+}
+
+ES_WIFI_Status_t wifiLinkWaitUp
+(
+  uint32_t xTimeout
+)
+{
+  EventBits_t events;
+
+  if (NULL == gWifiLinkEvents)
+  {
+    return ES_WIFI_STATUS_ERROR;
+  }
+
+  events = xEventGroupWaitBits(gWifiLinkEvents, C_SPI_WIFI_LINK_EV_UP, pdFALSE, pdTRUE,
+      pdMS_TO_TICKS(xTimeout));
+
+  return (0 != (events & C_SPI_WIFI_LINK_EV_UP)) ? ES_WIFI_STATUS_OK : ES_WIFI_STATUS_TIMEOUT;
+}
+
+void wifiLinkGetStats
+(
+  WIFI_LinkStats* pxStats
+)
+{
+  *pxStats = gWifiLinkStats;
+}
+#endif
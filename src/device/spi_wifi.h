@@ -15,6 +15,28 @@
 #include "es_wifi_io.h"
 #include "es_wifi.h"
 
+/** Counters of the network RX task. */
+typedef struct
+{
+  uint32_t polls;     /**< R0 reads issued to the module */
+  uint32_t datagrams; /**< datagrams stored in the socket rings */
+  uint32_t full;      /**< polls skipped because a ring was full */
+  uint32_t errors;    /**< failed reads */
+} WIFI_RxStats;
+
+/** Counters of the connection manager. */
+typedef struct
+{
+  uint32_t connects;        /**< joins after an enable request */
+  uint32_t reconnects;      /**< joins after a lost link */
+  uint32_t failures;        /**< failed joins */
+  uint32_t losses;          /**< links found down */
+  uint32_t lastConnectMs;   /**< enable request to link up, last connect */
+  uint32_t lastReconnectMs; /**< link found down to link up, last reconnect */
+  uint32_t maxReconnectMs;  /**< longest reconnect */
+  uint32_t addressChanges;  /**< joins given another address than the last lease */
+} WIFI_LinkStats;
+
 /**
  * @brief  EXTI line detection callback.
  * @param  GPIO_Pin: Specifies the port pin connected to corresponding EXTI line.
@@ -30,6 +52,18 @@ void SPI3_IRQHandler
   void
 );
 
+#if (ES_WIFI_USE_SPI_DMA == 1)
+void DMA2_Channel1_IRQHandler
+(
+  void
+);
+
+void DMA2_Channel2_IRQHandler
+(
+  void
+);
+#endif
+
 /**
  * @brief  Initialize the SPI to the WIFI and get MAC address
  * @retval Operation status
@@ -105,6 +139,173 @@ ES_WIFI_Status_t wifiSendDataTo
   uint16_t   xRecepientPort
 );
 
+/**
+ * @brief  Pin the destination of a UDP socket so that wifiSendData does not
+ *         reprogram the remote address on every datagram
+ * @param  xSocketId: ID of the socket to use
+ * @param  pxRecepientAddress: 4-byte array containing the IP address of the remote host,
+ *         NULL to unpin the socket
+ * @param  xRecepientPort: port number of the remote host
+ * @retval Operation status
+ */
+ES_WIFI_Status_t wifiConnectUdp
+(
+  uint8_t    xSocketId,
+  uint8_t*  pxRecepientAddress,
+  uint16_t   xRecepientPort
+);
+
+/**
+ * @brief       Send Data on a connected socket
+ * @param       xSocketId: ID of the socket to use
+ * @param       pxDataToSend: pointer to data to be sent
+ * @param       xSizeData: length of data to be sent
+ * @param[out]  pxDataSent: length actually sent
+ * @param       xTimeoutSend : Socket write timeout (ms)
+ * @retval      Operation status
+ */
+ES_WIFI_Status_t wifiSendData
+(
+  uint8_t    xSocketId,
+  uint8_t*  pxDataToSend,
+  uint16_t   xSizeData,
+  uint16_t* pxDataSent,
+  uint32_t   xTimeoutSend
+);
+
+/**
+ * @brief       Send a SPIFFS file on a connected socket. The file is read
+ *              in chunks of ES_WIFI_PAYLOAD_SIZE straight into the SPI staging
+ *              buffers; a chunk is read while the previous one is sent.
+ * @param       xSocketId: ID of the socket to use
+ * @param       xpPath: name of the file
+ * @param[out]  pxDataSent: length actually sent
+ * @param       xTimeoutSend : Socket write timeout of each chunk (ms)
+ * @retval      Operation status
+ */
+ES_WIFI_Status_t wifiSendFile
+(
+  uint8_t     xSocketId,
+  const char* xpPath,
+  uint32_t*   pxDataSent,
+  uint32_t    xTimeoutSend
+);
+
+/**
+ * @brief       Receive a SPIFFS file on a socket. The data is gathered in a
+ *              buffer of C_SPI_WIFI_FILE_CHUNK_SIZE bytes, written with one
+ *              SPIFFS_write. On a socket serviced by the RX task, the task
+ *              receives the next datagrams into the socket ring while the
+ *              flash is programmed. Room for the file is made before the
+ *              transfer, see SPIFFS_reserve. One transfer at a time.
+ * @param       xSocketId: ID of the socket to use
+ * @param       xpPath: name of the file, created or truncated
+ * @param       xLength: length of the file
+ * @param[out]  pxReceived: length received, all in the file unless a
+ *              write failed
+ * @param       xTimeout : time to wait for each datagram (ms)
+ * @retval      Operation status, ES_WIFI_STATUS_TIMEOUT if the data stops
+ */
+ES_WIFI_Status_t wifiReceiveToFile
+(
+  uint8_t     xSocketId,
+  const char* xpPath,
+  uint32_t    xLength,
+  uint32_t*   pxReceived,
+  uint32_t    xTimeout
+);
+
+#ifdef C_BOARD_USE_FREE_RTOS
+/**
+ * @brief  Start the network RX task. It drains the module into one ring per
+ *         serviced socket, so that wifiReceiveDataFrom reads from RAM and
+ *         sleeps until the task notifies it.
+ * @pre    wifiInit should be called.
+ * @retval Operation status
+ */
+ES_WIFI_Status_t wifiRxStart
+(
+  void
+);
+
+/**
+ * @brief  Have the RX task service a socket. Called by wifiBindToUdp.
+ * @param  xSocketId: ID of the socket to use
+ * @param  xSourceAddress: 1 to query the remote address of every datagram
+ *         (one more command per datagram), 0 otherwise
+ * @retval Operation status
+ */
+ES_WIFI_Status_t wifiRxOpen
+(
+  uint8_t xSocketId,
+  uint8_t xSourceAddress
+);
+
+/**
+ * @brief       Get the counters of the RX task
+ * @param[out]  pxStats: counters
+ * @retval      None
+ */
+void wifiRxGetStats
+(
+  WIFI_RxStats* pxStats
+);
+
+/**
+ * @brief  Ask the connection manager to join or leave the access point.
+ * @param  xEnable: 1 to join, 0 to leave
+ * @retval None
+ */
+void wifiLinkRequest
+(
+  uint8_t xEnable
+);
+
+/**
+ * @brief  wifiLinkRequest for interrupt handlers. The request is passed on
+ *         by the timer task.
+ * @param  xEnable: 1 to join, 0 to leave
+ * @retval None
+ */
+void wifiLinkRequestFromISR
+(
+  uint8_t xEnable
+);
+
+/**
+ * @brief  Run the connection manager in the calling task. It sleeps until a
+ *         request, joins with backoff, checks the link every
+ *         C_SPI_WIFI_LINK_CHECK_MS or when a send fails, and rejoins when it
+ *         is lost. Every join runs DHCP.
+ * @pre    wifiInit should be called, otherwise returns at once.
+ * @retval None
+ */
+void wifiLinkRun
+(
+  void
+);
+
+/**
+ * @brief  Wait until the connection manager has joined the access point
+ * @param  xTimeout: time to wait (ms)
+ * @retval ES_WIFI_STATUS_OK when joined, ES_WIFI_STATUS_TIMEOUT otherwise
+ */
+ES_WIFI_Status_t wifiLinkWaitUp
+(
+  uint32_t xTimeout
+);
+
+/**
+ * @brief       Get the counters of the connection manager
+ * @param[out]  pxStats: counters
+ * @retval      None
+ */
+void wifiLinkGetStats
+(
+  WIFI_LinkStats* pxStats
+);
+#endif
+
 /**
  * @brief  Close client connection
  * @retval Operation status
@@ -1,9 +1,22 @@
+#ifdef C_BOARD_USE_FREE_RTOS
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+#endif
+
 #include "memory_qspi.h"
 #include "spiffs.h"
 #include "spiffs_config.h"
 #include "spiffs_fs.h"
+#include "binlog.h"
 
-#define C_FILESYSTEM_ENABLE_LOG 0             //!< Enable or disable the log for this module
+#ifdef C_BOARD_USE_FREE_RTOS
+#define C_FILESYSTEM_ENABLE_LOG 2             //!< Log of this module: 0 off, 1 printf,
+                                              //   2 binary records (binlog.h)
+#else
+#define C_FILESYSTEM_ENABLE_LOG 1             //!< Without the kernel no log task sends
+                                              //   the binary records: printf.
+#endif
 #define C_FILESYSTEM_ENABLE_NAME "FileSystem" //!< Name of the module
 
 /*
@@ -11,6 +24,8 @@
  */
 #if (C_FILESYSTEM_ENABLE_LOG == 1)
   #define M_FILESYSTEM_SAL_LOG printf
+#elif (C_FILESYSTEM_ENABLE_LOG == 2)
+  #define M_FILESYSTEM_SAL_LOG M_BINLOG
 #else
   #define M_FILESYSTEM_SAL_LOG //
 #endif
@@ -40,6 +55,22 @@ static u8_t spiffsCacheBuffer[(SPIFFS_CFG_LOG_PAGE_SZ() + C_FILESYSTEM_FILE_DESC
 //!< Cache buffer used for speeding up calls. Can be computed using SPIFFS_buffer_bytes_for_cache
 //   Refer to https://github.com/pellepl/spiffs/wiki/Integrate-spiffs for more information
 
+#ifdef C_BOARD_USE_FREE_RTOS
+static SemaphoreHandle_t spiffsMutex = NULL; //!< Taken by every SPIFFS call, the log task writes
+                                            //   files alongside the other tasks.
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static StaticSemaphore_t spiffsMutexBuffer; //!< Storage of spiffsMutex.
+#endif
+#endif
+
+#if SPIFFS_COMPRESSED_FILES
+static u8_t spiffsCompressBuffer[2048];
+//!< Buffer used to read and write files opened with SPIFFS_O_COMPRESS, one at a time.
+//   Compressor state and frame page take about 800 bytes, the rest bounds the uncompressed
+//   bytes per frame. Can be computed using SPIFFS_buffer_bytes_for_compress
+#endif
+
 /*
  * @brief  Wrapper for the SPIFFS library to read a flash block
  * @return none
@@ -81,6 +112,41 @@ static void pSpiffsWrapperErase
   boardMemoryQspiErase(xAddr);
 } /* pSpiffsWrapperErase() */
 
+/*
+ * @brief  Takes the file system, called by SPIFFS_LOCK. Nothing to do before the
+ *         scheduler runs.
+ * @return none
+ */
+void spiffsLock
+(
+  void
+)
+{
+#ifdef C_BOARD_USE_FREE_RTOS
+  if ((NULL != spiffsMutex) && (taskSCHEDULER_RUNNING == xTaskGetSchedulerState()))
+  {
+    xSemaphoreTakeRecursive(spiffsMutex, portMAX_DELAY);
+  } /* if */
+#endif
+} /* spiffsLock() */
+
+/*
+ * @brief  Gives the file system back, called by SPIFFS_UNLOCK.
+ * @return none
+ */
+void spiffsUnlock
+(
+  void
+)
+{
+#ifdef C_BOARD_USE_FREE_RTOS
+  if ((NULL != spiffsMutex) && (taskSCHEDULER_RUNNING == xTaskGetSchedulerState()))
+  {
+    xSemaphoreGiveRecursive(spiffsMutex);
+  } /* if */
+#endif
+} /* spiffsUnlock() */
+
 /*
  * @brief   Mount the file system.
  * @return  BOARD_OK on success. BOARD_FATAL_ERROR on error.
@@ -95,6 +161,17 @@ BOARD_Status spiffsMount
   spiffs_config wrapperConfiguration = {0};
   BOARD_Status status = BOARD_ERROR_FATAL;
 
+#ifdef C_BOARD_USE_FREE_RTOS
+  if (NULL == spiffsMutex)
+  {
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    spiffsMutex = xSemaphoreCreateRecursiveMutexStatic(&spiffsMutexBuffer);
+#else
+    spiffsMutex = xSemaphoreCreateRecursiveMutex();
+#endif
+  } /* if */
+#endif
+
   wrapperConfiguration.hal_read_f  = pSpiffsWrapperRead;
   wrapperConfiguration.hal_write_f = pSpiffsWrapperWrite;
   wrapperConfiguration.hal_erase_f = pSpiffsWrapperErase;
@@ -108,6 +185,15 @@ BOARD_Status spiffsMount
     sizeof(spiffsCacheBuffer),
     NULL);
 
+#if SPIFFS_COMPRESSED_FILES
+  if (SPIFFS_OK == statusFileSystem)
+  {
+    statusFileSystem = SPIFFS_compress_buffer(&gSpiffsFs,
+      spiffsCompressBuffer,
+      sizeof(spiffsCompressBuffer));
+  }
+#endif
+
   M_FILESYSTEM_SAL_LOG("Mount result: %i", statusFileSystem);
   if (SPIFFS_OK != statusFileSystem)
   {
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 #include "stm32l4xx.h"
 #include "stm32l475e_iot01.h"
 #include "stm32l4xx_it.h"
@@ -8,9 +9,73 @@
 #include "spiffs_fs.h"
 #include "spi_wifi.h"
 #include "board.h"
+#include "console.h"
+#include "binlog.h"
+#include "bench.h"
+#include "boottime.h"
 
-/* Activated with the User button. */
-extern volatile uint8_t wifiControl;
+#define C_MAIN_WIFI_TASK_STACK 2048 //!< Stack of the Wi-Fi task, in words.
+#define C_MAIN_TEST_TASK_STACK 4096 //!< Stack of the test task, in words.
+
+#define C_MAIN_WIFI_TASK_PRIORITY (tskIDLE_PRIORITY + 3) //!< Priority of the Wi-Fi task.
+#define C_MAIN_TEST_TASK_PRIORITY (tskIDLE_PRIORITY + 2) //!< Priority of the test task.
+
+#ifndef C_MAIN_BOOT_LIST_FILES
+#define C_MAIN_BOOT_LIST_FILES 0 //!< 1 prints the files of the memory at boot: one lookup
+                                 //   per file, before the log starts.
+#endif
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static StaticTask_t wifiTaskBuffer; //!< Control block of the Wi-Fi task.
+static StackType_t wifiTaskStack[C_MAIN_WIFI_TASK_STACK]; //!< Stack of the Wi-Fi task.
+
+static StaticTask_t testTaskBuffer; //!< Control block of the test task.
+static StackType_t testTaskStack[C_MAIN_TEST_TASK_STACK]; //!< Stack of the test task.
+
+static StaticTask_t idleTaskBuffer; //!< Control block of the idle task.
+static StackType_t idleTaskStack[configMINIMAL_STACK_SIZE]; //!< Stack of the idle task.
+
+static StaticTask_t timerTaskBuffer; //!< Control block of the timer task.
+static StackType_t timerTaskStack[configTIMER_TASK_STACK_DEPTH]; //!< Stack of the timer task.
+
+/*
+ * @brief                          gives FreeRTOS the memory of the idle task.
+ * @param[out] ppxTaskBuffer       control block
+ * @param[out] ppxStackBuffer      stack
+ * @param[out] pxStackSize         size of the stack, in words
+ * @return                         none.
+ */
+void vApplicationGetIdleTaskMemory
+(
+  StaticTask_t** ppxTaskBuffer,
+  StackType_t**  ppxStackBuffer,
+  uint32_t*      pxStackSize
+)
+{
+  *ppxTaskBuffer = &idleTaskBuffer;
+  *ppxStackBuffer = idleTaskStack;
+  *pxStackSize = configMINIMAL_STACK_SIZE;
+}
+
+/*
+ * @brief                          gives FreeRTOS the memory of the timer task.
+ * @param[out] ppxTaskBuffer       control block
+ * @param[out] ppxStackBuffer      stack
+ * @param[out] pxStackSize         size of the stack, in words
+ * @return                         none.
+ */
+void vApplicationGetTimerTaskMemory
+(
+  StaticTask_t** ppxTaskBuffer,
+  StackType_t**  ppxStackBuffer,
+  uint32_t*      pxStackSize
+)
+{
+  *ppxTaskBuffer = &timerTaskBuffer;
+  *ppxStackBuffer = timerTaskStack;
+  *pxStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+#endif
 
 /*
  * @brief          prints one character on the console. Used for printf.
@@ -22,9 +87,23 @@ int __io_putchar(int ch) {
   return ch;
 }
 
+/*
+ * @brief              prints a buffer on the console in one go. Used for printf.
+ *                     Whatever does not fit in the console ring is dropped: newlib
+ *                     would retry a short write.
+ * @param[in]  ptr     text to print
+ * @param[in]  len     length of the text
+ * @return             len.
+ */
+int __io_write(char* ptr, int len) {
+  boardWrite(ptr, len);
+  return len;
+}
+
 /*
  * @brief                   Wifi function to enable or disable wifi when user button is pressed.
- *                          Prints cannot be sent when the UART is waiting on input from user.
+ *                          The task runs the connection manager: it sleeps until the button
+ *                          handler sends a request, and rejoins when the link is lost.
  * @param[in]  pParameters  Unused parameter list for the task
  * @return                  none.
  */
@@ -33,10 +112,12 @@ void wifiTask
   void* pParameters
 )
 {
-  ES_WIFI_APState_t wifiState = ES_WIFI_AP_NONE;
   ES_WIFI_Status_t wifiResult = ES_WIFI_STATUS_OK;
 
-  /* Init needs HAL_Delay to be enabled. */
+  boottimeMark(BOOTTIME_SCHEDULER);
+
+  /* Init needs HAL_Delay to be enabled. The module resets while the test task
+     mounts the file system: the delays of the reset block this task. */
   wifiResult = wifiInit();
   if (ES_WIFI_STATUS_OK != wifiResult)
   {
@@ -44,45 +125,63 @@ void wifiTask
     printf("Limited test availability.\n");
     vTaskDelete(NULL);
   }
+  boottimeMark(BOOTTIME_WIFI);
 
-  for(;;)
+  /* Sockets bound from now on are read by the RX task. */
+  if (ES_WIFI_STATUS_OK != wifiRxStart())
   {
-    if (ES_WIFI_STATUS_OK == wifiResult)
-    {
-      if ((0 != wifiControl) && (ES_WIFI_AP_JOINED != wifiState))
-      {
-        /* Enable Wifi */
-        printf("Enable Wifi\n");
-        if (ES_WIFI_STATUS_OK != wifiConnectTo())
-        {
-          printf("Failure to enable Wifi\n");
-          /* Keep old state */
-        }
-        else
-        {
-          wifiState = ES_WIFI_AP_JOINED;
-        }
-      }
-      else if ((0 == wifiControl) && (ES_WIFI_AP_NONE != wifiState))
-      {
-        printf("Disable Wifi\n");
-        if (ES_WIFI_STATUS_OK != wifiDisconnect())
-        {
-          printf("Failure to disable Wifi\n");
-          /* Keep old state */
-        }
-        else
-        {
-          wifiState = ES_WIFI_AP_NONE;
-        }
-      }
-    }
-    HAL_Delay(100);
+    printf("Could not start the WIFI RX task.\n");
   }
 
+  wifiLinkRun();
+
   vTaskDelete(NULL);
 }
 
+/*
+ * @brief   mounts the file system and starts the log. On a memory that cannot be
+ *          mounted, offers to wipe it and stops.
+ * @return  none.
+ */
+static void storageStart
+(
+  void
+)
+{
+  char charInput;
+  BOARD_Status status = spiffsMount();
+  if(BOARD_ERROR_FATAL == status)
+  {
+    printf("Could not init filesystem.\n");
+
+    printf("Press a key to wipe the memory.\n");
+    charInput = boardGetChar();
+    boardLed(0);
+    printf("Wiping...\n");
+    boardMemoryQspiWipe();
+    printf("Done, restart the board..\n");
+
+    while(1);
+  } /* if */
+  boottimeMark(BOOTTIME_MOUNT);
+
+#if (C_MAIN_BOOT_LIST_FILES == 1)
+  spiffsListFile();
+  boottimeMark(BOOTTIME_LIST);
+#endif
+
+#ifdef C_BOARD_USE_FREE_RTOS
+  /* Records of the Wi-Fi and SPIFFS logs, kept across resets in the log store,
+     decoded by tools/binlog_decode.py. The records of the Wi-Fi init wait in the
+     ring until then. */
+  if (BOARD_OK != binlogStart(BINLOG_SINK_FILE, "log."))
+  {
+    binlogStart(BINLOG_SINK_CONSOLE, NULL);
+  } /* if */
+  boottimeMark(BOOTTIME_LOG);
+#endif
+}
+
 /*
  * @brief                   freeRTOS task test function.
  * @param[in]  pParameters Unused parameter list for the task
@@ -94,6 +193,9 @@ void testTask
 )
 {
   char charInput;
+#ifdef C_BOARD_USE_FREE_RTOS
+  char line[C_CONSOLE_LINE_SIZE];
+#endif
   char itemPath[SPIFFS_OBJ_NAME_LEN] = { 'a', 'b', 'c', '\0'};
   const unsigned char data[16] = {'1', '2', '3'};
   size_t dataSize = sizeof(data);
@@ -105,15 +207,37 @@ void testTask
   int32_t resultWrite = 0;
   int32_t  statusFileSystem = 0;
 
-  /* Wait for network prints from wifiTask */
-  HAL_Delay(1000);
+#ifdef C_BOARD_USE_FREE_RTOS
+  boottimeMark(BOOTTIME_SCHEDULER);
+  storageStart();
+
+  if (BOARD_OK != boardConsoleStart())
+  {
+    printf("Could not start the console.\n");
+    vTaskDelete(NULL);
+  }
+#endif
+
   for(;;)
   {
+#ifdef C_BOARD_USE_FREE_RTOS
+    /* Sleeps until a line is typed: output is not held meanwhile. */
+    if (BOARD_OK != boardConsoleReadLine(line, sizeof(line), portMAX_DELAY))
+    {
+      continue;
+    }
+    if (0 == strncmp(line, "bench", 5))
+    {
+      benchCommand(line);
+      continue;
+    }
+    charInput = line[0];
+#else
     charInput = boardGetChar();
+#endif
     if (((charInput < 'a') || (charInput > 'd')) &&
         ((charInput < '0') || (charInput > '9')))
     {
-      HAL_Delay(100);
       continue;
     }
 
@@ -189,45 +313,40 @@ void testTask
 
   vTaskDelete(NULL);
 }
-
+
 int main
 (
   void
-)
+)
 {
-  char charInput;
   BOARD_Status status = boardInit();
   if(BOARD_ERROR_FATAL == status)
   {
 	  while(1);
   } /* if */
-
-  status = spiffsMount();
-  if(BOARD_ERROR_FATAL == status)
-  {
-    printf("Could not init filesystem.\n");
-
-    printf("Press a key to wipe the memory.\n");
-    charInput = boardGetChar();
-    boardLed(0);
-    printf("Wiping...\n");
-    boardMemoryQspiWipe();
-    printf("Done, restart the board..\n");
-
-    while(1);
-  } /* if */
-
-  spiffsListFile();
+  boottimeMark(BOOTTIME_BOARD);
 
 #ifdef C_BOARD_USE_FREE_RTOS
-  xTaskCreate(wifiTask, "Wifi Control", 2048, NULL /* parameters */, 10, NULL);
-  xTaskCreate(testTask, "Tests", 4096, NULL /* parameters */, 8, NULL);
+  /* The test task mounts the file system, the Wi-Fi task resets the module
+     meanwhile. Both stay below the timer task, configMAX_PRIORITIES - 1. */
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+  xTaskCreateStatic(wifiTask, "Wifi Control", C_MAIN_WIFI_TASK_STACK, NULL /* parameters */,
+                    C_MAIN_WIFI_TASK_PRIORITY, wifiTaskStack, &wifiTaskBuffer);
+  xTaskCreateStatic(testTask, "Tests", C_MAIN_TEST_TASK_STACK, NULL /* parameters */,
+                    C_MAIN_TEST_TASK_PRIORITY, testTaskStack, &testTaskBuffer);
+#else
+  xTaskCreate(wifiTask, "Wifi Control", C_MAIN_WIFI_TASK_STACK, NULL /* parameters */,
+              C_MAIN_WIFI_TASK_PRIORITY, NULL);
+  xTaskCreate(testTask, "Tests", C_MAIN_TEST_TASK_STACK, NULL /* parameters */,
+              C_MAIN_TEST_TASK_PRIORITY, NULL);
+#endif
   /* Start the scheduler. */
   vTaskStartScheduler();
 #else
   HAL_InitTick(0);
+  storageStart();
   testTask(NULL);
 #endif
 
-  return 0;
-}
+  return 0;
+}
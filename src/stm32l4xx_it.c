@@ -15,6 +15,7 @@
 #include <cmsis_os.h>
 #endif
 #include "stm32l4xx_it.h"
+#include "rtstats.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -53,6 +54,7 @@ void SysTick_Handler(void)
   */
 void EXTI1_IRQHandler(void)
 {
+  M_RTSTATS_IRQ_ENTER();
   if (RESET != __HAL_GPIO_EXTI_GET_IT(GPIO_PIN_1))
   {
     // Serve interrupt.
@@ -61,5 +63,5 @@ void EXTI1_IRQHandler(void)
     __HAL_GPIO_EXTI_CLEAR_IT(GPIO_PIN_1);
     HAL_NVIC_ClearPendingIRQ(EXTI1_IRQn);
   }
-
+  M_RTSTATS_IRQ_EXIT(RTSTATS_IRQ_EXTI);
 }
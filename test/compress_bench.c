@@ -0,0 +1,285 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "spiffs.h"
+#include "flash_sim.h"
+#include "test.h"
+
+/*
+ * Benchmark of compressed files over the RAM flash of flash_sim.h, 60 % full
+ * of static files. Telemetry lines are logged in segments of 32 KB, the
+ * oldest removed once eight are kept, stored raw, then compressed, then
+ * compressed and flushed every 20 lines and every line. The flash time follows
+ * the MX25R6435F datasheet and is the only time counted. Prints the effective
+ * write rate, logged bytes over flash time, the bytes programmed, the erases
+ * and the compression ratio of a segment. The segments kept must read back
+ * the exact lines and SPIFFS_check must pass.
+ */
+
+#define C_BENCH_LINES    40000       //!< Lines of a run.
+#define C_BENCH_SEGMENT  (32 * 1024) //!< Bytes logged in a segment before the next one.
+#define C_BENCH_SEGMENTS 8           //!< Segments kept.
+#define C_BENCH_MAX_SEGMENTS 128     //!< Segments of a run, at most.
+
+#define C_BENCH_STATIC_FILES 600  //!< Static files filling the memory.
+#define C_BENCH_STATIC_SIZE  4000 //!< Bytes of a static file.
+
+#define C_BENCH_PROGRAM_MS  0.85  //!< Page program time.
+#define C_BENCH_ERASE_MS    400.0 //!< 64 KB block erase time.
+#define C_BENCH_READ_MS     0.000125 //!< Read time of a byte, 8 MB/s.
+
+/**
+ * @brief  Run of the benchmark
+ */
+typedef struct
+{
+  const char* name;       /**< printed */
+  int         compress;   /**< 0 for raw files */
+  uint32_t    flushEvery; /**< lines between two SPIFFS_fflush, 0 for none */
+} BENCH_Run;
+
+spiffs gSpiffsFs;
+
+static spiffs_config benchConfig;
+
+static uint8_t benchWork[2 * 256]; //!< Two logical pages.
+
+static uint8_t benchFds[44 * 4]; //!< Four file descriptors.
+
+static uint8_t benchCompress[2048]; //!< Compression buffer, as the board's.
+
+static uint8_t benchSnapshot[C_FLASH_SIM_SIZE]; //!< Memory before a run.
+
+static FLASH_SIM_Stats benchStats; //!< Counters of the memory since the run started.
+
+static uint32_t benchFirst[C_BENCH_MAX_SEGMENTS + 1]; //!< First line of each segment.
+
+static uint32_t benchSize[C_BENCH_MAX_SEGMENTS]; //!< Bytes logged in each segment.
+
+/*
+ * @brief               adds the counters of the memory to benchStats
+ */
+static void benchUpdate(void)
+{
+  FLASH_SIM_Stats stats;
+
+  flashSimGetStats(&stats);
+  benchStats.reads += stats.reads;
+  benchStats.readBytes += stats.readBytes;
+  benchStats.programs += stats.programs;
+  benchStats.programBytes += stats.programBytes;
+  benchStats.programPages += stats.programPages;
+  benchStats.erases += stats.erases;
+} /* benchUpdate() */
+
+/*
+ * @brief               time the memory was busy since the run started
+ */
+static double benchMs(void)
+{
+  benchUpdate();
+  return (benchStats.programPages * C_BENCH_PROGRAM_MS) + (benchStats.erases * C_BENCH_ERASE_MS) +
+         (benchStats.readBytes * C_BENCH_READ_MS);
+} /* benchMs() */
+
+/* SPIFFS_LOCK and SPIFFS_UNLOCK are in flash_sim.c. */
+
+static void benchMount(void)
+{
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_mount(&gSpiffsFs, &benchConfig, benchWork, benchFds,
+      sizeof(benchFds), 0, 0, 0));
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_compress_buffer(&gSpiffsFs, benchCompress, sizeof(benchCompress)));
+} /* benchMount() */
+
+/*
+ * @brief               builds a telemetry line: time stamp and sensor values
+ * @return              bytes of the line
+ */
+static int benchLine
+(
+  char*    pxLine,
+  uint32_t xNumber
+)
+{
+  return sprintf(pxLine, "%010u I sensors: t=%u.%02u C rh=%u.%u%% p=%u.%02u hPa acc=%d,%d,%d rssi=-%u\n",
+                 1600000000u + (xNumber * 5), 20 + ((xNumber / 97) % 5), (xNumber * 7) % 100,
+                 40 + ((xNumber / 53) % 20), xNumber % 10, 1009 + ((xNumber / 301) % 6), (xNumber * 13) % 100,
+                 (int) ((xNumber * 17) % 9) - 4, (int) ((xNumber * 5) % 7) - 3, 981 + (xNumber % 5),
+                 55 + ((xNumber / 11) % 20));
+} /* benchLine() */
+
+/*
+ * @brief               checks that a segment holds its lines
+ */
+static void benchCheckSegment
+(
+  uint32_t xSegment
+)
+{
+  static uint8_t data[C_BENCH_SEGMENT + 1024];
+  char           name[SPIFFS_OBJ_NAME_LEN];
+  char           line[128];
+  spiffs_file    file;
+  uint32_t       length = 0;
+  uint32_t       offset = 0;
+  uint32_t       i;
+  int32_t        result;
+  int            size;
+
+  snprintf(name, sizeof(name), "log%08x", xSegment);
+  file = SPIFFS_open(&gSpiffsFs, name, SPIFFS_RDONLY, 0);
+  M_TEST_ASSERT(file >= 0);
+  while ((result = SPIFFS_read(&gSpiffsFs, file, &data[length], 700)) > 0)
+  {
+    length += result;
+    M_TEST_ASSERT((length + 700) <= sizeof(data));
+  } /* while */
+  SPIFFS_close(&gSpiffsFs, file);
+
+  for (i = benchFirst[xSegment]; i < benchFirst[xSegment + 1]; i++)
+  {
+    size = benchLine(line, i);
+    M_TEST_ASSERT((offset + size) <= length);
+    M_TEST_ASSERT(0 == memcmp(&data[offset], line, size));
+    offset += size;
+  } /* for */
+  M_TEST_ASSERT(offset == length);
+} /* benchCheckSegment() */
+
+/*
+ * @brief               runs the benchmark from the memory of benchSnapshot
+ */
+static void benchRun
+(
+  const BENCH_Run* pxRun
+)
+{
+  char        name[SPIFFS_OBJ_NAME_LEN];
+  char        line[128];
+  spiffs_stat stat;
+  spiffs_file file = -1;
+  uint32_t    segment = 0;
+  uint32_t    size = 0;
+  uint32_t    logged = 0;
+  uint32_t    i;
+  int         length;
+  double      ms;
+
+  memcpy(flashSimData(), benchSnapshot, C_FLASH_SIM_SIZE);
+  benchMount();
+  benchMs();
+  memset(&benchStats, 0, sizeof(benchStats));
+
+  for (i = 0; i < C_BENCH_LINES; i++)
+  {
+    if (file < 0)
+    {
+      if (segment >= C_BENCH_SEGMENTS)
+      {
+        snprintf(name, sizeof(name), "log%08x", segment - C_BENCH_SEGMENTS);
+        M_TEST_ASSERT(SPIFFS_OK == SPIFFS_remove(&gSpiffsFs, name));
+      } /* if */
+      snprintf(name, sizeof(name), "log%08x", segment);
+      file = SPIFFS_open(&gSpiffsFs, name, SPIFFS_CREAT | SPIFFS_APPEND | SPIFFS_WRONLY |
+                         (pxRun->compress ? SPIFFS_O_COMPRESS : 0), 0);
+      M_TEST_ASSERT(file >= 0);
+      benchFirst[segment] = i;
+      size = 0;
+    } /* if */
+    length = benchLine(line, i);
+    M_TEST_ASSERT(length == SPIFFS_write(&gSpiffsFs, file, line, length));
+    size += length;
+    logged += length;
+    if ((0 != pxRun->flushEvery) && ((pxRun->flushEvery - 1) == (i % pxRun->flushEvery)))
+    {
+      M_TEST_ASSERT(SPIFFS_OK == SPIFFS_fflush(&gSpiffsFs, file));
+    } /* if */
+    if (size >= C_BENCH_SEGMENT)
+    {
+      benchSize[segment] = size;
+      M_TEST_ASSERT(SPIFFS_OK == SPIFFS_close(&gSpiffsFs, file));
+      file = -1;
+      segment++;
+      M_TEST_ASSERT(segment < C_BENCH_MAX_SEGMENTS);
+    } /* if */
+  } /* for */
+  if (file >= 0)
+  {
+    M_TEST_ASSERT(SPIFFS_OK == SPIFFS_close(&gSpiffsFs, file));
+    segment++;
+  } /* if */
+  benchFirst[segment] = C_BENCH_LINES;
+
+  ms = benchMs();
+  snprintf(name, sizeof(name), "log%08x", segment - 2);
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_stat(&gSpiffsFs, name, &stat));
+  printf("%-26s %6.3f MB/s, %6u KB programmed, %4u erases, segment ratio %4.2f\n", pxRun->name,
+         (logged / 1e6) / (ms / 1000.0), benchStats.programBytes / 1024, benchStats.erases,
+         (double) benchSize[segment - 2] / stat.size);
+  M_TEST_ASSERT(pxRun->compress ? (stat.size < benchSize[segment - 2]) : (stat.size == benchSize[segment - 2]));
+
+  for (i = segment - C_BENCH_SEGMENTS; i < segment; i++)
+  {
+    benchCheckSegment(i);
+  } /* for */
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_check(&gSpiffsFs));
+  for (i = segment - C_BENCH_SEGMENTS; i < segment; i++)
+  {
+    benchCheckSegment(i);
+  } /* for */
+} /* benchRun() */
+
+int main(void)
+{
+  static const BENCH_Run runs[] =
+  {
+    { "raw", 0, 0 },
+    { "compressed", 1, 0 },
+    { "compressed, flush / 20", 1, 20 },
+    { "compressed, flush / line", 1, 1 }
+  };
+  uint8_t     data[C_BENCH_STATIC_SIZE];
+  char        name[SPIFFS_OBJ_NAME_LEN];
+  spiffs_file file;
+  uint32_t    i;
+  int         status;
+
+  flashSimInit(&benchConfig);
+  SPIFFS_mount(&gSpiffsFs, &benchConfig, benchWork, benchFds, sizeof(benchFds), 0, 0, 0);
+  SPIFFS_unmount(&gSpiffsFs);
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_format(&gSpiffsFs));
+  benchMount();
+  memset(data, 0x5A, sizeof(data));
+  for (i = 0; i < C_BENCH_STATIC_FILES; i++)
+  {
+    snprintf(name, sizeof(name), "static%u", i);
+    file = SPIFFS_open(&gSpiffsFs, name, SPIFFS_CREAT | SPIFFS_RDWR, 0);
+    M_TEST_ASSERT(file >= 0);
+    M_TEST_ASSERT(sizeof(data) == SPIFFS_write(&gSpiffsFs, file, data, sizeof(data)));
+    SPIFFS_close(&gSpiffsFs, file);
+  } /* for */
+  SPIFFS_unmount(&gSpiffsFs);
+  memcpy(benchSnapshot, flashSimData(), C_FLASH_SIM_SIZE);
+
+  printf("%u telemetry lines in segments of %u bytes, %u kept\n", C_BENCH_LINES, C_BENCH_SEGMENT,
+         C_BENCH_SEGMENTS);
+  for (i = 0; i < sizeof(runs) / sizeof(runs[0]); i++)
+  {
+    fflush(stdout);
+    if (0 == fork())
+    {
+      benchRun(&runs[i]);
+      fflush(stdout);
+      _exit(0);
+    } /* if */
+    M_TEST_ASSERT(wait(&status) > 0);
+    M_TEST_ASSERT(WIFEXITED(status) && (0 == WEXITSTATUS(status)));
+  } /* for */
+
+  printf("ALL OK\n");
+  return 0;
+} /* main() */
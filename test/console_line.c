@@ -0,0 +1,176 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "console.h"
+#include "test.h"
+
+/*
+ * Command line assembler of the console. The USART1 interrupt hands the
+ * characters over in bursts of any size: the state kept in the line between
+ * two calls of the assembler must give the same lines and the same echo as one
+ * burst.
+ */
+
+#define C_CONSOLE_LINE_MAX_LINES 8   //!< Lines kept by a run.
+#define C_CONSOLE_LINE_ECHO_SIZE 512 //!< Echo kept by a run.
+
+/**
+ * @brief  Output of the assembler for an input
+ */
+typedef struct
+{
+  CONSOLE_Line line;                                                 /**< line being typed */
+  char         lines[C_CONSOLE_LINE_MAX_LINES][C_CONSOLE_LINE_SIZE]; /**< lines completed */
+  int          count;                                                /**< lines completed */
+  char         echo[C_CONSOLE_LINE_ECHO_SIZE];                       /**< echo, 0-terminated */
+  uint32_t     echoLength;                                           /**< length of the echo */
+} CONSOLE_LINE_Run;
+
+static CONSOLE_LINE_Run consoleLineRun; //!< Output of the last input.
+
+/*
+ * @brief               feeds characters to the assembler, as one burst of the interrupt
+ */
+static void consoleLineBurst
+(
+  CONSOLE_LINE_Run* pxRun,
+  const char*       pxText,
+  size_t            xLength
+)
+{
+  char     echo[C_CONSOLE_ECHO_SIZE];
+  uint32_t echoLength;
+  size_t   i;
+
+  for (i = 0; i < xLength; i++)
+  {
+    int complete = consoleLineFeed(&pxRun->line, pxText[i], echo, &echoLength);
+
+    M_TEST_ASSERT(echoLength <= C_CONSOLE_ECHO_SIZE);
+    M_TEST_ASSERT((pxRun->echoLength + echoLength) < C_CONSOLE_LINE_ECHO_SIZE);
+    memcpy(&pxRun->echo[pxRun->echoLength], echo, echoLength);
+    pxRun->echoLength += echoLength;
+    M_TEST_ASSERT(pxRun->line.length < C_CONSOLE_LINE_SIZE);
+    if (0 != complete)
+    {
+      M_TEST_ASSERT(pxRun->count < C_CONSOLE_LINE_MAX_LINES);
+      M_TEST_ASSERT(strlen(pxRun->line.text) < C_CONSOLE_LINE_SIZE);
+      strcpy(pxRun->lines[pxRun->count++], pxRun->line.text);
+    } /* if */
+  } /* for */
+} /* consoleLineBurst() */
+
+/*
+ * @brief               feeds a text in bursts of xBurst characters, 0 for one burst
+ * @return              output of the assembler
+ */
+static const CONSOLE_LINE_Run* consoleLineFeedText
+(
+  const char* pxText,
+  size_t      xBurst
+)
+{
+  size_t length = strlen(pxText);
+  size_t done;
+
+  memset(&consoleLineRun, 0, sizeof(consoleLineRun));
+  consoleLineReset(&consoleLineRun.line);
+  if (0 == xBurst)
+  {
+    xBurst = length;
+  } /* if */
+  for (done = 0; done < length; done += xBurst)
+  {
+    consoleLineBurst(&consoleLineRun, &pxText[done], ((length - done) < xBurst) ? (length - done) : xBurst);
+  } /* for */
+  return &consoleLineRun;
+} /* consoleLineFeedText() */
+
+/*
+ * @brief               checks the lines and the echo of a text, in one burst, then in
+ *                      bursts of every size up to its length
+ */
+static void consoleLineCheck
+(
+  const char* pxText,
+  const char* pxEcho,
+  int         xCount,
+  ...
+)
+{
+  const char* expected[C_CONSOLE_LINE_MAX_LINES];
+  size_t      burst;
+  va_list     args;
+  int         i;
+
+  va_start(args, xCount);
+  for (i = 0; i < xCount; i++)
+  {
+    expected[i] = va_arg(args, const char*);
+  } /* for */
+  va_end(args);
+
+  for (burst = 0; burst <= strlen(pxText); burst++)
+  {
+    const CONSOLE_LINE_Run* run = consoleLineFeedText(pxText, burst);
+
+    if ((run->count != xCount) || (0 != strcmp(run->echo, pxEcho)))
+    {
+      printf("input \"%s\" in bursts of %zu: %d lines, echo \"%s\"\n", pxText, burst, run->count, run->echo);
+    } /* if */
+    M_TEST_ASSERT(run->count == xCount);
+    M_TEST_ASSERT(0 == strcmp(run->echo, pxEcho));
+    for (i = 0; i < xCount; i++)
+    {
+      M_TEST_ASSERT(0 == strcmp(run->lines[i], expected[i]));
+    } /* for */
+  } /* for */
+} /* consoleLineCheck() */
+
+int main(void)
+{
+  char long_line[2 * C_CONSOLE_LINE_SIZE + 2];
+  char long_echo[C_CONSOLE_LINE_SIZE + 8];
+  char long_text[C_CONSOLE_LINE_SIZE];
+
+  /* CR, LF and CR LF each end one line, CR LF CR LF ends two. */
+  consoleLineCheck("abc\r", "abc\r\n", 1, "abc");
+  consoleLineCheck("abc\n", "abc\r\n", 1, "abc");
+  consoleLineCheck("ab\r\ncd\n", "ab\r\ncd\r\n", 2, "ab", "cd");
+  consoleLineCheck("\r\n\r\n", "\r\n\r\n", 2, "", "");
+  consoleLineCheck("\n\r", "\r\n\r\n", 2, "", "");
+  consoleLineCheck("\r\r", "\r\n\r\n", 2, "", "");
+  consoleLineCheck("ab\r\n\ncd\r", "ab\r\n\r\ncd\r\n", 3, "ab", "", "cd");
+
+  /* Backspace and DEL erase one character, and nothing on an empty line. */
+  consoleLineCheck("abx\x7f" "c\r", "abx\b \bc\r\n", 1, "abc");
+  consoleLineCheck("abx\bc\r", "abx\b \bc\r\n", 1, "abc");
+  consoleLineCheck("\b\x7f" "a\r", "a\r\n", 1, "a");
+  consoleLineCheck("ab\b\b\bc\r", "ab\b \b\b \bc\r\n", 1, "c");
+
+  /* Ctrl-U erases the line, escape sequences and control characters are ignored. */
+  consoleLineCheck("junk\x15ok\r", "junk\r\x1b[Kok\r\n", 1, "ok");
+  consoleLineCheck("a\x1b[Ab\x1b[1;5Cc\x1bxd\r", "abcd\r\n", 1, "abcd");
+  consoleLineCheck("a\tb\x01\r", "ab\r\n", 1, "ab");
+
+  /* Overflow: the characters past the end of the line are neither kept nor echoed. */
+  memset(long_line, 'x', 2 * C_CONSOLE_LINE_SIZE);
+  strcpy(&long_line[2 * C_CONSOLE_LINE_SIZE], "\r");
+  memset(long_echo, 'x', C_CONSOLE_LINE_SIZE - 1);
+  strcpy(&long_echo[C_CONSOLE_LINE_SIZE - 1], "\r\n");
+  memset(long_text, 'x', C_CONSOLE_LINE_SIZE - 1);
+  long_text[C_CONSOLE_LINE_SIZE - 1] = 0;
+  consoleLineCheck(long_line, long_echo, 1, long_text);
+
+  /* A full line still takes a backspace, then a character again. */
+  long_line[2 * C_CONSOLE_LINE_SIZE - 2] = '\b';
+  long_line[2 * C_CONSOLE_LINE_SIZE - 1] = 'y';
+  strcpy(&long_echo[C_CONSOLE_LINE_SIZE - 1], "\b \by\r\n");
+  long_text[C_CONSOLE_LINE_SIZE - 2] = 'y';
+  consoleLineCheck(long_line, long_echo, 1, long_text);
+
+  printf("ALL OK\n");
+  return 0;
+} /* main() */
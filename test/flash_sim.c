@@ -0,0 +1,138 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "spiffs.h"
+#include "flash_sim.h"
+
+static uint8_t flashSimMemory[C_FLASH_SIM_SIZE]; //!< Content of the memory.
+
+static long flashSimCutAt = -1; //!< Operation torn, -1 for none.
+
+static long flashSimCount = 0; //!< Programs and erases since flashSimCut.
+
+static FLASH_SIM_Stats flashSimStats; //!< Counters of the memory.
+
+/*
+ * @brief               counts a program or an erase and tells whether it runs
+ * @return              2 when it runs, 1 when it is torn, 0 when the power is off
+ */
+static int flashSimPower(void)
+{
+  long op = flashSimCount++;
+
+  if ((flashSimCutAt < 0) || (op < flashSimCutAt))
+  {
+    return 2;
+  } /* if */
+  return (op == flashSimCutAt) ? 1 : 0;
+} /* flashSimPower() */
+
+static s32_t flashSimRead
+(
+  u32_t xAddress,
+  u32_t xSize,
+  u8_t* pxData
+)
+{
+  memcpy(pxData, &flashSimMemory[xAddress], xSize);
+  flashSimStats.reads++;
+  flashSimStats.readBytes += xSize;
+  return SPIFFS_OK;
+} /* flashSimRead() */
+
+static s32_t flashSimWrite
+(
+  u32_t xAddress,
+  u32_t xSize,
+  u8_t* pxData
+)
+{
+  int   power = flashSimPower();
+  u32_t i;
+
+  if (0 == power)
+  {
+    return -1;
+  } /* if */
+
+  /* A torn program leaves the first half of the bytes programmed. */
+  for (i = 0; i < ((2 == power) ? xSize : (xSize / 2)); i++)
+  {
+    flashSimMemory[xAddress + i] &= pxData[i];
+  } /* for */
+  flashSimStats.programs++;
+  flashSimStats.programBytes += xSize;
+  if (0 != xSize)
+  {
+    flashSimStats.programPages += ((xAddress + xSize - 1) / C_FLASH_SIM_PAGE) - (xAddress / C_FLASH_SIM_PAGE) + 1;
+  } /* if */
+  return (2 == power) ? SPIFFS_OK : -1;
+} /* flashSimWrite() */
+
+static s32_t flashSimErase
+(
+  u32_t xAddress,
+  u32_t xSize
+)
+{
+  int power = flashSimPower();
+
+  if (0 == power)
+  {
+    return -1;
+  } /* if */
+
+  memset(&flashSimMemory[xAddress], 0xFF, (2 == power) ? xSize : (xSize / 2));
+  flashSimStats.erases++;
+  return (2 == power) ? SPIFFS_OK : -1;
+} /* flashSimErase() */
+
+void flashSimInit
+(
+  spiffs_config* pxConfig
+)
+{
+  memset(flashSimMemory, 0xFF, sizeof(flashSimMemory));
+  memset(pxConfig, 0, sizeof(*pxConfig));
+  pxConfig->hal_read_f = flashSimRead;
+  pxConfig->hal_write_f = flashSimWrite;
+  pxConfig->hal_erase_f = flashSimErase;
+  flashSimCut(-1);
+} /* flashSimInit() */
+
+uint8_t* flashSimData(void)
+{
+  return flashSimMemory;
+} /* flashSimData() */
+
+void flashSimCut
+(
+  long xOp
+)
+{
+  flashSimCutAt = xOp;
+  flashSimCount = 0;
+} /* flashSimCut() */
+
+long flashSimOps(void)
+{
+  return flashSimCount;
+} /* flashSimOps() */
+
+void flashSimGetStats
+(
+  FLASH_SIM_Stats* pxStats
+)
+{
+  *pxStats = flashSimStats;
+  memset(&flashSimStats, 0, sizeof(flashSimStats));
+} /* flashSimGetStats() */
+
+/* SPIFFS_LOCK and SPIFFS_UNLOCK of spiffs_config.h: the tests run one thread. */
+void spiffsLock(void)
+{
+} /* spiffsLock() */
+
+void spiffsUnlock(void)
+{
+} /* spiffsUnlock() */
@@ -0,0 +1,78 @@
+#ifndef TEST_FLASH_SIM_H_
+#define TEST_FLASH_SIM_H_
+
+#include <stdint.h>
+
+#include "spiffs.h"
+
+/*
+ * NOR flash in RAM for the host tests, laid out like the QSPI memory of the
+ * board: SPIFFS_CFG_PHYS_ADDR then SPIFFS_CFG_PHYS_SZ bytes. A program only
+ * clears bits, an erase sets them back. A cut point simulates a power loss:
+ * the program or erase of that number is torn, half done, and everything after
+ * fails until flashSimCut(-1).
+ */
+
+#define C_FLASH_SIM_SIZE (SPIFFS_CFG_PHYS_ADDR(0) + SPIFFS_CFG_PHYS_SZ(0))
+                                    //!< Bytes of the memory.
+
+#define C_FLASH_SIM_PAGE 256 //!< Bytes of a program page of the memory.
+
+/**
+ * @brief  Counters of the memory
+ */
+typedef struct
+{
+  uint32_t reads;        /**< read operations */
+  uint32_t readBytes;    /**< bytes read */
+  uint32_t programs;     /**< program operations */
+  uint32_t programBytes; /**< bytes programmed */
+  uint32_t programPages; /**< program pages touched, each one costs a page program */
+  uint32_t erases;       /**< erase operations */
+} FLASH_SIM_Stats;
+
+/**
+ * @brief                   erases the memory and sets the callbacks of a SPIFFS
+ *                          configuration
+ * @param[out] pxConfig     configuration, the other fields are cleared
+ * @return                  none
+ */
+void flashSimInit
+(
+  spiffs_config* pxConfig
+);
+
+/**
+ * @brief                   gets the content of the memory
+ * @return                  C_FLASH_SIM_SIZE bytes
+ */
+uint8_t* flashSimData(void);
+
+/**
+ * @brief                   sets the power loss
+ * @param[in] xOp           number of the program or erase torn, from 0 at this
+ *                          call, or -1 for none
+ * @return                  none
+ */
+void flashSimCut
+(
+  long xOp
+);
+
+/**
+ * @brief                   gets the programs and erases since the last flashSimCut
+ * @return                  number of operations
+ */
+long flashSimOps(void);
+
+/**
+ * @brief                   gets the counters and clears them
+ * @param[out] pxStats      counters
+ * @return                  none
+ */
+void flashSimGetStats
+(
+  FLASH_SIM_Stats* pxStats
+);
+
+#endif /* TEST_FLASH_SIM_H_ */
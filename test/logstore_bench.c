@@ -0,0 +1,333 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "spiffs.h"
+#include "spiffs_fs.h"
+#include "logstore.h"
+#include "flash_sim.h"
+#include "test.h"
+
+/*
+ * Benchmark of the log store over the RAM flash of flash_sim.h, 70 % full of
+ * static files. 2 MB are logged as 48-byte lines, by one SPIFFS_write per
+ * line, then through the log store, then through the log store flushed every
+ * 20 lines. The flash time follows the MX25R6435F datasheet and is the only
+ * time counted: the log task is saturated. Prints the lines per second and
+ * the flash bytes programmed per byte logged. The segments left must hold the
+ * exact tail of the stream and SPIFFS_check must pass.
+ *
+ * The log store opens once per process: each run is a child process, started
+ * from the same memory.
+ */
+
+#define C_BENCH_LINE  48                          //!< Bytes of a log line.
+#define C_BENCH_LINES ((2 * 1024 * 1024) / C_BENCH_LINE) //!< Lines of a run.
+
+#define C_BENCH_STATIC_FILES 700  //!< Static files filling the memory.
+#define C_BENCH_STATIC_SIZE  4000 //!< Bytes of a static file.
+
+#define C_BENCH_PROGRAM_MS  0.85  //!< Page program time.
+#define C_BENCH_ERASE_MS    400.0 //!< 64 KB block erase time.
+#define C_BENCH_READ_MS     0.000125 //!< Read time of a byte, 8 MB/s.
+
+#define C_BENCH_NAIVE_SEGMENT (240 * 251) //!< Segment of the naive run, as the log store.
+
+#define C_BENCH_PREFIX "log." //!< Prefix of the segments.
+
+/**
+ * @brief  Run of the benchmark
+ */
+typedef struct
+{
+  const char* name;       /**< printed */
+  int         store;      /**< 0 for one SPIFFS_write per line */
+  uint32_t    flushEvery; /**< lines between two logstoreFlush, 0 for none */
+} BENCH_Run;
+
+spiffs gSpiffsFs;
+
+static spiffs_config benchConfig;
+
+static uint8_t benchWork[2 * 256]; //!< Two logical pages.
+
+static uint8_t benchFds[44 * 4]; //!< Four file descriptors.
+
+static uint8_t benchSnapshot[C_FLASH_SIM_SIZE]; //!< Memory before a run.
+
+static FLASH_SIM_Stats benchStats; //!< Counters of the memory since the run started.
+
+static uint8_t benchKept[(C_LOGSTORE_SEGMENTS + 1) * C_BENCH_NAIVE_SEGMENT]; //!< Segments read back.
+
+/*
+ * @brief               adds the counters of the memory to benchStats
+ */
+static void benchUpdate(void)
+{
+  FLASH_SIM_Stats stats;
+
+  flashSimGetStats(&stats);
+  benchStats.reads += stats.reads;
+  benchStats.readBytes += stats.readBytes;
+  benchStats.programs += stats.programs;
+  benchStats.programBytes += stats.programBytes;
+  benchStats.programPages += stats.programPages;
+  benchStats.erases += stats.erases;
+} /* benchUpdate() */
+
+/*
+ * @brief               time the memory was busy since the run started
+ */
+static double benchMs(void)
+{
+  benchUpdate();
+  return (benchStats.programPages * C_BENCH_PROGRAM_MS) + (benchStats.erases * C_BENCH_ERASE_MS) +
+         (benchStats.readBytes * C_BENCH_READ_MS);
+} /* benchMs() */
+
+/* The clock of the log store is the flash time. */
+uint32_t boardGetTick(void)
+{
+  return (uint32_t) benchMs();
+} /* boardGetTick() */
+
+/* SPIFFS_LOCK and SPIFFS_UNLOCK are in flash_sim.c. */
+
+static void benchMount(void)
+{
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_mount(&gSpiffsFs, &benchConfig, benchWork, benchFds,
+      sizeof(benchFds), 0, 0, 0));
+} /* benchMount() */
+
+/*
+ * @brief               builds a log line: its number, then a letter
+ */
+static void benchLine
+(
+  uint8_t* pxLine,
+  uint32_t xNumber
+)
+{
+  memset(pxLine, 'a' + (xNumber % 26), C_BENCH_LINE);
+  memcpy(pxLine, &xNumber, sizeof(xNumber));
+} /* benchLine() */
+
+static int benchCompare
+(
+  const void* pxA,
+  const void* pxB
+)
+{
+  return strcmp((const char*) pxA, (const char*) pxB);
+} /* benchCompare() */
+
+/*
+ * @brief               checks that the segments hold the tail of the stream
+ * @return              bytes kept
+ */
+static uint32_t benchCheckTail(void)
+{
+  char                 names[C_LOGSTORE_SEGMENTS + 1][SPIFFS_OBJ_NAME_LEN];
+  spiffs_DIR           dir;
+  struct spiffs_dirent entry;
+  spiffs_file          file;
+  uint32_t             count = 0;
+  uint32_t             length = 0;
+  uint32_t             start;
+  uint32_t             i;
+  int32_t              result;
+  uint8_t              line[C_BENCH_LINE];
+
+  M_TEST_ASSERT(NULL != SPIFFS_opendir(&gSpiffsFs, "" /* root */, &dir));
+  while (NULL != SPIFFS_readdir(&dir, &entry))
+  {
+    if (0 == strncmp((const char*) entry.name, C_BENCH_PREFIX, strlen(C_BENCH_PREFIX)))
+    {
+      M_TEST_ASSERT(count <= C_LOGSTORE_SEGMENTS);
+      strcpy(names[count++], (const char*) entry.name);
+    } /* if */
+  } /* while */
+  SPIFFS_closedir(&dir);
+  M_TEST_ASSERT(C_LOGSTORE_SEGMENTS == count);
+  qsort(names, count, sizeof(names[0]), benchCompare);
+
+  for (i = 0; i < count; i++)
+  {
+    file = SPIFFS_open(&gSpiffsFs, names[i], SPIFFS_RDONLY, 0);
+    M_TEST_ASSERT(file >= 0);
+    while ((result = SPIFFS_read(&gSpiffsFs, file, &benchKept[length], 4096)) > 0)
+    {
+      length += result;
+      M_TEST_ASSERT((length + 4096) <= sizeof(benchKept));
+    } /* while */
+    SPIFFS_close(&gSpiffsFs, file);
+  } /* for */
+
+  start = (C_BENCH_LINES * C_BENCH_LINE) - length;
+  for (i = 0; i < length; i++)
+  {
+    benchLine(line, (start + i) / C_BENCH_LINE);
+    M_TEST_ASSERT(benchKept[i] == line[(start + i) % C_BENCH_LINE]);
+  } /* for */
+  return length;
+} /* benchCheckTail() */
+
+/*
+ * @brief               logs the lines by one SPIFFS_write each, in segments
+ *                      rotated as the log store does
+ */
+static void benchNaive(void)
+{
+  char        name[SPIFFS_OBJ_NAME_LEN];
+  spiffs_file file;
+  uint32_t    segment = 0;
+  uint32_t    size = 0;
+  uint32_t    i;
+  uint8_t     line[C_BENCH_LINE];
+
+  snprintf(name, sizeof(name), "naive%08x", segment);
+  file = SPIFFS_open(&gSpiffsFs, name, SPIFFS_CREAT | SPIFFS_APPEND | SPIFFS_WRONLY, 0);
+  for (i = 0; i < C_BENCH_LINES; i++)
+  {
+    if (size >= C_BENCH_NAIVE_SEGMENT)
+    {
+      SPIFFS_close(&gSpiffsFs, file);
+      segment++;
+      if (segment >= C_LOGSTORE_SEGMENTS)
+      {
+        snprintf(name, sizeof(name), "naive%08x", segment - C_LOGSTORE_SEGMENTS);
+        M_TEST_ASSERT(SPIFFS_OK == SPIFFS_remove(&gSpiffsFs, name));
+      } /* if */
+      snprintf(name, sizeof(name), "naive%08x", segment);
+      file = SPIFFS_open(&gSpiffsFs, name, SPIFFS_CREAT | SPIFFS_APPEND | SPIFFS_WRONLY, 0);
+      size = 0;
+    } /* if */
+    M_TEST_ASSERT(file >= 0);
+    benchLine(line, i);
+    M_TEST_ASSERT(C_BENCH_LINE == SPIFFS_write(&gSpiffsFs, file, line, C_BENCH_LINE));
+    size += C_BENCH_LINE;
+  } /* for */
+  SPIFFS_close(&gSpiffsFs, file);
+} /* benchNaive() */
+
+/*
+ * @brief               logs the lines through the log store, flushed as the
+ *                      log task does when it is due
+ */
+static void benchStore
+(
+  uint32_t xFlushEvery
+)
+{
+  uint32_t i;
+  uint8_t  line[C_BENCH_LINE];
+
+  M_TEST_ASSERT(BOARD_OK == logstoreOpen(C_BENCH_PREFIX));
+  for (i = 0; i < C_BENCH_LINES; i++)
+  {
+    benchLine(line, i);
+    M_TEST_ASSERT(BOARD_OK == logstoreWrite(line, C_BENCH_LINE));
+    if (((0 != xFlushEvery) && ((xFlushEvery - 1) == (i % xFlushEvery))) || (0 == logstoreFlushIn()))
+    {
+      M_TEST_ASSERT(BOARD_OK == logstoreFlush());
+    } /* if */
+  } /* for */
+  M_TEST_ASSERT(BOARD_OK == logstoreFlush());
+} /* benchStore() */
+
+/*
+ * @brief               runs the benchmark from the memory of benchSnapshot
+ */
+static void benchRun
+(
+  const BENCH_Run* pxRun
+)
+{
+  LOGSTORE_Stats stats;
+  double         ms;
+
+  memcpy(flashSimData(), benchSnapshot, C_FLASH_SIM_SIZE);
+  benchMount();
+  benchMs();
+  memset(&benchStats, 0, sizeof(benchStats));
+
+  if (0 == pxRun->store)
+  {
+    benchNaive();
+  }
+  else
+  {
+    benchStore(pxRun->flushEvery);
+  } /* if */
+
+  ms = benchMs();
+  printf("%-24s %6.0f lines/s, %5.2f flash B per logged B, %4u erases\n", pxRun->name,
+         C_BENCH_LINES / (ms / 1000.0),
+         (double) benchStats.programBytes / ((double) C_BENCH_LINES * C_BENCH_LINE), benchStats.erases);
+
+  if (0 != pxRun->store)
+  {
+    logstoreGetStats(&stats);
+    M_TEST_ASSERT((C_BENCH_LINES * C_BENCH_LINE) == stats.bytes);
+    M_TEST_ASSERT((stats.bytes == stats.written) && (0 == stats.errors));
+    printf("%-24s %u writes, %u flushes, %u segments, %u deleted, %u bytes kept\n", "", stats.writes,
+           stats.flushes, stats.segments, stats.deleted, benchCheckTail());
+    if (0 == pxRun->flushEvery)
+    {
+      M_TEST_ASSERT(benchStats.programBytes < (2 * C_BENCH_LINES * C_BENCH_LINE));
+    } /* if */
+  } /* if */
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_check(&gSpiffsFs));
+} /* benchRun() */
+
+int main(void)
+{
+  static const BENCH_Run runs[] =
+  {
+    { "one SPIFFS_write a line", 0, 0 },
+    { "log store", 1, 0 },
+    { "log store, flush / 20", 1, 20 }
+  };
+  uint8_t     data[C_BENCH_STATIC_SIZE];
+  char        name[SPIFFS_OBJ_NAME_LEN];
+  spiffs_file file;
+  uint32_t    i;
+  int         status;
+
+  flashSimInit(&benchConfig);
+  SPIFFS_mount(&gSpiffsFs, &benchConfig, benchWork, benchFds, sizeof(benchFds), 0, 0, 0);
+  SPIFFS_unmount(&gSpiffsFs);
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_format(&gSpiffsFs));
+  benchMount();
+  memset(data, 0x5A, sizeof(data));
+  for (i = 0; i < C_BENCH_STATIC_FILES; i++)
+  {
+    snprintf(name, sizeof(name), "static%u", i);
+    file = SPIFFS_open(&gSpiffsFs, name, SPIFFS_CREAT | SPIFFS_RDWR, 0);
+    M_TEST_ASSERT(file >= 0);
+    M_TEST_ASSERT(sizeof(data) == SPIFFS_write(&gSpiffsFs, file, data, sizeof(data)));
+    SPIFFS_close(&gSpiffsFs, file);
+  } /* for */
+  SPIFFS_unmount(&gSpiffsFs);
+  memcpy(benchSnapshot, flashSimData(), C_FLASH_SIM_SIZE);
+
+  printf("%u lines of %u bytes\n", C_BENCH_LINES, C_BENCH_LINE);
+  for (i = 0; i < sizeof(runs) / sizeof(runs[0]); i++)
+  {
+    fflush(stdout);
+    if (0 == fork())
+    {
+      benchRun(&runs[i]);
+      fflush(stdout);
+      _exit(0);
+    } /* if */
+    M_TEST_ASSERT(wait(&status) > 0);
+    M_TEST_ASSERT(WIFEXITED(status) && (0 == WEXITSTATUS(status)));
+  } /* for */
+
+  printf("ALL OK\n");
+  return 0;
+} /* main() */
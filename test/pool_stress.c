@@ -0,0 +1,230 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "pool.h"
+#include "test.h"
+
+/*
+ * Stress benchmark of the block pools against heap_4, both built for the host.
+ * The same random mix of allocations and frees runs on pvPortMalloc alone,
+ * then on poolAlloc: 60 % small, 30 % page and 10 % payload sizes, while
+ * long-lived heap objects of random sizes are re-created from time to time to
+ * fragment the heap. Prints the latency of the operations. Checks that no
+ * pool block is given twice and that both allocators get all their memory
+ * back.
+ */
+
+#define C_POOL_STRESS_OPS     1000000 //!< Allocations and frees of a run.
+#define C_POOL_STRESS_LONG    24      //!< Long-lived heap objects.
+#define C_POOL_STRESS_REFRESH 5000    //!< Operations between two re-creations of one.
+
+#if defined(__x86_64__) || defined(__i386__)
+#define C_POOL_STRESS_UNIT "cycles" //!< Unit of poolStressClock.
+#else
+#define C_POOL_STRESS_UNIT "ns"     //!< Unit of poolStressClock.
+#endif
+
+uint32_t testPrimask = 0;
+
+static uint32_t poolStressSeed; //!< State of the xorshift generator.
+
+static uint64_t poolStressLatency[C_POOL_STRESS_OPS]; //!< Time of each operation.
+
+/*
+ * @brief               draws a random number
+ */
+static uint32_t poolStressRandom(void)
+{
+  poolStressSeed ^= poolStressSeed << 13;
+  poolStressSeed ^= poolStressSeed >> 17;
+  poolStressSeed ^= poolStressSeed << 5;
+  return poolStressSeed;
+} /* poolStressRandom() */
+
+/*
+ * @brief               draws a size: AT command, SPIFFS page or Wi-Fi payload
+ */
+static uint32_t poolStressSize(void)
+{
+  uint32_t r = poolStressRandom() % 100;
+
+  if (r < 60)
+  {
+    return 8 + (poolStressRandom() % 25);
+  } /* if */
+  if (r < 90)
+  {
+    return 100 + (poolStressRandom() % 157);
+  } /* if */
+  return 600 + (poolStressRandom() % 601);
+} /* poolStressSize() */
+
+/*
+ * @brief               reads a clock: the CPU cycles on x86, nanoseconds elsewhere
+ */
+static uint64_t poolStressClock(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t) now.tv_sec * 1000000000u) + (uint64_t) now.tv_nsec;
+#endif
+} /* poolStressClock() */
+
+static int poolStressCompare
+(
+  const void* pxA,
+  const void* pxB
+)
+{
+  uint64_t a = *(const uint64_t*) pxA;
+  uint64_t b = *(const uint64_t*) pxB;
+
+  return (a > b) - (a < b);
+} /* poolStressCompare() */
+
+static void* poolStressHeapAlloc
+(
+  uint32_t xSize
+)
+{
+  return pvPortMalloc(xSize);
+} /* poolStressHeapAlloc() */
+
+/*
+ * @brief               runs the mix on an allocator
+ * @param[in] pxName    name printed
+ * @param[in] xLive     blocks alive at most
+ * @param[in] pxAlloc   allocation
+ * @param[in] pxFree    free
+ */
+static void poolStressRun
+(
+  const char* pxName,
+  uint32_t    xLive,
+  void*       (*pxAlloc)(uint32_t),
+  void        (*pxFree)(void*)
+)
+{
+  void**    live = calloc(xLive, sizeof(void*));
+  uint8_t*  tags = calloc(xLive, 1);
+  uint32_t* sizes = calloc(xLive, sizeof(uint32_t));
+  void*     longs[C_POOL_STRESS_LONG];
+  size_t    heapFree = xPortGetFreeHeapSize();
+  uint64_t  total = 0;
+  uint64_t  start;
+  uint32_t  failed = 0;
+  uint32_t  i;
+
+  M_TEST_ASSERT((NULL != live) && (NULL != tags) && (NULL != sizes));
+  poolStressSeed = 12345;
+  for (i = 0; i < C_POOL_STRESS_LONG; i++)
+  {
+    longs[i] = pvPortMalloc(200 + (poolStressRandom() % 1800));
+    M_TEST_ASSERT(NULL != longs[i]);
+  } /* for */
+
+  for (i = 0; i < C_POOL_STRESS_OPS; i++)
+  {
+    uint32_t k = poolStressRandom() % xLive;
+
+    if (0 == (i % C_POOL_STRESS_REFRESH))
+    {
+      uint32_t j = poolStressRandom() % C_POOL_STRESS_LONG;
+
+      vPortFree(longs[j]);
+      longs[j] = pvPortMalloc(200 + (poolStressRandom() % 1800));
+      M_TEST_ASSERT(NULL != longs[j]);
+    } /* if */
+
+    if (NULL != live[k])
+    {
+      /* A block given twice would have been overwritten by its other owner. */
+      M_TEST_ASSERT(tags[k] == ((uint8_t*) live[k])[0]);
+      M_TEST_ASSERT(tags[k] == ((uint8_t*) live[k])[sizes[k] - 1]);
+      start = poolStressClock();
+      pxFree(live[k]);
+      poolStressLatency[i] = poolStressClock() - start;
+      live[k] = NULL;
+    }
+    else
+    {
+      sizes[k] = poolStressSize();
+      start = poolStressClock();
+      live[k] = pxAlloc(sizes[k]);
+      poolStressLatency[i] = poolStressClock() - start;
+      if (NULL == live[k])
+      {
+        failed++;
+      }
+      else
+      {
+        M_TEST_ASSERT(0 == ((uintptr_t) live[k] & 7));
+        tags[k] = (uint8_t) i;
+        memset(live[k], tags[k], sizes[k]);
+      } /* if */
+    } /* if */
+    total += poolStressLatency[i];
+  } /* for */
+
+  qsort(poolStressLatency, C_POOL_STRESS_OPS, sizeof(poolStressLatency[0]), poolStressCompare);
+  printf("%-6s %3u live: mean %5.1f p50 %4llu p99 %4llu p99.99 %5llu max %6llu, failed %u, heap min free %zu\n",
+         pxName, xLive, (double) total / C_POOL_STRESS_OPS,
+         (unsigned long long) poolStressLatency[C_POOL_STRESS_OPS / 2],
+         (unsigned long long) poolStressLatency[(uint64_t) C_POOL_STRESS_OPS * 99 / 100],
+         (unsigned long long) poolStressLatency[(uint64_t) C_POOL_STRESS_OPS * 9999 / 10000],
+         (unsigned long long) poolStressLatency[C_POOL_STRESS_OPS - 1], failed,
+         xPortGetMinimumEverFreeHeapSize());
+
+  for (i = 0; i < xLive; i++)
+  {
+    pxFree(live[i]);
+  } /* for */
+  for (i = 0; i < C_POOL_STRESS_LONG; i++)
+  {
+    vPortFree(longs[i]);
+  } /* for */
+  M_TEST_ASSERT(0 == failed);
+  M_TEST_ASSERT(heapFree == xPortGetFreeHeapSize());
+  free(live);
+  free(tags);
+  free(sizes);
+} /* poolStressRun() */
+
+int main(void)
+{
+  static const uint32_t lives[] = {20, 60};
+  POOL_Stats            stats;
+  uint32_t              i;
+  uint32_t              c;
+
+  /* heap_4 makes its heap on the first allocation. */
+  vPortFree(pvPortMalloc(8));
+
+  printf("latency in " C_POOL_STRESS_UNIT "\n");
+  for (i = 0; i < sizeof(lives) / sizeof(lives[0]); i++)
+  {
+    poolStressRun("heap_4", lives[i], poolStressHeapAlloc, vPortFree);
+    poolStressRun("pools", lives[i], poolAlloc, poolFree);
+  } /* for */
+
+  for (c = 0; c < C_POOL_CLASSES; c++)
+  {
+    M_TEST_ASSERT(BOARD_OK == poolGetStats(c, &stats));
+    printf("  class %u: %4u bytes, %2u blocks, max used %2u, allocs %7u, fallbacks %6u\n",
+           c, stats.size, stats.blocks, stats.maxUsed, stats.allocs, stats.fallbacks);
+    M_TEST_ASSERT(0 == stats.used);
+    M_TEST_ASSERT(stats.maxUsed <= stats.blocks);
+  } /* for */
+  M_TEST_ASSERT(BOARD_BAD_PARAMETER == poolGetStats(C_POOL_CLASSES, &stats));
+
+  printf("ALL OK\n");
+  return 0;
+} /* main() */
@@ -0,0 +1,420 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "spiffs.h"
+#include "flash_sim.h"
+#include "test.h"
+
+/*
+ * Benchmark of the SPIFFS ring files over the RAM flash of flash_sim.h, 70 %
+ * full of static files. 20000 records of 64 bytes are appended to a ring of
+ * 16 KB, then to 4 files of 4 KB rotated and deleted the oldest first. The
+ * flash time follows the MX25R6435F datasheet, as logstore_bench. Prints the
+ * appends per second, the latency of an append (mean, median, 99th percentile,
+ * maximum, standard deviation), the flash bytes programmed and the erases.
+ * The ring must hold the tail of the stream, before and after a remount, and
+ * SPIFFS_check must pass.
+ *
+ * Then the power is cut at each program and erase of a few appends to a full
+ * ring, across the start of new pages, and of the next append that erases a
+ * block: once the power is back, the ring must be at the old or the new head
+ * and hold the tail of the stream, before and after SPIFFS_check, and take
+ * the next append.
+ */
+
+#define C_BENCH_RECORD   64    //!< Bytes of an append.
+#define C_BENCH_RECORDS  20000 //!< Appends of a run.
+#define C_BENCH_CAPACITY 16384 //!< Bytes kept by the ring.
+#define C_BENCH_FILES    4     //!< Files of the rotation, C_BENCH_CAPACITY in all.
+
+#define C_BENCH_STATIC_FILES 700  //!< Static files filling the memory.
+#define C_BENCH_STATIC_SIZE  4000 //!< Bytes of a static file.
+
+#define C_BENCH_PROGRAM_MS  0.85     //!< Page program time.
+#define C_BENCH_ERASE_MS    400.0    //!< 64 KB block erase time.
+#define C_BENCH_READ_MS     0.000125 //!< Read time of a byte, 8 MB/s.
+
+#define C_BENCH_CUT_APPENDS 12 //!< Appends cut at each operation, then the next one
+                               //   that erases a block.
+
+#define C_BENCH_RING "ring" //!< Name of the ring.
+
+spiffs gSpiffsFs;
+
+static spiffs_config benchConfig;
+
+static uint8_t benchWork[2 * 256]; //!< Two logical pages.
+
+static uint8_t benchFds[44 * 4]; //!< Four file descriptors.
+
+static uint8_t benchSnapshot[C_FLASH_SIM_SIZE]; //!< Memory before a run.
+
+static uint8_t benchCutSnapshot[C_FLASH_SIM_SIZE]; //!< Memory before a cut append.
+
+static FLASH_SIM_Stats benchStats; //!< Counters of the memory since the run started.
+
+static double benchLatency[C_BENCH_RECORDS]; //!< Flash time of each append.
+
+static uint8_t benchKept[C_BENCH_CAPACITY + 512]; //!< Ring read back.
+
+/*
+ * @brief               adds the counters of the memory to benchStats
+ */
+static void benchUpdate(void)
+{
+  FLASH_SIM_Stats stats;
+
+  flashSimGetStats(&stats);
+  benchStats.reads += stats.reads;
+  benchStats.readBytes += stats.readBytes;
+  benchStats.programs += stats.programs;
+  benchStats.programBytes += stats.programBytes;
+  benchStats.programPages += stats.programPages;
+  benchStats.erases += stats.erases;
+} /* benchUpdate() */
+
+/*
+ * @brief               time the memory was busy since the run started
+ */
+static double benchMs(void)
+{
+  benchUpdate();
+  return (benchStats.programPages * C_BENCH_PROGRAM_MS) + (benchStats.erases * C_BENCH_ERASE_MS) +
+         (benchStats.readBytes * C_BENCH_READ_MS);
+} /* benchMs() */
+
+static void benchMount(void)
+{
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_mount(&gSpiffsFs, &benchConfig, benchWork, benchFds,
+      sizeof(benchFds), 0, 0, 0));
+} /* benchMount() */
+
+/*
+ * @brief               builds the record of a position of the stream
+ */
+static void benchRecord
+(
+  uint8_t* pxRecord,
+  uint32_t xNumber
+)
+{
+  memset(pxRecord, 'a' + (xNumber % 26), C_BENCH_RECORD);
+  memcpy(pxRecord, &xNumber, sizeof(xNumber));
+} /* benchRecord() */
+
+/*
+ * @brief               checks that the ring holds the tail of the stream, at
+ *                      least C_BENCH_CAPACITY bytes once written
+ * @return              the head of the stream
+ */
+static uint32_t benchCheckRing(void)
+{
+  spiffs_file file = SPIFFS_open(&gSpiffsFs, C_BENCH_RING, SPIFFS_RDONLY, 0);
+  uint8_t     record[C_BENCH_RECORD];
+  uint32_t    tail;
+  uint32_t    head;
+  uint32_t    i;
+
+  M_TEST_ASSERT(file >= 0);
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_ring_cursors(&gSpiffsFs, file, &tail, &head));
+  M_TEST_ASSERT((head - tail) >= ((head < C_BENCH_CAPACITY) ? head : C_BENCH_CAPACITY));
+  M_TEST_ASSERT((head - tail) <= sizeof(benchKept));
+  M_TEST_ASSERT((s32_t) tail == SPIFFS_lseek(&gSpiffsFs, file, tail, SPIFFS_SEEK_SET));
+  M_TEST_ASSERT((s32_t) (head - tail) == SPIFFS_read(&gSpiffsFs, file, benchKept, head - tail));
+  for (i = tail; i < head; i++)
+  {
+    benchRecord(record, i / C_BENCH_RECORD);
+    M_TEST_ASSERT(benchKept[i - tail] == record[i % C_BENCH_RECORD]);
+  } /* for */
+  if (tail > 0)
+  {
+    M_TEST_ASSERT((s32_t) (tail - 1) == SPIFFS_lseek(&gSpiffsFs, file, tail - 1, SPIFFS_SEEK_SET));
+    M_TEST_ASSERT(SPIFFS_ERR_RING_OVERWRITTEN == SPIFFS_read(&gSpiffsFs, file, benchKept, 1));
+  } /* if */
+  SPIFFS_close(&gSpiffsFs, file);
+  return head;
+} /* benchCheckRing() */
+
+/*
+ * @brief               appends the records to the ring
+ */
+static void benchRing(void)
+{
+  spiffs_file file;
+  uint8_t     record[C_BENCH_RECORD];
+  uint32_t    i;
+  double      start;
+
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_ring_create(&gSpiffsFs, C_BENCH_RING, C_BENCH_CAPACITY));
+  file = SPIFFS_open(&gSpiffsFs, C_BENCH_RING, SPIFFS_WRONLY, 0);
+  M_TEST_ASSERT(file >= 0);
+  for (i = 0; i < C_BENCH_RECORDS; i++)
+  {
+    benchRecord(record, i);
+    start = benchMs();
+    M_TEST_ASSERT(C_BENCH_RECORD == SPIFFS_write(&gSpiffsFs, file, record, C_BENCH_RECORD));
+    benchLatency[i] = benchMs() - start;
+  } /* for */
+  SPIFFS_close(&gSpiffsFs, file);
+} /* benchRing() */
+
+/*
+ * @brief               appends the records to files rotated and deleted the
+ *                      oldest first
+ */
+static void benchRotate(void)
+{
+  char        name[SPIFFS_OBJ_NAME_LEN];
+  spiffs_file file;
+  uint32_t    segment = 0;
+  uint32_t    size = 0;
+  uint32_t    i;
+  uint8_t     record[C_BENCH_RECORD];
+  double      start;
+
+  snprintf(name, sizeof(name), "seg%08x", segment);
+  file = SPIFFS_open(&gSpiffsFs, name, SPIFFS_CREAT | SPIFFS_APPEND | SPIFFS_WRONLY, 0);
+  for (i = 0; i < C_BENCH_RECORDS; i++)
+  {
+    benchRecord(record, i);
+    start = benchMs();
+    if (size >= (C_BENCH_CAPACITY / C_BENCH_FILES))
+    {
+      SPIFFS_close(&gSpiffsFs, file);
+      segment++;
+      if (segment >= C_BENCH_FILES)
+      {
+        snprintf(name, sizeof(name), "seg%08x", segment - C_BENCH_FILES);
+        M_TEST_ASSERT(SPIFFS_OK == SPIFFS_remove(&gSpiffsFs, name));
+      } /* if */
+      snprintf(name, sizeof(name), "seg%08x", segment);
+      file = SPIFFS_open(&gSpiffsFs, name, SPIFFS_CREAT | SPIFFS_APPEND | SPIFFS_WRONLY, 0);
+      size = 0;
+    } /* if */
+    M_TEST_ASSERT(file >= 0);
+    M_TEST_ASSERT(C_BENCH_RECORD == SPIFFS_write(&gSpiffsFs, file, record, C_BENCH_RECORD));
+    size += C_BENCH_RECORD;
+    benchLatency[i] = benchMs() - start;
+  } /* for */
+  SPIFFS_close(&gSpiffsFs, file);
+} /* benchRotate() */
+
+static int benchCompare
+(
+  const void* pxA,
+  const void* pxB
+)
+{
+  double a = *(const double*) pxA;
+  double b = *(const double*) pxB;
+
+  return (a > b) - (a < b);
+} /* benchCompare() */
+
+/*
+ * @brief               runs the benchmark from the memory of benchSnapshot
+ */
+static void benchRun
+(
+  int xRing
+)
+{
+  double   ms;
+  double   mean;
+  double   deviation = 0;
+  uint32_t i;
+
+  memcpy(flashSimData(), benchSnapshot, C_FLASH_SIM_SIZE);
+  benchMount();
+  benchMs();
+  memset(&benchStats, 0, sizeof(benchStats));
+
+  if (xRing)
+  {
+    benchRing();
+  }
+  else
+  {
+    benchRotate();
+  } /* if */
+
+  ms = benchMs();
+  mean = ms / C_BENCH_RECORDS;
+  for (i = 0; i < C_BENCH_RECORDS; i++)
+  {
+    deviation += (benchLatency[i] - mean) * (benchLatency[i] - mean);
+  } /* for */
+  deviation = sqrt(deviation / C_BENCH_RECORDS);
+  qsort(benchLatency, C_BENCH_RECORDS, sizeof(benchLatency[0]), benchCompare);
+  printf("%-18s %5.0f appends/s, %5.2f ms mean %5.2f median %5.2f p99 %6.1f max, %5.1f ms deviation,"
+         " %5u KB programmed, %3u erases\n",
+         xRing ? "ring" : "rotate and delete", C_BENCH_RECORDS / (ms / 1000.0), mean,
+         benchLatency[C_BENCH_RECORDS / 2], benchLatency[(C_BENCH_RECORDS * 99) / 100],
+         benchLatency[C_BENCH_RECORDS - 1], deviation, benchStats.programBytes / 1024, benchStats.erases);
+
+  if (xRing)
+  {
+    M_TEST_ASSERT((C_BENCH_RECORDS * C_BENCH_RECORD) == benchCheckRing());
+    SPIFFS_unmount(&gSpiffsFs);
+    benchMount();
+    M_TEST_ASSERT((C_BENCH_RECORDS * C_BENCH_RECORD) == benchCheckRing());
+  } /* if */
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_check(&gSpiffsFs));
+} /* benchRun() */
+
+/*
+ * @brief               appends the record of a number to the ring
+ * @return              the result of SPIFFS_write
+ */
+static s32_t benchAppend
+(
+  uint32_t xNumber
+)
+{
+  spiffs_file file = SPIFFS_open(&gSpiffsFs, C_BENCH_RING, SPIFFS_WRONLY, 0);
+  uint8_t     record[C_BENCH_RECORD];
+  s32_t       result;
+
+  if (file < 0)
+  {
+    return file;
+  } /* if */
+  benchRecord(record, xNumber);
+  result = SPIFFS_write(&gSpiffsFs, file, record, C_BENCH_RECORD);
+  SPIFFS_close(&gSpiffsFs, file);
+  return result;
+} /* benchAppend() */
+
+/*
+ * @brief               cuts the power at each operation of appends to a full ring
+ */
+static void benchCuts(void)
+{
+  FLASH_SIM_Stats stats;
+  uint32_t        records = (2 * C_BENCH_CAPACITY) / C_BENCH_RECORD;
+  uint32_t        cutAppends = 0;
+  uint32_t        erased = 0;
+  uint32_t        head;
+  uint32_t        size;
+  uint32_t        i;
+  long            operations;
+  long            cut;
+  long            cuts = 0;
+  int             counts[2] = { 0, 0 };
+
+  memcpy(flashSimData(), benchSnapshot, C_FLASH_SIM_SIZE);
+  benchMount();
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_ring_create(&gSpiffsFs, C_BENCH_RING, C_BENCH_CAPACITY));
+  for (i = 0; i < records; i++)
+  {
+    M_TEST_ASSERT(C_BENCH_RECORD == benchAppend(i));
+  } /* for */
+
+  /* The first appends, and the first one after them to erase a block. */
+  for (; (cutAppends < C_BENCH_CUT_APPENDS) || (0 == erased); i++)
+  {
+    M_TEST_ASSERT(i < (records * 4));
+    head = i * C_BENCH_RECORD;
+    SPIFFS_unmount(&gSpiffsFs);
+    memcpy(benchCutSnapshot, flashSimData(), C_FLASH_SIM_SIZE);
+
+    /* Reference run. */
+    benchMount();
+    flashSimCut(-1);
+    flashSimGetStats(&stats);
+    M_TEST_ASSERT(C_BENCH_RECORD == benchAppend(i));
+    operations = flashSimOps();
+    flashSimGetStats(&stats);
+    if ((cutAppends >= C_BENCH_CUT_APPENDS) && (0 == stats.erases))
+    {
+      continue;
+    } /* if */
+    SPIFFS_unmount(&gSpiffsFs);
+    cutAppends++;
+    erased += stats.erases;
+
+    for (cut = 0; cut <= operations; cut++)
+    {
+      memcpy(flashSimData(), benchCutSnapshot, C_FLASH_SIM_SIZE);
+      benchMount();
+      flashSimCut(cut);
+      (void) benchAppend(i);
+      SPIFFS_unmount(&gSpiffsFs);
+
+      /* Power back: the old or the new head, the tail of the stream. Until
+         SPIFFS_check, both copies of the header may be found. */
+      flashSimCut(-1);
+      benchMount();
+      size = benchCheckRing();
+      M_TEST_ASSERT((head == size) || ((head + C_BENCH_RECORD) == size));
+      M_TEST_ASSERT(SPIFFS_OK == SPIFFS_check(&gSpiffsFs));
+      size = benchCheckRing();
+      M_TEST_ASSERT((head == size) || ((head + C_BENCH_RECORD) == size));
+      counts[(head == size) ? 0 : 1]++;
+
+      /* The stream goes on from there. */
+      M_TEST_ASSERT(C_BENCH_RECORD == benchAppend(size / C_BENCH_RECORD));
+      M_TEST_ASSERT((size + C_BENCH_RECORD) == benchCheckRing());
+      SPIFFS_unmount(&gSpiffsFs);
+      cuts++;
+    } /* for */
+
+    memcpy(flashSimData(), benchCutSnapshot, C_FLASH_SIM_SIZE);
+    benchMount();
+    M_TEST_ASSERT(C_BENCH_RECORD == benchAppend(i));
+  } /* for */
+  SPIFFS_unmount(&gSpiffsFs);
+
+  printf("%u appends to a full ring, %ld cut points: %d old head, %d new head\n", cutAppends, cuts,
+         counts[0], counts[1]);
+} /* benchCuts() */
+
+int main(void)
+{
+  uint8_t     data[C_BENCH_STATIC_SIZE];
+  char        name[SPIFFS_OBJ_NAME_LEN];
+  spiffs_file file;
+  uint32_t    i;
+  int         status;
+
+  flashSimInit(&benchConfig);
+  SPIFFS_mount(&gSpiffsFs, &benchConfig, benchWork, benchFds, sizeof(benchFds), 0, 0, 0);
+  SPIFFS_unmount(&gSpiffsFs);
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_format(&gSpiffsFs));
+  benchMount();
+  memset(data, 0x5A, sizeof(data));
+  for (i = 0; i < C_BENCH_STATIC_FILES; i++)
+  {
+    snprintf(name, sizeof(name), "static%u", i);
+    file = SPIFFS_open(&gSpiffsFs, name, SPIFFS_CREAT | SPIFFS_RDWR, 0);
+    M_TEST_ASSERT(file >= 0);
+    M_TEST_ASSERT(sizeof(data) == SPIFFS_write(&gSpiffsFs, file, data, sizeof(data)));
+    SPIFFS_close(&gSpiffsFs, file);
+  } /* for */
+  SPIFFS_unmount(&gSpiffsFs);
+  memcpy(benchSnapshot, flashSimData(), C_FLASH_SIM_SIZE);
+
+  printf("%u appends of %u bytes, %u bytes kept\n", C_BENCH_RECORDS, C_BENCH_RECORD, C_BENCH_CAPACITY);
+  for (i = 0; i < 2; i++)
+  {
+    fflush(stdout);
+    if (0 == fork())
+    {
+      benchRun(0 == i);
+      fflush(stdout);
+      _exit(0);
+    } /* if */
+    M_TEST_ASSERT(wait(&status) > 0);
+    M_TEST_ASSERT(WIFEXITED(status) && (0 == WEXITSTATUS(status)));
+  } /* for */
+
+  benchCuts();
+
+  printf("ALL OK\n");
+  return 0;
+} /* main() */
@@ -0,0 +1,191 @@
+#include <stdint.h>
+#include <stdio.h>
+
+#include "board.h"
+#include "rtstats.h"
+#include "test.h"
+
+/*
+ * Cycle accounting of rtstats.c. The test sets the cycle counter, then calls
+ * the kernel and interrupt hooks as the kernel would, and checks the counters
+ * of each task, of each interrupt and of the system. Some sequences run across
+ * the wrap of the 32-bit counter.
+ */
+
+uint32_t testPrimask = 0;
+
+static uint32_t rtstatsCyclesNow = 0; //!< Value of the cycle counter.
+
+uint32_t boardGetCycles
+(
+  void
+)
+{
+  return rtstatsCyclesNow;
+} /* boardGetCycles() */
+
+/*
+ * @brief               gets the counters of a task, which must be known
+ */
+static RTSTATS_Task rtstatsCyclesTask
+(
+  uint32_t xSlot
+)
+{
+  RTSTATS_Task task;
+
+  M_TEST_ASSERT(1 == rtstatsGetTask(xSlot, &task));
+  return task;
+} /* rtstatsCyclesTask() */
+
+/*
+ * @brief               switches from the running task to another
+ */
+static void rtstatsCyclesSwitch
+(
+  uint32_t xAt,
+  void*    pxTask,
+  uint32_t xNumber
+)
+{
+  rtstatsCyclesNow = xAt;
+  rtstatsTaskOut();
+  rtstatsTaskIn(pxTask, xNumber);
+} /* rtstatsCyclesSwitch() */
+
+/*
+ * @brief               runs an interrupt from xFrom to xTo
+ */
+static void rtstatsCyclesIrq
+(
+  RTSTATS_IrqId xIrq,
+  uint32_t      xFrom,
+  uint32_t      xTo
+)
+{
+  uint32_t start;
+
+  rtstatsCyclesNow = xFrom;
+  start = rtstatsIrqEnter();
+  rtstatsCyclesNow = xTo;
+  rtstatsIrqExit(xIrq, start);
+} /* rtstatsCyclesIrq() */
+
+int main(void)
+{
+  int           a, b, c, d;
+  uint64_t      before;
+  uint32_t      outer;
+  uint32_t      inner;
+  RTSTATS_Irq   irq;
+  RTSTATS_Total total;
+  RTSTATS_Task  task;
+
+  /* The 64-bit extension steps over the wrap of the counter. */
+  rtstatsCyclesNow = 0xFFFFFF00u;
+  before = rtstatsNow();
+  rtstatsCyclesNow = 0x00000100u;
+  M_TEST_ASSERT(0x200 == (rtstatsNow() - before));
+
+  /* Per-task time, the interrupts excluded. */
+  rtstatsCyclesNow = 1000;
+  rtstatsTick();
+  rtstatsReset();
+  rtstatsTaskOut();
+  rtstatsTaskIn(&a, 1);
+  rtstatsCyclesIrq(RTSTATS_IRQ_EXTI, 1500, 1600);
+  rtstatsCyclesSwitch(2000, &b, 2);
+  task = rtstatsCyclesTask(1);
+  M_TEST_ASSERT((900 == task.cycles) && (1 == task.switches) && (&a == task.task));
+
+  /* Ready latency: the first time the task gets ready counts. */
+  rtstatsCyclesNow = 2100;
+  rtstatsTaskReady(3);
+  rtstatsCyclesNow = 2200;
+  rtstatsTaskReady(3);
+  rtstatsCyclesSwitch(2500, &c, 3);
+  M_TEST_ASSERT(500 == rtstatsCyclesTask(2).cycles);
+  M_TEST_ASSERT(400 == rtstatsCyclesTask(3).maxReadyCycles);
+
+  /* The same task switched out and in is not a switch. */
+  rtstatsCyclesSwitch(2600, &c, 3);
+  task = rtstatsCyclesTask(3);
+  M_TEST_ASSERT((1 == task.switches) && (100 == task.cycles) && (400 == task.maxReadyCycles));
+
+  /* Nested interrupts: each counts its own time, the total the outermost only. */
+  rtstatsCyclesNow = 3000;
+  outer = rtstatsIrqEnter();
+  rtstatsCyclesNow = 3100;
+  inner = rtstatsIrqEnter();
+  rtstatsCyclesNow = 3200;
+  rtstatsIrqExit(RTSTATS_IRQ_QUADSPI, inner);
+  rtstatsCyclesNow = 3400;
+  rtstatsIrqExit(RTSTATS_IRQ_SPI3, outer);
+  rtstatsGetIrq(RTSTATS_IRQ_QUADSPI, &irq);
+  M_TEST_ASSERT((1 == irq.count) && (100 == irq.cycles) && (100 == irq.maxCycles));
+  rtstatsGetIrq(RTSTATS_IRQ_SPI3, &irq);
+  M_TEST_ASSERT((1 == irq.count) && (400 == irq.cycles));
+
+  /* The slice of the running task counts on read: 2600 to 3600 less 400. */
+  rtstatsCyclesNow = 3600;
+  M_TEST_ASSERT((100 + 600) == rtstatsCyclesTask(3).cycles);
+  rtstatsGetTotal(&total);
+  M_TEST_ASSERT((2600 == total.window) && (500 == total.irqCycles));
+  M_TEST_ASSERT((3 == total.switches) && (400 == total.maxReadyCycles));
+
+  /* Trace numbers beyond the table share slot 0. */
+  rtstatsCyclesSwitch(4000, &d, C_RTSTATS_TASKS + 4);
+  rtstatsCyclesNow = 4300;
+  rtstatsTaskOut();
+  task = rtstatsCyclesTask(0);
+  M_TEST_ASSERT((300 == task.cycles) && (&d == task.task));
+  M_TEST_ASSERT(0 == rtstatsGetTask(C_RTSTATS_TASKS, &task));
+  M_TEST_ASSERT(0 == rtstatsGetTask(5, &task));
+
+  /* Across the wrap: a ready latency, an interrupt, and the slice around it. */
+  rtstatsCyclesNow = 0xFFFFFF00u;
+  rtstatsTick();
+  rtstatsReset();
+  rtstatsTaskReady(1);
+  rtstatsCyclesSwitch(0xFFFFFF20u, &a, 1);
+  M_TEST_ASSERT(0x20 == rtstatsCyclesTask(1).maxReadyCycles);
+  rtstatsCyclesIrq(RTSTATS_IRQ_USART1, 0xFFFFFF80u, 0x00000080u);
+  rtstatsGetIrq(RTSTATS_IRQ_USART1, &irq);
+  M_TEST_ASSERT((1 == irq.count) && (0x100 == irq.cycles) && (0x100 == irq.maxCycles));
+  rtstatsCyclesSwitch(0x00000120u, &b, 2);
+  M_TEST_ASSERT((0x200 - 0x100) == rtstatsCyclesTask(1).cycles);
+  rtstatsGetTotal(&total);
+  M_TEST_ASSERT((0x220 == total.window) && (0x100 == total.irqCycles));
+
+  /* A reset keeps the tasks and clears their counters. */
+  rtstatsCyclesNow = 0x10;
+  rtstatsReset();
+  task = rtstatsCyclesTask(1);
+  M_TEST_ASSERT((0 == task.cycles) && (0 == task.switches));
+  rtstatsGetTotal(&total);
+  M_TEST_ASSERT((0 == total.window) && (0 == total.switches));
+
+  /* Tickless sleep: the counter stops, the ticks slept are added back. */
+  rtstatsCyclesNow = 100;
+  rtstatsSleepEnter();
+  rtstatsCyclesNow = 110;
+  rtstatsSleepExit(5000);
+  rtstatsCyclesNow = 200;
+  M_TEST_ASSERT(((200 - 0x10) + 4990) == rtstatsCyclesTask(2).cycles);
+  rtstatsGetTotal(&total);
+  M_TEST_ASSERT((5000 == total.sleepCycles) && (((200 - 0x10) + 4990) == total.window));
+
+  /* Under a debugger the counter runs in sleep: nothing is added. */
+  rtstatsSleepEnter();
+  rtstatsCyclesNow = 6000;
+  rtstatsSleepExit(5000);
+  rtstatsGetTotal(&total);
+  M_TEST_ASSERT((10000 == total.sleepCycles) && (((6000 - 0x10) + 4990) == total.window));
+  rtstatsSleepExit(5000);
+  rtstatsGetTotal(&total);
+  M_TEST_ASSERT(10000 == total.sleepCycles);
+
+  M_TEST_ASSERT(0 == testPrimask);
+  printf("ALL OK\n");
+  return 0;
+} /* main() */
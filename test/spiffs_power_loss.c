@@ -0,0 +1,356 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "spiffs.h"
+#include "flash_sim.h"
+#include "test.h"
+
+/*
+ * Power loss during a SPIFFS transaction (SPIFFS_txn_begin). A reference run
+ * counts the programs and erases of the transaction, then the power is cut at
+ * each of them in turn, the last one torn. After the power comes back, every
+ * file of the transaction must hold all the old or all the new versions,
+ * SPIFFS_check must not change them, no page may leak, and a new transaction
+ * must succeed.
+ * The implicit transaction, one file opened with SPIFFS_O_SHADOW outside
+ * SPIFFS_txn_begin, is cut the same way.
+ */
+
+#define C_TEST_FILES 3 //!< Files of the transaction.
+
+#define C_TEST_BALLAST_FILES 250 //!< Other files, so that the transaction runs the gc.
+
+#define C_TEST_BALLAST_SIZE 3000 //!< Size of the other files.
+
+#define C_TEST_MAX_SIZE 40000 //!< Largest file of the transaction.
+
+static const char* testNames[C_TEST_FILES] = { "wifi.cfg", "net.cfg", "app.cfg" };
+
+static const uint32_t testSizes[2][C_TEST_FILES] =
+{
+  { 40, 900, 30000 },
+  { 60, 1200, 25000 }
+}; //!< Sizes of the old then new versions.
+
+static spiffs testFs;
+
+static spiffs_config testConfig;
+
+static uint8_t testWork[2 * 256]; //!< Two logical pages.
+
+static uint8_t testFds[44 * 4]; //!< Four file descriptors.
+
+static uint8_t testSnapshot[C_FLASH_SIM_SIZE]; //!< Memory before the transaction.
+
+static uint8_t testBuffer[C_TEST_MAX_SIZE];
+
+static uint8_t testExpected[C_TEST_MAX_SIZE];
+
+static int testMount(void)
+{
+  return SPIFFS_mount(&testFs, &testConfig, testWork, testFds, sizeof(testFds), 0, 0, 0);
+} /* testMount() */
+
+/*
+ * @brief               fills the content of a version of a file
+ */
+static void testContent
+(
+  uint8_t* pxData,
+  int      xFile,
+  int      xVersion
+)
+{
+  uint32_t i;
+
+  for (i = 0; i < testSizes[xVersion][xFile]; i++)
+  {
+    pxData[i] = (uint8_t) ((i * 7) + (xFile * 31) + (xVersion * 101));
+  } /* for */
+} /* testContent() */
+
+/*
+ * @brief               reads a file
+ * @return              its version, 0 or 1, or -1 when missing or broken
+ */
+static int testVersion
+(
+  int xFile
+)
+{
+  spiffs_stat stat;
+  spiffs_file file;
+  s32_t       length;
+  int         version;
+
+  if (SPIFFS_OK != SPIFFS_stat(&testFs, testNames[xFile], &stat))
+  {
+    return -1;
+  } /* if */
+  file = SPIFFS_open(&testFs, testNames[xFile], SPIFFS_RDONLY, 0);
+  if (file < 0)
+  {
+    return -1;
+  } /* if */
+  length = SPIFFS_read(&testFs, file, testBuffer, sizeof(testBuffer));
+  SPIFFS_close(&testFs, file);
+
+  for (version = 0; version < 2; version++)
+  {
+    testContent(testExpected, xFile, version);
+    if (((uint32_t) length == testSizes[version][xFile]) && (stat.size == (uint32_t) length) &&
+        (0 == memcmp(testBuffer, testExpected, length)))
+    {
+      return version;
+    } /* if */
+  } /* for */
+  return -1;
+} /* testVersion() */
+
+static int testCount(void)
+{
+  spiffs_DIR           dir;
+  struct spiffs_dirent entry;
+  int                  count = 0;
+
+  SPIFFS_opendir(&testFs, "/", &dir);
+  while (NULL != SPIFFS_readdir(&dir, &entry))
+  {
+    count++;
+  } /* while */
+  SPIFFS_closedir(&dir);
+  return count;
+} /* testCount() */
+
+/*
+ * @brief               writes the new version of one file in a shadow
+ * @return              SPIFFS_OK or an error
+ */
+static s32_t testShadow
+(
+  int xFile
+)
+{
+  spiffs_file file;
+
+  testContent(testBuffer, xFile, 1);
+  file = SPIFFS_open(&testFs, testNames[xFile], SPIFFS_O_SHADOW | SPIFFS_RDWR, 0);
+  if (file < 0)
+  {
+    return file;
+  } /* if */
+  if (SPIFFS_write(&testFs, file, testBuffer, testSizes[1][xFile]) < 0)
+  {
+    return -1;
+  } /* if */
+  return SPIFFS_close(&testFs, file);
+} /* testShadow() */
+
+/*
+ * @brief               replaces the files, all of them or the first one alone
+ * @return              SPIFFS_OK or an error
+ */
+static s32_t testTransaction
+(
+  int xImplicit
+)
+{
+  s32_t result;
+  int   i;
+
+  if (xImplicit)
+  {
+    return testShadow(0);
+  } /* if */
+
+  result = SPIFFS_txn_begin(&testFs);
+  for (i = 0; (i < C_TEST_FILES) && (SPIFFS_OK == result); i++)
+  {
+    result = testShadow(i);
+  } /* for */
+  return (SPIFFS_OK == result) ? SPIFFS_txn_commit(&testFs) : result;
+} /* testTransaction() */
+
+/*
+ * @brief               checks the files after the power came back
+ * @param[in] xImplicit 1 when only the first file is in the transaction
+ * @return              version of the transaction, 0 or 1, or -1 when mixed
+ */
+static int testConsistent
+(
+  int xImplicit
+)
+{
+  int version = testVersion(0);
+  int i;
+
+  for (i = 1; i < C_TEST_FILES; i++)
+  {
+    if (testVersion(i) != (xImplicit ? 0 : version))
+    {
+      return -1;
+    } /* if */
+  } /* for */
+  return version;
+} /* testConsistent() */
+
+/*
+ * @brief               cuts the power at each operation of a transaction
+ * @return              none
+ */
+static void testCuts
+(
+  int      xImplicit,
+  int      xFiles,
+  uint32_t xUsedOld
+)
+{
+  uint32_t total;
+  uint32_t used;
+  uint32_t usedNew;
+  long     operations;
+  long     cut;
+  int      version;
+  int      counts[2] = { 0, 0 };
+
+  /* Reference run. */
+  memcpy(flashSimData(), testSnapshot, C_FLASH_SIM_SIZE);
+  M_TEST_ASSERT(SPIFFS_OK == testMount());
+  flashSimCut(-1);
+  M_TEST_ASSERT(SPIFFS_OK == testTransaction(xImplicit));
+  operations = flashSimOps();
+  M_TEST_ASSERT(1 == testVersion(0));
+  M_TEST_ASSERT((xImplicit ? 0 : 1) == testVersion(C_TEST_FILES - 1));
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_check(&testFs));
+  SPIFFS_info(&testFs, &total, &usedNew);
+  SPIFFS_unmount(&testFs);
+
+  for (cut = 0; cut <= operations; cut++)
+  {
+    memcpy(flashSimData(), testSnapshot, C_FLASH_SIM_SIZE);
+    M_TEST_ASSERT(SPIFFS_OK == testMount());
+    flashSimCut(cut);
+    (void) testTransaction(xImplicit);
+    SPIFFS_unmount(&testFs);
+
+    /* Power back. */
+    flashSimCut(-1);
+    M_TEST_ASSERT(SPIFFS_OK == testMount());
+    version = testConsistent(xImplicit);
+    if (version < 0)
+    {
+      printf("cut %ld: versions %d %d %d\n", cut, testVersion(0), testVersion(1), testVersion(2));
+    } /* if */
+    M_TEST_ASSERT(version >= 0);
+    M_TEST_ASSERT(xFiles == testCount());
+
+    /* The check cleans the torn pages up, nothing visible changes. */
+    M_TEST_ASSERT(SPIFFS_OK == SPIFFS_check(&testFs));
+    M_TEST_ASSERT(version == testConsistent(xImplicit));
+    M_TEST_ASSERT(xFiles == testCount());
+    SPIFFS_unmount(&testFs);
+    M_TEST_ASSERT(SPIFFS_OK == testMount());
+
+    /* Nothing leaked: the pages of one version of each file. */
+    SPIFFS_info(&testFs, &total, &used);
+    M_TEST_ASSERT(used == (version ? usedNew : xUsedOld));
+    counts[version]++;
+
+    M_TEST_ASSERT(SPIFFS_OK == testTransaction(xImplicit));
+    M_TEST_ASSERT(1 == testConsistent(xImplicit));
+    SPIFFS_unmount(&testFs);
+  } /* for */
+
+  printf("%s transaction: %ld operations, %ld cut points: %d old, %d new\n",
+         xImplicit ? "implicit" : "explicit", operations, operations + 1, counts[0], counts[1]);
+} /* testCuts() */
+
+int main(void)
+{
+  uint8_t     ballast[C_TEST_BALLAST_SIZE];
+  char        name[16];
+  spiffs_file file;
+  uint32_t    total;
+  uint32_t    used;
+  uint32_t    usedOld;
+  int         files;
+  int         i;
+
+  flashSimInit(&testConfig);
+  SPIFFS_format(&testFs);
+  M_TEST_ASSERT(SPIFFS_OK == testMount());
+
+  memset(ballast, 0x33, sizeof(ballast));
+  for (i = 0; i < C_TEST_BALLAST_FILES; i++)
+  {
+    snprintf(name, sizeof(name), "ballast%d", i);
+    file = SPIFFS_open(&testFs, name, SPIFFS_CREAT | SPIFFS_RDWR, 0);
+    M_TEST_ASSERT(file > 0);
+    M_TEST_ASSERT(sizeof(ballast) == SPIFFS_write(&testFs, file, ballast, sizeof(ballast)));
+    SPIFFS_close(&testFs, file);
+  } /* for */
+  for (i = 0; i < C_TEST_FILES; i++)
+  {
+    testContent(testBuffer, i, 0);
+    file = SPIFFS_open(&testFs, testNames[i], SPIFFS_CREAT | SPIFFS_TRUNC | SPIFFS_RDWR, 0);
+    M_TEST_ASSERT(file > 0);
+    M_TEST_ASSERT((s32_t) testSizes[0][i] == SPIFFS_write(&testFs, file, testBuffer, testSizes[0][i]));
+    SPIFFS_close(&testFs, file);
+  } /* for */
+  files = testCount();
+  SPIFFS_info(&testFs, &total, &usedOld);
+  SPIFFS_unmount(&testFs);
+  memcpy(testSnapshot, flashSimData(), C_FLASH_SIM_SIZE);
+
+  testCuts(0, files, usedOld);
+  testCuts(1, files, usedOld);
+
+  /* Abort: the shadows go, the handles close. */
+  memcpy(flashSimData(), testSnapshot, C_FLASH_SIM_SIZE);
+  M_TEST_ASSERT(SPIFFS_OK == testMount());
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_txn_begin(&testFs));
+  M_TEST_ASSERT(SPIFFS_ERR_TXN_STATE == SPIFFS_txn_begin(&testFs));
+  file = SPIFFS_open(&testFs, testNames[1], SPIFFS_O_SHADOW | SPIFFS_RDWR, 0);
+  M_TEST_ASSERT(file > 0);
+  M_TEST_ASSERT(100 == SPIFFS_write(&testFs, file, ballast, 100));
+  M_TEST_ASSERT(0 == testVersion(1));
+  M_TEST_ASSERT(files == testCount());
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_txn_abort(&testFs));
+  M_TEST_ASSERT(SPIFFS_close(&testFs, file) < 0);
+  SPIFFS_info(&testFs, &total, &used);
+  M_TEST_ASSERT(usedOld == used);
+  M_TEST_ASSERT(SPIFFS_ERR_TXN_STATE == SPIFFS_txn_commit(&testFs));
+
+  /* The same path twice: the last shadow wins. */
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_txn_begin(&testFs));
+  for (i = 0; i < 2; i++)
+  {
+    file = SPIFFS_open(&testFs, testNames[2], SPIFFS_O_SHADOW | SPIFFS_RDWR, 0);
+    M_TEST_ASSERT(file > 0);
+    ballast[0] = (uint8_t) i;
+    M_TEST_ASSERT(10 == SPIFFS_write(&testFs, file, ballast, 10));
+    SPIFFS_close(&testFs, file);
+  } /* for */
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_txn_commit(&testFs));
+  file = SPIFFS_open(&testFs, testNames[2], SPIFFS_RDONLY, 0);
+  M_TEST_ASSERT(10 == SPIFFS_read(&testFs, file, testBuffer, 20));
+  M_TEST_ASSERT(1 == testBuffer[0]);
+  SPIFFS_close(&testFs, file);
+  M_TEST_ASSERT(files == testCount());
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_check(&testFs));
+
+  /* Full. */
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_txn_begin(&testFs));
+  for (i = 0; i < SPIFFS_TXN_MAX_FILES; i++)
+  {
+    file = SPIFFS_open(&testFs, testNames[0], SPIFFS_O_SHADOW | SPIFFS_RDWR, 0);
+    M_TEST_ASSERT(file > 0);
+    SPIFFS_close(&testFs, file);
+  } /* for */
+  M_TEST_ASSERT(SPIFFS_ERR_TXN_FULL == SPIFFS_open(&testFs, testNames[0], SPIFFS_O_SHADOW | SPIFFS_RDWR, 0));
+  M_TEST_ASSERT(SPIFFS_OK == SPIFFS_txn_abort(&testFs));
+
+  printf("ALL OK\n");
+  return 0;
+} /* main() */
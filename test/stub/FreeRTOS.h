@@ -0,0 +1,52 @@
+#ifndef TEST_STUB_FREERTOS_H_
+#define TEST_STUB_FREERTOS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Host stub of the kernel types and macros the device sources use, with a 1 kHz
+ * tick like inc/FreeRTOSConfig.h. The functions are the mocks of the tests.
+ */
+
+typedef long          BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t      TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE  ((BaseType_t)1)
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+
+#define configTICK_RATE_HZ               1000
+#define configSUPPORT_STATIC_ALLOCATION  1
+#define portMAX_DELAY                    ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS               ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(xTimeInMs) \
+  ((TickType_t)(((TickType_t)(xTimeInMs) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000))
+
+void vPortYieldFromISR(BaseType_t xSwitchRequired);
+#define portYIELD_FROM_ISR(x) vPortYieldFromISR(x)
+
+/* heap_4.c at 64 KB, the configTOTAL_HEAP_SIZE of the build without static objects. */
+#ifndef configTOTAL_HEAP_SIZE
+#define configTOTAL_HEAP_SIZE            ((size_t)(64 * 1024))
+#endif
+#define configSUPPORT_DYNAMIC_ALLOCATION 1
+#define configAPPLICATION_ALLOCATED_HEAP 0
+#define configUSE_MALLOC_FAILED_HOOK     0
+#define portBYTE_ALIGNMENT               8
+#define portBYTE_ALIGNMENT_MASK          0x0007
+#define configASSERT(x)                  do { if (!(x)) __builtin_trap(); } while (0)
+#define mtCOVERAGE_TEST_MARKER()
+#define traceMALLOC(pvAddress, uiSize)
+#define traceFREE(pvAddress, uiSize)
+#define PRIVILEGED_FUNCTION
+#define PRIVILEGED_DATA
+
+void*  pvPortMalloc(size_t xWantedSize);
+void   vPortFree(void* pv);
+size_t xPortGetFreeHeapSize(void);
+size_t xPortGetMinimumEverFreeHeapSize(void);
+
+#endif /* TEST_STUB_FREERTOS_H_ */
@@ -0,0 +1,41 @@
+#ifndef TEST_STUB_CORE_CM4_H_
+#define TEST_STUB_CORE_CM4_H_
+
+#include <stdint.h>
+
+/* Host stub of the CMSIS core: the tests run one thread, the mask is a flag and
+   the code runs in thread mode. */
+
+extern uint32_t testPrimask; //!< 1 while the interrupts are masked.
+
+static inline uint32_t __get_PRIMASK(void)
+{
+  return testPrimask;
+}
+
+static inline void __set_PRIMASK(uint32_t xMask)
+{
+  testPrimask = xMask;
+}
+
+static inline void __disable_irq(void)
+{
+  testPrimask = 1;
+}
+
+static inline void __enable_irq(void)
+{
+  testPrimask = 0;
+}
+
+static inline uint32_t __get_IPSR(void)
+{
+  return 0;
+}
+
+static inline void __DMB(void)
+{
+  __sync_synchronize();
+}
+
+#endif /* TEST_STUB_CORE_CM4_H_ */
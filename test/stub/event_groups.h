@@ -0,0 +1,27 @@
+#ifndef TEST_STUB_EVENT_GROUPS_H_
+#define TEST_STUB_EVENT_GROUPS_H_
+
+#include "FreeRTOS.h"
+
+/* Host stub of the event groups. */
+
+typedef uint32_t EventBits_t;
+
+typedef struct
+{
+  EventBits_t bits; //!< Bits set.
+} StaticEventGroup_t;
+
+typedef StaticEventGroup_t* EventGroupHandle_t;
+
+EventGroupHandle_t xEventGroupCreate(void);
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t* pxEventGroupBuffer);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet);
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet,
+                                     BaseType_t* pxHigherPriorityTaskWoken);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToClear);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor,
+                                const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits,
+                                TickType_t xTicksToWait);
+
+#endif /* TEST_STUB_EVENT_GROUPS_H_ */
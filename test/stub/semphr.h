@@ -0,0 +1,23 @@
+#ifndef TEST_STUB_SEMPHR_H_
+#define TEST_STUB_SEMPHR_H_
+
+#include "FreeRTOS.h"
+
+/* Host stub of the binary semaphores and mutexes. */
+
+typedef struct
+{
+  int given; //!< 1 when a take returns at once.
+} StaticSemaphore_t;
+
+typedef StaticSemaphore_t* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* pxSemaphoreBuffer);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* pxMutexBuffer);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t* pxHigherPriorityTaskWoken);
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore);
+
+#endif /* TEST_STUB_SEMPHR_H_ */
@@ -0,0 +1,127 @@
+#ifndef TEST_STUB_STM32L4XX_HAL_H_
+#define TEST_STUB_STM32L4XX_HAL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "core_cm4.h"
+
+/*
+ * Host stub of the HAL pieces the device sources use. The functions are the
+ * mocks of the tests.
+ */
+
+typedef enum { HAL_OK = 0, HAL_ERROR } HAL_StatusTypeDef;
+typedef enum { GPIO_PIN_RESET = 0, GPIO_PIN_SET } GPIO_PinState;
+typedef enum { RESET = 0, SET } FlagStatus;
+typedef int IRQn_Type;
+
+typedef struct { uint32_t ODR; } GPIO_TypeDef;
+typedef struct { volatile uint32_t CR2; } SPI_TypeDef;
+
+extern GPIO_TypeDef* GPIOE;
+extern SPI_TypeDef*  SPI3;
+
+#define GPIO_PIN_0 0x0001
+#define GPIO_PIN_1 0x0002
+#define GPIO_PIN_8 0x0100
+
+typedef struct
+{
+  uint32_t Request, Direction, PeriphInc, MemInc, PeriphDataAlignment, MemDataAlignment, Mode, Priority;
+} DMA_InitTypeDef;
+
+typedef struct
+{
+  void*           Instance;
+  DMA_InitTypeDef Init;
+  uint32_t        CNDTR; //!< Words left to move.
+  void*           Parent;
+} DMA_HandleTypeDef;
+
+typedef struct
+{
+  uint32_t Mode, Direction, DataSize, CLKPolarity, CLKPhase, NSS, BaudRatePrescaler, FirstBit, TIMode,
+           CRCCalculation, CRCPolynomial;
+} SPI_InitTypeDef;
+
+typedef struct
+{
+  SPI_TypeDef*       Instance;
+  SPI_InitTypeDef    Init;
+  DMA_HandleTypeDef* hdmarx;
+  DMA_HandleTypeDef* hdmatx;
+} SPI_HandleTypeDef;
+
+#define SPI_CR2_RXDMAEN 0x0001
+#define SPI_CR2_TXDMAEN 0x0002
+
+#define DMA2_Channel1 ((void*)21)
+#define DMA2_Channel2 ((void*)22)
+
+#define SPI_MODE_MASTER            1
+#define SPI_DIRECTION_2LINES       0
+#define SPI_DATASIZE_16BIT         16
+#define SPI_POLARITY_LOW           0
+#define SPI_PHASE_1EDGE            0
+#define SPI_NSS_SOFT               0
+#define SPI_BAUDRATEPRESCALER_8    8
+#define SPI_FIRSTBIT_MSB           0
+#define SPI_TIMODE_DISABLE         0
+#define SPI_CRCCALCULATION_DISABLE 0
+#define SPI_FLAG_BSY               0x80
+
+#define DMA_REQUEST_3           3
+#define DMA_PERIPH_TO_MEMORY    0
+#define DMA_MEMORY_TO_PERIPH    1
+#define DMA_PINC_DISABLE        0
+#define DMA_MINC_ENABLE         1
+#define DMA_PDATAALIGN_HALFWORD 1
+#define DMA_MDATAALIGN_HALFWORD 1
+#define DMA_NORMAL              0
+#define DMA_PRIORITY_HIGH       2
+#define DMA_PRIORITY_MEDIUM     1
+
+#define EXTI1_IRQn         7
+#define SPI3_IRQn          51
+#define DMA2_Channel1_IRQn 56
+#define DMA2_Channel2_IRQn 57
+
+#define SET_BIT(REG, BIT)   ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT) ((REG) &= ~(BIT))
+
+#define __HAL_RCC_DMA2_CLK_ENABLE() do {} while (0)
+#define __HAL_LINKDMA(h, f, d)      do { (h)->f = &(d); (d).Parent = (h); } while (0)
+#define __HAL_DMA_GET_COUNTER(h)    ((h)->CNDTR)
+#define __HAL_SPI_GET_FLAG(h, f)    0
+#define __HAL_GPIO_EXTI_GET_IT(p)   RESET
+#define __HAL_GPIO_EXTI_CLEAR_IT(p) do {} while (0)
+
+extern uint32_t SystemCoreClock;
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin);
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef* hspi);
+HAL_StatusTypeDef HAL_SPI_DeInit(SPI_HandleTypeDef* hspi);
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef* hspi, uint8_t* pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Receive_IT(SPI_HandleTypeDef* hspi, uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Transmit_IT(SPI_HandleTypeDef* hspi, uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef* hspi, uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef* hspi, uint8_t* pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_DMAStop(SPI_HandleTypeDef* hspi);
+HAL_StatusTypeDef HAL_SPIEx_FlushRxFifo(SPI_HandleTypeDef* hspi);
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef* hdma);
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef* hdma);
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+void HAL_SPI_IRQHandler(SPI_HandleTypeDef* hspi);
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef* hdma);
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef* hspi);
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef* hspi);
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef* hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef* hspi);
+
+#endif /* TEST_STUB_STM32L4XX_HAL_H_ */
@@ -0,0 +1,43 @@
+#ifndef TEST_STUB_TASK_H_
+#define TEST_STUB_TASK_H_
+
+#include "FreeRTOS.h"
+
+/*
+ * Host stub of the scheduler. The tests that create tasks run each one as a
+ * thread: the functions are their mocks. Without tasks, the tests run one
+ * thread and there is nothing to suspend.
+ */
+
+#define tskIDLE_PRIORITY ((UBaseType_t)0)
+
+typedef struct TEST_Task* TaskHandle_t;
+typedef void (*TaskFunction_t)(void* pvParameters);
+typedef uint32_t StackType_t;
+
+typedef struct
+{
+  void* reserved[24];
+} StaticTask_t;
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char* pcName, uint16_t usStackDepth, void* pvParameters,
+                       UBaseType_t uxPriority, TaskHandle_t* pxCreatedTask);
+TaskHandle_t xTaskCreateStatic(TaskFunction_t pxTaskCode, const char* pcName, uint32_t ulStackDepth,
+                               void* pvParameters, UBaseType_t uxPriority, StackType_t* puxStackBuffer,
+                               StaticTask_t* pxTaskBuffer);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t* pxHigherPriorityTaskWoken);
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+
+static inline void vTaskSuspendAll(void)
+{
+}
+
+static inline BaseType_t xTaskResumeAll(void)
+{
+  return pdFALSE;
+}
+
+#endif /* TEST_STUB_TASK_H_ */
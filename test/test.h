@@ -0,0 +1,25 @@
+#ifndef TEST_TEST_H_
+#define TEST_TEST_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Host tests: each one is a program that prints what it measured, then "ALL OK",
+ * and exits with 0. The first failed check prints its line and exits with 1.
+ */
+
+/*
+ * @brief Stops the test when a condition is false.
+ */
+#define M_TEST_ASSERT(x) \
+  do \
+  { \
+    if (!(x)) \
+    { \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #x); \
+      exit(1); \
+    } \
+  } while (0)
+
+#endif /* TEST_TEST_H_ */
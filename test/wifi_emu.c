@@ -0,0 +1,298 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "es_wifi.h"
+#include "es_wifi_emu.h"
+#include "test.h"
+
+/*
+ * es_wifi.c driven through the module emulator instead of the SPI: every AT
+ * command the device sources use goes through the real driver and parser, and
+ * the sockets of the module reach peers on the loopback.
+ */
+
+#define C_WIFI_EMU_UDP_PORT    47001 //!< Port of the UDP echo peer.
+#define C_WIFI_EMU_TCP_PORT    47002 //!< Port of the TCP echo peer.
+#define C_WIFI_EMU_SERVER_PORT 47003 //!< Port of the TCP server of the module.
+#define C_WIFI_EMU_LOCAL_PORT  47004 //!< Local port of the UDP socket of the module.
+
+static ES_WIFIObject_t wifiEmuObj; //!< Driver under test.
+
+static uint16_t wifiEmuUdpFrom; //!< Source port of the datagram the UDP echo peer got.
+
+/*
+ * @brief               opens a loopback socket bound to a port
+ * @return              the socket
+ */
+static int wifiEmuBind
+(
+  int      xType,
+  uint16_t xPort
+)
+{
+  struct sockaddr_in addr;
+  int fd = socket(AF_INET, xType, 0);
+  int one = 1;
+
+  M_TEST_ASSERT(fd >= 0);
+  (void) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(xPort);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  M_TEST_ASSERT(0 == bind(fd, (struct sockaddr*) &addr, sizeof(addr)));
+  return fd;
+} /* wifiEmuBind() */
+
+/*
+ * @brief               peer answering each datagram with its copy
+ */
+static void* wifiEmuUdpEcho
+(
+  void* pxFd
+)
+{
+  int fd = *(int*) pxFd;
+  uint8_t buffer[ES_WIFI_PAYLOAD_SIZE];
+  struct sockaddr_in from;
+  socklen_t fromLength = sizeof(from);
+  ssize_t n = recvfrom(fd, buffer, sizeof(buffer), 0, (struct sockaddr*) &from, &fromLength);
+
+  if (n > 0)
+  {
+    wifiEmuUdpFrom = ntohs(from.sin_port);
+    (void) sendto(fd, buffer, n, 0, (struct sockaddr*) &from, fromLength);
+  } /* if */
+  return NULL;
+} /* wifiEmuUdpEcho() */
+
+/*
+ * @brief               peer sending back the stream of one connection
+ */
+static void* wifiEmuTcpEcho
+(
+  void* pxFd
+)
+{
+  int fd = accept(*(int*) pxFd, NULL, NULL);
+  uint8_t buffer[1024];
+  ssize_t n;
+
+  M_TEST_ASSERT(fd >= 0);
+  while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+  {
+    M_TEST_ASSERT(n == send(fd, buffer, n, 0));
+  } /* while */
+  close(fd);
+  return NULL;
+} /* wifiEmuTcpEcho() */
+
+/*
+ * @brief               client of the TCP server of the module
+ */
+static void* wifiEmuTcpClient
+(
+  void* pxUnused
+)
+{
+  struct sockaddr_in addr;
+  char buffer[16];
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+  (void) pxUnused;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(C_WIFI_EMU_SERVER_PORT);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  M_TEST_ASSERT(0 == connect(fd, (struct sockaddr*) &addr, sizeof(addr)));
+  M_TEST_ASSERT(5 == send(fd, "hello", 5, 0));
+  M_TEST_ASSERT(5 == recv(fd, buffer, 5, MSG_WAITALL));
+  M_TEST_ASSERT(0 == memcmp(buffer, "world", 5));
+  close(fd);
+  return NULL;
+} /* wifiEmuTcpClient() */
+
+/*
+ * @brief               joins the access point and reads the module settings
+ */
+static void wifiEmuJoin(void)
+{
+  static ES_WIFI_APs_t aps;
+  uint8_t mac[6];
+  uint8_t ip[4];
+  int32_t ping[3];
+
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_RegisterBusIO(&wifiEmuObj, EMU_WIFI_Init, EMU_WIFI_DeInit,
+                                                           EMU_WIFI_Delay, EMU_WIFI_SendData,
+                                                           EMU_WIFI_ReceiveData));
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_Init(&wifiEmuObj));
+  M_TEST_ASSERT(0 == strcmp((char*) wifiEmuObj.Product_Name, "Inventek eS-WiFi"));
+
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_ListAccessPoints(&wifiEmuObj, &aps));
+  M_TEST_ASSERT(3 == aps.nbr);
+
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_Connect(&wifiEmuObj, "lab", "secret", ES_WIFI_SEC_WPA2));
+  M_TEST_ASSERT(ES_WIFI_IsConnected(&wifiEmuObj));
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_GetNetworkSettings(&wifiEmuObj));
+  M_TEST_ASSERT(42 == wifiEmuObj.NetSettings.IP_Addr[3]);
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_GetMACAddress(&wifiEmuObj, mac));
+  M_TEST_ASSERT(0x01 == mac[5]);
+
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_DNS_LookUp(&wifiEmuObj, "localhost", ip));
+  M_TEST_ASSERT(127 == ip[0]);
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_Ping(&wifiEmuObj, ip, 3, 100, ping));
+  M_TEST_ASSERT((0 == ping[0]) && (0 == ping[2]));
+} /* wifiEmuJoin() */
+
+/*
+ * @brief               sends a datagram to the echo peer and receives its copy
+ */
+static void wifiEmuUdp(void)
+{
+  uint8_t ip[4] = { 10, 0, 0, 7 };
+  uint8_t from[4];
+  uint8_t buffer[ES_WIFI_PAYLOAD_SIZE];
+  uint8_t copy[ES_WIFI_PAYLOAD_SIZE];
+  uint16_t port;
+  uint16_t n;
+  pthread_t peer;
+  int fd = wifiEmuBind(SOCK_DGRAM, C_WIFI_EMU_UDP_PORT);
+  ES_WIFI_Conn_t conn;
+  int i;
+
+  M_TEST_ASSERT(0 == pthread_create(&peer, NULL, wifiEmuUdpEcho, &fd));
+  memset(&conn, 0, sizeof(conn));
+  conn.Type = ES_WIFI_UDP_CONNECTION;
+  conn.Number = 1;
+  conn.RemotePort = C_WIFI_EMU_UDP_PORT;
+  conn.LocalPort = C_WIFI_EMU_LOCAL_PORT;
+  memcpy(conn.RemoteIP, ip, sizeof(ip));
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_StartClientConnection(&wifiEmuObj, &conn));
+
+  for (i = 0; i < (int) sizeof(buffer); i++)
+  {
+    buffer[i] = (uint8_t) (i * 7);
+  } /* for */
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_SendDataTo(&wifiEmuObj, 1, buffer, sizeof(buffer), &n, 100,
+                                                        ip, C_WIFI_EMU_UDP_PORT));
+  M_TEST_ASSERT(sizeof(buffer) == n);
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_ReceiveDataFrom(&wifiEmuObj, 1, copy, sizeof(copy), &n, 1000,
+                                                             from, &port));
+  M_TEST_ASSERT(sizeof(copy) == n);
+  M_TEST_ASSERT(0 == memcmp(buffer, copy, n));
+  M_TEST_ASSERT(C_WIFI_EMU_UDP_PORT == port);
+  /* The datagram left from the local port the socket was started with. */
+  M_TEST_ASSERT(C_WIFI_EMU_LOCAL_PORT == wifiEmuUdpFrom);
+
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_StopClientConnection(&wifiEmuObj, &conn));
+  pthread_join(peer, NULL);
+  close(fd);
+} /* wifiEmuUdp() */
+
+/*
+ * @brief               streams 4 KB to the echo peer and back, as a TCP client
+ */
+static void wifiEmuTcpClientStream(void)
+{
+  static uint8_t buffer[4096];
+  static uint8_t copy[4096];
+  uint16_t n;
+  int have = 0;
+  pthread_t peer;
+  int fd = wifiEmuBind(SOCK_STREAM, C_WIFI_EMU_TCP_PORT);
+  ES_WIFI_Conn_t conn;
+  int i;
+
+  M_TEST_ASSERT(0 == listen(fd, 1));
+  M_TEST_ASSERT(0 == pthread_create(&peer, NULL, wifiEmuTcpEcho, &fd));
+  memset(&conn, 0, sizeof(conn));
+  conn.Type = ES_WIFI_TCP_CONNECTION;
+  conn.Number = 2;
+  conn.RemotePort = C_WIFI_EMU_TCP_PORT;
+  conn.RemoteIP[0] = 127;
+  conn.RemoteIP[3] = 1;
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_StartClientConnection(&wifiEmuObj, &conn));
+
+  for (i = 0; i < (int) sizeof(buffer); i++)
+  {
+    buffer[i] = (uint8_t) (i * 13 + (i >> 8));
+  } /* for */
+  for (i = 0; i < (int) sizeof(buffer); i += ES_WIFI_PAYLOAD_SIZE)
+  {
+    uint16_t length = ((sizeof(buffer) - i) < ES_WIFI_PAYLOAD_SIZE) ? (sizeof(buffer) - i) : ES_WIFI_PAYLOAD_SIZE;
+
+    M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_SendData(&wifiEmuObj, 2, &buffer[i], length, &n, 100));
+    M_TEST_ASSERT(length == n);
+  } /* for */
+  while (have < (int) sizeof(copy))
+  {
+    uint16_t length = ((sizeof(copy) - have) < ES_WIFI_PAYLOAD_SIZE) ? (sizeof(copy) - have) : ES_WIFI_PAYLOAD_SIZE;
+
+    M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_ReceiveData(&wifiEmuObj, 2, &copy[have], length, &n, 1000));
+    M_TEST_ASSERT(n > 0);
+    have += n;
+  } /* while */
+  M_TEST_ASSERT(0 == memcmp(buffer, copy, sizeof(buffer)));
+
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_StopClientConnection(&wifiEmuObj, &conn));
+  pthread_join(peer, NULL);
+  close(fd);
+} /* wifiEmuTcpClientStream() */
+
+/*
+ * @brief               accepts a client on a TCP server of the module
+ */
+static void wifiEmuTcpServer(void)
+{
+  ES_WIFI_Conn_t conn;
+  ES_WIFI_Conn_t client;
+  uint8_t buffer[16];
+  uint16_t n;
+  pthread_t peer;
+
+  memset(&conn, 0, sizeof(conn));
+  conn.Type = ES_WIFI_TCP_CONNECTION;
+  conn.Number = 3;
+  conn.LocalPort = C_WIFI_EMU_SERVER_PORT;
+  conn.Backlog = 1;
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_StartServerSingleConn(&wifiEmuObj, &conn));
+  M_TEST_ASSERT(0 == pthread_create(&peer, NULL, wifiEmuTcpClient, NULL));
+
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_WaitServerConnection(&wifiEmuObj, 2000, &client));
+  M_TEST_ASSERT(127 == client.RemoteIP[0]);
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_ReceiveData(&wifiEmuObj, 3, buffer, sizeof(buffer), &n, 1000));
+  M_TEST_ASSERT((5 == n) && (0 == memcmp(buffer, "hello", 5)));
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_SendData(&wifiEmuObj, 3, (uint8_t*) "world", 5, &n, 100));
+  M_TEST_ASSERT(5 == n);
+
+  pthread_join(peer, NULL);
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_CloseServerConnection(&wifiEmuObj, 3));
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_StopServerSingleConn(&wifiEmuObj, 3));
+} /* wifiEmuTcpServer() */
+
+int main(void)
+{
+  EMU_WIFI_Stats_t stats;
+
+  /* The protocol only: no SPI time, no module latency, no join delay. */
+  EMU_WIFI_Configure(0, 0);
+  EMU_WIFI_ConfigureJoin(0, 0);
+
+  wifiEmuJoin();
+  wifiEmuUdp();
+  wifiEmuTcpClientStream();
+  wifiEmuTcpServer();
+
+  EMU_WIFI_GetStats(&stats);
+  printf("%u AT commands, %u transfers, %u bytes to the module, %u from it\n",
+         (unsigned) stats.Commands, (unsigned) stats.Transfers, (unsigned) stats.BytesToModule,
+         (unsigned) stats.BytesFromModule);
+  printf("ALL OK\n");
+  return 0;
+} /* main() */
@@ -0,0 +1,335 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* The response parser of the driver is private: built in. */
+#include "es_wifi.c"
+#include "test.h"
+
+/*
+ * Microbenchmark of the response checks of es_wifi.c on the module responses
+ * of fixtures/es_wifi/: the answers to I? and C?, a scan of ten networks, an
+ * ERROR, and R0 payloads of 1200 and 64 binary bytes, the last one followed by
+ * a stuffing byte. Each response is checked as before the incremental parser,
+ * by strstr for the OK trailer then for ERROR (the R0 payload copied out of
+ * CmdData), once with the strstr of the C library and once with the byte loop
+ * of the size-optimised newlib the target links, then by the parser. Prints
+ * the nanoseconds per response. The parser must agree with strstr on every
+ * response, and give the same result fed in chunks of any size.
+ */
+
+#define C_BENCH_LOOPS 200000 //!< Checks of a response per method.
+
+#define C_BENCH_FIXTURES "fixtures/es_wifi/" //!< Directory of the responses.
+
+#define C_BENCH_STUFFING 0x15 //!< Byte the module sends when it has none.
+
+/**
+ * @brief  Recorded response
+ */
+typedef struct
+{
+  const char* name;   /**< printed */
+  const char* file;   /**< in C_BENCH_FIXTURES */
+  int         binary; /**< 1 for an R0 payload */
+} BENCH_Response;
+
+/**
+ * @brief  Check of a response
+ */
+typedef enum
+{
+  BENCH_LIBC = 0,  /**< strstr of the C library */
+  BENCH_BYTE_LOOP, /**< byte loop strstr */
+  BENCH_PARSER     /**< AT_Parser_t */
+} BENCH_Method;
+
+typedef char* (*BENCH_Strstr)(const char*, const char*);
+
+static uint8_t benchData[ES_WIFI_DATA_SIZE + 1]; //!< Response, as received in CmdData.
+
+static uint8_t benchOut[ES_WIFI_DATA_SIZE]; //!< Payload copied out of CmdData.
+
+static volatile int benchSink; //!< Keeps the results.
+
+/* Nothing in the benchmark waits. */
+uint32_t HAL_GetTick(void)
+{
+  return 0;
+} /* HAL_GetTick() */
+
+/*
+ * @brief               strstr of newlib built with PREFER_SIZE_OVER_SPEED:
+ *                      a byte loop
+ */
+static char* benchByteLoop
+(
+  const char* pxHaystack,
+  const char* pxNeedle
+)
+{
+  const char* a;
+  const char* b;
+
+  for (; '\0' != *pxHaystack; pxHaystack++)
+  {
+    for (a = pxHaystack, b = pxNeedle; ('\0' != *b) && (*a == *b); a++, b++)
+    {
+    } /* for */
+    if ('\0' == *b)
+    {
+      return (char*) pxHaystack;
+    } /* if */
+  } /* for */
+  return NULL;
+} /* benchByteLoop() */
+
+/*
+ * @brief               checks a response as AT_ExecuteCommand did with strstr
+ * @return              1 for OK, 2 for ERROR, else 0
+ */
+static int benchStrstrExecute
+(
+  uint8_t*     pxData,
+  int          xLen,
+  BENCH_Strstr xStrstr
+)
+{
+  pxData[xLen] = '\0';
+  if (NULL != xStrstr((char*) pxData, AT_OK_STRING))
+  {
+    return 1;
+  }
+  else if (NULL != xStrstr((char*) pxData, AT_ERROR_STRING))
+  {
+    return 2;
+  } /* if */
+  return 0;
+} /* benchStrstrExecute() */
+
+/*
+ * @brief               checks an R0 response as AT_RequestReceiveData did
+ *                      with strstr, copying the payload out
+ * @return              bytes of the payload, -1 for a bad response, -2 for no OK
+ */
+static int benchStrstrReceive
+(
+  uint8_t*     pxData,
+  int          xLen,
+  BENCH_Strstr xStrstr
+)
+{
+  int result;
+
+  if (('\r' != pxData[0]) || ('\n' != pxData[1]))
+  {
+    return -1;
+  } /* if */
+  xLen -= 2;
+  pxData += 2;
+  if (xLen < (int) AT_OK_STRING_LEN)
+  {
+    return -1;
+  } /* if */
+  while ((0 != xLen) && (C_BENCH_STUFFING == pxData[xLen - 1]))
+  {
+    xLen--;
+  } /* while */
+  pxData[xLen] = '\0';
+  if (NULL == xStrstr((char*) pxData + xLen - AT_OK_STRING_LEN, AT_OK_STRING))
+  {
+    return -2;
+  } /* if */
+  result = xLen - AT_OK_STRING_LEN;
+  memcpy(benchOut, pxData, result);
+  return result;
+} /* benchStrstrReceive() */
+
+/*
+ * @brief               checks a response as AT_ExecuteCommand does
+ * @return              1 for OK, 2 for ERROR, else 0
+ */
+static int benchParseExecute
+(
+  uint8_t* pxData,
+  int      xLen
+)
+{
+  AT_Parser_t   parser;
+  AT_Response_t response;
+
+  AT_ParserInit(&parser, 0);
+  AT_ParserFeed(&parser, pxData, xLen);
+  response = AT_ParserResult(&parser);
+  return (AT_RESPONSE_OK == response) ? 1 : ((AT_RESPONSE_ERROR == response) ? 2 : 0);
+} /* benchParseExecute() */
+
+/*
+ * @brief               checks an R0 response as AT_RequestReceiveData does,
+ *                      leaving the payload in place
+ * @return              bytes of the payload, -1 for a bad response, -2 for no OK
+ */
+static int benchParseReceive
+(
+  uint8_t*  pxData,
+  int       xLen,
+  uint8_t** pxPayload
+)
+{
+  AT_Parser_t parser;
+
+  while ((0 != xLen) && (C_BENCH_STUFFING == pxData[xLen - 1]))
+  {
+    xLen--;
+  } /* while */
+  AT_ParserInit(&parser, 1);
+  AT_ParserFeed(&parser, pxData, xLen);
+  if ((2 != parser.Head) || (parser.Length < (2 + AT_OK_STRING_LEN)))
+  {
+    return -1;
+  } /* if */
+  if (AT_RESPONSE_OK != AT_ParserResult(&parser))
+  {
+    return -2;
+  } /* if */
+  *pxPayload = pxData + 2;
+  return parser.Length - 2 - AT_OK_STRING_LEN;
+} /* benchParseReceive() */
+
+/*
+ * @brief               checks a response with a method
+ * @return              result of the check
+ */
+static int benchCheck
+(
+  const BENCH_Response* pxResponse,
+  BENCH_Method          xMethod,
+  int                   xLen
+)
+{
+  BENCH_Strstr finder = (BENCH_LIBC == xMethod) ? (BENCH_Strstr) strstr : benchByteLoop;
+  uint8_t*     payload;
+
+  if (0 != pxResponse->binary)
+  {
+    return (BENCH_PARSER == xMethod) ? benchParseReceive(benchData, xLen, &payload)
+                                     : benchStrstrReceive(benchData, xLen, finder);
+  } /* if */
+  return (BENCH_PARSER == xMethod) ? benchParseExecute(benchData, xLen)
+                                   : benchStrstrExecute(benchData, xLen, finder);
+} /* benchCheck() */
+
+/*
+ * @brief               reads a response of the fixtures
+ * @return              bytes of the response
+ */
+static int benchLoad
+(
+  const BENCH_Response* pxResponse,
+  uint8_t*              pxData
+)
+{
+  char  path[128];
+  FILE* file;
+  int   len;
+
+  snprintf(path, sizeof(path), C_BENCH_FIXTURES "%s", pxResponse->file);
+  file = fopen(path, "rb");
+  M_TEST_ASSERT(NULL != file);
+  len = (int) fread(pxData, 1, ES_WIFI_DATA_SIZE, file);
+  fclose(file);
+  M_TEST_ASSERT((len > 0) && (len < ES_WIFI_DATA_SIZE));
+  return len;
+} /* benchLoad() */
+
+/*
+ * @return              the monotonic time, in nanoseconds
+ */
+static double benchNow(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (t.tv_sec * 1e9) + t.tv_nsec;
+} /* benchNow() */
+
+int main(void)
+{
+  static const BENCH_Response responses[] =
+  {
+    { "OK", "ok.bin", 0 },
+    { "I?", "info.bin", 0 },
+    { "C?", "config.bin", 0 },
+    { "F0 scan", "scan.bin", 0 },
+    { "ERROR", "error.bin", 0 },
+    { "R0 1200 B", "recv_1200.bin", 1 },
+    { "R0 64 B", "recv_64.bin", 1 }
+  };
+  static uint8_t response[ES_WIFI_DATA_SIZE + 1];
+  AT_Parser_t    whole;
+  AT_Parser_t    chunked;
+  uint8_t*       payload;
+  double         ns[BENCH_PARSER + 1];
+  double         start;
+  int            len;
+  int            expected;
+  int            chunk;
+  int            offset;
+  int            method;
+  int            i;
+  int            k;
+
+  printf("%-10s %5s %12s %12s %8s   (ns per response)\n", "response", "bytes", "libc strstr", "byte loop",
+         "parser");
+  for (i = 0; i < (int) (sizeof(responses) / sizeof(responses[0])); i++)
+  {
+    len = benchLoad(&responses[i], response);
+
+    /* Same result as strstr, and the same payload in place. */
+    memcpy(benchData, response, len);
+    expected = benchCheck(&responses[i], BENCH_LIBC, len);
+    M_TEST_ASSERT(expected > 0);
+    memcpy(benchData, response, len);
+    M_TEST_ASSERT(expected == benchCheck(&responses[i], BENCH_BYTE_LOOP, len));
+    memcpy(benchData, response, len);
+    M_TEST_ASSERT(expected == benchCheck(&responses[i], BENCH_PARSER, len));
+    if (0 != responses[i].binary)
+    {
+      M_TEST_ASSERT(expected == benchParseReceive(benchData, len, &payload));
+      M_TEST_ASSERT(0 == memcmp(payload, benchOut, expected));
+    } /* if */
+
+    /* Same result fed in chunks of any size. */
+    AT_ParserInit(&whole, responses[i].binary);
+    AT_ParserFeed(&whole, response, len);
+    for (chunk = 1; chunk <= len; chunk++)
+    {
+      AT_ParserInit(&chunked, responses[i].binary);
+      for (offset = 0; offset < len; offset += chunk)
+      {
+        AT_ParserFeed(&chunked, &response[offset], ((len - offset) < chunk) ? (len - offset) : chunk);
+      } /* for */
+      M_TEST_ASSERT(AT_ParserResult(&whole) == AT_ParserResult(&chunked));
+      M_TEST_ASSERT((whole.Length == chunked.Length) && (whole.Head == chunked.Head));
+    } /* for */
+
+    for (method = BENCH_LIBC; method <= BENCH_PARSER; method++)
+    {
+      memcpy(benchData, response, len);
+      start = benchNow();
+      for (k = 0; k < C_BENCH_LOOPS; k++)
+      {
+        /* The checks may write a terminator over the last bytes. */
+        memcpy(&benchData[len - 8], &response[len - 8], 8);
+        benchSink += benchCheck(&responses[i], (BENCH_Method) method, len);
+      } /* for */
+      ns[method] = (benchNow() - start) / C_BENCH_LOOPS;
+    } /* for */
+    printf("%-10s %5d %12.1f %12.1f %8.1f\n", responses[i].name, len, ns[BENCH_LIBC], ns[BENCH_BYTE_LOOP],
+           ns[BENCH_PARSER]);
+  } /* for */
+
+  printf("ALL OK\n");
+  return 0;
+} /* main() */
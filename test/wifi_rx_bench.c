@@ -0,0 +1,645 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "event_groups.h"
+#include "es_wifi_io.h"
+#include "es_wifi_emu.h"
+#include "spi_wifi.h"
+#include "spiffs_fs.h"
+#include "binlog.h"
+#include "boottime.h"
+#include "test.h"
+
+/*
+ * Benchmark of the network RX task of spi_wifi.c on the module emulator, with
+ * its default time model: 10 MHz SPI and 250 us of module latency per
+ * response. A peer on the loopback sends datagrams to a UDP socket of the
+ * module, read by wifiReceiveDataFrom:
+ * - without the RX task, each call polls the module until its timeout;
+ * - with the RX task, the task drains the socket into its ring, with and
+ *   without querying the remote address of each datagram.
+ * Prints the latency of a datagram, the AT commands per datagram and per
+ * second while idle, the share of time the driver mutex is held and, once
+ * the socket is closed, the wakeups of the RX task.
+ *
+ * The kernel is mocked with threads: a task is a thread, the tick is the
+ * millisecond of the monotonic clock.
+ */
+
+#define C_BENCH_PORT      47021 //!< Local port of the socket of the module.
+#define C_BENCH_PEER_PORT 47022 //!< Port of the sending peer.
+#define C_BENCH_SOCKET    1     //!< Module socket of the runs.
+#define C_BENCH_SIZE      64    //!< Bytes of a datagram.
+#define C_BENCH_IDLE_MS   1000  //!< Length of an idle window.
+
+/**
+ * @brief  Task of the mocked kernel
+ */
+struct TEST_Task
+{
+  pthread_mutex_t lock;       /**< protects notified */
+  pthread_cond_t  wake;       /**< signalled on a notification */
+  uint32_t        notified;   /**< notification count */
+  uint32_t        wakeups;    /**< returns of ulTaskNotifyTake */
+  TaskFunction_t  code;       /**< task function */
+  void*           parameters; /**< parameter of the task function */
+};
+
+/**
+ * @brief  Traffic of a run
+ */
+typedef struct
+{
+  uint32_t count;   /**< datagrams sent */
+  uint32_t gapUs;   /**< time between two datagrams */
+} BENCH_Traffic;
+
+spiffs gSpiffsFs;
+
+SPI_HandleTypeDef hspi;
+
+static __thread TaskHandle_t benchCurrent; //!< Task of the calling thread.
+
+static TaskHandle_t benchRxTask; //!< Task created by spi_wifi.c.
+
+static pthread_mutex_t benchWifiMutex = PTHREAD_MUTEX_INITIALIZER; //!< gWifiMutex.
+
+static double benchHeld;  //!< Seconds gWifiMutex was held.
+static double benchTaken; //!< Time gWifiMutex was taken.
+
+static EventBits_t benchEventBits; //!< Bits of the event group.
+
+/*
+ * @return              the monotonic time, in seconds
+ */
+static double benchNow(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + (t.tv_nsec * 1e-9);
+} /* benchNow() */
+
+/*
+ * @brief               creates the state of a task
+ */
+static TaskHandle_t benchTaskNew(void)
+{
+  TaskHandle_t task = calloc(1, sizeof(*task));
+  pthread_condattr_t attributes;
+
+  M_TEST_ASSERT(NULL != task);
+  pthread_mutex_init(&task->lock, NULL);
+  pthread_condattr_init(&attributes);
+  pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+  pthread_cond_init(&task->wake, &attributes);
+  return task;
+} /* benchTaskNew() */
+
+/*
+ * @brief               thread of a task
+ */
+static void* benchTaskThread
+(
+  void* pxTask
+)
+{
+  benchCurrent = pxTask;
+  benchCurrent->code(benchCurrent->parameters);
+  return NULL;
+} /* benchTaskThread() */
+
+BaseType_t xTaskCreate
+(
+  TaskFunction_t pxTaskCode,
+  const char*    pcName,
+  uint16_t       usStackDepth,
+  void*          pvParameters,
+  UBaseType_t    uxPriority,
+  TaskHandle_t*  pxCreatedTask
+)
+{
+  TaskHandle_t task = benchTaskNew();
+  pthread_t thread;
+
+  (void) pcName;
+  (void) usStackDepth;
+  (void) uxPriority;
+  task->code = pxTaskCode;
+  task->parameters = pvParameters;
+  *pxCreatedTask = task;
+  benchRxTask = task;
+  M_TEST_ASSERT(0 == pthread_create(&thread, NULL, benchTaskThread, task));
+  pthread_detach(thread);
+  return pdPASS;
+} /* xTaskCreate() */
+
+TaskHandle_t xTaskCreateStatic
+(
+  TaskFunction_t pxTaskCode,
+  const char*    pcName,
+  uint32_t       ulStackDepth,
+  void*          pvParameters,
+  UBaseType_t    uxPriority,
+  StackType_t*   puxStackBuffer,
+  StaticTask_t*  pxTaskBuffer
+)
+{
+  TaskHandle_t task = NULL;
+
+  (void) puxStackBuffer;
+  (void) pxTaskBuffer;
+  (void) xTaskCreate(pxTaskCode, pcName, (uint16_t) ulStackDepth, pvParameters, uxPriority, &task);
+  return task;
+} /* xTaskCreateStatic() */
+
+TickType_t xTaskGetTickCount
+(
+  void
+)
+{
+  static double start;
+
+  if (0 == start)
+  {
+    start = benchNow();
+  } /* if */
+  return (TickType_t) ((benchNow() - start) * 1000);
+} /* xTaskGetTickCount() */
+
+TaskHandle_t xTaskGetCurrentTaskHandle
+(
+  void
+)
+{
+  if (NULL == benchCurrent)
+  {
+    benchCurrent = benchTaskNew();
+  } /* if */
+  return benchCurrent;
+} /* xTaskGetCurrentTaskHandle() */
+
+BaseType_t xTaskNotifyGive
+(
+  TaskHandle_t xTaskToNotify
+)
+{
+  pthread_mutex_lock(&xTaskToNotify->lock);
+  xTaskToNotify->notified++;
+  pthread_cond_signal(&xTaskToNotify->wake);
+  pthread_mutex_unlock(&xTaskToNotify->lock);
+  return pdPASS;
+} /* xTaskNotifyGive() */
+
+void vTaskNotifyGiveFromISR
+(
+  TaskHandle_t xTaskToNotify,
+  BaseType_t*  pxHigherPriorityTaskWoken
+)
+{
+  (void) pxHigherPriorityTaskWoken;
+  (void) xTaskNotifyGive(xTaskToNotify);
+} /* vTaskNotifyGiveFromISR() */
+
+uint32_t ulTaskNotifyTake
+(
+  BaseType_t xClearCountOnExit,
+  TickType_t xTicksToWait
+)
+{
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  struct timespec until;
+  uint32_t count;
+
+  clock_gettime(CLOCK_MONOTONIC, &until);
+  until.tv_sec += xTicksToWait / 1000;
+  until.tv_nsec += (long) (xTicksToWait % 1000) * 1000000L;
+  if (until.tv_nsec >= 1000000000L)
+  {
+    until.tv_sec++;
+    until.tv_nsec -= 1000000000L;
+  } /* if */
+
+  pthread_mutex_lock(&task->lock);
+  while (0 == task->notified)
+  {
+    int result = (portMAX_DELAY == xTicksToWait) ? pthread_cond_wait(&task->wake, &task->lock)
+                                                 : pthread_cond_timedwait(&task->wake, &task->lock, &until);
+
+    if (ETIMEDOUT == result)
+    {
+      break;
+    } /* if */
+  } /* while */
+  count = task->notified;
+  task->notified = ((pdFALSE != xClearCountOnExit) || (0 == count)) ? 0 : (count - 1);
+  task->wakeups++;
+  pthread_mutex_unlock(&task->lock);
+  return count;
+} /* ulTaskNotifyTake() */
+
+SemaphoreHandle_t xSemaphoreCreateMutex
+(
+  void
+)
+{
+  static StaticSemaphore_t mutex;
+
+  return &mutex;
+} /* xSemaphoreCreateMutex() */
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic
+(
+  StaticSemaphore_t* pxMutexBuffer
+)
+{
+  return pxMutexBuffer;
+} /* xSemaphoreCreateMutexStatic() */
+
+BaseType_t xSemaphoreTake
+(
+  SemaphoreHandle_t xSemaphore,
+  TickType_t        xBlockTime
+)
+{
+  (void) xSemaphore;
+  (void) xBlockTime;
+  pthread_mutex_lock(&benchWifiMutex);
+  benchTaken = benchNow();
+  return pdTRUE;
+} /* xSemaphoreTake() */
+
+BaseType_t xSemaphoreGive
+(
+  SemaphoreHandle_t xSemaphore
+)
+{
+  (void) xSemaphore;
+  benchHeld += benchNow() - benchTaken;
+  pthread_mutex_unlock(&benchWifiMutex);
+  return pdTRUE;
+} /* xSemaphoreGive() */
+
+EventGroupHandle_t xEventGroupCreate
+(
+  void
+)
+{
+  static StaticEventGroup_t group;
+
+  return &group;
+} /* xEventGroupCreate() */
+
+EventGroupHandle_t xEventGroupCreateStatic
+(
+  StaticEventGroup_t* pxEventGroupBuffer
+)
+{
+  return pxEventGroupBuffer;
+} /* xEventGroupCreateStatic() */
+
+EventBits_t xEventGroupSetBits
+(
+  EventGroupHandle_t xEventGroup,
+  const EventBits_t  uxBitsToSet
+)
+{
+  (void) xEventGroup;
+  return __atomic_or_fetch(&benchEventBits, uxBitsToSet, __ATOMIC_SEQ_CST);
+} /* xEventGroupSetBits() */
+
+BaseType_t xEventGroupSetBitsFromISR
+(
+  EventGroupHandle_t xEventGroup,
+  const EventBits_t  uxBitsToSet,
+  BaseType_t*        pxHigherPriorityTaskWoken
+)
+{
+  (void) pxHigherPriorityTaskWoken;
+  (void) xEventGroupSetBits(xEventGroup, uxBitsToSet);
+  return pdPASS;
+} /* xEventGroupSetBitsFromISR() */
+
+EventBits_t xEventGroupClearBits
+(
+  EventGroupHandle_t xEventGroup,
+  const EventBits_t  uxBitsToClear
+)
+{
+  (void) xEventGroup;
+  return __atomic_fetch_and(&benchEventBits, ~uxBitsToClear, __ATOMIC_SEQ_CST);
+} /* xEventGroupClearBits() */
+
+EventBits_t xEventGroupWaitBits
+(
+  EventGroupHandle_t xEventGroup,
+  const EventBits_t  uxBitsToWaitFor,
+  const BaseType_t   xClearOnExit,
+  const BaseType_t   xWaitForAllBits,
+  TickType_t         xTicksToWait
+)
+{
+  (void) uxBitsToWaitFor;
+  (void) xClearOnExit;
+  (void) xWaitForAllBits;
+  (void) xTicksToWait;
+  return xEventGroupClearBits(xEventGroup, 0);
+} /* xEventGroupWaitBits() */
+
+/* The module is the emulator. */
+
+int8_t SPI_WIFI_Init
+(
+  uint16_t mode
+)
+{
+  return EMU_WIFI_Init(mode);
+} /* SPI_WIFI_Init() */
+
+int8_t SPI_WIFI_DeInit
+(
+  void
+)
+{
+  return EMU_WIFI_DeInit();
+} /* SPI_WIFI_DeInit() */
+
+int16_t SPI_WIFI_ReceiveData
+(
+  uint8_t* pData,
+  uint16_t len,
+  uint32_t timeout
+)
+{
+  return EMU_WIFI_ReceiveData(pData, len, timeout);
+} /* SPI_WIFI_ReceiveData() */
+
+int16_t SPI_WIFI_SendData
+(
+  uint8_t* pData,
+  uint16_t len,
+  uint32_t timeout
+)
+{
+  return EMU_WIFI_SendData(pData, len, timeout);
+} /* SPI_WIFI_SendData() */
+
+uint8_t* SPI_WIFI_GetTxBuffer
+(
+  uint16_t len
+)
+{
+  return EMU_WIFI_GetTxBuffer(len);
+} /* SPI_WIFI_GetTxBuffer() */
+
+void SPI_WIFI_Delay
+(
+  uint32_t Delay
+)
+{
+  EMU_WIFI_Delay(Delay);
+} /* SPI_WIFI_Delay() */
+
+void SPI_WIFI_ISR
+(
+  void
+)
+{
+} /* SPI_WIFI_ISR() */
+
+void vPortYieldFromISR
+(
+  BaseType_t xSwitchRequired
+)
+{
+  (void) xSwitchRequired;
+} /* vPortYieldFromISR() */
+
+void HAL_Delay
+(
+  uint32_t Delay
+)
+{
+  usleep(Delay * 1000);
+} /* HAL_Delay() */
+
+void HAL_NVIC_ClearPendingIRQ
+(
+  IRQn_Type IRQn
+)
+{
+  (void) IRQn;
+} /* HAL_NVIC_ClearPendingIRQ() */
+
+void HAL_SPI_IRQHandler
+(
+  SPI_HandleTypeDef* hspi
+)
+{
+  (void) hspi;
+} /* HAL_SPI_IRQHandler() */
+
+void HAL_DMA_IRQHandler
+(
+  DMA_HandleTypeDef* hdma
+)
+{
+  (void) hdma;
+} /* HAL_DMA_IRQHandler() */
+
+void binlogRecord
+(
+  const char* xpFormat,
+  uint32_t    xStrings,
+  uint32_t    xCount,
+  ...
+)
+{
+  (void) xpFormat;
+  (void) xStrings;
+  (void) xCount;
+} /* binlogRecord() */
+
+void boottimeMark
+(
+  BOOTTIME_Step xStep
+)
+{
+  (void) xStep;
+} /* boottimeMark() */
+
+/*
+ * @brief               peer sending the datagrams of a run, stamped with their time
+ */
+static void* benchSender
+(
+  void* pxTraffic
+)
+{
+  const BENCH_Traffic* traffic = pxTraffic;
+  uint8_t datagram[C_BENCH_SIZE];
+  struct sockaddr_in addr;
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  uint32_t i;
+
+  M_TEST_ASSERT(fd >= 0);
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(C_BENCH_PEER_PORT);
+  M_TEST_ASSERT(0 == bind(fd, (struct sockaddr*) &addr, sizeof(addr)));
+  addr.sin_port = htons(C_BENCH_PORT);
+  memset(datagram, 'x', sizeof(datagram));
+  for (i = 0; i < traffic->count; i++)
+  {
+    double sentAt;
+
+    usleep(traffic->gapUs);
+    sentAt = benchNow();
+    memcpy(datagram, &sentAt, sizeof(sentAt));
+    M_TEST_ASSERT(sizeof(datagram) == sendto(fd, datagram, sizeof(datagram), 0, (struct sockaddr*) &addr,
+                                             sizeof(addr)));
+  } /* for */
+  close(fd);
+  return NULL;
+} /* benchSender() */
+
+/*
+ * @brief               receives the datagrams of a run and prints their latency
+ */
+static void benchRun
+(
+  const char* pxName,
+  uint32_t    xCount,
+  uint32_t    xGapUs,
+  uint32_t    xTimeout
+)
+{
+  BENCH_Traffic traffic = { xCount, xGapUs };
+  EMU_WIFI_Stats_t stats;
+  uint8_t datagram[ES_WIFI_PAYLOAD_SIZE];
+  uint8_t address[4];
+  uint16_t port;
+  uint16_t length;
+  pthread_t sender;
+  double latency = 0;
+  double worst = 0;
+  double start;
+  double seconds;
+  uint32_t received = 0;
+
+  EMU_WIFI_ResetStats();
+  benchHeld = 0;
+  start = benchNow();
+  M_TEST_ASSERT(0 == pthread_create(&sender, NULL, benchSender, &traffic));
+  while ((received < xCount) && ((benchNow() - start) < ((xCount * xGapUs * 1e-6) + 2)))
+  {
+    M_TEST_ASSERT(ES_WIFI_STATUS_OK == wifiReceiveDataFrom(C_BENCH_SOCKET, datagram, sizeof(datagram),
+                                                           &length, xTimeout, address, &port));
+    if (0 != length)
+    {
+      double sentAt;
+      double late;
+
+      M_TEST_ASSERT(C_BENCH_SIZE == length);
+      memcpy(&sentAt, datagram, sizeof(sentAt));
+      late = benchNow() - sentAt;
+      latency += late;
+      worst = (late > worst) ? late : worst;
+      received++;
+    } /* if */
+  } /* while */
+  seconds = benchNow() - start;
+  pthread_join(sender, NULL);
+  EMU_WIFI_GetStats(&stats);
+
+  M_TEST_ASSERT(xCount == received);
+  printf("%-30s %4.1f commands/datagram, latency %5.2f ms mean %5.2f ms max, driver held %3.0f %%\n", pxName,
+         (double) stats.Commands / received, (latency / received) * 1e3, worst * 1e3,
+         (benchHeld / seconds) * 100);
+} /* benchRun() */
+
+/*
+ * @brief               counts the AT commands while no datagram comes
+ * @return              the AT commands per second
+ */
+static double benchIdle
+(
+  uint32_t xTimeout
+)
+{
+  EMU_WIFI_Stats_t stats;
+  uint8_t datagram[ES_WIFI_PAYLOAD_SIZE];
+  uint8_t address[4];
+  uint16_t port;
+  uint16_t length;
+  double start = benchNow();
+
+  EMU_WIFI_ResetStats();
+  if (0 == xTimeout)
+  {
+    usleep(C_BENCH_IDLE_MS * 1000);
+  }
+  else
+  {
+    while ((benchNow() - start) < (C_BENCH_IDLE_MS * 1e-3))
+    {
+      M_TEST_ASSERT(ES_WIFI_STATUS_OK == wifiReceiveDataFrom(C_BENCH_SOCKET, datagram, sizeof(datagram),
+                                                             &length, xTimeout, address, &port));
+    } /* while */
+  } /* if */
+  EMU_WIFI_GetStats(&stats);
+  return stats.Commands / (benchNow() - start);
+} /* benchIdle() */
+
+int main(void)
+{
+  WIFI_RxStats rxStats;
+  uint32_t wakeups;
+
+  EMU_WIFI_Configure(ES_WIFI_EMU_SPI_CLOCK, ES_WIFI_EMU_LATENCY_US);
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == wifiInit());
+  printf("SPI at %u Hz, %u us of module latency, %u B datagrams\n", ES_WIFI_EMU_SPI_CLOCK,
+         ES_WIFI_EMU_LATENCY_US, C_BENCH_SIZE);
+
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == wifiBindToUdp(C_BENCH_SOCKET, C_BENCH_PORT));
+  benchRun("polling, 10 ms timeout", 100, 20000, 10);
+  printf("%-30s %6.1f commands/s idle\n", "", benchIdle(10));
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == wifiCloseSocket(C_BENCH_SOCKET));
+
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == wifiRxStart());
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == wifiBindToUdp(C_BENCH_SOCKET, C_BENCH_PORT));
+  benchRun("RX task, remote address", 100, 20000, 100);
+  printf("%-30s %6.1f commands/s idle\n", "", benchIdle(0));
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == wifiRxOpen(C_BENCH_SOCKET, 0));
+  benchRun("RX task, no remote address", 100, 20000, 100);
+  benchRun("RX task, 1 ms apart", 1000, 1000, 100);
+  wifiRxGetStats(&rxStats);
+  printf("RX task: %u polls, %u datagrams, %u full, %u errors\n", (unsigned) rxStats.polls,
+         (unsigned) rxStats.datagrams, (unsigned) rxStats.full, (unsigned) rxStats.errors);
+  M_TEST_ASSERT(0 == rxStats.errors);
+
+  /* With no socket open, the RX task must sleep: no command, no timed wakeup. */
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == wifiCloseSocket(C_BENCH_SOCKET));
+  usleep(200 * 1000);
+  wakeups = benchRxTask->wakeups;
+  M_TEST_ASSERT(0 == benchIdle(0));
+  printf("no socket open: %u wakeups of the RX task in %u ms\n", (unsigned) (benchRxTask->wakeups - wakeups),
+         C_BENCH_IDLE_MS);
+  M_TEST_ASSERT(wakeups == benchRxTask->wakeups);
+
+  printf("ALL OK\n");
+  return 0;
+} /* main() */
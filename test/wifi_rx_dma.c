@@ -0,0 +1,537 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stm32l4xx_hal.h"
+#include "semphr.h"
+#include "es_wifi.h"
+#include "es_wifi_io.h"
+#include "test.h"
+
+/*
+ * DMA receive of the Wi-Fi module, es_wifi_io.c built with the kernel. The
+ * module is a byte stream clocked out while CMDDATA_READY is high. The bus only
+ * moves while the task sleeps on a semaphore: a receive that polls instead sees
+ * no progress and fails. The interrupts record that they never stop the DMA
+ * channels themselves.
+ */
+
+#define C_WIFI_RX_DMA_RUNS 20000 //!< Random responses checked byte by byte.
+
+#define C_WIFI_RX_DMA_STUFFING 0x15 //!< Byte the module sends when it has none.
+
+GPIO_TypeDef* GPIOE = &(GPIO_TypeDef){0};
+SPI_TypeDef*  SPI3 = &(SPI_TypeDef){0};
+uint32_t      SystemCoreClock = 1000;
+uint32_t      testPrimask = 0;
+
+static uint32_t wifiRxDmaTick = 0; //!< Milliseconds, one per HAL_GetTick.
+
+static uint8_t  wifiRxDmaStream[4096]; //!< Bytes the module has to send.
+static int      wifiRxDmaLen = 0;      //!< Length of the stream.
+static int      wifiRxDmaPos = 0;      //!< Bytes already clocked out.
+static int      wifiRxDmaLate = 0;     //!< Words clocked between the edge and its interrupt.
+static int      wifiRxDmaStall = 0;    //!< 1 when the bus does not move.
+
+static SPI_HandleTypeDef* wifiRxDmaSpi = NULL;  //!< Handle of the DMA receive.
+static uint8_t*           wifiRxDmaBuf = NULL;  //!< Buffer of the DMA receive.
+static uint16_t           wifiRxDmaWords = 0;   //!< Size of the DMA receive.
+static int                wifiRxDmaArmed = 0;   //!< 1 from the start to the stop of the channels.
+static int                wifiRxDmaInIsr = 0;   //!< 1 in the interrupts.
+
+static unsigned long wifiRxDmaIrqs = 0;     //!< Interrupts.
+static unsigned long wifiRxDmaBlocks = 0;   //!< Takes that put the task to sleep.
+static unsigned long wifiRxDmaPolls = 0;    //!< CMDDATA_READY reads while armed.
+static unsigned long wifiRxDmaStops = 0;    //!< HAL_SPI_DMAStop calls.
+static unsigned long wifiRxDmaReceives = 0; //!< DMA receives started.
+
+static int wifiRxDmaReady(void)
+{
+  return wifiRxDmaPos < wifiRxDmaLen;
+} /* wifiRxDmaReady() */
+
+static void wifiRxDmaClock
+(
+  uint8_t* pxWord
+)
+{
+  if (wifiRxDmaReady())
+  {
+    pxWord[0] = wifiRxDmaStream[wifiRxDmaPos];
+    pxWord[1] = wifiRxDmaStream[wifiRxDmaPos + 1];
+    wifiRxDmaPos += 2;
+  }
+  else
+  {
+    pxWord[0] = C_WIFI_RX_DMA_STUFFING;
+    pxWord[1] = C_WIFI_RX_DMA_STUFFING;
+  } /* if */
+} /* wifiRxDmaClock() */
+
+static void wifiRxDmaFallingEdge(void)
+{
+  wifiRxDmaIrqs++;
+  wifiRxDmaInIsr = 1;
+  SPI_WIFI_ISR();
+  wifiRxDmaInIsr = 0;
+} /* wifiRxDmaFallingEdge() */
+
+/*
+ * @brief               moves the bus while the task sleeps: the DMA clocks words
+ *                      until its requests are cleared or its counter is 0
+ */
+static void wifiRxDmaRun(void)
+{
+  const uint32_t enabled = SPI_CR2_TXDMAEN | SPI_CR2_RXDMAEN;
+  int            late = -1;
+
+  if (!wifiRxDmaArmed || wifiRxDmaStall)
+  {
+    return;
+  } /* if */
+
+  while (((SPI3->CR2 & enabled) == enabled) && (wifiRxDmaSpi->hdmarx->CNDTR > 0))
+  {
+    wifiRxDmaClock(&wifiRxDmaBuf[2 * (wifiRxDmaWords - wifiRxDmaSpi->hdmarx->CNDTR)]);
+    wifiRxDmaSpi->hdmarx->CNDTR--;
+    if (!wifiRxDmaReady() && (late < 0))
+    {
+      late = wifiRxDmaLate;
+    } /* if */
+    if (0 == late)
+    {
+      wifiRxDmaFallingEdge();
+      return;
+    } /* if */
+    if (late > 0)
+    {
+      late--;
+    } /* if */
+  } /* while */
+
+  if (0 == wifiRxDmaSpi->hdmarx->CNDTR)
+  {
+    /* the HAL ends a complete transfer before the callback */
+    CLEAR_BIT(SPI3->CR2, enabled);
+    wifiRxDmaIrqs++;
+    wifiRxDmaInIsr = 1;
+    HAL_SPI_TxRxCpltCallback(wifiRxDmaSpi);
+    wifiRxDmaInIsr = 0;
+    if (late >= 0)
+    {
+      wifiRxDmaFallingEdge();
+    } /* if */
+  } /* if */
+} /* wifiRxDmaRun() */
+
+uint32_t HAL_GetTick(void)
+{
+  return wifiRxDmaTick++;
+} /* HAL_GetTick() */
+
+void HAL_Delay
+(
+  uint32_t xDelay
+)
+{
+  static const uint8_t prompt[] = {0x15, 0x15, '\r', '\n', '>', ' '};
+
+  wifiRxDmaTick += xDelay;
+  /* the reset of the module ends with a delay, then it sends its prompt */
+  memcpy(wifiRxDmaStream, prompt, sizeof(prompt));
+  wifiRxDmaLen = sizeof(prompt);
+  wifiRxDmaPos = 0;
+} /* HAL_Delay() */
+
+void HAL_GPIO_WritePin
+(
+  GPIO_TypeDef* pxGpio,
+  uint16_t      xPin,
+  GPIO_PinState xState
+)
+{
+} /* HAL_GPIO_WritePin() */
+
+GPIO_PinState HAL_GPIO_ReadPin
+(
+  GPIO_TypeDef* pxGpio,
+  uint16_t      xPin
+)
+{
+  if (wifiRxDmaArmed && !wifiRxDmaInIsr)
+  {
+    wifiRxDmaPolls++;
+  } /* if */
+  return ((GPIO_PIN_1 == xPin) && wifiRxDmaReady()) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+} /* HAL_GPIO_ReadPin() */
+
+HAL_StatusTypeDef HAL_SPI_Init
+(
+  SPI_HandleTypeDef* pxSpi
+)
+{
+  return HAL_OK;
+} /* HAL_SPI_Init() */
+
+HAL_StatusTypeDef HAL_SPI_DeInit
+(
+  SPI_HandleTypeDef* pxSpi
+)
+{
+  return HAL_OK;
+} /* HAL_SPI_DeInit() */
+
+HAL_StatusTypeDef HAL_SPI_Receive
+(
+  SPI_HandleTypeDef* pxSpi,
+  uint8_t*           pxData,
+  uint16_t           xSize,
+  uint32_t           xTimeout
+)
+{
+  uint16_t i;
+
+  for (i = 0; i < xSize; i++)
+  {
+    wifiRxDmaClock(&pxData[2 * i]);
+  } /* for */
+  return HAL_OK;
+} /* HAL_SPI_Receive() */
+
+HAL_StatusTypeDef HAL_SPI_Receive_IT
+(
+  SPI_HandleTypeDef* pxSpi,
+  uint8_t*           pxData,
+  uint16_t           xSize
+)
+{
+  int ready = wifiRxDmaReady();
+
+  HAL_SPI_Receive(pxSpi, pxData, xSize, 0);
+  wifiRxDmaIrqs++;
+  HAL_SPI_RxCpltCallback(pxSpi);
+  if (ready && !wifiRxDmaReady())
+  {
+    wifiRxDmaFallingEdge();
+  } /* if */
+  return HAL_OK;
+} /* HAL_SPI_Receive_IT() */
+
+HAL_StatusTypeDef HAL_SPI_Transmit_IT
+(
+  SPI_HandleTypeDef* pxSpi,
+  uint8_t*           pxData,
+  uint16_t           xSize
+)
+{
+  wifiRxDmaIrqs++;
+  HAL_SPI_TxCpltCallback(pxSpi);
+  return HAL_OK;
+} /* HAL_SPI_Transmit_IT() */
+
+HAL_StatusTypeDef HAL_SPI_Receive_DMA
+(
+  SPI_HandleTypeDef* pxSpi,
+  uint8_t*           pxData,
+  uint16_t           xSize
+)
+{
+  M_TEST_ASSERT(0 == ((uintptr_t)pxData & 1));
+  M_TEST_ASSERT(!wifiRxDmaArmed);
+  wifiRxDmaSpi = pxSpi;
+  wifiRxDmaBuf = pxData;
+  wifiRxDmaWords = xSize;
+  wifiRxDmaArmed = 1;
+  wifiRxDmaReceives++;
+  pxSpi->hdmarx->CNDTR = xSize;
+  SET_BIT(pxSpi->Instance->CR2, SPI_CR2_TXDMAEN | SPI_CR2_RXDMAEN);
+  return HAL_OK;
+} /* HAL_SPI_Receive_DMA() */
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA
+(
+  SPI_HandleTypeDef* pxSpi,
+  uint8_t*           pxData,
+  uint16_t           xSize
+)
+{
+  return HAL_ERROR;
+} /* HAL_SPI_Transmit_DMA() */
+
+HAL_StatusTypeDef HAL_SPI_DMAStop
+(
+  SPI_HandleTypeDef* pxSpi
+)
+{
+  /* aborting the channels waits on them: never in an interrupt, never masked */
+  M_TEST_ASSERT(!wifiRxDmaInIsr);
+  M_TEST_ASSERT(0 == testPrimask);
+  CLEAR_BIT(pxSpi->Instance->CR2, SPI_CR2_TXDMAEN | SPI_CR2_RXDMAEN);
+  wifiRxDmaArmed = 0;
+  wifiRxDmaStops++;
+  return HAL_OK;
+} /* HAL_SPI_DMAStop() */
+
+HAL_StatusTypeDef HAL_SPIEx_FlushRxFifo
+(
+  SPI_HandleTypeDef* pxSpi
+)
+{
+  return HAL_OK;
+} /* HAL_SPIEx_FlushRxFifo() */
+
+HAL_StatusTypeDef HAL_DMA_Init
+(
+  DMA_HandleTypeDef* pxDma
+)
+{
+  return HAL_OK;
+} /* HAL_DMA_Init() */
+
+HAL_StatusTypeDef HAL_DMA_DeInit
+(
+  DMA_HandleTypeDef* pxDma
+)
+{
+  return HAL_OK;
+} /* HAL_DMA_DeInit() */
+
+void HAL_NVIC_SetPriority
+(
+  IRQn_Type xIrq,
+  uint32_t  xPreempt,
+  uint32_t  xSub
+)
+{
+} /* HAL_NVIC_SetPriority() */
+
+void HAL_NVIC_EnableIRQ
+(
+  IRQn_Type xIrq
+)
+{
+} /* HAL_NVIC_EnableIRQ() */
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic
+(
+  StaticSemaphore_t* pxBuffer
+)
+{
+  pxBuffer->given = 0;
+  return pxBuffer;
+} /* xSemaphoreCreateBinaryStatic() */
+
+BaseType_t xSemaphoreTake
+(
+  SemaphoreHandle_t xSemaphore,
+  TickType_t        xBlockTime
+)
+{
+  M_TEST_ASSERT(!wifiRxDmaInIsr);
+  if (!xSemaphore->given && (xBlockTime > 0))
+  {
+    /* the task sleeps, the other side runs */
+    wifiRxDmaBlocks++;
+    wifiRxDmaRun();
+    if (!xSemaphore->given)
+    {
+      wifiRxDmaTick += xBlockTime;
+      if (wifiRxDmaStall && wifiRxDmaArmed)
+      {
+        /* the bus resumes and the edge comes right after the timeout */
+        wifiRxDmaStall = 0;
+        wifiRxDmaRun();
+        return pdFALSE;
+      } /* if */
+    } /* if */
+  } /* if */
+  if (!xSemaphore->given)
+  {
+    return pdFALSE;
+  } /* if */
+  xSemaphore->given = 0;
+  return pdTRUE;
+} /* xSemaphoreTake() */
+
+BaseType_t xSemaphoreGive
+(
+  SemaphoreHandle_t xSemaphore
+)
+{
+  xSemaphore->given = 1;
+  return pdTRUE;
+} /* xSemaphoreGive() */
+
+BaseType_t xSemaphoreGiveFromISR
+(
+  SemaphoreHandle_t xSemaphore,
+  BaseType_t*       pxHigherPriorityTaskWoken
+)
+{
+  M_TEST_ASSERT(wifiRxDmaInIsr);
+  xSemaphore->given = 1;
+  *pxHigherPriorityTaskWoken = pdTRUE;
+  return pdTRUE;
+} /* xSemaphoreGiveFromISR() */
+
+void vSemaphoreDelete
+(
+  SemaphoreHandle_t xSemaphore
+)
+{
+} /* vSemaphoreDelete() */
+
+void vPortYieldFromISR
+(
+  BaseType_t xSwitchRequired
+)
+{
+} /* vPortYieldFromISR() */
+
+/*
+ * @brief               builds a response as the module sends it: data between
+ *                      "\r\n" and "\r\nOK\r\n> ", padded to words
+ * @return              length of the response
+ */
+static int wifiRxDmaLoad
+(
+  uint8_t* pxResponse,
+  int      xDataLen,
+  int      xRandom
+)
+{
+  int n = 0;
+  int i;
+
+  pxResponse[n++] = '\r';
+  pxResponse[n++] = '\n';
+  for (i = 0; i < xDataLen; i++)
+  {
+    pxResponse[n++] = (3 == (i % 7)) ? C_WIFI_RX_DMA_STUFFING : (xRandom ? (uint8_t)rand() : 'x');
+  } /* for */
+  memcpy(&pxResponse[n], "\r\nOK\r\n> ", 8);
+  n += 8;
+
+  memcpy(wifiRxDmaStream, pxResponse, n);
+  wifiRxDmaLen = n;
+  if (n & 1)
+  {
+    wifiRxDmaStream[wifiRxDmaLen++] = C_WIFI_RX_DMA_STUFFING;
+  } /* if */
+  wifiRxDmaPos = 0;
+  return n;
+} /* wifiRxDmaLoad() */
+
+/*
+ * @brief               gets the length the receive returns: the response cut at
+ *                      the limit in words, without its trailing stuffing bytes
+ */
+static int wifiRxDmaExpected
+(
+  const uint8_t* pxResponse,
+  int            xLen,
+  uint16_t       xLimit
+)
+{
+  int expected = xLen;
+
+  if ((xLimit > 0) && (xLimit < xLen))
+  {
+    expected = (xLimit + 1) & ~1;
+    if (expected > xLen)
+    {
+      expected = xLen;
+    } /* if */
+  } /* if */
+  while ((expected > 0) && (C_WIFI_RX_DMA_STUFFING == pxResponse[expected - 1]))
+  {
+    expected--;
+  } /* while */
+  return expected;
+} /* wifiRxDmaExpected() */
+
+static uint8_t wifiRxDmaBuffer[ES_WIFI_DATA_SIZE + 8] __attribute__((aligned(4)));
+
+int main(void)
+{
+  static const int sizes[] = {16, 256, 1200};
+  uint8_t          response[ES_WIFI_DATA_SIZE];
+  int              run;
+  int              k;
+  int              n;
+  int16_t          length;
+
+  M_TEST_ASSERT(0 == SPI_WIFI_Init(ES_WIFI_INIT));
+  srand(1);
+
+  /* byte exactness, by DMA and by the odd buffers of the interrupt path */
+  for (run = 0; run < C_WIFI_RX_DMA_RUNS; run++)
+  {
+    int      offset = (4 == (run % 5)) ? 1 : 0;
+    uint16_t limit;
+
+    n = wifiRxDmaLoad(response, rand() % 1300, 1);
+    limit = (10 == (run % 11)) ? (uint16_t)(rand() % n) : ((run & 1) ? 0 : ES_WIFI_DATA_SIZE);
+    wifiRxDmaLate = run % 4;
+    memset(wifiRxDmaBuffer, 0xAA, sizeof(wifiRxDmaBuffer));
+    length = SPI_WIFI_ReceiveData(&wifiRxDmaBuffer[offset], limit, 100);
+    M_TEST_ASSERT(length == wifiRxDmaExpected(response, n, limit));
+    M_TEST_ASSERT(0 == memcmp(&wifiRxDmaBuffer[offset], response, length));
+    M_TEST_ASSERT(!wifiRxDmaArmed);
+  } /* for */
+
+  /* the edge comes between the timeout and the halt: its give is stale */
+  n = wifiRxDmaLoad(response, 100, 1);
+  wifiRxDmaStall = 1;
+  length = SPI_WIFI_ReceiveData(wifiRxDmaBuffer, 0, 100);
+  M_TEST_ASSERT(length == wifiRxDmaExpected(response, n, 0));
+  M_TEST_ASSERT(!wifiRxDmaArmed);
+  n = wifiRxDmaLoad(response, 500, 1);
+  length = SPI_WIFI_ReceiveData(wifiRxDmaBuffer, 0, 100);
+  M_TEST_ASSERT(length == wifiRxDmaExpected(response, n, 0));
+  M_TEST_ASSERT(0 == memcmp(wifiRxDmaBuffer, response, length));
+
+  /* stuffing forever: the module never drops CMDDATA_READY */
+  memset(wifiRxDmaStream, C_WIFI_RX_DMA_STUFFING, sizeof(wifiRxDmaStream));
+  wifiRxDmaLen = sizeof(wifiRxDmaStream);
+  wifiRxDmaPos = 0;
+  M_TEST_ASSERT(ES_WIFI_ERROR_STUFFING_FOREVER == SPI_WIFI_ReceiveData(wifiRxDmaBuffer, 0, 100));
+
+  /* cost per KB: one wakeup per response, no polling */
+  for (k = 0; k < (int)(sizeof(sizes) / sizeof(sizes[0])); k++)
+  {
+    int offset;
+
+    wifiRxDmaLate = 1;
+    for (offset = 0; offset < 2; offset++)
+    {
+      double kb;
+
+      wifiRxDmaIrqs = wifiRxDmaBlocks = wifiRxDmaPolls = wifiRxDmaStops = wifiRxDmaReceives = 0;
+      for (run = 0; run < 100; run++)
+      {
+        n = wifiRxDmaLoad(response, sizes[k], 0);
+        M_TEST_ASSERT(wifiRxDmaExpected(response, n, 0) == SPI_WIFI_ReceiveData(&wifiRxDmaBuffer[offset], 0, 100));
+      } /* for */
+      kb = 100.0 * n / 1024;
+      printf("%5d B response %-8s irq/KB %6.1f switches/KB %6.1f polls/receive %4.1f\n",
+             n, offset ? "per-word" : "DMA", wifiRxDmaIrqs / kb, wifiRxDmaBlocks / kb,
+             wifiRxDmaReceives ? (double)wifiRxDmaPolls / wifiRxDmaReceives : 0.0);
+      if (0 == offset)
+      {
+        M_TEST_ASSERT(100 == wifiRxDmaReceives);
+        M_TEST_ASSERT(100 == wifiRxDmaStops);
+        M_TEST_ASSERT(wifiRxDmaBlocks <= wifiRxDmaReceives);
+        M_TEST_ASSERT(wifiRxDmaPolls <= wifiRxDmaReceives);
+        if (n >= 1024)
+        {
+          M_TEST_ASSERT((wifiRxDmaBlocks / kb) <= 1.0);
+        } /* if */
+      } /* if */
+    } /* for */
+  } /* for */
+
+  printf("ALL OK\n");
+  return 0;
+} /* main() */
@@ -0,0 +1,188 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "es_wifi.h"
+#include "es_wifi_emu.h"
+#include "test.h"
+
+/*
+ * Benchmark of the UDP send of es_wifi.c on the module emulator, with its
+ * default time model: 10 MHz SPI and 250 us of module latency per response.
+ * Datagrams of 32, 256 and 1200 bytes go to one destination by
+ * ES_WIFI_SendDataTo, to two destinations in turn, and through a socket
+ * connected by ES_WIFI_ConnectUDP. Prints the datagrams per second and the AT
+ * commands per datagram. The peer must receive every byte.
+ */
+
+#define C_BENCH_PORT      47011 //!< Port of the receiving peer.
+#define C_BENCH_DATAGRAMS 300   //!< Datagrams of a run.
+#define C_BENCH_SOCKET    0     //!< Module socket of the runs.
+
+/**
+ * @brief  Destinations of a run
+ */
+typedef enum
+{
+  BENCH_ONE_DESTINATION = 0, /**< ES_WIFI_SendDataTo, always to the same address */
+  BENCH_TWO_DESTINATIONS,    /**< ES_WIFI_SendDataTo, to two addresses in turn */
+  BENCH_CONNECTED            /**< ES_WIFI_ConnectUDP, then ES_WIFI_SendData */
+} BENCH_Mode;
+
+static const char* const benchModeNames[] = { "sendto, one destination", "sendto, two destinations",
+                                              "connected" };
+
+static ES_WIFIObject_t benchObj; //!< Driver under test.
+
+static int benchPeer; //!< Socket of the receiving peer.
+
+static volatile uint32_t benchReceived;      //!< Datagrams received by the peer.
+static volatile uint32_t benchReceivedBytes; //!< Bytes received by the peer.
+
+/*
+ * @brief               peer counting the datagrams it receives
+ */
+static void* benchSink
+(
+  void* pxUnused
+)
+{
+  uint8_t buffer[ES_WIFI_PAYLOAD_SIZE];
+  ssize_t n;
+
+  (void) pxUnused;
+  while ((n = recv(benchPeer, buffer, sizeof(buffer), 0)) >= 0)
+  {
+    benchReceivedBytes += n;
+    benchReceived++;
+  } /* while */
+  return NULL;
+} /* benchSink() */
+
+/*
+ * @return              the monotonic time, in seconds
+ */
+static double benchNow(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + (t.tv_nsec * 1e-9);
+} /* benchNow() */
+
+/*
+ * @brief               sends the datagrams of a run and prints its rate
+ */
+static void benchRun
+(
+  BENCH_Mode xMode,
+  uint16_t   xSize
+)
+{
+  static uint8_t payload[ES_WIFI_PAYLOAD_SIZE];
+  uint8_t destinations[2][4] = { { 10, 0, 0, 7 }, { 10, 0, 0, 8 } };
+  ES_WIFI_Conn_t conn;
+  EMU_WIFI_Stats_t stats;
+  uint32_t received = benchReceived;
+  uint32_t receivedBytes = benchReceivedBytes;
+  uint16_t sent;
+  double start;
+  double seconds;
+  int i;
+
+  memset(&conn, 0, sizeof(conn));
+  conn.Type = ES_WIFI_UDP_CONNECTION;
+  conn.Number = C_BENCH_SOCKET;
+  conn.RemotePort = C_BENCH_PORT;
+  memcpy(conn.RemoteIP, destinations[0], 4);
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_StartClientConnection(&benchObj, &conn));
+  if (BENCH_CONNECTED == xMode)
+  {
+    M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_ConnectUDP(&benchObj, C_BENCH_SOCKET, destinations[0],
+                                                          C_BENCH_PORT));
+  } /* if */
+  memset(payload, 'D', xSize);
+
+  EMU_WIFI_ResetStats();
+  start = benchNow();
+  for (i = 0; i < C_BENCH_DATAGRAMS; i++)
+  {
+    if (BENCH_CONNECTED == xMode)
+    {
+      M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_SendData(&benchObj, C_BENCH_SOCKET, payload, xSize, &sent,
+                                                          10));
+    }
+    else
+    {
+      uint8_t* destination = destinations[(BENCH_TWO_DESTINATIONS == xMode) ? (i & 1) : 0];
+
+      M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_SendDataTo(&benchObj, C_BENCH_SOCKET, payload, xSize, &sent,
+                                                            10, destination, C_BENCH_PORT));
+    } /* if */
+    M_TEST_ASSERT(xSize == sent);
+  } /* for */
+  seconds = benchNow() - start;
+  EMU_WIFI_GetStats(&stats);
+
+  printf("%-26s %4u B %7.0f datagrams/s, %4.2f AT commands per datagram\n", benchModeNames[xMode], xSize,
+         C_BENCH_DATAGRAMS / seconds, (double) stats.Commands / C_BENCH_DATAGRAMS);
+
+  for (i = 0; (i < 100) && ((benchReceived - received) < C_BENCH_DATAGRAMS); i++)
+  {
+    usleep(10000);
+  } /* for */
+  M_TEST_ASSERT(C_BENCH_DATAGRAMS == (benchReceived - received));
+  M_TEST_ASSERT(((uint32_t) C_BENCH_DATAGRAMS * xSize) == (benchReceivedBytes - receivedBytes));
+
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_StopClientConnection(&benchObj, &conn));
+} /* benchRun() */
+
+int main(void)
+{
+  static const uint16_t sizes[] = { 32, 256, 1200 };
+  struct sockaddr_in addr;
+  pthread_t sink;
+  int bufferSize = 1024 * 1024;
+  int mode;
+  int i;
+
+  benchPeer = socket(AF_INET, SOCK_DGRAM, 0);
+  M_TEST_ASSERT(benchPeer >= 0);
+  (void) setsockopt(benchPeer, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(C_BENCH_PORT);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  M_TEST_ASSERT(0 == bind(benchPeer, (struct sockaddr*) &addr, sizeof(addr)));
+  M_TEST_ASSERT(0 == pthread_create(&sink, NULL, benchSink, NULL));
+
+  /* Join at once, then measure with the default time model. */
+  EMU_WIFI_Configure(0, 0);
+  EMU_WIFI_ConfigureJoin(0, 0);
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_RegisterBusIO(&benchObj, EMU_WIFI_Init, EMU_WIFI_DeInit,
+                                                           EMU_WIFI_Delay, EMU_WIFI_SendData,
+                                                           EMU_WIFI_ReceiveData));
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_Init(&benchObj));
+  M_TEST_ASSERT(ES_WIFI_STATUS_OK == ES_WIFI_Connect(&benchObj, "lab", "secret", ES_WIFI_SEC_WPA2));
+  EMU_WIFI_Configure(ES_WIFI_EMU_SPI_CLOCK, ES_WIFI_EMU_LATENCY_US);
+
+  printf("SPI at %u Hz, %u us of module latency, %u datagrams per run\n", ES_WIFI_EMU_SPI_CLOCK,
+         ES_WIFI_EMU_LATENCY_US, C_BENCH_DATAGRAMS);
+  for (mode = BENCH_ONE_DESTINATION; mode <= BENCH_CONNECTED; mode++)
+  {
+    for (i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++)
+    {
+      benchRun((BENCH_Mode) mode, sizes[i]);
+    } /* for */
+  } /* for */
+
+  printf("ALL OK\n");
+  return 0;
+} /* main() */
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""Decodes the binary log records of src/device/binlog.c.
+
+The records hold the address of their format string and the raw arguments;
+the strings are read back from the ELF file that was flashed.
+
+Usage:
+  binlog_decode.py firmware.elf capture.txt   console capture, lines "#BL:..."
+  binlog_decode.py firmware.elf log.bin       SPIFFS log file, raw records
+  binlog_decode.py firmware.elf               reads stdin
+"""
+
+import base64
+import re
+import struct
+import sys
+
+INLINE = 0xFFFF0000     # C_BINLOG_INLINE
+STRING_MAX = 32         # C_BINLOG_STRING_MAX
+MAX_WORDS = 2 + 12 * (1 + STRING_MAX // 4)  # C_BINLOG_MAX_ARGS
+TICK_WRAP = 1 << 24
+
+CONVERSION = re.compile(
+    r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|z|j|t|L)?([diouxXcsp%])")
+
+
+class Elf:
+    """Loadable segments of an ELF file, enough to read strings by address."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF":
+            raise ValueError("%s is not an ELF file" % path)
+        is64 = data[4] == 2
+        order = "<" if data[5] == 1 else ">"
+        if is64:
+            phoff, = struct.unpack_from(order + "Q", data, 0x20)
+            phentsize, phnum = struct.unpack_from(order + "HH", data, 0x36)
+        else:
+            phoff, = struct.unpack_from(order + "I", data, 0x1C)
+            phentsize, phnum = struct.unpack_from(order + "HH", data, 0x2A)
+        self.segments = []
+        for i in range(phnum):
+            at = phoff + i * phentsize
+            if is64:
+                ptype, _, offset, vaddr, _, filesz = struct.unpack_from(
+                    order + "IIQQQQ", data, at)
+            else:
+                ptype, offset, vaddr, _, filesz = struct.unpack_from(
+                    order + "IIIII", data, at)
+            if ptype == 1 and filesz:  # PT_LOAD
+                self.segments.append((vaddr, data[offset:offset + filesz]))
+
+    def string(self, address):
+        for vaddr, content in self.segments:
+            if vaddr <= address < vaddr + len(content):
+                start = address - vaddr
+                end = content.find(b"\0", start)
+                if end < 0:
+                    end = len(content)
+                return content[start:end].decode("latin-1")
+        return None
+
+
+def format_record(elf, address, body):
+    fmt = elf.string(address)
+    if fmt is None:
+        return None
+    words = list(struct.unpack_from("<%dI" % (len(body) // 4), body))
+    position = [0]
+
+    def word():
+        if position[0] >= len(words):
+            raise ValueError("missing argument")
+        value = words[position[0]]
+        position[0] += 1
+        return value
+
+    def string(value):
+        if (value & 0xFFFF0000) == INLINE:
+            length = value & 0xFFFF
+            if length > STRING_MAX:
+                raise ValueError("bad inline string")
+            start = position[0] * 4
+            position[0] += (length + 3) // 4
+            return body[start:start + length].decode("latin-1")
+        text = elf.string(value)
+        return text if text is not None else "<0x%08x>" % value
+
+    def convert(match):
+        flags, width, precision, _, kind = match.groups()
+        if kind == "%":
+            return "%"
+        if width == "*":
+            width = str(struct.unpack("<i", struct.pack("<I", word()))[0])
+        if precision == "*":
+            precision = str(word())
+        spec = "%" + flags + (width or "") + ("." + precision if precision else "")
+        value = word()
+        if kind in "di":
+            return (spec + "d") % struct.unpack("<i", struct.pack("<I", value))[0]
+        if kind == "u":
+            return (spec + "d") % value
+        if kind == "c":
+            return (spec + "c") % chr(value & 0xFF)
+        if kind == "s":
+            return (spec + "s") % string(value)
+        if kind == "p":
+            return (spec + "s") % ("0x%08x" % value)
+        return (spec + kind) % value
+
+    try:
+        text = CONVERSION.sub(convert, fmt)
+    except ValueError:
+        return None
+    # Arguments left over, or missing: not a record.
+    if position[0] != len(words):
+        return None
+    return text
+
+
+def records(elf, stream):
+    """Decodes the byte stream: (tick, text) per record, None for lost bytes."""
+    at = 0
+    while at + 8 <= len(stream):
+        address, header = struct.unpack_from("<II", stream, at)
+        words = header >> 24
+        text = None
+        if 2 <= words <= MAX_WORDS and at + words * 4 <= len(stream):
+            text = format_record(elf, address, stream[at + 8:at + words * 4])
+        if text is None:
+            # A console line went missing: try again at the next word.
+            yield None
+            at += 4
+            continue
+        yield header & (TICK_WRAP - 1), text
+        at += words * 4
+
+
+def read_input(path):
+    data = sys.stdin.buffer.read() if path is None else open(path, "rb").read()
+    if b"#BL:" not in data:
+        return data
+    stream = bytearray()
+    for line in data.splitlines():
+        at = line.find(b"#BL:")
+        if at >= 0:
+            try:
+                stream += base64.b64decode(line[at + 4:].strip())
+            except ValueError:
+                pass
+    return bytes(stream)
+
+
+def main(argv):
+    if len(argv) not in (2, 3):
+        sys.stderr.write(__doc__)
+        return 2
+    elf = Elf(argv[1])
+    stream = read_input(argv[2] if len(argv) == 3 else None)
+    base = 0
+    last = None
+    lost = False
+    for record in records(elf, stream):
+        if record is None:
+            lost = True
+            continue
+        tick, text = record
+        if lost:
+            print("-- bytes lost --")
+            lost = False
+        if last is not None and tick < last:
+            base += TICK_WRAP
+        last = tick
+        print("[%10.3f] %s" % ((base + tick) / 1000.0, text.rstrip("\n")))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))